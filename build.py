@@ -611,8 +611,20 @@ def main():
         if changed or not os.path.exists(f"{CONFIG['outDir'][0]}/lng.elf"):
             print("> Linking source")
             linkDir(f"{CONFIG['outDir'][0]}/src", False, True, "lng")
+        # lng-opt links the compiler's objects with its own main instead of src/main.cc.
+        tools_changed: bool = buildDir("tools", False)
+        if changed or tools_changed or not os.path.exists(f"{CONFIG['outDir'][0]}/lng-opt.elf"):
+            print("> Linking lng-opt")
+            objects = glob.glob(f"{CONFIG['outDir'][0]}/src/**", recursive=True)
+            objects = [obj for obj in objects if os.path.isfile(obj) and checkExtension(obj, ["o", "bc"])]
+            objects = [obj for obj in objects if not os.path.basename(obj).startswith("main.cc.")]
+            linkDir(f"{CONFIG['outDir'][0]}/tools/lng-opt", False, True, "lng-opt", static_lib_files=objects)
         print("> Getting info")
         getInfo()
+    if "test" in sys.argv:
+        print("> Running tests")
+        if callCmd(f"python3 tests/run.py {CONFIG['outDir'][0]}", True)[0] != 0:
+            exit(1)
     currentUser = os.getlogin()
     callCmd(f"chown -R {currentUser}:{currentUser} ./")
 
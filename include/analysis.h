@@ -0,0 +1,144 @@
+#if !defined(_LANGUAGE_ANALYSIS_H_)
+#define _LANGUAGE_ANALYSIS_H_
+#include "ir.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace language {
+// Predecessor and successor lists derived from block terminators. Everything is indexed by
+// IrBlock::number, so the view has to be rebuilt once blocks or terminators change.
+class IrCFG {
+  public:
+    IrCFG(IrFunction* func);
+    IrFunction*            getFunction();
+    std::vector<IrBlock*>& getPredecessors(IrBlock* block);
+    std::vector<IrBlock*>& getSuccessors(IrBlock* block);
+    std::vector<IrBlock*>& getReversePostOrder();
+    std::vector<IrBlock*>& getExitBlocks();
+    bool                   isReachable(IrBlock* block);
+    size_t                 getRPOIndex(IrBlock* block);
+    size_t                 getBlockSlots();
+    IrBlock*               getBlock(size_t number);
+
+  private:
+    IrFunction*                        func;
+    std::vector<IrBlock*>              blocks;
+    std::vector<std::vector<IrBlock*>> preds;
+    std::vector<std::vector<IrBlock*>> succs;
+    std::vector<IrBlock*>              rpo;
+    std::vector<int64_t>               rpoIndex;
+    std::vector<IrBlock*>              exits;
+};
+// Dominator tree built with the Semi-NCA algorithm, which stays close to linear even on functions
+// with thousands of blocks. With `post` set the tree is built over the reversed CFG below a virtual
+// exit node that every returning block flows into; getIdom then yields nullptr for blocks that are
+// immediately post dominated by that virtual exit.
+class IrDominatorTree {
+  public:
+    IrDominatorTree(IrCFG* cfg, bool post);
+    IrBlock*               getIdom(IrBlock* block);
+    std::vector<IrBlock*>& getChildren(IrBlock* block);
+    std::vector<IrBlock*>& getRoots();
+    std::vector<IrBlock*>& getFrontier(IrBlock* block);
+    bool                   contains(IrBlock* block);
+    bool                   dominates(IrBlock* a, IrBlock* b);
+    bool                   dominates(IrInstruction* def, IrInstruction* user);
+    bool                   isPostDominatorTree();
+    // One line per block, indented by its depth in the tree and followed by its frontier.
+    void                   print();
+
+  private:
+    void                               computeFrontiers();
+    void                               printNode(IrBlock* block, size_t depth);
+    IrCFG*                             cfg;
+    bool                               post;
+    bool                               haveFrontiers;
+    std::vector<int64_t>               idom;
+    std::vector<std::vector<IrBlock*>> children;
+    std::vector<IrBlock*>              roots;
+    std::vector<std::vector<IrBlock*>> frontiers;
+    std::vector<uint32_t>              enter;
+    std::vector<uint32_t>              leave;
+};
+// Block level liveness of SSA values, solved backwards over the CFG with one bit per value number.
+// Phi operands count as uses at the end of the incoming block, so they are live out of that
+// predecessor but not live into the phi's own block.
+class IrLiveness {
+  public:
+    IrLiveness(IrCFG* cfg);
+    bool                  isLiveIn(IrBlock* block, IrValue* value);
+    bool                  isLiveOut(IrBlock* block, IrValue* value);
+    std::vector<IrValue*> getLiveIn(IrBlock* block);
+    std::vector<IrValue*> getLiveOut(IrBlock* block);
+
+  private:
+    std::vector<IrValue*>              collect(std::vector<uint64_t>& bits);
+    IrCFG*                             cfg;
+    size_t                             words;
+    std::vector<IrValue*>              values;
+    std::vector<std::vector<uint64_t>> liveIn;
+    std::vector<std::vector<uint64_t>> liveOut;
+};
+// A natural loop: a header that dominates the sources of its back edges, the latches, plus every
+// block that reaches a latch without passing the header. Blocks are in reverse post order, so the
+// header comes first.
+struct IrLoop {
+    IrBlock*              header;
+    IrLoop*               parent;
+    std::vector<IrLoop*>  children;
+    std::vector<IrBlock*> blocks;
+    std::vector<IrBlock*> latches;
+    uint32_t              depth;
+    std::vector<bool>     members;
+    bool                  contains(IrBlock* block);
+};
+// Natural loops of a function and how they nest. Loops sharing a header are one loop.
+class IrLoopInfo {
+  public:
+    IrLoopInfo(IrCFG* cfg, IrDominatorTree* domTree);
+    ~IrLoopInfo();
+    std::vector<IrLoop*>& getLoops();
+    std::vector<IrLoop*>& getTopLevelLoops();
+    IrLoop*               getLoopFor(IrBlock* block);
+    uint32_t              getLoopDepth(IrBlock* block);
+    IrBlock*              getPreheader(IrLoop* loop);
+    std::vector<IrBlock*> getOutsidePredecessors(IrLoop* loop);
+    std::vector<IrBlock*> getExitBlocks(IrLoop* loop);
+    // One line per loop with its header, depth, blocks and latches, inner loops indented below.
+    void                  print();
+
+  private:
+    void                 printLoop(IrLoop* loop, size_t indent);
+    IrCFG*               cfg;
+    std::vector<IrLoop*> loops;
+    std::vector<IrLoop*> topLevel;
+    std::vector<IrLoop*> innermost;
+};
+// Lazily computed analyses of one function. Nothing is tracked automatically: invalidate() drops
+// everything and has to follow any change to blocks or terminators, invalidateLiveness() is enough
+// when only instructions changed.
+class IrAnalysisCache {
+  public:
+    IrAnalysisCache(IrFunction* func);
+    ~IrAnalysisCache();
+    IrFunction*      getFunction();
+    IrCFG*           getCFG();
+    IrDominatorTree* getDominatorTree();
+    IrDominatorTree* getPostDominatorTree();
+    IrLiveness*      getLiveness();
+    IrLoopInfo*      getLoopInfo();
+    void             invalidate();
+    void             invalidateLiveness();
+
+  private:
+    IrFunction*      func;
+    IrCFG*           cfg;
+    IrDominatorTree* domTree;
+    IrDominatorTree* postDomTree;
+    IrLiveness*      liveness;
+    IrLoopInfo*      loopInfo;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_ANALYSIS_H_
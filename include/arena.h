@@ -0,0 +1,35 @@
+#if !defined(_LANGUAGE_ARENA_H_)
+#define _LANGUAGE_ARENA_H_
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace language {
+// Bump allocator backing all IR that belongs to one function. Objects placed in here are never
+// destructed individually, so anything allocated from it must be trivially destructible.
+class Arena {
+  public:
+    Arena(size_t chunkSize = 16384);
+    ~Arena();
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+    void*  allocate(size_t size, size_t align);
+    size_t getBytesUsed();
+    size_t getBytesReserved();
+    template <typename T, typename... Args> T* create(Args&&... args) {
+        return new (this->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+  private:
+    std::vector<char*> chunks;
+    char*              cursor;
+    char*              end;
+    size_t             chunkSize;
+    size_t             bytesUsed;
+    size_t             bytesReserved;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_ARENA_H_
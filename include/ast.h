@@ -33,12 +33,15 @@ enum struct AttributeType {
     Public,
     Private,
     NoMangle,
+    Inline,
+    NoInline,
 };
 class AttributeNode : public AstNode {
   public:
     AttributeNode(AttributeType type, AttributeData data);
     ~AttributeNode();
-    void print(size_t indent);
+    void          print(size_t indent);
+    AttributeType getType();
 
   private:
     AttributeType type;
@@ -68,6 +71,8 @@ enum struct StatementNodeType {
     Expression,
     Declaration,
     Return,
+    While,
+    For,
 };
 class StatementNode : public AstNode {
   public:
@@ -94,13 +99,46 @@ class IfStatementNode : public StatementNode {
     IfStatementNode(ExpressionNode* condition, StatementNode* trueBody,
                     std::optional<StatementNode*> falseBody);
     ~IfStatementNode();
-    void print(size_t indent);
+    void                          print(size_t indent);
+    ExpressionNode*               getCondition();
+    StatementNode*                getTrueBody();
+    std::optional<StatementNode*> getFalseBody();
 
   private:
     ExpressionNode*               condition;
     StatementNode*                trueBody;
     std::optional<StatementNode*> falseBody;
 };
+class WhileStatementNode : public StatementNode {
+  public:
+    WhileStatementNode(ExpressionNode* condition, StatementNode* body);
+    ~WhileStatementNode();
+    void            print(size_t indent);
+    ExpressionNode* getCondition();
+    StatementNode*  getBody();
+
+  private:
+    ExpressionNode* condition;
+    StatementNode*  body;
+};
+// `for (init; condition; step) body`, every part of the header may be left out.
+class ForStatementNode : public StatementNode {
+  public:
+    ForStatementNode(std::optional<StatementNode*> init, std::optional<ExpressionNode*> condition,
+                     std::optional<ExpressionNode*> step, StatementNode* body);
+    ~ForStatementNode();
+    void                           print(size_t indent);
+    std::optional<StatementNode*>  getInit();
+    std::optional<ExpressionNode*> getCondition();
+    std::optional<ExpressionNode*> getStep();
+    StatementNode*                 getBody();
+
+  private:
+    std::optional<StatementNode*>  init;
+    std::optional<ExpressionNode*> condition;
+    std::optional<ExpressionNode*> step;
+    StatementNode*                 body;
+};
 class CompoundStatementNode : public StatementNode {
   public:
     CompoundStatementNode(std::vector<StatementNode*> nodes);
@@ -115,7 +153,8 @@ class ExpressionStatementNode : public StatementNode {
   public:
     ExpressionStatementNode(ExpressionNode* expr);
     ~ExpressionStatementNode();
-    void print(size_t indent);
+    void            print(size_t indent);
+    ExpressionNode* getExpr();
 
   private:
     ExpressionNode* expr;
@@ -248,7 +287,9 @@ class UnaryExpressionNode : public ExpressionNode {
   public:
     UnaryExpressionNode(std::string unaryOp, ExpressionNode* expr);
     ~UnaryExpressionNode();
-    void print(size_t indent);
+    void            print(size_t indent);
+    std::string     getOperator();
+    ExpressionNode* getExpr();
 
   private:
     std::string     unaryOp;
@@ -272,7 +313,9 @@ class FunctionCallExpressionNode : public ExpressionNode {
   public:
     FunctionCallExpressionNode(ExpressionNode* callee, std::vector<ExpressionNode*> arguments);
     ~FunctionCallExpressionNode();
-    void print(size_t indent);
+    void                         print(size_t indent);
+    ExpressionNode*              getCallee();
+    std::vector<ExpressionNode*> getArguments();
 
   private:
     ExpressionNode*              callee;
@@ -311,7 +354,9 @@ class AssignmentExpressionNode : public ExpressionNode {
   public:
     AssignmentExpressionNode(ExpressionNode* assignee, ExpressionNode* value);
     ~AssignmentExpressionNode();
-    void print(size_t indent);
+    void            print(size_t indent);
+    ExpressionNode* getAssignee();
+    ExpressionNode* getValue();
 
   private:
     ExpressionNode* assignee;
@@ -0,0 +1,44 @@
+#if !defined(_LANGUAGE_CGEN_H_)
+#define _LANGUAGE_CGEN_H_
+#include "ir.h"
+
+#include <string>
+
+namespace language {
+// Self contained C11. Every SSA value is a local of an unsigned fixed width type declared at the
+// top of its function, so arithmetic wraps like in the IR and signedness only shows up in the
+// signed compares, signed division, `ashr` and `sext`, which cast to the signed type first. Blocks
+// are labels, branches are `goto`s.
+//
+// Each `phi` gets a second local that the incoming edges assign to before the jump and that is
+// copied into the phi at the top of its block, which keeps all phis of a block parallel. A
+// `reserve` is a local of its element type, used directly wherever the access has that type. The
+// source level `main` is the C entry point whether it is mangled or not.
+class CGen {
+  public:
+    CGen(IrModule* module);
+    ~CGen();
+    void        generate();
+    std::string getSource();
+
+  private:
+    void        emit(const char* format, ...);
+    void        emitObject(IrObject* obj);
+    void        emitPrototype(IrFunction* func);
+    void        emitFunction(IrFunction* func);
+    void        emitEntryPoint(IrFunction* func);
+    void        emitInstruction(IrInstruction* inst);
+    void        emitBinary(IrInstruction* inst);
+    void        emitMultiplyHigh(IrInstruction* inst);
+    void        emitCast(IrInstruction* inst);
+    void        emitCall(IrInstruction* inst);
+    void        emitEdge(IrBlock* pred, IrBlock* succ, int indent);
+    std::string getValue(IrOperand& operand);
+    std::string getAccess(IrOperand& pointer, IrType type);
+
+    IrModule*   module;
+    std::string source;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_CGEN_H_
@@ -0,0 +1,74 @@
+#if !defined(_LANGUAGE_ELFOBJECT_H_)
+#define _LANGUAGE_ELFOBJECT_H_
+#include "x86asm.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace language {
+// Symbols that are not in any section of the object.
+static constexpr int32_t ELF_UNDEFINED = -1;
+static constexpr int32_t ELF_ABSOLUTE  = -2;
+
+// `type` and `flags` are the SHT_ and SHF_ values, a SHT_NOBITS section has a size but no bytes.
+struct ElfSection {
+    std::string          name;
+    uint32_t             type;
+    uint64_t             flags;
+    uint64_t             alignment;
+    uint64_t             size;
+    std::vector<uint8_t> bytes;
+};
+// `section` indexes the object's sections or is one of ELF_UNDEFINED and ELF_ABSOLUTE, `binding`
+// and `type` are the STB_ and STT_ values.
+struct ElfSymbol {
+    std::string name;
+    int32_t     section;
+    uint64_t    value;
+    uint64_t    size;
+    uint8_t     binding;
+    uint8_t     type;
+    uint8_t     visibility;
+};
+// R_X86_64_ relocation of the field at `offset` in `section` against the object's `symbol`.
+struct ElfRelocation {
+    uint32_t section;
+    uint64_t offset;
+    uint32_t type;
+    uint32_t symbol;
+    int64_t  addend;
+};
+// Whether the file at `path` starts with the ELF magic.
+bool isElfFile(std::string path);
+// Relocatable x86-64 object, either made from the sections X86Assembler produced or read from an
+// ET_REL file such as libc's crt files. Symbol 0 is always the null symbol, so indices match the
+// ones of a `.symtab`. Malformed files are reported and exit.
+//
+// write() puts the section contents first, then one `.rela` section per section with relocations,
+// then `.symtab`, `.strtab` and `.shstrtab` and the section headers last. Branches are written as
+// R_X86_64_PLT32 and other rel32 fields as R_X86_64_PC32, so the object links with `ld` as well.
+class ElfObject {
+  public:
+    ElfObject(X86Assembler* assembler, std::string name);
+    ElfObject(std::string path);
+    std::string&                getName();
+    std::vector<ElfSection>&    getSections();
+    std::vector<ElfSymbol>&     getSymbols();
+    std::vector<ElfRelocation>& getRelocations();
+    // Defines the global `alias` at the same place as the defined symbol `target`.
+    void addAlias(std::string alias, std::string target);
+    void write(std::string path);
+
+  private:
+    void           fail();
+    const uint8_t* getBytes(const uint8_t* data, uint64_t size, uint64_t offset, uint64_t length);
+
+    std::string                name;
+    std::vector<ElfSection>    sections;
+    std::vector<ElfSymbol>     symbols;
+    std::vector<ElfRelocation> relocations;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_ELFOBJECT_H_
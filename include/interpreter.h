@@ -0,0 +1,134 @@
+#if !defined(_LANGUAGE_INTERPRETER_H_)
+#define _LANGUAGE_INTERPRETER_H_
+#include "ir.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+enum struct IrOpcode : uint32_t {
+    Reserve,
+    Load32,
+    Load64,
+    Store32,
+    Store64,
+    Move,
+    Trunc,
+    Sext,
+    Add32,
+    Add64,
+    Sub32,
+    Sub64,
+    Mul32,
+    Mul64,
+    Sdiv32,
+    Sdiv64,
+    Udiv,
+    Srem32,
+    Srem64,
+    Urem,
+    Smulh32,
+    Smulh64,
+    Umulh32,
+    Umulh64,
+    And,
+    Shl32,
+    Shl64,
+    Lshr32,
+    Lshr64,
+    Ashr32,
+    Ashr64,
+    Eq,
+    Ne,
+    Slt32,
+    Slt64,
+    Sle32,
+    Sle64,
+    Sgt32,
+    Sgt64,
+    Sge32,
+    Sge64,
+    Ult,
+    Ule,
+    Ugt,
+    Uge,
+    Call,
+    Return,
+    ReturnVoid,
+    Jump,
+    Branch,
+};
+// One decoded instruction. Operands are register numbers, `handler` is the address of the code
+// executing the opcode once the function has been threaded. Calls name their callee by index and
+// take `count` argument registers from IrDecodedFunction::arguments starting at `b`, branches
+// jump to the instruction index in `b` or `c`.
+struct IrBytecode {
+    const void* handler;
+    IrOpcode    opcode;
+    uint32_t    dst;
+    uint32_t    a;
+    uint32_t    b;
+    uint32_t    c;
+};
+struct IrDecodedFunction {
+    IrFunction*                     func;
+    std::vector<IrBytecode>         code;
+    // Initial register file, constants and global addresses are filled in once at decode time.
+    std::vector<uint64_t>           registers;
+    std::vector<uint32_t>           arguments;
+    std::vector<IrDecodedFunction*> callees;
+    uint32_t                        frameSize;
+    bool                            decoded;
+    bool                            threaded;
+};
+// Caller of a running function, `ip` is its call instruction and `registers` its frame.
+struct IrCallFrame {
+    IrDecodedFunction* function;
+    IrBytecode*        ip;
+    uint64_t*          registers;
+};
+// Called for functions without a body with the argument values, an i32 travels zero extended.
+using ExternalCallFn = uint64_t (*)(IrFunction* callee, uint64_t* args, size_t count,
+                                    void* userData);
+// Interpreter over the IR of a module. Functions are decoded on their first call into a compact
+// bytecode whose registers are the SSA numbers of the function followed by one register per
+// constant operand and one per phi. Every i32 is kept zero extended in its 64 bit register, so
+// only signed compares and `sext` need to know the width of their operands.
+//
+// A phi becomes a copy from its own register at the start of its block, the incoming edges write
+// that register before they jump, which keeps the phis of a block parallel. Dispatch is direct
+// threaded with computed goto. Frames live on a fixed stack, a `reserve` is a slot above the
+// registers of its frame, and globals are 8 byte cells owned by the interpreter. A call pushes its
+// caller onto `calls` and continues in the same execute() loop, so a deep recursion uses no host
+// stack and ends with a diagnostic once either stack is full.
+//
+// Calls to functions without a body go to the external call shim, which defaults to calling the
+// symbol dlsym finds in the running process.
+class IrInterpreter {
+  public:
+    IrInterpreter(IrModule* module);
+    ~IrInterpreter();
+    void     setExternalCall(ExternalCallFn fn, void* userData);
+    uint64_t call(IrFunction* func, std::vector<uint64_t> args);
+    int      run();
+
+  private:
+    IrDecodedFunction* getDecoded(IrFunction* func);
+    void               decode(IrDecodedFunction* function);
+    uint64_t           execute(IrDecodedFunction* function, uint64_t* frame);
+    uint64_t*          enter(IrDecodedFunction* function, uint64_t* frame);
+    uint32_t           getRegister(IrDecodedFunction* function, IrOperand& operand);
+
+    IrModule*                                           module;
+    std::unordered_map<IrFunction*, IrDecodedFunction*> functions;
+    std::unordered_map<IrObject*, uint64_t*>            globalAddresses;
+    std::vector<uint64_t>                               globals;
+    std::vector<uint64_t>                               stack;
+    std::vector<IrCallFrame>                            calls;
+    ExternalCallFn                                      externalCall;
+    void*                                               externalUserData;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_INTERPRETER_H_
@@ -0,0 +1,327 @@
+#if !defined(_LANGUAGE_IR_H_)
+#define _LANGUAGE_IR_H_
+#include "arena.h"
+
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+enum struct IrTypeType : uint8_t {
+    I32,
+    I64,
+    Void,
+    String,
+    Variable,
+    Variadic,
+    Pointer,
+    Label,
+    Custom,
+};
+struct IrType {
+    IrTypeType  type;
+    const char* getName();
+    void        print();
+    bool        operator==(const IrType& other) const {
+        return this->type == other.type;
+    }
+};
+enum struct IrOperandType : uint8_t {
+    Const,
+    Type,
+    SSA,
+    Global,
+    Label,
+    Function,
+};
+struct IrObject;
+struct IrValue;
+struct IrInstruction;
+struct IrBlock;
+struct IrFunction;
+// Operands are 16 byte tagged values that live inline behind their instruction.
+struct IrOperand {
+    IrOperandType type;
+    IrType        irType;
+    union {
+        int64_t     constant;
+        IrValue*    value;
+        IrBlock*    block;
+        IrObject*   object;
+        IrFunction* function;
+    };
+    void print();
+};
+static_assert(sizeof(IrOperand) == 16, "IrOperand must stay 16 bytes");
+IrOperand createSSAOperand(IrValue* value);
+IrOperand createConstOperand(IrType type, int64_t value);
+IrOperand createTypeOperand(IrType type);
+IrOperand createGlobalOperand(IrObject* object, IrType type);
+IrOperand createLabelOperand(IrBlock* block);
+IrOperand createFunctionOperand(IrFunction* function);
+// Intrusive doubly linked list over nodes that carry their own `prev`/`next` pointers. Nodes are
+// never copied or moved, so a pointer to one stays a valid handle until it is removed. Iterators
+// remember the following node, which makes removing the current node while iterating safe.
+template <typename T> class IrList {
+  public:
+    class iterator {
+      public:
+        iterator(T* _node) {
+            this->node = _node;
+            this->next = _node ? _node->next : nullptr;
+        }
+        T* operator*() {
+            return this->node;
+        }
+        iterator& operator++() {
+            this->node = this->next;
+            this->next = this->node ? this->node->next : nullptr;
+            return *this;
+        }
+        bool operator!=(const iterator& other) const {
+            return this->node != other.node;
+        }
+
+      private:
+        T* node;
+        T* next;
+    };
+    iterator begin() {
+        return iterator(this->head);
+    }
+    iterator end() {
+        return iterator(nullptr);
+    }
+    T* front() {
+        return this->head;
+    }
+    T* back() {
+        return this->tail;
+    }
+    bool empty() {
+        return this->head == nullptr;
+    }
+    size_t size() {
+        return this->count;
+    }
+    void pushBack(T* node) {
+        this->insertBefore(nullptr, node);
+    }
+    void pushFront(T* node) {
+        this->insertBefore(this->head, node);
+    }
+    // Inserts `node` in front of `pos`, or at the end when `pos` is null.
+    void insertBefore(T* pos, T* node) {
+        node->next = pos;
+        node->prev = pos ? pos->prev : this->tail;
+        if (node->prev) {
+            node->prev->next = node;
+        } else {
+            this->head = node;
+        }
+        if (pos) {
+            pos->prev = node;
+        } else {
+            this->tail = node;
+        }
+        this->count++;
+    }
+    void insertAfter(T* pos, T* node) {
+        this->insertBefore(pos ? pos->next : this->head, node);
+    }
+    void remove(T* node) {
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            this->head = node->next;
+        }
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            this->tail = node->prev;
+        }
+        node->prev = nullptr;
+        node->next = nullptr;
+        this->count--;
+    }
+
+  private:
+    T*     head  = nullptr;
+    T*     tail  = nullptr;
+    size_t count = 0;
+};
+enum struct IrInstructionType : uint8_t {
+    Reserve,
+    Store,
+    Load,
+
+    Trunc,
+    Sext,
+    Zext,
+
+    Const,
+
+    Add,
+    Sub,
+    Mul,
+    // Division truncates toward zero and the remainder takes the sign of the dividend. Dividing by
+    // zero or the smallest signed value by -1 is undefined.
+    Sdiv,
+    Udiv,
+    Srem,
+    Urem,
+    // High half of the double width product.
+    Smulh,
+    Umulh,
+    And,
+    // The shift amount is taken modulo the bit width.
+    Shl,
+    Lshr,
+    Ashr,
+
+    // Comparisons produce an i32 that is 0 or 1.
+    Eq,
+    Ne,
+    Slt,
+    Sle,
+    Sgt,
+    Sge,
+    Ult,
+    Ule,
+    Ugt,
+    Uge,
+
+    Phi,
+
+    Call,
+
+    Return,
+    Br,
+    CondBr,
+};
+// One SSA operand of `user` referring to `value`. Uses of the same value form an intrusive doubly
+// linked list headed at IrValue::firstUse.
+struct IrUse {
+    IrValue*       value;
+    IrInstruction* user;
+    IrUse*         prevUse;
+    IrUse*         nextUse;
+    size_t         getOperandIndex();
+};
+enum struct IrValueKind : uint8_t {
+    Argument,
+    Instruction,
+};
+struct IrValue {
+    IrValueKind kind;
+    IrType      valueType;
+    uint32_t    number;
+    IrUse*      firstUse;
+    void        addUse(IrUse* use);
+    void        removeUse(IrUse* use);
+    void        replaceAllUsesWith(IrValue* other);
+    void        replaceAllUsesWith(IrOperand operand);
+    bool        hasUses();
+    size_t      getNumUses();
+};
+struct IrArgument : public IrValue {
+    uint32_t index;
+};
+// Instructions are allocated from their function's arena with the operand array and the matching
+// use array placed directly after the instruction header, so an instruction, its operands and its
+// use list nodes are one contiguous allocation. Operand `i` owns use node `i`.
+struct IrInstruction : public IrValue {
+    IrInstructionType type;
+    uint8_t           numOperands;
+    bool              hasResult;
+    IrBlock*          parent;
+    IrInstruction*    prev;
+    IrInstruction*    next;
+    IrOperand*        getOperands() {
+        return reinterpret_cast<IrOperand*>(this + 1);
+    }
+    IrOperand& getOperand(size_t index) {
+        return this->getOperands()[index];
+    }
+    IrUse* getUses() {
+        return reinterpret_cast<IrUse*>(this->getOperands() + this->numOperands);
+    }
+    IrValue* getOperandValue(size_t index);
+    void     setOperand(size_t index, IrOperand operand);
+    void     setOperandValue(size_t index, IrValue* value);
+    void     dropOperands();
+    bool     isTerminator();
+    bool     isComparison();
+    void     replaceSuccessor(IrBlock* from, IrBlock* to);
+    bool     hasSideEffects();
+    void     removeFromParent();
+    void     eraseFromParent();
+    void     print(size_t indent);
+};
+// Type of the value `inst` computes from its opcode and the types of its operands.
+IrType      getResultType(IrInstruction* inst);
+std::string irInstructionTypeToString(IrInstructionType type);
+static_assert(sizeof(IrInstruction) % alignof(IrOperand) == 0,
+              "Inline operands must be aligned after the instruction header");
+static_assert(sizeof(IrOperand) % alignof(IrUse) == 0,
+              "Use nodes must be aligned after the operand array");
+struct IrBlock {
+    uint32_t              number;
+    IrFunction*           parent;
+    IrBlock*              prev;
+    IrBlock*              next;
+    IrList<IrInstruction> insts;
+    void                  append(IrInstruction* inst);
+    void                  insertBefore(IrInstruction* pos, IrInstruction* inst);
+    void                  remove(IrInstruction* inst);
+    IrInstruction*        getTerminator();
+    std::vector<IrBlock*> getSuccessors();
+    void                  removePredecessor(IrBlock* pred);
+    void                  replacePredecessor(IrBlock* from, IrBlock* to);
+    void                  addPredecessor(IrBlock* pred, IrBlock* like);
+    void                  print(size_t indent);
+};
+// The first block of `blocks` is the entry block; IrGen places every `reserve` there. The inline
+// flags come from `@attrib(inline)` and `@attrib(noinline)`, `noMangle` from `@attrib(no_mangle)`.
+struct IrFunction {
+    std::string                               name;
+    IrType                                    returnType;
+    std::vector<IrArgument*>                  arguments;
+    bool                                      alwaysInline = false;
+    bool                                      noInline     = false;
+    bool                                      noMangle     = false;
+    std::unordered_map<std::string, IrValue*> nameToValue;
+    IrList<IrBlock>                           blocks;
+    uint32_t                                  nextValueNumber = 0;
+    uint32_t                                  nextBlockNumber = 0;
+    Arena                                     arena;
+    IrArgument*                               createArgument(IrType type);
+    IrInstruction* createInstruction(IrInstructionType type, bool hasResult, size_t numOperands);
+    IrInstruction* createInstruction(IrInstructionType type, bool hasResult,
+                                     std::initializer_list<IrOperand> operands);
+    IrBlock*       createBlock();
+    IrBlock*       getEntryBlock();
+    void           eraseBlock(IrBlock* block);
+    size_t         getInstructionCount();
+    std::string    getSymbolName();
+    void           print(size_t indent);
+};
+struct IrObject {
+    std::string name;
+    IrOperand   value;
+    IrType      type;
+    bool        noMangle = false;
+    std::string getSymbolName();
+    void        print(size_t indent);
+};
+struct IrModule {
+    std::vector<IrFunction*> functions;
+    std::vector<IrObject*>   objects;
+    void                     print();
+};
+}; // namespace language
+
+#endif // _LANGUAGE_IR_H_
@@ -0,0 +1,35 @@
+#if !defined(_LANGUAGE_IRBUILDER_H_)
+#define _LANGUAGE_IRBUILDER_H_
+#include "ir.h"
+
+namespace language {
+// Creates instructions in a function and places them at the insertion point: either at the end of a
+// block or directly in front of an existing instruction.
+class IrBuilder {
+  public:
+    IrBuilder(IrFunction* func);
+    void           setInsertPoint(IrBlock* block);
+    void           setInsertPoint(IrInstruction* before);
+    IrBlock*       getInsertBlock();
+    IrFunction*    getFunction();
+    IrInstruction* insert(IrInstruction* inst);
+    IrBlock*       createBlock();
+    IrInstruction* createReserve(IrType type);
+    IrInstruction* createStore(IrOperand pointer, IrValue* value);
+    IrInstruction* createLoad(IrOperand pointer, IrType type);
+    IrInstruction* createCast(IrInstructionType type, IrValue* value, IrType destType);
+    IrInstruction* createConst(IrType type, int64_t value);
+    IrInstruction* createBinary(IrInstructionType type, IrValue* lhs, IrValue* rhs);
+    IrInstruction* createCall(IrFunction* callee, const std::vector<IrValue*>& args);
+    IrInstruction* createReturn(IrValue* value);
+    IrInstruction* createBr(IrBlock* target);
+    IrInstruction* createCondBr(IrValue* condition, IrBlock* ifTrue, IrBlock* ifFalse);
+
+  private:
+    IrFunction*    func;
+    IrBlock*       block;
+    IrInstruction* before;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_IRBUILDER_H_
@@ -0,0 +1,96 @@
+#if !defined(_LANGUAGE_IRFILE_H_)
+#define _LANGUAGE_IRFILE_H_
+#include "ir.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+static constexpr uint32_t IR_FILE_MAGIC   = 0x52494C4E; // "NLIR"
+static constexpr uint32_t IR_FILE_VERSION = 2;
+
+// Fixed header at offset 0, every offset is from the start of the file. All integers are little
+// endian.
+struct IrFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t typesOffset;
+    uint64_t typeCount;
+    uint64_t objectsOffset;
+    uint64_t objectCount;
+    uint64_t functionsOffset;
+    uint64_t functionCount;
+};
+static_assert(sizeof(IrFileHeader) == 72, "IrFileHeader is part of the file format");
+// Whether the file at `path` starts with the IR file magic.
+bool isIrFile(std::string path);
+// Binary form of an IrModule. Past the header the file holds a string table of length prefixed
+// strings named by their offset, a table of the IrTypeType values used by the module, the objects,
+// and the function index with one signature per function and the offset and size of its body.
+// Everything but the header is LEB128 varints, constants are zigzag encoded.
+//
+// A body lists its blocks and their instructions. An operand names its value by SSA number, its
+// block by position, its object or callee by index and its type by type table index. Value and
+// block numbers are kept, so a module reads back exactly as it was written.
+class IrWriter {
+  public:
+    IrWriter(IrModule* module);
+    void write(std::string path);
+
+  private:
+    void     writeVarint(std::vector<uint8_t>& out, uint64_t value);
+    void     writeOperand(std::vector<uint8_t>& out, IrOperand& operand,
+                          std::unordered_map<IrBlock*, uint32_t>& blocks);
+    void     writeBody(std::vector<uint8_t>& out, IrFunction* func);
+    uint32_t getString(std::string string);
+    uint32_t getType(IrType type);
+
+    IrModule*                                 module;
+    std::vector<uint8_t>                      strings;
+    std::unordered_map<std::string, uint32_t> stringOffsets;
+    std::vector<uint8_t>                      types;
+    std::unordered_map<IrObject*, uint32_t>   objectIndex;
+    std::unordered_map<IrFunction*, uint32_t> functionIndex;
+};
+// Bytes of a table or body still to be read.
+struct IrFileCursor {
+    const uint8_t* position;
+    const uint8_t* end;
+};
+// Maps an IR file and reads its objects and function index up front. Bodies stay in the mapping
+// until materialize() decodes them, before that a function looks like a declaration. Malformed
+// files are reported and exit, they never produce a partial module.
+class IrReader {
+  public:
+    IrReader(std::string path);
+    ~IrReader();
+    IrModule*   getModule();
+    IrFunction* getFunction(std::string name);
+    bool        isMaterialized(IrFunction* func);
+    void        materialize(IrFunction* func);
+    void        materializeAll();
+
+  private:
+    void           fail();
+    const uint8_t* getSection(uint64_t offset, uint64_t length);
+    uint8_t        readByte(IrFileCursor& cursor);
+    uint64_t       readVarint(IrFileCursor& cursor);
+    IrType         readType(IrFileCursor& cursor);
+    std::string    readString(IrFileCursor& cursor);
+    IrOperand      readOperand(IrFileCursor& cursor, std::vector<IrBlock*>& blocks);
+
+    std::string                                                    path;
+    uint8_t*                                                       data;
+    size_t                                                         size;
+    IrFileHeader                                                   header;
+    IrModule*                                                      module;
+    std::vector<IrTypeType>                                        types;
+    std::unordered_map<IrFunction*, std::pair<uint64_t, uint64_t>> bodies;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_IRFILE_H_
@@ -1,7 +1,10 @@
 #if !defined(_LANGUAGE_IRGEN_H_)
 #define _LANGUAGE_IRGEN_H_
 #include "ast.h"
+#include "ir.h"
+#include "irbuilder.h"
 #include "sema.h"
+#include "threadpool.h"
 
 #include <cstdint>
 #include <string>
@@ -9,111 +12,60 @@
 #include <vector>
 
 namespace language {
-enum struct IrTypeType {
-    I32,
-    I64,
-    Void,
-    String,
-    Variable,
-    Variadic,
-    Pointer,
-    Label,
-    Custom,
+// Module level names, filled in before any function body is lowered and only read afterwards, so
+// every function can be lowered on its own thread.
+struct IrGenGlobals {
+    std::unordered_map<std::string, IrObject*>   objects;
+    std::unordered_map<std::string, IrFunction*> functions;
+    // Source level types of every global and function, the IR types have no signedness.
+    std::unordered_map<std::string, TypeSpec*> types;
 };
-struct IrType {
-    IrTypeType  type;
-    std::string name;
-    void        print();
-};
-enum struct IrOperandType {
-    ConstI32,
-    ConstI64,
-    Type,
-    SSA,
-    Name,
-    Label,
-};
-struct IrOperand {
-    IrOperandType type;
-    IrType*       irType;
-    uint32_t      constU32;
-    int32_t       constI32;
-    uint64_t      constU64;
-    int64_t       constI64;
-    size_t        ssaResult;
-    std::string   name;
-    void          print();
-};
-enum struct IrInstructionType {
-    Reserve,
-    Store,
-    Load,
-
-    Trunc,
-    Sext,
-    Zext,
+// Lowers the body of one function. Everything that changes while lowering lives here or in the
+// function itself.
+class IrFunctionGen {
+  public:
+    IrFunctionGen(const IrGenGlobals* globals, IrFunction* func);
+    ~IrFunctionGen();
+    void generate(FunctionDeclarationNode* node);
 
-    Const,
+  private:
+    TypeSpec*      getNameType(std::string name);
+    TypeSpec*      convertExpressionToType(ExpressionNode* node);
+    void           constructFuncArgs(std::vector<DeclarationNode*> nodes);
+    IrOperand      generateOperand(ExpressionNode* expr);
+    IrValue*       generateExpr(ExpressionNode* node);
+    IrInstruction* generateReserve(IrType type);
+    void           emitBlock(IrBlock* block);
+    void           generateIfStatement(IfStatementNode* node);
+    void           generateWhileStatement(WhileStatementNode* node);
+    void           generateForStatement(ForStatementNode* node);
+    void           generateStatement(StatementNode* node);
+    void           generateCompoundBlocks(CompoundStatementNode* node);
+    void           generateBlocks(StatementNode* node);
 
-    Add,
-    Mul,
+    const IrGenGlobals* globals;
+    IrFunction*         func;
+    IrBuilder*          builder;
 
-    Return,
-    Br,
-};
-struct IrInstruction {
-    std::optional<size_t>   result;
-    IrInstructionType       type;
-    std::vector<IrOperand*> operands;
-    void                    print(size_t indent);
-};
-struct IrBlock {
-    std::string                 name;
-    std::vector<IrInstruction*> insts;
-    void                        print(size_t indent);
-};
-struct IrFunction {
-    std::string                             name;
-    IrType*                                 returnType;
-    std::vector<std::pair<IrType*, size_t>> arguments;
-    std::unordered_map<std::string, size_t> nameToSSANumber;
-    std::vector<IrInstruction*>             entryInsts;
-    std::vector<IrBlock*>                   blocks;
-    void                                    print(size_t indent);
-};
-struct IrObject {
-    std::string name;
-    IrOperand*  value;
-    IrType*     type;
-    void        print(size_t indent);
-};
-struct IrModule {
-    std::vector<IrFunction*> functions;
-    std::vector<IrObject*>   objects;
-    void                     print();
+    // Source level types of the parameters and locals, they shadow the globals.
+    std::unordered_map<std::string, TypeSpec*> nameToType;
 };
+// Objects and function declarations are created in source order first, then the function bodies
+// are lowered in parallel. Each body only writes to its own function, so the module comes out the
+// same whatever the number of threads.
 class IrGen {
   public:
     IrGen(Ast* ast);
-    ~IrGen();
     void      generate();
     IrModule* getModule();
 
   private:
-    IrObject*                            emitTopVariableDecl(VariableDeclarationNode* node);
-    IrFunction*                          emitTopFunctionDecl(FunctionDeclarationNode* node);
-    std::variant<IrFunction*, IrObject*> emitTopDeclaration(DeclarationNode* node);
-    std::variant<IrFunction*, IrObject*> emitNode(AstNode* node);
-    std::pair<std::vector<std::pair<IrType*, size_t>>, std::unordered_map<std::string, size_t>>
-                                constructFuncArgs(std::vector<DeclarationNode*> nodes);
-    IrType*                     generateType(TypeSpec* type);
-    IrOperand*                  generateOperand(ExpressionNode* expr);
-    std::vector<IrInstruction*> genInstsFromExpr(ExpressionNode* node);
-    std::vector<IrBlock*>       generateCompoundBlocks(CompoundStatementNode* node);
-    std::vector<IrBlock*>       generateBlocks(StatementNode* node);
-    Ast*                        inAst;
-    IrModule*                   outModule;
-    IrFunction*                 currentFunc;
+    IrObject*   emitTopVariableDecl(VariableDeclarationNode* node);
+    IrFunction* declareFunction(FunctionDeclarationNode* node);
+
+    Ast*         inAst;
+    IrModule*    outModule;
+    IrGenGlobals globals;
 };
 }; // namespace language
 
@@ -0,0 +1,60 @@
+#if !defined(_LANGUAGE_IRPARSER_H_)
+#define _LANGUAGE_IRPARSER_H_
+#include "ir.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+// SSA operand waiting for its value, phis may name values defined further down.
+struct IrPendingOperand {
+    IrInstruction* inst;
+    size_t         index;
+    uint32_t       number;
+    size_t         line;
+};
+// Parser for the text IrModule::print writes, one item per line. Objects and function signatures
+// are read in a first pass so that values and calls can name them before their definition, the
+// bodies in a second. Value and block numbers are kept as written. Every function is checked with
+// IrVerifier once it is read. Errors report the line and exit.
+class IrParser {
+  public:
+    IrParser(std::string source);
+    IrModule* getModule();
+
+  private:
+    void        declareObject(size_t line);
+    size_t      declareFunction(size_t line);
+    void        parseObject(IrObject* obj, size_t line);
+    void        parseFunction(IrFunction* func, size_t line);
+    void        parseInstruction(IrBlock* block);
+    IrOperand   parseOperand(bool callee, bool& isPending, uint32_t& number);
+    IrType      parseType();
+    IrBlock*    getBlock(std::string token);
+    uint32_t    parseNumber(std::string token, size_t prefix);
+    void        tokenize(size_t line);
+    std::string peek();
+    std::string next();
+    bool        accept(std::string token);
+    void        expect(std::string token);
+    void        fail(std::string message);
+
+    std::vector<std::string>                     lines;
+    std::vector<std::string>                     tokens;
+    size_t                                       tokenIndex;
+    size_t                                       lineIndex;
+    IrModule*                                    module;
+    std::unordered_map<std::string, IrObject*>   objects;
+    std::unordered_map<std::string, IrFunction*> functions;
+    IrFunction*                                  func;
+    std::unordered_map<uint32_t, IrValue*>       values;
+    std::unordered_map<uint32_t, IrBlock*>       blocks;
+    std::unordered_map<IrBlock*, bool>           defined;
+    std::vector<IrPendingOperand>                pending;
+    std::unordered_map<IrBlock*, size_t>         blockLines;
+    std::unordered_map<IrInstruction*, size_t>   instructionLines;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_IRPARSER_H_
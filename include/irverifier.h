@@ -0,0 +1,40 @@
+#if !defined(_LANGUAGE_IRVERIFIER_H_)
+#define _LANGUAGE_IRVERIFIER_H_
+#include "analysis.h"
+#include "ir.h"
+
+#include <string>
+
+namespace language {
+// Checks the shape the passes and back ends take for granted: every opcode has the operands it
+// needs, a call passes as many arguments as its callee takes, every block ends in its only
+// terminator, phis come first and have one incoming value per predecessor, operand types agree,
+// and every definition dominates its uses. Uses in unreachable blocks are not checked.
+//
+// Only the first problem is kept, getBlock() and getInstruction() say where it is. The instruction
+// is null for problems of a whole block.
+class IrVerifier {
+  public:
+    IrVerifier(IrFunction* _func);
+    bool           verify();
+    // Only the operands and the result of `inst`, which is enough to compute its result type.
+    bool           verifyInstruction(IrInstruction* inst);
+    IrBlock*       getBlock();
+    IrInstruction* getInstruction();
+    std::string    getMessage();
+
+  private:
+    bool verifyBlock(IrBlock* block);
+    bool verifyTypes(IrInstruction* inst);
+    bool verifyPhi(IrInstruction* phi, IrCFG* cfg);
+    bool verifyUses(IrInstruction* inst, IrDominatorTree* domTree);
+    bool fail(IrBlock* block, IrInstruction* inst, std::string reason);
+
+    IrFunction*    func;
+    IrBlock*       errorBlock;
+    IrInstruction* errorInst;
+    std::string    message;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_IRVERIFIER_H_
@@ -0,0 +1,39 @@
+#if !defined(_LANGUAGE_JIT_H_)
+#define _LANGUAGE_JIT_H_
+#include "ir.h"
+#include "passmanager.h"
+#include "x86asm.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace language {
+// Runs a module in process. X86Gen output is assembled by X86Assembler and linked into a single
+// anonymous mapping, code first, then one stub per external function, then the data. The mapping
+// is writable while it is filled and the code pages are flipped to read and execute before
+// anything runs, no page is ever writable and executable at once.
+//
+// External functions are looked up with dlsym in the symbols the compiler itself was linked
+// against. They are called through a stub holding the absolute address, so they need not be
+// within reach of a rel32. Every function is listed in /tmp/perf-<pid>.map for `perf`.
+class Jit {
+  public:
+    Jit(PassManager* passManager);
+    ~Jit();
+    void  compile();
+    void* getSymbolAddress(std::string name);
+    int   run();
+
+  private:
+    void writePerfMap(X86Assembler* assembler);
+
+    PassManager*                           passManager;
+    IrModule*                              module;
+    uint8_t*                               memory;
+    size_t                                 memorySize;
+    std::unordered_map<std::string, void*> addresses;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_JIT_H_
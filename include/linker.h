@@ -0,0 +1,97 @@
+#if !defined(_LANGUAGE_LINKER_H_)
+#define _LANGUAGE_LINKER_H_
+#include "elfobject.h"
+
+#include <cstdint>
+#include <elf.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+// Path of `name` in the directories libc's start files and libraries are installed in.
+std::string findLibraryFile(std::string name);
+
+// The definition a global symbol resolved to. `object` is -1 for symbols that come from a
+// shared library, that the linker defines itself or that stay undefined weak references.
+struct LinkerSymbol {
+    int32_t  object;
+    uint32_t index;
+    bool     weak;
+    bool     referenced;
+    bool     imported;
+    uint64_t address;
+    int64_t  dynamicIndex;
+    int64_t  gotIndex;
+    int64_t  pltIndex;
+};
+// Input section placed in an output section.
+struct LinkerInput {
+    uint32_t object;
+    uint32_t section;
+};
+// Output sections made of input sections have `inputs`, the ones the linker writes itself have
+// `bytes`.
+struct LinkerOutputSection {
+    std::string              name;
+    uint32_t                 type;
+    uint64_t                 flags;
+    uint64_t                 alignment;
+    uint64_t                 address;
+    uint64_t                 size;
+    std::vector<LinkerInput> inputs;
+    std::vector<uint8_t>     bytes;
+};
+// Links relocatable objects into a non-PIE x86-64 executable without `ld`. The objects are put
+// between libc's crt1.o and crti.o in front and crtn.o behind, and libc.so.6 is the only shared
+// library, so `_start` runs and calls `main` as it does in a program `cc` linked.
+//
+// Only sections reachable from `_start` and the init and fini code through relocations are kept,
+// the `.text.<symbol>` and `.data.<symbol>` sections X86Gen emits make that per function and per
+// object. Debug information and `.eh_frame` are dropped. Functions of libc are called through a
+// PLT of `jmp [rip + GOT]` stubs, the dynamic loader fills the GOT before `_start` runs.
+//
+// The image is laid out in three segments, each starting on its own page: the read only one with
+// the headers, the dynamic tables and constants, the code, and the writable data with `.bss` at
+// its end.
+class Linker {
+  public:
+    Linker();
+    void addObject(ElfObject* object);
+    void link(std::string path);
+
+  private:
+    void                   addLibrary(std::string path);
+    void                   resolveSymbols();
+    void                   markSection(uint32_t object, uint32_t section);
+    void                   collectGarbage();
+    void                   resolveReferences();
+    void                   createOutputSections();
+    void                   layout();
+    void                   createDynamicSections();
+    void                   applyRelocations(std::vector<uint8_t>& image);
+    void                   writeImage(std::string path);
+    LinkerSymbol*          getGlobal(uint32_t object, uint32_t index);
+    uint64_t               getSymbolAddress(uint32_t object, uint32_t index);
+    LinkerOutputSection*   getOutputSection(std::string name);
+    std::vector<Elf64_Dyn> getDynamicEntries();
+
+    std::vector<ElfObject*>                       objects;
+    std::vector<std::vector<std::vector<size_t>>> sectionRelocations;
+    std::vector<std::vector<bool>>                live;
+    std::vector<std::vector<uint64_t>>            addresses;
+    std::unordered_map<std::string, LinkerSymbol> globals;
+    std::string                                   library;
+    std::unordered_map<std::string, uint8_t>      exports;
+    std::vector<std::string>                      imports;
+    std::vector<std::string>                      gotEntries;
+    std::vector<std::string>                      pltEntries;
+    std::vector<LinkerOutputSection>              sections;
+    uint64_t                                      segmentStarts[3];
+    uint64_t                                      segmentEnds[3];
+    uint64_t                                      segmentFileEnds[3];
+    uint64_t                                      fileSize;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_LINKER_H_
@@ -0,0 +1,45 @@
+#if !defined(_LANGUAGE_LLVMGEN_H_)
+#define _LANGUAGE_LLVMGEN_H_
+#include "ir.h"
+
+#include <cstdint>
+#include <string>
+
+namespace language {
+// Textual LLVM IR. `reserve` becomes an `alloca`, everything else maps onto the LLVM instruction
+// of the same name, the signedness already lives in the opcodes. `const` has no counterpart, its
+// value is printed in place at every use. Compares produce an i1 that is widened to the i32 the IR
+// expects, `opt` folds that pair into the branch again.
+//
+// Pointers are typed, `i8*` unless the pointee is known, which keeps the output readable by LLVM
+// versions from before opaque pointers. Symbols with `@attrib(no_mangle)` are external, the
+// mangled ones cannot be named from outside the module and are internal. A mangled `main` is
+// called from an external `@main` so the module runs under `lli` and links with the C start files.
+class LlvmGen {
+  public:
+    LlvmGen(IrModule* module);
+    ~LlvmGen();
+    void        generate();
+    std::string getAssembly();
+
+  private:
+    void        emit(const char* format, ...);
+    void        emitObject(IrObject* obj);
+    void        emitDeclaration(IrFunction* func);
+    void        emitFunction(IrFunction* func);
+    void        emitEntryPoint(IrFunction* func);
+    void        emitInstruction(IrInstruction* inst);
+    void        emitCast(IrInstruction* inst);
+    void        emitShift(IrInstruction* inst);
+    void        emitMultiplyHigh(IrInstruction* inst);
+    void        emitCall(IrInstruction* inst);
+    std::string getValue(IrOperand& operand);
+    std::string getPointer(IrOperand& pointer, IrType type);
+
+    IrModule*   module;
+    std::string assembly;
+    uint32_t    temporaryCount;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_LLVMGEN_H_
@@ -20,6 +20,8 @@ class Parser {
     StatementNode*                parseReturnStatement();
     StatementNode*                parseCompoundStatement();
     StatementNode*                parseIfStatement();
+    StatementNode*                parseWhileStatement();
+    StatementNode*                parseForStatement();
     std::vector<DeclarationNode*> parseDecl();
     std::vector<DeclarationNode*> parseImportDecl();
     DeclarationNode*              parseFuncDecl();
@@ -0,0 +1,47 @@
+#if !defined(_LANGUAGE_PASSES_H_)
+#define _LANGUAGE_PASSES_H_
+#include "analysis.h"
+#include "ir.h"
+#include "passmanager.h"
+
+namespace language {
+// Promotes every non-escaping `reserve` slot of the function to SSA values and inserts phis at the
+// dominance frontiers of the blocks that store to it. Returns whether anything changed.
+bool promoteMemoryToRegisters(IrFunction* func, IrAnalysisCache* analyses);
+// Sparse conditional constant propagation. Values that are constant on every executable path are
+// folded into the operands of their users, branches on constants become `br` and blocks that can
+// never execute are deleted.
+bool propagateConstants(IrFunction* func, IrAnalysisCache* analyses);
+// Peephole rewrites driven by a pattern table: folds casts and arithmetic of constants, casts of
+// casts, `trunc` of arithmetic on extended i32s, identities like `add x, 0` and `mul x, 1`, and
+// reassociates chains of constant adds and muls. Dead instructions it comes across are deleted.
+bool combineInstructions(IrFunction* func, IrAnalysisCache* analyses);
+// Replaces multiplications by powers of two with shifts and divisions and remainders by constants
+// with shifts, masks and multiplications by magic numbers.
+bool reduceStrength(IrFunction* func, IrAnalysisCache* analyses);
+// reduceStrength() for -Os, divisions and remainders by constants other than powers of two stay.
+bool reduceStrengthForSize(IrFunction* func, IrAnalysisCache* analyses);
+// Cleans up the control flow graph: folds constant branches, drops unreachable blocks, merges
+// blocks into a sole predecessor ending in `br`, removes empty forwarding blocks and threads jumps
+// past blocks that only branch on a phi of constants.
+bool simplifyCFG(IrFunction* func, IrAnalysisCache* analyses);
+// Turns calls of the function to itself in tail position into jumps back to its start. The
+// arguments become phis in the old entry block, which is the loop header from then on.
+bool eliminateTailCalls(IrFunction* func, IrAnalysisCache* analyses);
+// Loop invariant code motion. Pure instructions whose operands are all defined outside a loop are
+// moved into its preheader, which is created where missing, innermost loops first. Loads move too
+// when they read a global or slot that nothing in the loop can write.
+bool hoistLoopInvariants(IrFunction* func, IrAnalysisCache* analyses);
+// Global value numbering over the dominator tree. Pure instructions computing a value that is
+// already available from a dominating instruction are replaced by it, as are loads that no store
+// can have changed since.
+bool numberValues(IrFunction* func, IrAnalysisCache* analyses);
+// Deletes instructions without side effects whose results are never used.
+bool eliminateDeadCode(IrFunction* func, IrAnalysisCache* analyses);
+// Inlines call sites whose callee is cheap enough under the manager's inline threshold, walking
+// the call graph bottom-up so callees are already inlined into when they are costed. Calls within
+// a strongly connected component of the call graph are never inlined.
+bool inlineFunctions(IrModule* module, PassManager* manager);
+}; // namespace language
+
+#endif // _LANGUAGE_PASSES_H_
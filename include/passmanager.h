@@ -0,0 +1,78 @@
+#if !defined(_LANGUAGE_PASSMANAGER_H_)
+#define _LANGUAGE_PASSMANAGER_H_
+#include "analysis.h"
+#include "ir.h"
+#include "threadpool.h"
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+enum struct OptLevel : uint8_t {
+    O0,
+    O1,
+    O2,
+    Os,
+};
+class PassManager;
+using FunctionPassFn = bool (*)(IrFunction* func, IrAnalysisCache* analyses);
+using ModulePassFn   = bool (*)(IrModule* module, PassManager* manager);
+// One step of a pipeline, exactly one of `function` and `module` is set. When a function pass
+// reports a change its cached analyses are dropped, all of them unless `preservesCFG` is set, in
+// which case only the liveness. Module passes invalidate what they touch through the manager.
+struct PassInfo {
+    const char*    name;
+    FunctionPassFn function;
+    ModulePassFn   module;
+    bool           preservesCFG;
+};
+// The time of a function pass is summed over all functions, with several threads it can be more
+// than the wall time the pass took.
+struct PassTiming {
+    uint64_t nanoseconds;
+    size_t   instsBefore;
+    size_t   instsAfter;
+    size_t   blocksBefore;
+    size_t   blocksAfter;
+    size_t   changed;
+};
+// Consecutive function passes form one pipeline that runs to completion on a function before the
+// next function starts, the functions are spread over a thread pool. Function passes only touch the
+// function they are given, so the result does not depend on the number of threads.
+class PassManager {
+  public:
+    PassManager(IrModule* module);
+    ~PassManager();
+    void             addFunctionPass(const char* name, FunctionPassFn fn, bool preservesCFG);
+    void             addModulePass(const char* name, ModulePassFn fn);
+    bool             addPass(std::string name);
+    void             addPipeline(OptLevel level);
+    IrModule*        getModule();
+    OptLevel         getOptLevel();
+    void             setInlineThreshold(int64_t threshold);
+    int64_t          getInlineThreshold();
+    ThreadPool*      getThreadPool();
+    IrAnalysisCache* getAnalyses(IrFunction* func);
+    void             invalidate(IrFunction* func);
+    bool             run();
+    void             printTimings();
+
+  private:
+    void runFunctionPasses(size_t first, size_t last);
+
+    IrModule*                                         module;
+    OptLevel                                          level;
+    std::optional<int64_t>                            inlineThreshold;
+    std::vector<PassInfo>                             passes;
+    std::vector<PassTiming>                           timings;
+    std::unordered_map<IrFunction*, IrAnalysisCache*> analyses;
+    std::mutex                                        analysesMutex;
+    ThreadPool*                                       pool;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_PASSMANAGER_H_
@@ -0,0 +1,126 @@
+#if !defined(_LANGUAGE_REGALLOC_H_)
+#define _LANGUAGE_REGALLOC_H_
+#include "analysis.h"
+#include "ir.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+// Allocatable registers of a target, numbered from 0. Registers marked caller saved do not survive
+// a `call`. Registers the backend needs as scratch space are simply not part of the file.
+struct RegisterInfo {
+    uint32_t          count;
+    std::vector<bool> callerSaved;
+};
+enum struct LocationKind : uint8_t {
+    None,
+    Register,
+    Stack,
+    // Rematerialized constant, a spilled `const` costs no stack slot and is recreated where needed.
+    Constant,
+};
+struct Location {
+    LocationKind kind;
+    uint32_t     index;
+    int64_t      constant;
+    bool         operator==(const Location& other) const;
+};
+// One element of a parallel move, all sources are read before any destination is written.
+struct RegMove {
+    Location from;
+    Location to;
+    IrType   type;
+};
+struct LiveRange {
+    uint32_t from;
+    uint32_t to;
+};
+struct UsePosition {
+    uint32_t position;
+    bool     needsRegister;
+};
+// Positions an SSA value is live at, as sorted half open ranges. Splitting hands the tail of an
+// interval to a child that is allocated on its own, all children hang off the original interval.
+struct LiveInterval {
+    IrValue*                   value;
+    LiveInterval*              parent;
+    std::vector<LiveInterval*> children;
+    std::vector<LiveRange>     ranges;
+    std::vector<UsePosition>   uses;
+    int32_t                    reg;
+    bool                       spilled;
+    bool                       fixed;
+    uint32_t                   getStart();
+    uint32_t                   getEnd();
+    bool                       covers(uint32_t position);
+    uint32_t                   nextIntersection(LiveInterval* other);
+    uint32_t                   nextRegisterUse(uint32_t position);
+};
+// Linear scan register allocation with interval splitting in the style of Wimmer and Franz. Every
+// instruction gets two positions, operands are read at the first one and the result is written at
+// the same position, so a result may take the register of an operand that dies there. Each block
+// starts with a label position that phis and arguments are defined at.
+//
+// An interval that does not find a free register either evicts the intervals whose next use is
+// furthest away or is spilled itself up to its next use, and each of the pieces gets a second
+// chance at a register later on. Splits are moved to the block boundary of least loop depth that
+// is still in range, so spill and reload code stays out of loops. Constants are never stored, a
+// spilled `const` is rematerialized instead.
+//
+// Moves needed where an interval was split inside a block are returned by getMovesBefore, the ones
+// needed on control flow edges, phis included, by getEdgeMoves. Both are parallel moves.
+class IrRegisterAllocation {
+  public:
+    IrRegisterAllocation(IrFunction* func, IrAnalysisCache* analyses, RegisterInfo* info);
+    ~IrRegisterAllocation();
+    std::vector<IrBlock*>& getBlockOrder();
+    bool                   needsLocation(IrValue* value);
+    Location               getInputLocation(IrValue* value, IrInstruction* user);
+    Location               getOutputLocation(IrValue* value);
+    std::vector<RegMove>&  getMovesBefore(IrInstruction* inst);
+    std::vector<RegMove>   getEdgeMoves(IrBlock* pred, IrBlock* succ);
+    uint32_t               getSpillSlotCount();
+    bool                   isRegisterUsed(uint32_t reg);
+    void                   print();
+
+  private:
+    void          numberInstructions();
+    void          buildIntervals();
+    void          allocate();
+    bool          tryAllocateFreeRegister(LiveInterval* current);
+    void          allocateBlockedRegister(LiveInterval* current);
+    void          spillFrom(LiveInterval* interval, uint32_t position);
+    void          spill(LiveInterval* interval);
+    LiveInterval* split(LiveInterval* interval, uint32_t position);
+    uint32_t      findSplitPosition(uint32_t minPosition, uint32_t maxPosition);
+    uint32_t      normalizeSplitPosition(uint32_t position);
+    void          addUnhandled(LiveInterval* interval);
+    void          resolve();
+    LiveInterval* getIntervalAt(IrValue* value, uint32_t position);
+    Location      getLocation(LiveInterval* interval);
+    IrBlock*      getBlockAt(uint32_t position);
+    uint32_t      getBlockEnd(IrBlock* block);
+
+    IrFunction*                                        func;
+    IrAnalysisCache*                                   analyses;
+    RegisterInfo*                                      info;
+    std::vector<IrBlock*>                              order;
+    std::vector<uint32_t>                              blockStart;
+    std::unordered_map<IrInstruction*, uint32_t>       positions;
+    std::vector<LiveInterval*>                         intervals;
+    std::vector<LiveInterval*>                         fixedIntervals;
+    std::vector<LiveInterval*>                         unhandled;
+    std::vector<LiveInterval*>                         active;
+    std::vector<LiveInterval*>                         inactive;
+    std::vector<int64_t>                               spillSlots;
+    uint32_t                                           nextSpillSlot;
+    std::vector<bool>                                  usedRegisters;
+    std::unordered_map<uint32_t, std::vector<RegMove>> splitMoves;
+    std::unordered_map<uint64_t, std::vector<RegMove>> edgeMoves;
+    std::vector<RegMove>                               noMoves;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_REGALLOC_H_
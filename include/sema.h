@@ -11,6 +11,7 @@ struct Symbol {
     TypeSpec*                   type;
     DeclarationNodeType         kind;
     std::vector<AttributeNode*> attrs;
+    std::vector<TypeSpec*>      params;
 };
 struct SymbolTable {
     std::vector<std::string>                 allowedTypes;
@@ -60,14 +61,23 @@ class Sema {
     DeclarationNode*         checkVarDecl(VariableDeclarationNode* node);
     StatementNode*           checkCompoundStatement(CompoundStatementNode* node);
     StatementNode*           checkReturnStatement(ReturnStatementNode* node);
+    StatementNode*           checkIfStatement(IfStatementNode* node);
+    StatementNode*           checkWhileStatement(WhileStatementNode* node);
+    StatementNode*           checkForStatement(ForStatementNode* node);
+    ExpressionNode*          checkCondition(ExpressionNode* node);
     StatementNode*           checkStatement(StatementNode* node);
     ExpressionNode*          checkBinaryExpression(BinaryExpressionNode* node);
+    ExpressionNode*          checkUnaryExpression(UnaryExpressionNode* node);
+    ExpressionNode*          checkCastExpression(CastExpressionNode* node);
+    ExpressionNode*          checkFunctionCallExpression(FunctionCallExpressionNode* node);
+    ExpressionNode*          checkAssignmentExpression(AssignmentExpressionNode* node);
     ExpressionNode*          checkExpression(ExpressionNode* node);
     TypeSpec*                checkTypeSpec(TypeSpec* type);
     AstNode*                 checkTopAstNode(AstNode* node);
     Ast*                     newAst;
     Ast*                     oldAst;
     SymbolTable*             getCurrentTable();
+    void                     pushBlockScope();
     std::stack<SymbolTable*> tables;
 };
 }; // namespace language
@@ -0,0 +1,50 @@
+#if !defined(_LANGUAGE_THREADPOOL_H_)
+#define _LANGUAGE_THREADPOOL_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace language {
+// Fixed set of worker threads that run batches of independent tasks. parallelFor() splits the
+// indices of a batch into one contiguous range per thread and returns once all of them ran, the
+// calling thread works on the batch as well. A thread takes indices from the front of its own
+// range and, once that is empty, steals the back half of another thread's range, so neighbouring
+// indices mostly stay on one thread. A pool of one thread runs everything on the caller.
+class ThreadPool {
+  public:
+    ThreadPool(size_t threadCount);
+    ~ThreadPool();
+    void          parallelFor(size_t count, std::function<void(size_t)> task);
+    size_t        getThreadCount();
+    static size_t getDefaultThreadCount();
+    static void   setDefaultThreadCount(size_t threadCount);
+
+  private:
+    struct WorkRange {
+        std::mutex mutex;
+        size_t     begin = 0;
+        size_t     end   = 0;
+    };
+    void runWorker(size_t index);
+    void runTasks(size_t index);
+    bool takeTask(size_t index, size_t& task);
+
+    std::vector<std::thread>    workers;
+    std::vector<WorkRange>      ranges;
+    std::mutex                  mutex;
+    std::condition_variable     wakeWorkers;
+    std::condition_variable     batchDone;
+    std::function<void(size_t)> task;
+    std::atomic<size_t>         remaining;
+    uint64_t                    batch;
+    bool                        stopping;
+
+    static size_t defaultThreadCount;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_THREADPOOL_H_
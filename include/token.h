@@ -19,10 +19,16 @@ enum struct TokenType {
     Plus             = '+',
     Percent          = '%',
     Star             = '*',
+    Slash            = '/',
     Minus            = '-',
+    Less             = '<',
+    Greater          = '>',
     __MultibyteStart = 255,
     ColonColon,
     EqualEqual,
+    NotEqual,
+    LessEqual,
+    GreaterEqual,
     Identifier,
     LitString,
     LitNumber,
@@ -42,6 +48,8 @@ enum struct TokenType {
     I32,
     String,
     Variadic,
+    While,
+    For,
 };
 class Token {
   private:
@@ -0,0 +1,90 @@
+#if !defined(_LANGUAGE_X86ASM_H_)
+#define _LANGUAGE_X86ASM_H_
+#include "x86gen.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+// Sections that are not allocated, like `.note.GNU-stack`, only carry information for the linker
+// and are never loaded.
+struct X86Section {
+    std::string          name;
+    std::vector<uint8_t> bytes;
+    uint32_t             alignment;
+    bool                 allocated;
+    bool                 executable;
+    bool                 writable;
+};
+// `section` is -1 for symbols that are referenced but not defined by the module.
+struct X86Symbol {
+    std::string name;
+    int32_t     section;
+    uint64_t    offset;
+    uint64_t    size;
+    bool        global;
+    bool        function;
+};
+enum struct X86RelocationKind : uint8_t {
+    // rel32 of a `call` or `jmp`, may be sent through a stub when the target is too far away.
+    Branch,
+    // rel32 of a `[rip + symbol]` operand.
+    PcRelative,
+};
+// Field of 4 bytes at `offset` that receives `symbol + addend - field address`.
+struct X86Relocation {
+    uint32_t          section;
+    uint64_t          offset;
+    std::string       symbol;
+    int64_t           addend;
+    X86RelocationKind kind;
+};
+// Operand as written in the source, a label is the bare target of a `call` or a jump.
+struct X86AsmOperand {
+    X86Operand operand;
+    uint8_t    size;
+    bool       label;
+};
+// Assembler for the Intel syntax X86Gen writes, so code can be produced without an external
+// toolchain. Only the instructions and directives X86Gen uses are understood. Jumps always take
+// the rel32 form. References to symbols that are not global and live in the same section are
+// resolved right away, everything else is left as a relocation.
+class X86Assembler {
+  public:
+    X86Assembler(std::string source);
+    ~X86Assembler();
+    void                        assemble();
+    std::vector<X86Section>&    getSections();
+    std::vector<X86Symbol>&     getSymbols();
+    std::vector<X86Relocation>& getRelocations();
+    X86Symbol*                  findSymbol(std::string name);
+
+  private:
+    void          assembleLine(std::string line);
+    void          assembleDirective(std::string directive, std::string arguments);
+    void          assembleInstruction(std::string mnemonic, std::vector<X86AsmOperand>& operands);
+    X86AsmOperand parseOperand(std::string text);
+    X86Symbol*    getSymbol(std::string name);
+    void          switchSection(std::string name, std::string flags);
+    void          emitByte(uint8_t byte);
+    void          emitImmediate(int64_t value, size_t size);
+    void          emitRex(bool wide, uint8_t reg, X86AsmOperand& rm, bool byteRegister);
+    void          emitModRM(uint8_t reg, X86AsmOperand& rm);
+    void          emitInstruction(std::vector<uint8_t> opcode, uint8_t reg, X86AsmOperand& rm,
+                                  bool wide);
+    void          emitRelative(std::string symbol, X86RelocationKind kind);
+    void          resolveFixups();
+
+    std::string                             source;
+    std::vector<X86Section>                 sections;
+    std::vector<X86Symbol>                  symbols;
+    std::unordered_map<std::string, size_t> symbolIndex;
+    std::vector<X86Relocation>              fixups;
+    std::vector<X86Relocation>              relocations;
+    uint32_t                                currentSection;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_X86ASM_H_
@@ -0,0 +1,117 @@
+#if !defined(_LANGUAGE_X86GEN_H_)
+#define _LANGUAGE_X86GEN_H_
+#include "ir.h"
+#include "passmanager.h"
+#include "regalloc.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace language {
+enum struct X86Register : uint8_t {
+    Rax,
+    Rcx,
+    Rdx,
+    Rbx,
+    Rsp,
+    Rbp,
+    Rsi,
+    Rdi,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+enum struct X86OperandKind : uint8_t {
+    Register,
+    Immediate,
+    // `[base + offset]`
+    Memory,
+    // `[rip + symbol]`
+    Symbol,
+};
+struct X86Operand {
+    X86OperandKind kind;
+    X86Register    reg;
+    int32_t        offset;
+    int64_t        immediate;
+    std::string    symbol;
+    bool           operator==(const X86Operand& other) const;
+};
+struct X86Move {
+    X86Operand from;
+    X86Operand to;
+};
+// x86-64 System V code generation, GNU as in Intel syntax. Values live where IrRegisterAllocation
+// puts them, rax and r11 are never allocated and serve as scratch registers, rsp and rbp hold the
+// frame. Every `reserve` and every spill slot gets 8 bytes below the saved callee saved registers.
+//
+// A compare whose only use is the `condbr` right after it sets the flags for the branch instead of
+// materializing a 0 or 1. Edges that need moves for phis or split intervals get the moves on their
+// own, behind a stub label when the branch has moves on both sides. A call that is directly
+// returned from tears the frame down and jumps to the callee when its arguments fit.
+//
+// Functions are emitted in parallel on the pass manager's thread pool, each into its own buffer.
+// Every function and every object is put in a section of its own, `.text.<symbol>` and
+// `.data.<symbol>`, so a linker can drop the ones nothing refers to.
+class X86Gen {
+  public:
+    X86Gen(PassManager* passManager);
+    ~X86Gen();
+    void        generate();
+    std::string getAssembly();
+
+  private:
+    void        emit(const char* format, ...);
+    void        emitObject(IrObject* obj);
+    void        emitFunction(IrFunction* func);
+    void        emitPrologue();
+    void        emitEpilogue();
+    void        emitFrameRestore();
+    void        emitInstruction(IrInstruction* inst);
+    void        emitLoad(IrInstruction* inst);
+    void        emitStore(IrInstruction* inst);
+    void        emitCast(IrInstruction* inst);
+    void        emitBinary(IrInstruction* inst);
+    void        emitDoubleWidth(IrInstruction* inst);
+    void        emitShift(IrInstruction* inst);
+    void        emitCompare(IrInstruction* inst);
+    void        emitCall(IrInstruction* inst);
+    bool        isSiblingCall(IrInstruction* inst);
+    void        emitSiblingCall(IrInstruction* inst);
+    void        emitReturn(IrInstruction* inst);
+    void        emitCondBranch(IrInstruction* inst);
+    void        emitEdge(IrBlock* pred, IrBlock* succ, bool canFallThrough);
+    void        emitMove(X86Operand to, X86Operand from);
+    void        emitParallelMove(std::vector<X86Move> moves);
+    X86Operand  getLocation(Location location);
+    X86Operand  getInput(IrOperand& operand, IrInstruction* user);
+    X86Operand  getOutput(IrInstruction* inst);
+    X86Operand  getAddress(IrOperand& pointer, IrInstruction* user);
+    std::string getBlockLabel(IrBlock* block);
+
+    PassManager*                                passManager;
+    IrModule*                                   module;
+    std::string                                 assembly;
+    RegisterInfo                                registerInfo;
+    IrFunction*                                 func;
+    IrRegisterAllocation*                       allocation;
+    std::vector<X86Register>                    savedRegisters;
+    std::unordered_map<IrInstruction*, int32_t> reserveOffsets;
+    int32_t                                     spillOffset;
+    int32_t                                     frameSize;
+    IrBlock*                                    nextBlock;
+    IrInstruction*                              fusedCompare;
+    IrInstructionType                           fusedCondition;
+    uint32_t                                    functionIndex;
+    uint32_t                                    stubCount;
+};
+}; // namespace language
+
+#endif // _LANGUAGE_X86GEN_H_
@@ -0,0 +1,651 @@
+#include <algorithm>
+#include <analysis.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace language {
+IrCFG::IrCFG(IrFunction* _func) {
+    this->func   = _func;
+    size_t slots = _func->nextBlockNumber;
+    this->blocks.assign(slots, nullptr);
+    this->preds.assign(slots, {});
+    this->succs.assign(slots, {});
+    this->rpoIndex.assign(slots, -1);
+    for (IrBlock* block : _func->blocks) {
+        this->blocks.at(block->number) = block;
+        this->succs.at(block->number)  = block->getSuccessors();
+        for (IrBlock* succ : this->succs.at(block->number)) {
+            this->preds.at(succ->number).push_back(block);
+        }
+        if (this->succs.at(block->number).empty()) {
+            this->exits.push_back(block);
+        }
+    }
+    if (_func->blocks.empty()) {
+        return;
+    }
+    std::vector<bool>                        visited(slots, false);
+    std::vector<IrBlock*>                    postOrder;
+    std::vector<std::pair<IrBlock*, size_t>> stack;
+    IrBlock*                                 entry = _func->getEntryBlock();
+    stack.push_back({entry, 0});
+    visited.at(entry->number) = true;
+    while (!stack.empty()) {
+        IrBlock* block = stack.back().first;
+        size_t   index = stack.back().second;
+        if (index < this->succs.at(block->number).size()) {
+            stack.back().second++;
+            IrBlock* succ = this->succs.at(block->number).at(index);
+            if (!visited.at(succ->number)) {
+                visited.at(succ->number) = true;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            postOrder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    this->rpo.assign(postOrder.rbegin(), postOrder.rend());
+    for (size_t i = 0; i < this->rpo.size(); ++i) {
+        this->rpoIndex.at(this->rpo.at(i)->number) = i;
+    }
+}
+IrFunction* IrCFG::getFunction() {
+    return this->func;
+}
+std::vector<IrBlock*>& IrCFG::getPredecessors(IrBlock* block) {
+    return this->preds.at(block->number);
+}
+std::vector<IrBlock*>& IrCFG::getSuccessors(IrBlock* block) {
+    return this->succs.at(block->number);
+}
+std::vector<IrBlock*>& IrCFG::getReversePostOrder() {
+    return this->rpo;
+}
+std::vector<IrBlock*>& IrCFG::getExitBlocks() {
+    return this->exits;
+}
+bool IrCFG::isReachable(IrBlock* block) {
+    return this->rpoIndex.at(block->number) >= 0;
+}
+size_t IrCFG::getRPOIndex(IrBlock* block) {
+    if (!this->isReachable(block)) {
+        std::printf("ICE: Asked for the RPO index of unreachable block .BB%u\n", block->number);
+        std::exit(1);
+    }
+    return this->rpoIndex.at(block->number);
+}
+size_t IrCFG::getBlockSlots() {
+    return this->blocks.size();
+}
+IrBlock* IrCFG::getBlock(size_t number) {
+    return this->blocks.at(number);
+}
+
+// The graph the tree is built over, in node numbers. For post dominators the edges are reversed
+// and node `getBlockSlots()` is the virtual exit every exit block hangs off.
+static void buildGraph(IrCFG* cfg, bool post, std::vector<std::vector<uint32_t>>& succs,
+                       std::vector<std::vector<uint32_t>>& preds) {
+    size_t slots = cfg->getBlockSlots();
+    size_t nodes = post ? slots + 1 : slots;
+    succs.assign(nodes, {});
+    preds.assign(nodes, {});
+    auto addEdge = [&](uint32_t from, uint32_t to) {
+        succs.at(from).push_back(to);
+        preds.at(to).push_back(from);
+    };
+    for (size_t i = 0; i < slots; ++i) {
+        IrBlock* block = cfg->getBlock(i);
+        if (!block) {
+            continue;
+        }
+        for (IrBlock* succ : cfg->getSuccessors(block)) {
+            if (post) {
+                addEdge(succ->number, block->number);
+            } else {
+                addEdge(block->number, succ->number);
+            }
+        }
+    }
+    if (post) {
+        for (IrBlock* exit : cfg->getExitBlocks()) {
+            addEdge(slots, exit->number);
+        }
+    }
+}
+IrDominatorTree::IrDominatorTree(IrCFG* _cfg, bool _post) {
+    this->cfg           = _cfg;
+    this->post          = _post;
+    this->haveFrontiers = false;
+    size_t slots        = _cfg->getBlockSlots();
+    size_t nodes        = _post ? slots + 1 : slots;
+    this->idom.assign(nodes, -1);
+    this->children.assign(nodes, {});
+    this->enter.assign(nodes, 0);
+    this->leave.assign(nodes, 0);
+    if (_cfg->getFunction()->blocks.empty()) {
+        return;
+    }
+    std::vector<std::vector<uint32_t>> succs;
+    std::vector<std::vector<uint32_t>> preds;
+    buildGraph(_cfg, _post, succs, preds);
+    uint32_t root = _post ? slots : _cfg->getFunction()->getEntryBlock()->number;
+
+    // Depth first preorder numbering; everything below works on preorder numbers.
+    std::vector<int64_t>                     preorder(nodes, -1);
+    std::vector<uint32_t>                    vertex;
+    std::vector<uint32_t>                    parent;
+    std::vector<std::pair<uint32_t, size_t>> stack;
+    preorder.at(root) = 0;
+    vertex.push_back(root);
+    parent.push_back(0);
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+        uint32_t node  = stack.back().first;
+        size_t   index = stack.back().second;
+        if (index >= succs.at(node).size()) {
+            stack.pop_back();
+            continue;
+        }
+        stack.back().second++;
+        uint32_t succ = succs.at(node).at(index);
+        if (preorder.at(succ) < 0) {
+            preorder.at(succ) = vertex.size();
+            vertex.push_back(succ);
+            parent.push_back(preorder.at(node));
+            stack.push_back({succ, 0});
+        }
+    }
+
+    // Semi dominators with Lengauer-Tarjan's link/eval forest and path compression, then the
+    // immediate dominator of v is the nearest common ancestor of parent(v) and semi(v).
+    size_t                count = vertex.size();
+    std::vector<uint32_t> semi(count);
+    std::vector<uint32_t> label(count);
+    std::vector<int64_t>  ancestor(count, -1);
+    std::vector<uint32_t> dom(count, 0);
+    std::vector<uint32_t> path;
+    for (size_t i = 0; i < count; ++i) {
+        semi.at(i)  = i;
+        label.at(i) = i;
+    }
+    auto eval = [&](uint32_t v) -> uint32_t {
+        if (ancestor.at(v) < 0) {
+            return v;
+        }
+        path.clear();
+        for (uint32_t u = v; ancestor.at(ancestor.at(u)) >= 0; u = ancestor.at(u)) {
+            path.push_back(u);
+        }
+        while (!path.empty()) {
+            uint32_t u = path.back();
+            uint32_t a = ancestor.at(u);
+            path.pop_back();
+            if (semi.at(label.at(a)) < semi.at(label.at(u))) {
+                label.at(u) = label.at(a);
+            }
+            ancestor.at(u) = ancestor.at(a);
+        }
+        return label.at(v);
+    };
+    for (size_t i = count - 1; i > 0; --i) {
+        for (uint32_t pred : preds.at(vertex.at(i))) {
+            if (preorder.at(pred) < 0) {
+                continue;
+            }
+            uint32_t u = eval(preorder.at(pred));
+            if (semi.at(u) < semi.at(i)) {
+                semi.at(i) = semi.at(u);
+            }
+        }
+        ancestor.at(i) = parent.at(i);
+    }
+    for (size_t i = 1; i < count; ++i) {
+        uint32_t d = parent.at(i);
+        while (d > semi.at(i)) {
+            d = dom.at(d);
+        }
+        dom.at(i) = d;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        uint32_t node       = vertex.at(i);
+        uint32_t owner      = vertex.at(dom.at(i));
+        this->idom.at(node) = owner;
+        this->children.at(owner).push_back(_cfg->getBlock(node));
+    }
+    if (_post) {
+        this->roots = this->children.at(root);
+    } else {
+        this->roots.push_back(_cfg->getBlock(root));
+    }
+
+    // Entry and exit times of a walk over the tree answer dominance queries in constant time.
+    uint32_t clock = 1;
+    stack.clear();
+    stack.push_back({root, 0});
+    this->enter.at(root) = clock++;
+    while (!stack.empty()) {
+        uint32_t node  = stack.back().first;
+        size_t   index = stack.back().second;
+        if (index >= this->children.at(node).size()) {
+            this->leave.at(node) = clock++;
+            stack.pop_back();
+            continue;
+        }
+        stack.back().second++;
+        uint32_t child        = this->children.at(node).at(index)->number;
+        this->enter.at(child) = clock++;
+        stack.push_back({child, 0});
+    }
+}
+IrBlock* IrDominatorTree::getIdom(IrBlock* block) {
+    int64_t owner = this->idom.at(block->number);
+    if (owner < 0 || static_cast<size_t>(owner) >= this->cfg->getBlockSlots()) {
+        return nullptr;
+    }
+    return this->cfg->getBlock(owner);
+}
+std::vector<IrBlock*>& IrDominatorTree::getChildren(IrBlock* block) {
+    return this->children.at(block->number);
+}
+std::vector<IrBlock*>& IrDominatorTree::getRoots() {
+    return this->roots;
+}
+std::vector<IrBlock*>& IrDominatorTree::getFrontier(IrBlock* block) {
+    if (!this->haveFrontiers) {
+        this->computeFrontiers();
+    }
+    return this->frontiers.at(block->number);
+}
+bool IrDominatorTree::contains(IrBlock* block) {
+    return this->enter.at(block->number) != 0;
+}
+bool IrDominatorTree::dominates(IrBlock* a, IrBlock* b) {
+    if (!this->contains(b)) {
+        return true;
+    }
+    if (!this->contains(a)) {
+        return false;
+    }
+    return this->enter.at(a->number) <= this->enter.at(b->number) &&
+           this->leave.at(b->number) <= this->leave.at(a->number);
+}
+bool IrDominatorTree::dominates(IrInstruction* def, IrInstruction* user) {
+    if (def->parent != user->parent) {
+        return this->dominates(def->parent, user->parent);
+    }
+    IrInstruction* first  = this->post ? user : def;
+    IrInstruction* second = this->post ? def : user;
+    for (IrInstruction* inst = first; inst; inst = inst->next) {
+        if (inst == second) {
+            return true;
+        }
+    }
+    return false;
+}
+bool IrDominatorTree::isPostDominatorTree() {
+    return this->post;
+}
+void IrDominatorTree::print() {
+    std::printf("%s tree of $%s:\n", this->post ? "Post dominator" : "Dominator",
+                this->cfg->getFunction()->name.c_str());
+    for (IrBlock* root : this->roots) {
+        this->printNode(root, 1);
+    }
+}
+void IrDominatorTree::printNode(IrBlock* block, size_t depth) {
+    std::printf("%*s.BB%u", (int)depth * 2, "", block->number);
+    std::vector<IrBlock*>& frontier = this->getFrontier(block);
+    if (!frontier.empty()) {
+        std::printf(" frontier");
+    }
+    for (IrBlock* member : frontier) {
+        std::printf(" .BB%u", member->number);
+    }
+    std::printf("\n");
+    for (IrBlock* child : this->getChildren(block)) {
+        this->printNode(child, depth + 1);
+    }
+}
+// Cytron et al.'s frontiers computed the Cooper-Harvey-Kennedy way: walk up from every predecessor
+// of a block until reaching its immediate dominator. Blocks with a single predecessor usually stop
+// right away, but the entry block can still be its own frontier through a back edge.
+void IrDominatorTree::computeFrontiers() {
+    std::vector<std::vector<uint32_t>> succs;
+    std::vector<std::vector<uint32_t>> preds;
+    buildGraph(this->cfg, this->post, succs, preds);
+    this->frontiers.assign(this->idom.size(), {});
+    for (size_t node = 0; node < this->cfg->getBlockSlots(); ++node) {
+        IrBlock* block = this->cfg->getBlock(node);
+        if (!block || !this->contains(block)) {
+            continue;
+        }
+        for (uint32_t pred : preds.at(node)) {
+            if (this->enter.at(pred) == 0) {
+                continue;
+            }
+            int64_t runner = pred;
+            while (runner != this->idom.at(node)) {
+                std::vector<IrBlock*>& frontier = this->frontiers.at(runner);
+                if (frontier.empty() || frontier.back() != block) {
+                    frontier.push_back(block);
+                }
+                runner = this->idom.at(runner);
+            }
+        }
+    }
+    this->haveFrontiers = true;
+}
+
+IrLiveness::IrLiveness(IrCFG* _cfg) {
+    this->cfg      = _cfg;
+    IrFunction* fn = _cfg->getFunction();
+    size_t slots   = _cfg->getBlockSlots();
+    this->words    = (fn->nextValueNumber + 63) / 64;
+    this->values.assign(fn->nextValueNumber, nullptr);
+    this->liveIn.assign(slots, std::vector<uint64_t>(this->words, 0));
+    this->liveOut.assign(slots, std::vector<uint64_t>(this->words, 0));
+    auto set = [](std::vector<uint64_t>& bits, uint32_t bit) {
+        bits.at(bit / 64) |= 1ull << (bit % 64);
+    };
+    auto test = [](std::vector<uint64_t>& bits, uint32_t bit) {
+        return (bits.at(bit / 64) >> (bit % 64)) & 1;
+    };
+    for (IrArgument* arg : fn->arguments) {
+        this->values.at(arg->number) = arg;
+    }
+
+    // Upward exposed uses and definitions of every block, plus the phi operands each block has to
+    // provide to its successors.
+    std::vector<std::vector<uint64_t>> uses(slots, std::vector<uint64_t>(this->words, 0));
+    std::vector<std::vector<uint64_t>> defs(slots, std::vector<uint64_t>(this->words, 0));
+    std::vector<std::vector<uint64_t>> phiUses(slots, std::vector<uint64_t>(this->words, 0));
+    for (IrBlock* block : _cfg->getReversePostOrder()) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Phi) {
+                for (size_t i = 0; i + 1 < inst->numOperands; i += 2) {
+                    IrValue* value = inst->getOperandValue(i);
+                    IrBlock* pred  = inst->getOperand(i + 1).block;
+                    if (value && _cfg->isReachable(pred)) {
+                        set(phiUses.at(pred->number), value->number);
+                    }
+                }
+            } else {
+                for (size_t i = 0; i < inst->numOperands; ++i) {
+                    IrValue* value = inst->getOperandValue(i);
+                    if (value && !test(defs.at(block->number), value->number)) {
+                        set(uses.at(block->number), value->number);
+                    }
+                }
+            }
+            if (inst->hasResult) {
+                this->values.at(inst->number) = inst;
+                set(defs.at(block->number), inst->number);
+            }
+        }
+    }
+
+    // out(B) = phiUses(B) | in(S) for every successor S, in(B) = uses(B) | (out(B) & ~defs(B)).
+    std::vector<IrBlock*>& rpo     = _cfg->getReversePostOrder();
+    bool                   changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = rpo.rbegin(); it != rpo.rend(); ++it) {
+            IrBlock*               block = *it;
+            std::vector<uint64_t>& out   = this->liveOut.at(block->number);
+            std::vector<uint64_t>& in    = this->liveIn.at(block->number);
+            for (size_t w = 0; w < this->words; ++w) {
+                uint64_t word = phiUses.at(block->number).at(w);
+                for (IrBlock* succ : _cfg->getSuccessors(block)) {
+                    word |= this->liveIn.at(succ->number).at(w);
+                }
+                out.at(w)       = word;
+                uint64_t inWord = word & ~defs.at(block->number).at(w);
+                inWord |= uses.at(block->number).at(w);
+                if (inWord != in.at(w)) {
+                    in.at(w) = inWord;
+                    changed  = true;
+                }
+            }
+        }
+    }
+}
+bool IrLiveness::isLiveIn(IrBlock* block, IrValue* value) {
+    return (this->liveIn.at(block->number).at(value->number / 64) >> (value->number % 64)) & 1;
+}
+bool IrLiveness::isLiveOut(IrBlock* block, IrValue* value) {
+    return (this->liveOut.at(block->number).at(value->number / 64) >> (value->number % 64)) & 1;
+}
+std::vector<IrValue*> IrLiveness::getLiveIn(IrBlock* block) {
+    return this->collect(this->liveIn.at(block->number));
+}
+std::vector<IrValue*> IrLiveness::getLiveOut(IrBlock* block) {
+    return this->collect(this->liveOut.at(block->number));
+}
+std::vector<IrValue*> IrLiveness::collect(std::vector<uint64_t>& bits) {
+    std::vector<IrValue*> result;
+    for (size_t w = 0; w < this->words; ++w) {
+        for (uint64_t word = bits.at(w); word; word &= word - 1) {
+            result.push_back(this->values.at(w * 64 + __builtin_ctzll(word)));
+        }
+    }
+    return result;
+}
+
+bool IrLoop::contains(IrBlock* block) {
+    return block->number < this->members.size() && this->members.at(block->number);
+}
+IrLoopInfo::IrLoopInfo(IrCFG* _cfg, IrDominatorTree* domTree) {
+    this->cfg    = _cfg;
+    size_t slots = _cfg->getBlockSlots();
+    this->innermost.assign(slots, nullptr);
+    for (IrBlock* header : _cfg->getReversePostOrder()) {
+        IrLoop* loop = nullptr;
+        for (IrBlock* latch : _cfg->getPredecessors(header)) {
+            if (!_cfg->isReachable(latch) || !domTree->dominates(header, latch)) {
+                continue;
+            }
+            if (!loop) {
+                loop         = new IrLoop;
+                loop->header = header;
+                loop->parent = nullptr;
+                loop->depth  = 0;
+                loop->members.assign(slots, false);
+                loop->members.at(header->number) = true;
+                this->loops.push_back(loop);
+            }
+            loop->latches.push_back(latch);
+            std::vector<IrBlock*> worklist = {latch};
+            while (!worklist.empty()) {
+                IrBlock* block = worklist.back();
+                worklist.pop_back();
+                if (loop->members.at(block->number)) {
+                    continue;
+                }
+                loop->members.at(block->number) = true;
+                for (IrBlock* pred : _cfg->getPredecessors(block)) {
+                    if (_cfg->isReachable(pred)) {
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+        }
+        if (!loop) {
+            continue;
+        }
+        for (IrBlock* block : _cfg->getReversePostOrder()) {
+            if (loop->members.at(block->number)) {
+                loop->blocks.push_back(block);
+            }
+        }
+    }
+    // A loop nested in another has strictly fewer blocks, so after sorting by size the parent of a
+    // loop is the first later loop containing its header, and inner loops come first.
+    std::stable_sort(this->loops.begin(), this->loops.end(), [](IrLoop* a, IrLoop* b) {
+        return a->blocks.size() < b->blocks.size();
+    });
+    for (size_t i = 0; i < this->loops.size(); ++i) {
+        IrLoop* loop = this->loops.at(i);
+        for (size_t j = i + 1; j < this->loops.size() && !loop->parent; ++j) {
+            if (this->loops.at(j)->contains(loop->header)) {
+                loop->parent = this->loops.at(j);
+                loop->parent->children.push_back(loop);
+            }
+        }
+        if (!loop->parent) {
+            this->topLevel.push_back(loop);
+        }
+        for (IrBlock* block : loop->blocks) {
+            if (!this->innermost.at(block->number)) {
+                this->innermost.at(block->number) = loop;
+            }
+        }
+    }
+    for (auto it = this->loops.rbegin(); it != this->loops.rend(); ++it) {
+        (*it)->depth = (*it)->parent ? (*it)->parent->depth + 1 : 1;
+    }
+}
+IrLoopInfo::~IrLoopInfo() {
+    for (IrLoop* loop : this->loops) {
+        delete loop;
+    }
+}
+// Innermost loops first.
+std::vector<IrLoop*>& IrLoopInfo::getLoops() {
+    return this->loops;
+}
+std::vector<IrLoop*>& IrLoopInfo::getTopLevelLoops() {
+    return this->topLevel;
+}
+IrLoop* IrLoopInfo::getLoopFor(IrBlock* block) {
+    if (block->number >= this->innermost.size()) {
+        return nullptr;
+    }
+    return this->innermost.at(block->number);
+}
+uint32_t IrLoopInfo::getLoopDepth(IrBlock* block) {
+    IrLoop* loop = this->getLoopFor(block);
+    return loop ? loop->depth : 0;
+}
+std::vector<IrBlock*> IrLoopInfo::getOutsidePredecessors(IrLoop* loop) {
+    std::vector<IrBlock*> preds;
+    for (IrBlock* pred : this->cfg->getPredecessors(loop->header)) {
+        if (loop->contains(pred) || !this->cfg->isReachable(pred)) {
+            continue;
+        }
+        bool seen = false;
+        for (IrBlock* other : preds) {
+            seen |= other == pred;
+        }
+        if (!seen) {
+            preds.push_back(pred);
+        }
+    }
+    return preds;
+}
+// The block outside the loop that only jumps to the header and is the only way in, if there is
+// one. Code hoisted out of the loop goes there.
+IrBlock* IrLoopInfo::getPreheader(IrLoop* loop) {
+    std::vector<IrBlock*> preds = this->getOutsidePredecessors(loop);
+    if (preds.size() != 1 || this->cfg->getSuccessors(preds.front()).size() != 1) {
+        return nullptr;
+    }
+    return preds.front();
+}
+std::vector<IrBlock*> IrLoopInfo::getExitBlocks(IrLoop* loop) {
+    std::vector<IrBlock*> exits;
+    for (IrBlock* block : loop->blocks) {
+        for (IrBlock* succ : this->cfg->getSuccessors(block)) {
+            bool seen = loop->contains(succ);
+            for (IrBlock* other : exits) {
+                seen |= other == succ;
+            }
+            if (!seen) {
+                exits.push_back(succ);
+            }
+        }
+    }
+    return exits;
+}
+void IrLoopInfo::print() {
+    std::printf("Loops of $%s:\n", this->cfg->getFunction()->name.c_str());
+    for (IrLoop* loop : this->topLevel) {
+        this->printLoop(loop, 1);
+    }
+}
+void IrLoopInfo::printLoop(IrLoop* loop, size_t indent) {
+    std::printf("%*s.BB%u depth %u blocks", (int)indent * 2, "", loop->header->number, loop->depth);
+    for (IrBlock* block : loop->blocks) {
+        std::printf(" .BB%u", block->number);
+    }
+    std::printf(" latches");
+    for (IrBlock* latch : loop->latches) {
+        std::printf(" .BB%u", latch->number);
+    }
+    std::printf("\n");
+    for (IrLoop* child : loop->children) {
+        this->printLoop(child, indent + 1);
+    }
+}
+
+IrAnalysisCache::IrAnalysisCache(IrFunction* _func) {
+    this->func        = _func;
+    this->cfg         = nullptr;
+    this->domTree     = nullptr;
+    this->postDomTree = nullptr;
+    this->liveness    = nullptr;
+    this->loopInfo    = nullptr;
+}
+IrAnalysisCache::~IrAnalysisCache() {
+    this->invalidate();
+}
+IrFunction* IrAnalysisCache::getFunction() {
+    return this->func;
+}
+IrCFG* IrAnalysisCache::getCFG() {
+    if (!this->cfg) {
+        this->cfg = new IrCFG(this->func);
+    }
+    return this->cfg;
+}
+IrDominatorTree* IrAnalysisCache::getDominatorTree() {
+    if (!this->domTree) {
+        this->domTree = new IrDominatorTree(this->getCFG(), false);
+    }
+    return this->domTree;
+}
+IrDominatorTree* IrAnalysisCache::getPostDominatorTree() {
+    if (!this->postDomTree) {
+        this->postDomTree = new IrDominatorTree(this->getCFG(), true);
+    }
+    return this->postDomTree;
+}
+IrLiveness* IrAnalysisCache::getLiveness() {
+    if (!this->liveness) {
+        this->liveness = new IrLiveness(this->getCFG());
+    }
+    return this->liveness;
+}
+IrLoopInfo* IrAnalysisCache::getLoopInfo() {
+    if (!this->loopInfo) {
+        this->loopInfo = new IrLoopInfo(this->getCFG(), this->getDominatorTree());
+    }
+    return this->loopInfo;
+}
+void IrAnalysisCache::invalidate() {
+    this->invalidateLiveness();
+    delete this->loopInfo;
+    delete this->postDomTree;
+    delete this->domTree;
+    delete this->cfg;
+    this->cfg         = nullptr;
+    this->domTree     = nullptr;
+    this->postDomTree = nullptr;
+    this->loopInfo    = nullptr;
+}
+void IrAnalysisCache::invalidateLiveness() {
+    delete this->liveness;
+    this->liveness = nullptr;
+}
+}; // namespace language
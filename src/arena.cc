@@ -0,0 +1,43 @@
+#include <arena.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace language {
+Arena::Arena(size_t _chunkSize) {
+    this->chunkSize     = _chunkSize;
+    this->cursor        = nullptr;
+    this->end           = nullptr;
+    this->bytesUsed     = 0;
+    this->bytesReserved = 0;
+}
+Arena::~Arena() {
+    for (char* chunk : this->chunks) {
+        std::free(chunk);
+    }
+}
+void* Arena::allocate(size_t size, size_t align) {
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(this->cursor) + align - 1) & ~(align - 1);
+    if (this->cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(this->end)) {
+        size_t newSize = size + align > this->chunkSize ? size + align : this->chunkSize;
+        char*  chunk   = static_cast<char*>(std::malloc(newSize));
+        if (!chunk) {
+            std::printf("ICE: Arena out of memory allocating %zu bytes\n", size);
+            std::exit(1);
+        }
+        this->chunks.push_back(chunk);
+        this->bytesReserved += newSize;
+        this->cursor = chunk;
+        this->end    = chunk + newSize;
+        aligned      = (reinterpret_cast<uintptr_t>(this->cursor) + align - 1) & ~(align - 1);
+    }
+    this->cursor = reinterpret_cast<char*>(aligned + size);
+    this->bytesUsed += size;
+    return reinterpret_cast<void*>(aligned);
+}
+size_t Arena::getBytesUsed() {
+    return this->bytesUsed;
+}
+size_t Arena::getBytesReserved() {
+    return this->bytesReserved;
+}
+}; // namespace language
@@ -52,6 +52,9 @@ void AttributeNode::print(size_t indent) {
     printIndent(indent + TAB_WIDTH);
     std::printf("|- Data: %zu\n", this->data.index());
 }
+AttributeType AttributeNode::getType() {
+    return this->type;
+}
 StatementNode::StatementNode(StatementNodeType __stmtType) : AstNode(AstNodeType::Statement) {
     this->__stmtNodeType = __stmtType;
 }
@@ -111,6 +114,99 @@ void IfStatementNode::print(size_t indent) {
         this->falseBody.value()->print(indent + (TAB_WIDTH * 3));
     }
 }
+ExpressionNode* IfStatementNode::getCondition() {
+    return this->condition;
+}
+StatementNode* IfStatementNode::getTrueBody() {
+    return this->trueBody;
+}
+std::optional<StatementNode*> IfStatementNode::getFalseBody() {
+    return this->falseBody;
+}
+WhileStatementNode::WhileStatementNode(ExpressionNode* condition, StatementNode* body)
+    : StatementNode(StatementNodeType::While) {
+    this->condition = condition;
+    this->body      = body;
+}
+WhileStatementNode::~WhileStatementNode() {
+    delete this->condition;
+    delete this->body;
+}
+void WhileStatementNode::print(size_t indent) {
+    printIndent(indent);
+    std::printf("|- Statement:\n");
+    printIndent(indent + TAB_WIDTH);
+    std::printf("|- While:\n");
+    printIndent(indent + (TAB_WIDTH * 2));
+    std::printf("|- Condition:\n");
+    this->condition->print(indent + (TAB_WIDTH * 3));
+    printIndent(indent + (TAB_WIDTH * 2));
+    std::printf("|- Body:\n");
+    this->body->print(indent + (TAB_WIDTH * 3));
+}
+ExpressionNode* WhileStatementNode::getCondition() {
+    return this->condition;
+}
+StatementNode* WhileStatementNode::getBody() {
+    return this->body;
+}
+ForStatementNode::ForStatementNode(std::optional<StatementNode*>  init,
+                                   std::optional<ExpressionNode*> condition,
+                                   std::optional<ExpressionNode*> step, StatementNode* body)
+    : StatementNode(StatementNodeType::For) {
+    this->init      = init;
+    this->condition = condition;
+    this->step      = step;
+    this->body      = body;
+}
+ForStatementNode::~ForStatementNode() {
+    if (this->init.has_value()) {
+        delete this->init.value();
+    }
+    if (this->condition.has_value()) {
+        delete this->condition.value();
+    }
+    if (this->step.has_value()) {
+        delete this->step.value();
+    }
+    delete this->body;
+}
+void ForStatementNode::print(size_t indent) {
+    printIndent(indent);
+    std::printf("|- Statement:\n");
+    printIndent(indent + TAB_WIDTH);
+    std::printf("|- For:\n");
+    if (this->init.has_value()) {
+        printIndent(indent + (TAB_WIDTH * 2));
+        std::printf("|- Init:\n");
+        this->init.value()->print(indent + (TAB_WIDTH * 3));
+    }
+    if (this->condition.has_value()) {
+        printIndent(indent + (TAB_WIDTH * 2));
+        std::printf("|- Condition:\n");
+        this->condition.value()->print(indent + (TAB_WIDTH * 3));
+    }
+    if (this->step.has_value()) {
+        printIndent(indent + (TAB_WIDTH * 2));
+        std::printf("|- Step:\n");
+        this->step.value()->print(indent + (TAB_WIDTH * 3));
+    }
+    printIndent(indent + (TAB_WIDTH * 2));
+    std::printf("|- Body:\n");
+    this->body->print(indent + (TAB_WIDTH * 3));
+}
+std::optional<StatementNode*> ForStatementNode::getInit() {
+    return this->init;
+}
+std::optional<ExpressionNode*> ForStatementNode::getCondition() {
+    return this->condition;
+}
+std::optional<ExpressionNode*> ForStatementNode::getStep() {
+    return this->step;
+}
+StatementNode* ForStatementNode::getBody() {
+    return this->body;
+}
 ExpressionStatementNode::ExpressionStatementNode(ExpressionNode* expr)
     : StatementNode(StatementNodeType::Expression) {
     this->expr = expr;
@@ -125,6 +221,9 @@ void ExpressionStatementNode::print(size_t indent) {
     std::printf("|- Expression:\n");
     this->expr->print(indent + TAB_WIDTH * 2);
 }
+ExpressionNode* ExpressionStatementNode::getExpr() {
+    return this->expr;
+}
 CompoundStatementNode::CompoundStatementNode(std::vector<StatementNode*> nodes)
     : StatementNode(StatementNodeType::Compound) {
     this->nodes = nodes;
@@ -213,6 +312,12 @@ void UnaryExpressionNode::print(size_t indent) {
     std::printf("|- Expression:\n");
     this->expr->print(indent + (TAB_WIDTH * 3));
 }
+std::string UnaryExpressionNode::getOperator() {
+    return this->unaryOp;
+}
+ExpressionNode* UnaryExpressionNode::getExpr() {
+    return this->expr;
+}
 BinaryExpressionNode::BinaryExpressionNode(ExpressionNode* lhs, ExpressionNode* rhs,
                                            std::string _operator)
     : ExpressionNode(ExpressionNodeType::Binary) {
@@ -279,6 +384,12 @@ void FunctionCallExpressionNode::print(size_t indent) {
         arg->print(indent + (TAB_WIDTH * 3));
     }
 }
+ExpressionNode* FunctionCallExpressionNode::getCallee() {
+    return this->callee;
+}
+std::vector<ExpressionNode*> FunctionCallExpressionNode::getArguments() {
+    return this->arguments;
+}
 AssignmentExpressionNode::AssignmentExpressionNode(ExpressionNode* assignee, ExpressionNode* value)
     : ExpressionNode(ExpressionNodeType::Assignment) {
     this->assignee = assignee;
@@ -303,6 +414,12 @@ void AssignmentExpressionNode::print(size_t indent) {
     std::printf("|- Value:\n");
     this->value->print(indent + (TAB_WIDTH * 3));
 }
+ExpressionNode* AssignmentExpressionNode::getAssignee() {
+    return this->assignee;
+}
+ExpressionNode* AssignmentExpressionNode::getValue() {
+    return this->value;
+}
 CastExpressionNode::CastExpressionNode(ExpressionNode* value, TypeSpec* type)
     : ExpressionNode(ExpressionNodeType::Cast) {
     this->value = value;
@@ -532,9 +649,11 @@ void FunctionDeclarationNode::print(size_t indent) {
     for (DeclarationNode* param : this->params) {
         param->print(indent + (TAB_WIDTH * 3));
     }
-    printIndent(indent + (TAB_WIDTH * 2));
-    std::printf("|- Body:\n");
-    this->body->print(indent + (TAB_WIDTH * 3));
+    if (this->body) {
+        printIndent(indent + (TAB_WIDTH * 2));
+        std::printf("|- Body:\n");
+        this->body->print(indent + (TAB_WIDTH * 3));
+    }
 }
 StatementNode* FunctionDeclarationNode::getBody() {
     return this->body;
@@ -0,0 +1,441 @@
+#include <cgen.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace language {
+static std::string getTypeName(IrType type) {
+    switch (type.type) {
+    case IrTypeType::I32: {
+        return "uint32_t";
+    } break;
+    case IrTypeType::I64: {
+        return "uint64_t";
+    } break;
+    case IrTypeType::Pointer: {
+        return "void*";
+    } break;
+    case IrTypeType::Void: {
+        return "void";
+    } break;
+    default: {
+        std::printf("TODO: C type for IR type %llu\n", type.type);
+        std::exit(1);
+    } break;
+    }
+}
+static std::string getSignedTypeName(IrType type) {
+    switch (type.type) {
+    case IrTypeType::I32: {
+        return "int32_t";
+    } break;
+    case IrTypeType::I64: {
+        return "int64_t";
+    } break;
+    case IrTypeType::Pointer: {
+        return "intptr_t";
+    } break;
+    default: {
+        std::printf("ICE: No signed C type for IR type %llu\n", type.type);
+        std::exit(1);
+    } break;
+    }
+}
+// The C standard wants `int main`, the exit status is truncated to 8 bits either way.
+static bool isEntryPoint(IrFunction* func) {
+    return func->noMangle && func->name == "main";
+}
+static std::string getReturnTypeName(IrFunction* func) {
+    return isEntryPoint(func) ? "int" : getTypeName(func->returnType);
+}
+static const char* getLinkage(bool noMangle) {
+    return noMangle ? "" : "static ";
+}
+static std::string getConstant(IrType type, int64_t value) {
+    switch (type.type) {
+    case IrTypeType::I32: {
+        return std::to_string((uint32_t)value) + "u";
+    } break;
+    case IrTypeType::I64: {
+        return std::to_string((uint64_t)value) + "ull";
+    } break;
+    case IrTypeType::Pointer: {
+        return "((void*)" + std::to_string((uint64_t)value) + "ull)";
+    } break;
+    default: {
+        std::printf("ICE: No C constant of IR type %llu\n", type.type);
+        std::exit(1);
+    } break;
+    }
+}
+static const char* getOperator(IrInstructionType type) {
+    switch (type) {
+    case IrInstructionType::Add: {
+        return "+";
+    } break;
+    case IrInstructionType::Sub: {
+        return "-";
+    } break;
+    case IrInstructionType::Mul: {
+        return "*";
+    } break;
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv: {
+        return "/";
+    } break;
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem: {
+        return "%";
+    } break;
+    case IrInstructionType::And: {
+        return "&";
+    } break;
+    case IrInstructionType::Shl: {
+        return "<<";
+    } break;
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr: {
+        return ">>";
+    } break;
+    case IrInstructionType::Eq: {
+        return "==";
+    } break;
+    case IrInstructionType::Ne: {
+        return "!=";
+    } break;
+    case IrInstructionType::Slt:
+    case IrInstructionType::Ult: {
+        return "<";
+    } break;
+    case IrInstructionType::Sle:
+    case IrInstructionType::Ule: {
+        return "<=";
+    } break;
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Ugt: {
+        return ">";
+    } break;
+    case IrInstructionType::Sge:
+    case IrInstructionType::Uge: {
+        return ">=";
+    } break;
+    default: {
+        std::printf("ICE: No C operator for instruction type %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+static bool isSignedComparison(IrInstructionType type) {
+    return type == IrInstructionType::Slt || type == IrInstructionType::Sle ||
+           type == IrInstructionType::Sgt || type == IrInstructionType::Sge;
+}
+static bool isShift(IrInstructionType type) {
+    return type == IrInstructionType::Shl || type == IrInstructionType::Lshr ||
+           type == IrInstructionType::Ashr;
+}
+static IrInstruction* getReserve(IrOperand& operand) {
+    if (operand.type != IrOperandType::SSA || operand.value->kind != IrValueKind::Instruction) {
+        return nullptr;
+    }
+    IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+    return inst->type == IrInstructionType::Reserve ? inst : nullptr;
+}
+CGen::CGen(IrModule* _module) {
+    this->module = _module;
+}
+CGen::~CGen() {
+}
+void CGen::emit(const char* format, ...) {
+    va_list args;
+    va_list copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    int length = std::vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    std::string line(length, '\0');
+    std::vsnprintf(line.data(), length + 1, format, args);
+    va_end(args);
+    this->source += line;
+}
+void CGen::generate() {
+    this->source.clear();
+    this->emit("#include <stdint.h>\n\n");
+    for (IrObject* obj : this->module->objects) {
+        this->emitObject(obj);
+    }
+    for (IrFunction* func : this->module->functions) {
+        this->emitPrototype(func);
+        this->emit(";\n");
+    }
+    for (IrFunction* func : this->module->functions) {
+        if (!func->blocks.empty()) {
+            this->emit("\n");
+            this->emitFunction(func);
+        }
+    }
+    for (IrFunction* func : this->module->functions) {
+        if (func->name == "main" && !func->blocks.empty() && !isEntryPoint(func)) {
+            this->emitEntryPoint(func);
+        }
+    }
+}
+std::string CGen::getSource() {
+    return this->source;
+}
+void CGen::emitObject(IrObject* obj) {
+    if (obj->value.type != IrOperandType::Const) {
+        std::printf("TODO: Initializer of global `%s` is not a constant\n", obj->name.c_str());
+        std::exit(1);
+    }
+    this->emit("%s%s %s = %s;\n", getLinkage(obj->noMangle), getTypeName(obj->type).c_str(),
+               obj->getSymbolName().c_str(), getConstant(obj->type, obj->value.constant).c_str());
+}
+void CGen::emitPrototype(IrFunction* func) {
+    this->emit("%s%s %s(", getLinkage(func->noMangle || func->blocks.empty()),
+               getReturnTypeName(func).c_str(), func->getSymbolName().c_str());
+    if (func->arguments.empty()) {
+        this->emit("void");
+    }
+    for (size_t i = 0; i < func->arguments.size(); ++i) {
+        IrArgument* arg = func->arguments.at(i);
+        this->emit("%s%s v%u", i ? ", " : "", getTypeName(arg->valueType).c_str(), arg->number);
+    }
+    this->emit(")");
+}
+void CGen::emitFunction(IrFunction* func) {
+    this->emitPrototype(func);
+    this->emit(" {\n");
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Reserve) {
+                this->emit("    %s s%u;\n", getTypeName(inst->getOperand(0).irType).c_str(),
+                           inst->number);
+            } else if (inst->hasResult && inst->type != IrInstructionType::Const) {
+                this->emit("    %s v%u;\n", getTypeName(inst->valueType).c_str(), inst->number);
+            }
+            if (inst->type == IrInstructionType::Phi) {
+                this->emit("    %s p%u;\n", getTypeName(inst->valueType).c_str(), inst->number);
+            }
+        }
+    }
+    for (IrBlock* block : func->blocks) {
+        if (block != func->getEntryBlock()) {
+            this->emit("bb%u:;\n", block->number);
+        }
+        for (IrInstruction* inst : block->insts) {
+            this->emitInstruction(inst);
+        }
+    }
+    this->emit("}\n");
+}
+// `cc` starts the program at the C name `main`, a mangled `main` is called from there.
+void CGen::emitEntryPoint(IrFunction* func) {
+    this->emit("\nint main(void) {\n");
+    if (func->returnType.type == IrTypeType::Void) {
+        this->emit("    %s();\n", func->getSymbolName().c_str());
+        this->emit("    return 0;\n");
+    } else {
+        this->emit("    return (int)%s();\n", func->getSymbolName().c_str());
+    }
+    this->emit("}\n");
+}
+std::string CGen::getValue(IrOperand& operand) {
+    switch (operand.type) {
+    case IrOperandType::Const: {
+        return getConstant(operand.irType, operand.constant);
+    } break;
+    case IrOperandType::SSA: {
+        IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+        if (operand.value->kind == IrValueKind::Instruction &&
+            inst->type == IrInstructionType::Const) {
+            return getConstant(inst->valueType, inst->getOperand(0).constant);
+        }
+        if (getReserve(operand)) {
+            return "(void*)&s" + std::to_string(operand.value->number);
+        }
+        return "v" + std::to_string(operand.value->number);
+    } break;
+    case IrOperandType::Global: {
+        return "(void*)&" + operand.object->getSymbolName();
+    } break;
+    default: {
+        std::printf("TODO: C value for operand type %llu\n", operand.type);
+        std::exit(1);
+    } break;
+    }
+}
+// Lvalue for a memory access of `type`, the slot or global itself when it has that type.
+std::string CGen::getAccess(IrOperand& pointer, IrType type) {
+    IrInstruction* reserve = getReserve(pointer);
+    if (reserve && reserve->getOperand(0).irType == type) {
+        return "s" + std::to_string(reserve->number);
+    }
+    if (pointer.type == IrOperandType::Global && pointer.object->type == type) {
+        return pointer.object->getSymbolName();
+    }
+    return "*(" + getTypeName(type) + "*)" + this->getValue(pointer);
+}
+void CGen::emitInstruction(IrInstruction* inst) {
+    switch (inst->type) {
+    case IrInstructionType::Reserve:
+    case IrInstructionType::Const: {
+    } break;
+    case IrInstructionType::Store: {
+        IrOperand& value = inst->getOperand(1);
+        this->emit("    %s = %s;\n", this->getAccess(inst->getOperand(0), value.irType).c_str(),
+                   this->getValue(value).c_str());
+    } break;
+    case IrInstructionType::Load: {
+        this->emit("    v%u = %s;\n", inst->number,
+                   this->getAccess(inst->getOperand(0), inst->valueType).c_str());
+    } break;
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        this->emitCast(inst);
+    } break;
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem:
+    case IrInstructionType::And:
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr: {
+        this->emitBinary(inst);
+    } break;
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh: {
+        this->emitMultiplyHigh(inst);
+    } break;
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge: {
+        std::string cast;
+        if (isSignedComparison(inst->type)) {
+            cast = "(" + getSignedTypeName(inst->getOperand(0).irType) + ")";
+        }
+        this->emit("    v%u = %s%s %s %s%s;\n", inst->number, cast.c_str(),
+                   this->getValue(inst->getOperand(0)).c_str(), getOperator(inst->type),
+                   cast.c_str(), this->getValue(inst->getOperand(1)).c_str());
+    } break;
+    case IrInstructionType::Phi: {
+        this->emit("    v%u = p%u;\n", inst->number, inst->number);
+    } break;
+    case IrInstructionType::Call: {
+        this->emitCall(inst);
+    } break;
+    case IrInstructionType::Return: {
+        IrOperand& value = inst->getOperand(0);
+        if (value.type == IrOperandType::Type) {
+            this->emit("    return;\n");
+        } else {
+            this->emit("    return %s;\n", this->getValue(value).c_str());
+        }
+    } break;
+    case IrInstructionType::Br: {
+        this->emitEdge(inst->parent, inst->getOperand(0).block, 4);
+    } break;
+    case IrInstructionType::CondBr: {
+        this->emit("    if (%s) {\n", this->getValue(inst->getOperand(0)).c_str());
+        this->emitEdge(inst->parent, inst->getOperand(1).block, 8);
+        this->emit("    } else {\n");
+        this->emitEdge(inst->parent, inst->getOperand(2).block, 8);
+        this->emit("    }\n");
+    } break;
+    default: {
+        std::printf("TODO: C lowering of instruction type %llu\n", inst->type);
+        std::exit(1);
+    } break;
+    }
+}
+// Signed division and `ashr` work on the signed type. Shift amounts are masked to the width, C
+// leaves shifting by the width or more undefined.
+void CGen::emitBinary(IrInstruction* inst) {
+    IrInstructionType type = inst->type;
+    std::string       cast;
+    if (type == IrInstructionType::Sdiv || type == IrInstructionType::Srem ||
+        type == IrInstructionType::Ashr) {
+        cast = "(" + getSignedTypeName(inst->valueType) + ")";
+    }
+    std::string lhs = cast + this->getValue(inst->getOperand(0));
+    std::string rhs = this->getValue(inst->getOperand(1));
+    if (isShift(type)) {
+        rhs = "(" + rhs + " & " + (inst->valueType.type == IrTypeType::I32 ? "31u" : "63u") + ")";
+    } else {
+        rhs = cast + rhs;
+    }
+    this->emit("    v%u = (%s)(%s %s %s);\n", inst->number,
+               getTypeName(inst->valueType).c_str(), lhs.c_str(), getOperator(type), rhs.c_str());
+}
+// The product is computed at twice the width, 64 bit values go through the __int128 extension.
+void CGen::emitMultiplyHigh(IrInstruction* inst) {
+    bool        isSigned = inst->type == IrInstructionType::Smulh;
+    bool        narrow   = inst->valueType.type == IrTypeType::I32;
+    std::string cast     = isSigned ? "(" + getSignedTypeName(inst->valueType) + ")" : "";
+    std::string wide     = narrow ? (isSigned ? "int64_t" : "uint64_t")
+                                  : (isSigned ? "__int128" : "unsigned __int128");
+    std::string product  = "(" + wide + ")" + cast + this->getValue(inst->getOperand(0)) + " * " +
+                          cast + this->getValue(inst->getOperand(1));
+    if (!narrow) {
+        product = "__extension__(" + product + ")";
+    }
+    this->emit("    v%u = (%s)(%s >> %s);\n", inst->number,
+               getTypeName(inst->valueType).c_str(), product.c_str(), narrow ? "32" : "64");
+}
+// Widening goes through the signed type of the source for `sext`, pointers through uintptr_t.
+void CGen::emitCast(IrInstruction* inst) {
+    IrOperand&  operand = inst->getOperand(0);
+    IrType      from    = operand.irType;
+    IrType      to      = inst->valueType;
+    std::string value   = this->getValue(operand);
+    if (from.type == IrTypeType::Pointer && to.type != IrTypeType::Pointer) {
+        value = "(uintptr_t)" + value;
+    } else if (from.type != IrTypeType::Pointer && to.type == IrTypeType::Pointer) {
+        value = "(uintptr_t)" + value;
+    } else if (inst->type == IrInstructionType::Sext) {
+        value = "(" + getSignedTypeName(from) + ")" + value;
+    }
+    this->emit("    v%u = (%s)%s;\n", inst->number, getTypeName(to).c_str(), value.c_str());
+}
+void CGen::emitCall(IrInstruction* inst) {
+    IrFunction* callee = inst->getOperand(0).function;
+    std::string args;
+    for (size_t i = 1; i < inst->numOperands; ++i) {
+        if (i > 1) {
+            args += ", ";
+        }
+        args += this->getValue(inst->getOperand(i));
+    }
+    if (inst->hasResult) {
+        this->emit("    v%u = %s(%s);\n", inst->number, callee->getSymbolName().c_str(),
+                   args.c_str());
+    } else {
+        this->emit("    %s(%s);\n", callee->getSymbolName().c_str(), args.c_str());
+    }
+}
+void CGen::emitEdge(IrBlock* pred, IrBlock* succ, int indent) {
+    for (IrInstruction* inst : succ->insts) {
+        if (inst->type != IrInstructionType::Phi) {
+            break;
+        }
+        for (size_t i = 0; i + 1 < inst->numOperands; i += 2) {
+            if (inst->getOperand(i + 1).block == pred) {
+                this->emit("%*sp%u = %s;\n", indent, "", inst->number,
+                           this->getValue(inst->getOperand(i)).c_str());
+            }
+        }
+    }
+    this->emit("%*sgoto bb%u;\n", indent, "", succ->number);
+}
+}; // namespace language
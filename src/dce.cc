@@ -0,0 +1,41 @@
+#include <passes.h>
+
+namespace language {
+static bool isTriviallyDead(IrInstruction* inst) {
+    return inst->parent && inst->hasResult && !inst->hasUses() && !inst->hasSideEffects();
+}
+bool eliminateDeadCode(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    std::vector<IrInstruction*> worklist;
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (isTriviallyDead(inst)) {
+                worklist.push_back(inst);
+            }
+        }
+    }
+    bool changed = false;
+    while (!worklist.empty()) {
+        IrInstruction* inst = worklist.back();
+        worklist.pop_back();
+        if (!isTriviallyDead(inst)) {
+            continue;
+        }
+        std::vector<IrInstruction*> operands;
+        for (size_t i = 0; i < inst->numOperands; ++i) {
+            IrValue* value = inst->getOperandValue(i);
+            if (value && value->kind == IrValueKind::Instruction) {
+                operands.push_back(static_cast<IrInstruction*>(value));
+            }
+        }
+        inst->eraseFromParent();
+        changed = true;
+        for (IrInstruction* operand : operands) {
+            if (isTriviallyDead(operand)) {
+                worklist.push_back(operand);
+            }
+        }
+    }
+    return changed;
+}
+}; // namespace language
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <elfobject.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace language {
+static uint64_t alignTo(uint64_t value, uint64_t alignment) {
+    return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+// Offset of `string` in a string table that starts with the empty string.
+static uint32_t addString(std::vector<uint8_t>& table, std::string string) {
+    if (string.empty()) {
+        return 0;
+    }
+    uint32_t offset = table.size();
+    table.insert(table.end(), string.begin(), string.end());
+    table.push_back(0);
+    return offset;
+}
+bool isElfFile(std::string path) {
+    uint8_t    magic[SELFMAG];
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    size_t read = std::fread(magic, SELFMAG, 1, f);
+    std::fclose(f);
+    return read == 1 && std::memcmp(magic, ELFMAG, SELFMAG) == 0;
+}
+ElfObject::ElfObject(X86Assembler* assembler, std::string _name) {
+    this->name = _name;
+    this->symbols.push_back({"", ELF_UNDEFINED, 0, 0, STB_LOCAL, STT_NOTYPE, STV_DEFAULT});
+    // Every section gets a section symbol, relocations against local labels go through it.
+    std::vector<X86Section>& x86Sections = assembler->getSections();
+    for (size_t i = 0; i < x86Sections.size(); ++i) {
+        X86Section& x86Section = x86Sections.at(i);
+        ElfSection  section;
+        section.name      = x86Section.name;
+        section.type      = SHT_PROGBITS;
+        section.flags     = (x86Section.allocated ? SHF_ALLOC : 0) |
+                        (x86Section.executable ? SHF_EXECINSTR : 0) |
+                        (x86Section.writable ? SHF_WRITE : 0);
+        section.alignment = x86Section.alignment;
+        section.size      = x86Section.bytes.size();
+        section.bytes     = x86Section.bytes;
+        this->sections.push_back(section);
+        this->symbols.push_back({"", (int32_t)i, 0, 0, STB_LOCAL, STT_SECTION, STV_DEFAULT});
+    }
+    std::unordered_map<std::string, uint32_t> symbolIndex;
+    for (X86Symbol& x86Symbol : assembler->getSymbols()) {
+        if (x86Symbol.name.starts_with(".L")) {
+            continue;
+        }
+        ElfSymbol symbol;
+        symbol.name       = x86Symbol.name;
+        symbol.section    = x86Symbol.section < 0 ? ELF_UNDEFINED : x86Symbol.section;
+        symbol.value      = x86Symbol.offset;
+        symbol.size       = x86Symbol.size;
+        symbol.binding    = x86Symbol.global || x86Symbol.section < 0 ? STB_GLOBAL : STB_LOCAL;
+        symbol.type       = STT_NOTYPE;
+        symbol.visibility = STV_DEFAULT;
+        if (x86Symbol.function) {
+            symbol.type = STT_FUNC;
+        } else if (x86Symbol.section >= 0 && !x86Sections.at(x86Symbol.section).executable) {
+            symbol.type = STT_OBJECT;
+        }
+        symbolIndex[symbol.name] = this->symbols.size();
+        this->symbols.push_back(symbol);
+    }
+    for (X86Relocation& x86Relocation : assembler->getRelocations()) {
+        X86Symbol*    target = assembler->findSymbol(x86Relocation.symbol);
+        ElfRelocation relocation;
+        relocation.section = x86Relocation.section;
+        relocation.offset  = x86Relocation.offset;
+        relocation.type    = x86Relocation.kind == X86RelocationKind::Branch ? R_X86_64_PLT32
+                                                                             : R_X86_64_PC32;
+        relocation.addend  = x86Relocation.addend;
+        if (target->global || target->section < 0) {
+            relocation.symbol = symbolIndex.at(target->name);
+        } else {
+            relocation.symbol = 1 + target->section;
+            relocation.addend += target->offset;
+        }
+        this->relocations.push_back(relocation);
+    }
+}
+ElfObject::ElfObject(std::string path) {
+    this->name = path;
+    int         fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    uint64_t size = info.st_size;
+    if (size < sizeof(Elf64_Ehdr)) {
+        this->fail();
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    const uint8_t* data = (const uint8_t*)mapping;
+    Elf64_Ehdr     header;
+    std::memcpy(&header, data, sizeof(Elf64_Ehdr));
+    if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+        header.e_ident[EI_CLASS] != ELFCLASS64 || header.e_ident[EI_DATA] != ELFDATA2LSB ||
+        header.e_type != ET_REL || header.e_machine != EM_X86_64 ||
+        header.e_shentsize != sizeof(Elf64_Shdr)) {
+        std::fprintf(stderr, "`%s` is not an x86-64 relocatable object\n", path.c_str());
+        std::exit(1);
+    }
+    std::vector<Elf64_Shdr> headers(header.e_shnum);
+    if (!headers.empty()) {
+        std::memcpy(headers.data(),
+                    this->getBytes(data, size, header.e_shoff, headers.size() * sizeof(Elf64_Shdr)),
+                    headers.size() * sizeof(Elf64_Shdr));
+    }
+    if (header.e_shstrndx >= headers.size()) {
+        this->fail();
+    }
+    Elf64_Shdr& names = headers.at(header.e_shstrndx);
+    const char* shstrtab =
+        (const char*)this->getBytes(data, size, names.sh_offset, names.sh_size);
+    auto getName = [&](const char* table, uint64_t tableSize, uint32_t offset) {
+        if (offset >= tableSize || !std::memchr(table + offset, 0, tableSize - offset)) {
+            this->fail();
+        }
+        return std::string(table + offset);
+    };
+
+    // Symbol tables, string tables and relocations are not sections of the object in memory.
+    std::vector<int32_t> sectionIndex(headers.size(), ELF_UNDEFINED);
+    size_t               symtab = 0;
+    for (size_t i = 1; i < headers.size(); ++i) {
+        Elf64_Shdr& shdr = headers.at(i);
+        switch (shdr.sh_type) {
+        case SHT_SYMTAB: {
+            symtab = i;
+        } break;
+        case SHT_STRTAB:
+        case SHT_RELA:
+        case SHT_GROUP: {
+        } break;
+        case SHT_REL: {
+            std::fprintf(stderr, "TODO: SHT_REL relocations in `%s`\n", path.c_str());
+            std::exit(1);
+        } break;
+        default: {
+            ElfSection section;
+            section.name      = getName(shstrtab, names.sh_size, shdr.sh_name);
+            section.type      = shdr.sh_type;
+            section.flags     = shdr.sh_flags & ~(uint64_t)SHF_GROUP;
+            section.alignment = shdr.sh_addralign ? shdr.sh_addralign : 1;
+            section.size      = shdr.sh_size;
+            if (shdr.sh_type != SHT_NOBITS) {
+                const uint8_t* bytes = this->getBytes(data, size, shdr.sh_offset, shdr.sh_size);
+                section.bytes.assign(bytes, bytes + shdr.sh_size);
+            }
+            sectionIndex.at(i) = this->sections.size();
+            this->sections.push_back(section);
+        } break;
+        }
+    }
+    if (symtab == 0) {
+        this->symbols.push_back({"", ELF_UNDEFINED, 0, 0, STB_LOCAL, STT_NOTYPE, STV_DEFAULT});
+        munmap(mapping, size);
+        return;
+    }
+    Elf64_Shdr& symbolHeader = headers.at(symtab);
+    if (symbolHeader.sh_entsize != sizeof(Elf64_Sym) || symbolHeader.sh_link >= headers.size()) {
+        this->fail();
+    }
+    Elf64_Shdr& stringHeader = headers.at(symbolHeader.sh_link);
+    const char* strtab =
+        (const char*)this->getBytes(data, size, stringHeader.sh_offset, stringHeader.sh_size);
+    const uint8_t* symbolData =
+        this->getBytes(data, size, symbolHeader.sh_offset, symbolHeader.sh_size);
+    for (uint64_t i = 0; i < symbolHeader.sh_size / sizeof(Elf64_Sym); ++i) {
+        Elf64_Sym sym;
+        std::memcpy(&sym, symbolData + i * sizeof(Elf64_Sym), sizeof(Elf64_Sym));
+        ElfSymbol symbol;
+        symbol.name       = getName(strtab, stringHeader.sh_size, sym.st_name);
+        symbol.value      = sym.st_value;
+        symbol.size       = sym.st_size;
+        symbol.binding    = ELF64_ST_BIND(sym.st_info);
+        symbol.type       = ELF64_ST_TYPE(sym.st_info);
+        symbol.visibility = ELF64_ST_VISIBILITY(sym.st_other);
+        if (sym.st_shndx == SHN_UNDEF) {
+            symbol.section = ELF_UNDEFINED;
+        } else if (sym.st_shndx == SHN_ABS) {
+            symbol.section = ELF_ABSOLUTE;
+        } else if (sym.st_shndx == SHN_COMMON) {
+            std::fprintf(stderr, "TODO: Common symbol `%s` in `%s`\n", symbol.name.c_str(),
+                         path.c_str());
+            std::exit(1);
+        } else if (sym.st_shndx < headers.size() &&
+                   sectionIndex.at(sym.st_shndx) != ELF_UNDEFINED) {
+            symbol.section = sectionIndex.at(sym.st_shndx);
+        } else {
+            this->fail();
+        }
+        this->symbols.push_back(symbol);
+    }
+    if (this->symbols.empty()) {
+        this->fail();
+    }
+    for (size_t i = 1; i < headers.size(); ++i) {
+        Elf64_Shdr& shdr = headers.at(i);
+        if (shdr.sh_type != SHT_RELA || shdr.sh_info >= headers.size() ||
+            sectionIndex.at(shdr.sh_info) == ELF_UNDEFINED) {
+            continue;
+        }
+        if (shdr.sh_entsize != sizeof(Elf64_Rela) || shdr.sh_link != symtab) {
+            this->fail();
+        }
+        const uint8_t* relaData = this->getBytes(data, size, shdr.sh_offset, shdr.sh_size);
+        for (uint64_t j = 0; j < shdr.sh_size / sizeof(Elf64_Rela); ++j) {
+            Elf64_Rela rela;
+            std::memcpy(&rela, relaData + j * sizeof(Elf64_Rela), sizeof(Elf64_Rela));
+            ElfRelocation relocation;
+            relocation.section = sectionIndex.at(shdr.sh_info);
+            relocation.offset  = rela.r_offset;
+            relocation.type    = ELF64_R_TYPE(rela.r_info);
+            relocation.symbol  = ELF64_R_SYM(rela.r_info);
+            relocation.addend  = rela.r_addend;
+            if (relocation.symbol >= this->symbols.size() ||
+                relocation.offset > this->sections.at(relocation.section).size) {
+                this->fail();
+            }
+            this->relocations.push_back(relocation);
+        }
+    }
+    munmap(mapping, size);
+}
+std::string& ElfObject::getName() {
+    return this->name;
+}
+std::vector<ElfSection>& ElfObject::getSections() {
+    return this->sections;
+}
+std::vector<ElfSymbol>& ElfObject::getSymbols() {
+    return this->symbols;
+}
+std::vector<ElfRelocation>& ElfObject::getRelocations() {
+    return this->relocations;
+}
+void ElfObject::addAlias(std::string alias, std::string target) {
+    for (size_t i = 0; i < this->symbols.size(); ++i) {
+        if (this->symbols.at(i).name == target && this->symbols.at(i).section != ELF_UNDEFINED) {
+            ElfSymbol symbol = this->symbols.at(i);
+            symbol.name      = alias;
+            symbol.binding   = STB_GLOBAL;
+            this->symbols.push_back(symbol);
+            return;
+        }
+    }
+    std::printf("ICE: Alias `%s` of undefined symbol `%s`\n", alias.c_str(), target.c_str());
+    std::exit(1);
+}
+void ElfObject::write(std::string path) {
+    // Section headers: null, the sections, their `.rela` sections, then the tables.
+    std::vector<uint32_t> relocated;
+    std::vector<size_t>   relocationCount(this->sections.size());
+    for (ElfRelocation& relocation : this->relocations) {
+        if (relocationCount.at(relocation.section)++ == 0) {
+            relocated.push_back(relocation.section);
+        }
+    }
+    std::sort(relocated.begin(), relocated.end());
+    uint32_t symtabIndex   = 1 + this->sections.size() + relocated.size();
+    uint32_t strtabIndex   = symtabIndex + 1;
+    uint32_t shstrtabIndex = symtabIndex + 2;
+
+    // The symbol table lists locals before globals.
+    std::vector<uint32_t> symbolIndex(this->symbols.size());
+    std::vector<uint8_t>  strtab = {0};
+    std::vector<uint8_t>  symtab;
+    uint32_t              firstGlobal = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            firstGlobal = symtab.size() / sizeof(Elf64_Sym);
+        }
+        for (size_t i = 0; i < this->symbols.size(); ++i) {
+            ElfSymbol& symbol = this->symbols.at(i);
+            if ((symbol.binding == STB_LOCAL) != (pass == 0)) {
+                continue;
+            }
+            Elf64_Sym sym;
+            sym.st_name  = addString(strtab, symbol.name);
+            sym.st_info  = ELF64_ST_INFO(symbol.binding, symbol.type);
+            sym.st_other = symbol.visibility;
+            sym.st_value = symbol.value;
+            sym.st_size  = symbol.size;
+            if (i == 0 || symbol.section == ELF_UNDEFINED) {
+                sym.st_shndx = SHN_UNDEF;
+            } else if (symbol.section == ELF_ABSOLUTE) {
+                sym.st_shndx = SHN_ABS;
+            } else {
+                sym.st_shndx = 1 + symbol.section;
+            }
+            symbolIndex.at(i) = symtab.size() / sizeof(Elf64_Sym);
+            symtab.insert(symtab.end(), (uint8_t*)&sym, (uint8_t*)&sym + sizeof(Elf64_Sym));
+        }
+    }
+
+    std::vector<uint8_t>    shstrtab = {0};
+    std::vector<Elf64_Shdr> headers(shstrtabIndex + 1);
+    uint64_t offset = sizeof(Elf64_Ehdr);
+    for (size_t i = 0; i < this->sections.size(); ++i) {
+        ElfSection& section = this->sections.at(i);
+        Elf64_Shdr& shdr    = headers.at(1 + i);
+        offset              = alignTo(offset, section.alignment);
+        shdr.sh_name        = addString(shstrtab, section.name);
+        shdr.sh_type        = section.type;
+        shdr.sh_flags       = section.flags;
+        shdr.sh_offset      = offset;
+        shdr.sh_size        = section.size;
+        shdr.sh_addralign   = section.alignment;
+        offset += section.bytes.size();
+    }
+    std::vector<std::vector<uint8_t>> relas;
+    for (size_t i = 0; i < relocated.size(); ++i) {
+        std::vector<uint8_t> rela;
+        for (ElfRelocation& relocation : this->relocations) {
+            if (relocation.section != relocated.at(i)) {
+                continue;
+            }
+            Elf64_Rela entry;
+            entry.r_offset = relocation.offset;
+            entry.r_info   = ELF64_R_INFO(symbolIndex.at(relocation.symbol), relocation.type);
+            entry.r_addend = relocation.addend;
+            rela.insert(rela.end(), (uint8_t*)&entry, (uint8_t*)&entry + sizeof(Elf64_Rela));
+        }
+        Elf64_Shdr& shdr  = headers.at(1 + this->sections.size() + i);
+        offset            = alignTo(offset, 8);
+        shdr.sh_name      = addString(shstrtab, ".rela" + this->sections.at(relocated.at(i)).name);
+        shdr.sh_type      = SHT_RELA;
+        shdr.sh_flags     = SHF_INFO_LINK;
+        shdr.sh_offset    = offset;
+        shdr.sh_size      = rela.size();
+        shdr.sh_link      = symtabIndex;
+        shdr.sh_info      = 1 + relocated.at(i);
+        shdr.sh_addralign = 8;
+        shdr.sh_entsize   = sizeof(Elf64_Rela);
+        offset += rela.size();
+        relas.push_back(rela);
+    }
+    Elf64_Shdr& symtabHeader  = headers.at(symtabIndex);
+    offset                    = alignTo(offset, 8);
+    symtabHeader.sh_name      = addString(shstrtab, ".symtab");
+    symtabHeader.sh_type      = SHT_SYMTAB;
+    symtabHeader.sh_offset    = offset;
+    symtabHeader.sh_size      = symtab.size();
+    symtabHeader.sh_link      = strtabIndex;
+    symtabHeader.sh_info      = firstGlobal;
+    symtabHeader.sh_addralign = 8;
+    symtabHeader.sh_entsize   = sizeof(Elf64_Sym);
+    offset += symtab.size();
+    Elf64_Shdr& strtabHeader  = headers.at(strtabIndex);
+    strtabHeader.sh_name      = addString(shstrtab, ".strtab");
+    strtabHeader.sh_type      = SHT_STRTAB;
+    strtabHeader.sh_offset    = offset;
+    strtabHeader.sh_size      = strtab.size();
+    strtabHeader.sh_addralign = 1;
+    offset += strtab.size();
+    Elf64_Shdr& shstrtabHeader  = headers.at(shstrtabIndex);
+    shstrtabHeader.sh_name      = addString(shstrtab, ".shstrtab");
+    shstrtabHeader.sh_type      = SHT_STRTAB;
+    shstrtabHeader.sh_offset    = offset;
+    shstrtabHeader.sh_size      = shstrtab.size();
+    shstrtabHeader.sh_addralign = 1;
+    offset += shstrtab.size();
+    uint64_t headersOffset = alignTo(offset, 8);
+    uint64_t fileSize      = headersOffset + headers.size() * sizeof(Elf64_Shdr);
+
+    Elf64_Ehdr header;
+    std::memset(&header, 0, sizeof(Elf64_Ehdr));
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS]   = ELFCLASS64;
+    header.e_ident[EI_DATA]    = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI]   = ELFOSABI_SYSV;
+    header.e_type              = ET_REL;
+    header.e_machine           = EM_X86_64;
+    header.e_version           = EV_CURRENT;
+    header.e_shoff             = headersOffset;
+    header.e_ehsize            = sizeof(Elf64_Ehdr);
+    header.e_shentsize         = sizeof(Elf64_Shdr);
+    header.e_shnum             = headers.size();
+    header.e_shstrndx          = shstrtabIndex;
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, fileSize) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    void* mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    uint8_t* data = (uint8_t*)mapping;
+    std::memcpy(data, &header, sizeof(Elf64_Ehdr));
+    for (size_t i = 0; i < this->sections.size(); ++i) {
+        std::vector<uint8_t>& bytes = this->sections.at(i).bytes;
+        std::memcpy(data + headers.at(1 + i).sh_offset, bytes.data(), bytes.size());
+    }
+    for (size_t i = 0; i < relas.size(); ++i) {
+        std::memcpy(data + headers.at(1 + this->sections.size() + i).sh_offset,
+                    relas.at(i).data(), relas.at(i).size());
+    }
+    std::memcpy(data + symtabHeader.sh_offset, symtab.data(), symtab.size());
+    std::memcpy(data + strtabHeader.sh_offset, strtab.data(), strtab.size());
+    std::memcpy(data + shstrtabHeader.sh_offset, shstrtab.data(), shstrtab.size());
+    std::memcpy(data + headersOffset, headers.data(), headers.size() * sizeof(Elf64_Shdr));
+    munmap(mapping, fileSize);
+}
+void ElfObject::fail() {
+    std::fprintf(stderr, "Invalid ELF object `%s`\n", this->name.c_str());
+    std::exit(1);
+}
+const uint8_t* ElfObject::getBytes(const uint8_t* data, uint64_t size, uint64_t offset,
+                                   uint64_t length) {
+    if (offset > size || length > size - offset) {
+        this->fail();
+    }
+    return data + offset;
+}
+}; // namespace language
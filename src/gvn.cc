@@ -0,0 +1,208 @@
+#include <passes.h>
+#include <unordered_map>
+
+namespace language {
+// Identity of an instruction's result: opcode, result type and up to two operands. Loads also
+// carry the memory generation they read from, which moves on at every store.
+struct ValueKey {
+    IrInstructionType type;
+    IrTypeType        valueType;
+    IrOperandType     kinds[2];
+    IrTypeType        types[2];
+    uint64_t          payloads[2];
+    uint64_t          generation;
+    bool              operator==(const ValueKey& other) const = default;
+};
+struct ValueKeyHash {
+    size_t operator()(const ValueKey& key) const {
+        size_t hash = (size_t)key.type * 31 + (size_t)key.valueType;
+        for (size_t i = 0; i < 2; ++i) {
+            hash = hash * 131 + (size_t)key.kinds[i];
+            hash = hash * 131 + (size_t)key.types[i];
+            hash = hash * 1000003 ^ key.payloads[i];
+        }
+        return hash * 1000003 ^ key.generation;
+    }
+};
+static void setKeyOperand(ValueKey& key, size_t index, IrOperand& operand) {
+    key.kinds[index] = operand.type;
+    key.types[index] = operand.irType.type;
+    switch (operand.type) {
+    case IrOperandType::Const: {
+        key.payloads[index] = operand.constant;
+    } break;
+    case IrOperandType::SSA: {
+        key.payloads[index] = (uint64_t)operand.value;
+    } break;
+    case IrOperandType::Global: {
+        key.payloads[index] = (uint64_t)operand.object;
+    } break;
+    case IrOperandType::Label: {
+        key.payloads[index] = (uint64_t)operand.block;
+    } break;
+    case IrOperandType::Function: {
+        key.payloads[index] = (uint64_t)operand.function;
+    } break;
+    case IrOperandType::Type: {
+        key.payloads[index] = 0;
+    } break;
+    }
+}
+static bool isNumberable(IrInstruction* inst) {
+    switch (inst->type) {
+    case IrInstructionType::Const:
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem:
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh:
+    case IrInstructionType::And:
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr:
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge:
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext:
+    case IrInstructionType::Load: {
+        return inst->numOperands <= 2;
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+}
+static ValueKey getKey(IrInstruction* inst, uint64_t generation) {
+    ValueKey key  = {};
+    key.type      = inst->type;
+    key.valueType = inst->valueType.type;
+    for (size_t i = 0; i < inst->numOperands; ++i) {
+        setKeyOperand(key, i, inst->getOperand(i));
+    }
+    // Commutative operations are keyed with their operands in a fixed order.
+    bool commutative =
+        inst->type == IrInstructionType::Add || inst->type == IrInstructionType::Mul ||
+        inst->type == IrInstructionType::Smulh || inst->type == IrInstructionType::Umulh ||
+        inst->type == IrInstructionType::And || inst->type == IrInstructionType::Eq ||
+        inst->type == IrInstructionType::Ne;
+    if (commutative &&
+        (key.kinds[0] > key.kinds[1] ||
+         (key.kinds[0] == key.kinds[1] && key.payloads[0] > key.payloads[1]))) {
+        std::swap(key.kinds[0], key.kinds[1]);
+        std::swap(key.types[0], key.types[1]);
+        std::swap(key.payloads[0], key.payloads[1]);
+    }
+    if (inst->type == IrInstructionType::Load) {
+        key.generation = generation;
+    }
+    return key;
+}
+bool numberValues(IrFunction* func, IrAnalysisCache* analyses) {
+    if (func->blocks.empty()) {
+        return false;
+    }
+    IrCFG*           cfg     = analyses->getCFG();
+    IrDominatorTree* domTree = analyses->getDominatorTree();
+
+    std::unordered_map<ValueKey, IrValue*, ValueKeyHash> available;
+    std::vector<std::pair<ValueKey, IrValue*>>           undo;
+    uint64_t                                             nextGeneration = 0;
+    bool                                                 changed        = false;
+
+    // Values are only available inside the dominator subtree of their definition, `undo` restores
+    // whatever a key mapped to before the subtree was entered.
+    auto define = [&](ValueKey& key, IrValue* value) {
+        auto it = available.find(key);
+        undo.push_back({key, it == available.end() ? nullptr : it->second});
+        available[key] = value;
+    };
+    auto processBlock = [&](IrBlock* block, uint64_t generation) -> uint64_t {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Store) {
+                generation = ++nextGeneration;
+                // The stored value is what a later load of the same pointer reads.
+                IrOperand& pointer = inst->getOperand(0);
+                IrOperand& value   = inst->getOperand(1);
+                if (value.type == IrOperandType::SSA) {
+                    ValueKey key  = {};
+                    key.type      = IrInstructionType::Load;
+                    key.valueType = value.irType.type;
+                    setKeyOperand(key, 0, pointer);
+                    IrOperand loaded = createTypeOperand(value.irType);
+                    setKeyOperand(key, 1, loaded);
+                    key.generation = generation;
+                    define(key, value.value);
+                }
+                continue;
+            }
+            if (inst->hasSideEffects() && !inst->isTerminator()) {
+                generation = ++nextGeneration;
+                continue;
+            }
+            if (!inst->hasResult || !isNumberable(inst)) {
+                continue;
+            }
+            ValueKey key = getKey(inst, generation);
+            auto     it  = available.find(key);
+            if (it != available.end() && it->second) {
+                inst->replaceAllUsesWith(it->second);
+                inst->eraseFromParent();
+                changed = true;
+                continue;
+            }
+            define(key, inst);
+        }
+        return generation;
+    };
+
+    // A block keeps its dominator's memory state only when that dominator is its sole predecessor,
+    // anything else may have stored on the way in.
+    struct Frame {
+        IrBlock* block;
+        size_t   child;
+        size_t   undoMark;
+        uint64_t generation;
+    };
+    std::vector<Frame> stack;
+    IrBlock*           entry = func->getEntryBlock();
+    stack.push_back({entry, 0, undo.size(), 0});
+    stack.back().generation = processBlock(entry, ++nextGeneration);
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.child < domTree->getChildren(frame.block).size()) {
+            IrBlock*               child      = domTree->getChildren(frame.block).at(frame.child++);
+            std::vector<IrBlock*>& preds      = cfg->getPredecessors(child);
+            uint64_t               generation = frame.generation;
+            if (preds.size() != 1 || preds.front() != frame.block) {
+                generation = ++nextGeneration;
+            }
+            size_t mark = undo.size();
+            stack.push_back({child, 0, mark, processBlock(child, generation)});
+            continue;
+        }
+        while (undo.size() > frame.undoMark) {
+            if (undo.back().second) {
+                available[undo.back().first] = undo.back().second;
+            } else {
+                available.erase(undo.back().first);
+            }
+            undo.pop_back();
+        }
+        stack.pop_back();
+    }
+    return changed;
+}
+}; // namespace language
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <passes.h>
+#include <unordered_map>
+
+namespace language {
+// Cost model knobs. A call site is inlined when the callee's cost minus the bonuses of the site is
+// at most the threshold. Constant arguments are worth a flat bonus plus one for every use of the
+// parameter in the callee, those are the instructions that fold after inlining. Every loop around
+// the call site adds the hot call bonus.
+static constexpr int64_t CONSTANT_ARG_BONUS = 4;
+static constexpr int64_t HOT_CALL_BONUS     = 10;
+// Callers stop taking inlined code once they are this large, whatever the callee costs.
+static constexpr size_t MAX_CALLER_SIZE = 4096;
+
+struct CallSite {
+    IrInstruction* call;
+    uint32_t       loopDepth;
+};
+// Tarjan's algorithm over the call graph. Components come out callees first, which is the order
+// the inliner visits functions in.
+struct CallGraph {
+    std::unordered_map<IrFunction*, std::vector<IrFunction*>> callees;
+    std::unordered_map<IrFunction*, uint32_t>                 index;
+    std::unordered_map<IrFunction*, uint32_t>                 lowLink;
+    std::unordered_map<IrFunction*, uint32_t>                 component;
+    std::unordered_map<IrFunction*, bool>                     onStack;
+    std::vector<IrFunction*>                                  stack;
+    std::vector<IrFunction*>                                  order;
+    uint32_t                                                  nextIndex     = 0;
+    uint32_t                                                  nextComponent = 0;
+
+    CallGraph(IrModule* module) {
+        for (IrFunction* func : module->functions) {
+            std::vector<IrFunction*>& targets = this->callees[func];
+            for (IrBlock* block : func->blocks) {
+                for (IrInstruction* inst : block->insts) {
+                    if (inst->type == IrInstructionType::Call) {
+                        targets.push_back(inst->getOperand(0).function);
+                    }
+                }
+            }
+        }
+        for (IrFunction* func : module->functions) {
+            if (!this->index.contains(func)) {
+                this->visit(func);
+            }
+        }
+    }
+    void visit(IrFunction* func) {
+        uint32_t funcIndex  = this->nextIndex++;
+        this->index[func]   = funcIndex;
+        this->lowLink[func] = funcIndex;
+        this->onStack[func] = true;
+        this->stack.push_back(func);
+        for (IrFunction* callee : this->callees[func]) {
+            if (!this->index.contains(callee)) {
+                this->visit(callee);
+                this->lowLink[func] = std::min(this->lowLink[func], this->lowLink[callee]);
+            } else if (this->onStack[callee]) {
+                this->lowLink[func] = std::min(this->lowLink[func], this->index[callee]);
+            }
+        }
+        if (this->lowLink[func] != funcIndex) {
+            return;
+        }
+        IrFunction* member = nullptr;
+        while (member != func) {
+            member = this->stack.back();
+            this->stack.pop_back();
+            this->onStack[member]   = false;
+            this->component[member] = this->nextComponent;
+            this->order.push_back(member);
+        }
+        this->nextComponent++;
+    }
+    bool isRecursive(IrFunction* caller, IrFunction* callee) {
+        return this->component.at(caller) == this->component.at(callee);
+    }
+};
+// What the callee adds to the caller. Slots, phis, constants and jumps mostly disappear once the
+// copy is simplified, so they are free.
+static int64_t getCalleeCost(IrFunction* callee) {
+    int64_t cost = 0;
+    for (IrBlock* block : callee->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            switch (inst->type) {
+            case IrInstructionType::Reserve:
+            case IrInstructionType::Const:
+            case IrInstructionType::Phi:
+            case IrInstructionType::Br:
+            case IrInstructionType::Return: {
+            } break;
+            default: {
+                cost++;
+            } break;
+            }
+        }
+    }
+    return cost;
+}
+static int64_t getCallSiteCost(CallSite& site) {
+    IrInstruction* call   = site.call;
+    IrFunction*    callee = call->getOperand(0).function;
+    // The call itself and the moves of its arguments go away.
+    int64_t cost = getCalleeCost(callee) - (int64_t)call->numOperands;
+    for (size_t i = 1; i < call->numOperands; ++i) {
+        if (call->getOperand(i).type != IrOperandType::Const) {
+            continue;
+        }
+        cost -= CONSTANT_ARG_BONUS + (int64_t)callee->arguments.at(i - 1)->getNumUses();
+    }
+    return cost - (int64_t)site.loopDepth * HOT_CALL_BONUS;
+}
+// Replaces `call` by a copy of the callee's body. The block holding the call is split after it,
+// the copied returns jump to the second half and a phi there merges their values.
+static void inlineCall(IrInstruction* call) {
+    IrBlock*    callBlock = call->parent;
+    IrFunction* caller    = callBlock->parent;
+    IrFunction* callee    = call->getOperand(0).function;
+
+    IrBlock* continuation = caller->createBlock();
+    caller->blocks.remove(continuation);
+    caller->blocks.insertAfter(callBlock, continuation);
+    while (call->next) {
+        IrInstruction* inst = call->next;
+        inst->removeFromParent();
+        continuation->append(inst);
+    }
+    for (IrBlock* succ : continuation->getSuccessors()) {
+        succ->replacePredecessor(callBlock, continuation);
+    }
+
+    std::unordered_map<IrValue*, IrOperand>                valueMap;
+    std::unordered_map<IrBlock*, IrBlock*>                 blockMap;
+    std::vector<std::pair<IrInstruction*, IrInstruction*>> clones;
+    for (size_t i = 0; i < callee->arguments.size(); ++i) {
+        valueMap[callee->arguments.at(i)] = call->getOperand(i + 1);
+    }
+    IrBlock* insertAfter = callBlock;
+    for (IrBlock* block : callee->blocks) {
+        IrBlock* copy = caller->createBlock();
+        caller->blocks.remove(copy);
+        caller->blocks.insertAfter(insertAfter, copy);
+        blockMap[block] = copy;
+        insertAfter     = copy;
+    }
+    // Operands can refer forward through phis, so every instruction is created before any operand
+    // is filled in.
+    IrBlock*       callerEntry = caller->getEntryBlock();
+    IrInstruction* firstInst   = callerEntry->insts.front();
+    while (firstInst && firstInst->type == IrInstructionType::Reserve) {
+        firstInst = firstInst->next;
+    }
+    for (IrBlock* block : callee->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            IrInstruction* copy =
+                caller->createInstruction(inst->type, inst->hasResult, inst->numOperands);
+            copy->valueType = inst->valueType;
+            if (inst->type == IrInstructionType::Reserve) {
+                callerEntry->insertBefore(firstInst, copy);
+            } else {
+                blockMap.at(block)->append(copy);
+            }
+            valueMap[inst] = createSSAOperand(copy);
+            clones.push_back({inst, copy});
+        }
+    }
+    std::vector<std::pair<IrOperand, IrBlock*>> returns;
+    for (auto& [inst, copy] : clones) {
+        for (size_t i = 0; i < inst->numOperands; ++i) {
+            IrOperand operand = inst->getOperand(i);
+            if (operand.type == IrOperandType::SSA) {
+                operand = valueMap.at(operand.value);
+            } else if (operand.type == IrOperandType::Label) {
+                operand = createLabelOperand(blockMap.at(operand.block));
+            }
+            copy->setOperand(i, operand);
+        }
+        if (copy->type == IrInstructionType::Return) {
+            returns.push_back({copy->getOperand(0), copy->parent});
+            IrBlock* block = copy->parent;
+            copy->eraseFromParent();
+            block->append(caller->createInstruction(IrInstructionType::Br, false,
+                                                    {createLabelOperand(continuation)}));
+        }
+    }
+
+    if (call->hasResult) {
+        if (returns.size() == 1) {
+            call->replaceAllUsesWith(returns.front().first);
+        } else if (returns.empty()) {
+            // The callee never returns, nothing after the call can run.
+            call->replaceAllUsesWith(createConstOperand(call->valueType, 0));
+        } else {
+            IrInstruction* phi =
+                caller->createInstruction(IrInstructionType::Phi, true, returns.size() * 2);
+            phi->valueType = call->valueType;
+            for (size_t i = 0; i < returns.size(); ++i) {
+                phi->setOperand(i * 2, returns.at(i).first);
+                phi->setOperand(i * 2 + 1, createLabelOperand(returns.at(i).second));
+            }
+            continuation->insertBefore(continuation->insts.front(), phi);
+            call->replaceAllUsesWith(phi);
+        }
+    }
+    call->eraseFromParent();
+    callBlock->append(caller->createInstruction(
+        IrInstructionType::Br, false, {createLabelOperand(blockMap.at(callee->getEntryBlock()))}));
+}
+bool inlineFunctions(IrModule* module, PassManager* manager) {
+    CallGraph graph(module);
+    int64_t   threshold = manager->getInlineThreshold();
+    bool      changed   = false;
+    for (IrFunction* caller : graph.order) {
+        if (caller->blocks.empty()) {
+            continue;
+        }
+        // Sites are collected up front, calls that come in with an inlined body were already
+        // turned down when that body was inlined into its own function.
+        IrLoopInfo*           loopInfo = manager->getAnalyses(caller)->getLoopInfo();
+        std::vector<CallSite> sites;
+        for (IrBlock* block : caller->blocks) {
+            for (IrInstruction* inst : block->insts) {
+                if (inst->type == IrInstructionType::Call) {
+                    sites.push_back({inst, loopInfo->getLoopDepth(block)});
+                }
+            }
+        }
+        bool inlined = false;
+        for (CallSite& site : sites) {
+            IrFunction* callee = site.call->getOperand(0).function;
+            if (callee->blocks.empty() || callee->noInline || graph.isRecursive(caller, callee) ||
+                caller->getInstructionCount() > MAX_CALLER_SIZE) {
+                continue;
+            }
+            if (!callee->alwaysInline && getCallSiteCost(site) > threshold) {
+                continue;
+            }
+            inlineCall(site.call);
+            inlined = true;
+        }
+        if (inlined) {
+            manager->invalidate(caller);
+            changed = true;
+        }
+    }
+    return changed;
+}
+}; // namespace language
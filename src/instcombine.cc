@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <passes.h>
+
+namespace language {
+// What an operand has to look like for a rule to apply. Constants are either constant operands or
+// the result of a `const` instruction.
+enum struct OperandPattern : uint8_t {
+    Any,
+    Constant,
+    Zero,
+    One,
+    // The same value as the first operand.
+    SameAsFirst,
+    // A `sext` or `zext` of a value that already has the instruction's result type.
+    Extension,
+    // An instruction of the same opcode whose second operand is a constant.
+    SameOpcodeWithConstant,
+    // A single use i64 `add`, `sub` or `mul` whose operands are extended i32s or constants.
+    NarrowableBinary,
+};
+enum struct CombineAction : uint8_t {
+    // The instruction becomes the constant its operands fold to.
+    Fold,
+    UseFirst,
+    UseSecond,
+    UseZero,
+    // The instruction becomes the value its extension operand extends.
+    UseExtended,
+    // The constant of a commutative instruction moves to the second operand.
+    Commute,
+    // `sub x, c` becomes `add x, -c`, which the add rules handle from then on.
+    Negate,
+    // `op (op x, c1), c2` becomes `op x, (c1 op c2)`.
+    Reassociate,
+    // `trunc (op a, b)` becomes `op (trunc a), (trunc b)` on i32, the low half of an add, sub or
+    // mul only depends on the low halves of its operands.
+    Narrow,
+};
+struct CombineRule {
+    IrInstructionType type;
+    OperandPattern    first;
+    OperandPattern    second;
+    CombineAction     action;
+};
+// Tried in order, the first rule whose opcode and operand patterns match is applied. Rules that
+// rewrite an instruction in place queue it again, so later rules see the canonical form.
+static const CombineRule combineRules[] = {
+    {IrInstructionType::Trunc, OperandPattern::Constant, OperandPattern::Any, CombineAction::Fold},
+    {IrInstructionType::Sext, OperandPattern::Constant, OperandPattern::Any, CombineAction::Fold},
+    {IrInstructionType::Zext, OperandPattern::Constant, OperandPattern::Any, CombineAction::Fold},
+    {IrInstructionType::Trunc, OperandPattern::Extension, OperandPattern::Any,
+     CombineAction::UseExtended},
+    {IrInstructionType::Trunc, OperandPattern::NarrowableBinary, OperandPattern::Any,
+     CombineAction::Narrow},
+    {IrInstructionType::Add, OperandPattern::Constant, OperandPattern::Constant,
+     CombineAction::Fold},
+    {IrInstructionType::Sub, OperandPattern::Constant, OperandPattern::Constant,
+     CombineAction::Fold},
+    {IrInstructionType::Mul, OperandPattern::Constant, OperandPattern::Constant,
+     CombineAction::Fold},
+    {IrInstructionType::Add, OperandPattern::Constant, OperandPattern::Any, CombineAction::Commute},
+    {IrInstructionType::Mul, OperandPattern::Constant, OperandPattern::Any, CombineAction::Commute},
+    {IrInstructionType::Add, OperandPattern::Any, OperandPattern::Zero, CombineAction::UseFirst},
+    {IrInstructionType::Sub, OperandPattern::Any, OperandPattern::Zero, CombineAction::UseFirst},
+    {IrInstructionType::Mul, OperandPattern::Any, OperandPattern::One, CombineAction::UseFirst},
+    {IrInstructionType::Mul, OperandPattern::Any, OperandPattern::Zero, CombineAction::UseSecond},
+    {IrInstructionType::Sub, OperandPattern::Any, OperandPattern::SameAsFirst,
+     CombineAction::UseZero},
+    {IrInstructionType::Sub, OperandPattern::Any, OperandPattern::Constant, CombineAction::Negate},
+    {IrInstructionType::Add, OperandPattern::SameOpcodeWithConstant, OperandPattern::Constant,
+     CombineAction::Reassociate},
+    {IrInstructionType::Mul, OperandPattern::SameOpcodeWithConstant, OperandPattern::Constant,
+     CombineAction::Reassociate},
+};
+
+// i32 constants are compared and folded sign extended.
+static int64_t normalize(IrType type, int64_t value) {
+    return type.type == IrTypeType::I32 ? static_cast<int32_t>(value) : value;
+}
+static bool getConstant(IrOperand& operand, int64_t& value) {
+    if (operand.type == IrOperandType::Const) {
+        value = normalize(operand.irType, operand.constant);
+        return true;
+    }
+    if (operand.type != IrOperandType::SSA || operand.value->kind != IrValueKind::Instruction) {
+        return false;
+    }
+    IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+    return inst->type == IrInstructionType::Const && getConstant(inst->getOperand(0), value);
+}
+static IrInstruction* getInstruction(IrOperand& operand, IrInstructionType type) {
+    if (operand.type != IrOperandType::SSA || operand.value->kind != IrValueKind::Instruction) {
+        return nullptr;
+    }
+    IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+    return inst->type == type ? inst : nullptr;
+}
+static IrInstruction* getExtension(IrOperand& operand, IrType from) {
+    IrInstruction* ext = getInstruction(operand, IrInstructionType::Sext);
+    if (!ext) {
+        ext = getInstruction(operand, IrInstructionType::Zext);
+    }
+    return ext && ext->getOperand(0).irType == from ? ext : nullptr;
+}
+static int64_t foldBinary(IrInstructionType type, int64_t lhs, int64_t rhs) {
+    uint64_t a = lhs;
+    uint64_t b = rhs;
+    switch (type) {
+    case IrInstructionType::Add: {
+        return a + b;
+    } break;
+    case IrInstructionType::Sub: {
+        return a - b;
+    } break;
+    case IrInstructionType::Mul: {
+        return a * b;
+    } break;
+    default: {
+        std::printf("ICE: Cannot combine binary instruction %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+static int64_t foldCast(IrInstructionType type, IrType from, int64_t value) {
+    switch (type) {
+    case IrInstructionType::Trunc: {
+        return static_cast<int32_t>(value);
+    } break;
+    case IrInstructionType::Sext: {
+        return from.type == IrTypeType::I32 ? static_cast<int32_t>(value) : value;
+    } break;
+    case IrInstructionType::Zext: {
+        return from.type == IrTypeType::I32 ? static_cast<uint32_t>(value) : value;
+    } break;
+    default: {
+        std::printf("ICE: Cannot combine cast instruction %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+static bool isNarrowableOperand(IrOperand& operand) {
+    int64_t value;
+    return getConstant(operand, value) || getExtension(operand, IrType(IrTypeType::I32));
+}
+static bool matchOperand(OperandPattern pattern, IrInstruction* inst, size_t index) {
+    if (pattern == OperandPattern::Any) {
+        return true;
+    }
+    if (index >= inst->numOperands) {
+        return false;
+    }
+    IrOperand& operand = inst->getOperand(index);
+    int64_t    value;
+    switch (pattern) {
+    case OperandPattern::Any: {
+        return true;
+    } break;
+    case OperandPattern::Constant: {
+        return getConstant(operand, value);
+    } break;
+    case OperandPattern::Zero: {
+        return getConstant(operand, value) && value == 0;
+    } break;
+    case OperandPattern::One: {
+        return getConstant(operand, value) && value == 1;
+    } break;
+    case OperandPattern::SameAsFirst: {
+        return operand.type == IrOperandType::SSA && inst->getOperandValue(0) == operand.value;
+    } break;
+    case OperandPattern::Extension: {
+        return getExtension(operand, inst->valueType) != nullptr;
+    } break;
+    case OperandPattern::SameOpcodeWithConstant: {
+        IrInstruction* inner = getInstruction(operand, inst->type);
+        return inner && getConstant(inner->getOperand(1), value);
+    } break;
+    case OperandPattern::NarrowableBinary: {
+        if (operand.type != IrOperandType::SSA || operand.irType.type != IrTypeType::I64 ||
+            operand.value->kind != IrValueKind::Instruction || operand.value->getNumUses() != 1) {
+            return false;
+        }
+        IrInstruction* inner = static_cast<IrInstruction*>(operand.value);
+        if (inner->type != IrInstructionType::Add && inner->type != IrInstructionType::Sub &&
+            inner->type != IrInstructionType::Mul) {
+            return false;
+        }
+        return isNarrowableOperand(inner->getOperand(0)) &&
+               isNarrowableOperand(inner->getOperand(1));
+    } break;
+    }
+    return false;
+}
+static void pushUsers(IrValue* value, std::vector<IrInstruction*>& worklist) {
+    for (IrUse* use = value->firstUse; use; use = use->nextUse) {
+        worklist.push_back(use->user);
+    }
+}
+static void pushOperands(IrInstruction* inst, std::vector<IrInstruction*>& worklist) {
+    for (size_t i = 0; i < inst->numOperands; ++i) {
+        IrValue* value = inst->getOperandValue(i);
+        if (value && value->kind == IrValueKind::Instruction) {
+            worklist.push_back(static_cast<IrInstruction*>(value));
+        }
+    }
+}
+// Replaces every use of `inst` by `operand` and erases it. Users may match a rule now, operands may
+// have lost their last use.
+static void replaceInstruction(IrInstruction* inst, IrOperand operand,
+                               std::vector<IrInstruction*>& worklist) {
+    pushUsers(inst, worklist);
+    inst->replaceAllUsesWith(operand);
+    pushOperands(inst, worklist);
+    inst->eraseFromParent();
+}
+static IrOperand narrowOperand(IrOperand& operand) {
+    int64_t value;
+    if (getConstant(operand, value)) {
+        return createConstOperand(IrType(IrTypeType::I32), static_cast<int32_t>(value));
+    }
+    return getExtension(operand, IrType(IrTypeType::I32))->getOperand(0);
+}
+static void applyRule(const CombineRule& rule, IrInstruction* inst, IrFunction* func,
+                      std::vector<IrInstruction*>& worklist) {
+    IrType type = inst->valueType;
+    switch (rule.action) {
+    case CombineAction::Fold: {
+        int64_t lhs;
+        int64_t rhs;
+        getConstant(inst->getOperand(0), lhs);
+        int64_t value;
+        if (inst->type == IrInstructionType::Add || inst->type == IrInstructionType::Sub ||
+            inst->type == IrInstructionType::Mul) {
+            getConstant(inst->getOperand(1), rhs);
+            value = foldBinary(inst->type, lhs, rhs);
+        } else {
+            value = foldCast(inst->type, inst->getOperand(0).irType, lhs);
+        }
+        replaceInstruction(inst, createConstOperand(type, normalize(type, value)), worklist);
+    } break;
+    case CombineAction::UseFirst: {
+        replaceInstruction(inst, inst->getOperand(0), worklist);
+    } break;
+    case CombineAction::UseSecond: {
+        replaceInstruction(inst, inst->getOperand(1), worklist);
+    } break;
+    case CombineAction::UseZero: {
+        replaceInstruction(inst, createConstOperand(type, 0), worklist);
+    } break;
+    case CombineAction::UseExtended: {
+        IrInstruction* ext = getExtension(inst->getOperand(0), type);
+        replaceInstruction(inst, ext->getOperand(0), worklist);
+    } break;
+    case CombineAction::Commute: {
+        IrOperand first  = inst->getOperand(0);
+        IrOperand second = inst->getOperand(1);
+        inst->setOperand(0, second);
+        inst->setOperand(1, first);
+        worklist.push_back(inst);
+    } break;
+    case CombineAction::Negate: {
+        int64_t value;
+        getConstant(inst->getOperand(1), value);
+        value      = normalize(type, foldBinary(IrInstructionType::Sub, 0, value));
+        inst->type = IrInstructionType::Add;
+        inst->setOperand(1, createConstOperand(type, value));
+        pushUsers(inst, worklist);
+        worklist.push_back(inst);
+    } break;
+    case CombineAction::Reassociate: {
+        IrInstruction* inner = static_cast<IrInstruction*>(inst->getOperandValue(0));
+        int64_t        lhs;
+        int64_t        rhs;
+        getConstant(inner->getOperand(1), lhs);
+        getConstant(inst->getOperand(1), rhs);
+        int64_t value = normalize(type, foldBinary(inst->type, lhs, rhs));
+        inst->setOperand(0, inner->getOperand(0));
+        inst->setOperand(1, createConstOperand(type, value));
+        worklist.push_back(inner);
+        pushUsers(inst, worklist);
+        worklist.push_back(inst);
+    } break;
+    case CombineAction::Narrow: {
+        IrInstruction* wide   = static_cast<IrInstruction*>(inst->getOperandValue(0));
+        IrInstruction* narrow = func->createInstruction(
+            wide->type, true,
+            {narrowOperand(wide->getOperand(0)), narrowOperand(wide->getOperand(1))});
+        inst->parent->insertBefore(inst, narrow);
+        replaceInstruction(inst, createSSAOperand(narrow), worklist);
+        worklist.push_back(narrow);
+    } break;
+    }
+}
+bool combineInstructions(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    std::vector<IrInstruction*> worklist;
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->hasResult) {
+                worklist.push_back(inst);
+            }
+        }
+    }
+    // The worklist is a stack, reversed it hands out definitions before their users.
+    std::reverse(worklist.begin(), worklist.end());
+    bool changed = false;
+    while (!worklist.empty()) {
+        IrInstruction* inst = worklist.back();
+        worklist.pop_back();
+        if (!inst->parent || !inst->hasResult) {
+            continue;
+        }
+        if (!inst->hasUses() && !inst->hasSideEffects()) {
+            pushOperands(inst, worklist);
+            inst->eraseFromParent();
+            changed = true;
+            continue;
+        }
+        for (const CombineRule& rule : combineRules) {
+            if (rule.type == inst->type && matchOperand(rule.first, inst, 0) &&
+                matchOperand(rule.second, inst, 1)) {
+                applyRule(rule, inst, func, worklist);
+                changed = true;
+                break;
+            }
+        }
+    }
+    return changed;
+}
+}; // namespace language
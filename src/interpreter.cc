@@ -0,0 +1,629 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <interpreter.h>
+
+namespace language {
+// 8 MiB of registers and stack slots for all frames together.
+static constexpr size_t   STACK_SIZE             = 1 << 20;
+static constexpr uint32_t MAX_CALL_DEPTH         = 1 << 15;
+static constexpr size_t   MAX_EXTERNAL_ARGUMENTS = 6;
+
+static bool is64Bit(IrType type) {
+    return type.type != IrTypeType::I32;
+}
+static uint64_t normalize(IrType type, uint64_t value) {
+    return is64Bit(type) ? value : (uint32_t)value;
+}
+static uint32_t addRegister(IrDecodedFunction* function, uint64_t value) {
+    function->registers.push_back(value);
+    return function->registers.size() - 1;
+}
+static IrBytecode createBytecode(IrOpcode opcode, uint32_t dst, uint32_t a, uint32_t b) {
+    return {nullptr, opcode, dst, a, b, 0};
+}
+static IrOpcode getOpcode(IrInstructionType type, bool wide) {
+    switch (type) {
+    case IrInstructionType::Add: {
+        return wide ? IrOpcode::Add64 : IrOpcode::Add32;
+    } break;
+    case IrInstructionType::Sub: {
+        return wide ? IrOpcode::Sub64 : IrOpcode::Sub32;
+    } break;
+    case IrInstructionType::Mul: {
+        return wide ? IrOpcode::Mul64 : IrOpcode::Mul32;
+    } break;
+    case IrInstructionType::Sdiv: {
+        return wide ? IrOpcode::Sdiv64 : IrOpcode::Sdiv32;
+    } break;
+    case IrInstructionType::Udiv: {
+        return IrOpcode::Udiv;
+    } break;
+    case IrInstructionType::Srem: {
+        return wide ? IrOpcode::Srem64 : IrOpcode::Srem32;
+    } break;
+    case IrInstructionType::Urem: {
+        return IrOpcode::Urem;
+    } break;
+    case IrInstructionType::Smulh: {
+        return wide ? IrOpcode::Smulh64 : IrOpcode::Smulh32;
+    } break;
+    case IrInstructionType::Umulh: {
+        return wide ? IrOpcode::Umulh64 : IrOpcode::Umulh32;
+    } break;
+    case IrInstructionType::And: {
+        return IrOpcode::And;
+    } break;
+    case IrInstructionType::Shl: {
+        return wide ? IrOpcode::Shl64 : IrOpcode::Shl32;
+    } break;
+    case IrInstructionType::Lshr: {
+        return wide ? IrOpcode::Lshr64 : IrOpcode::Lshr32;
+    } break;
+    case IrInstructionType::Ashr: {
+        return wide ? IrOpcode::Ashr64 : IrOpcode::Ashr32;
+    } break;
+    case IrInstructionType::Eq: {
+        return IrOpcode::Eq;
+    } break;
+    case IrInstructionType::Ne: {
+        return IrOpcode::Ne;
+    } break;
+    case IrInstructionType::Slt: {
+        return wide ? IrOpcode::Slt64 : IrOpcode::Slt32;
+    } break;
+    case IrInstructionType::Sle: {
+        return wide ? IrOpcode::Sle64 : IrOpcode::Sle32;
+    } break;
+    case IrInstructionType::Sgt: {
+        return wide ? IrOpcode::Sgt64 : IrOpcode::Sgt32;
+    } break;
+    case IrInstructionType::Sge: {
+        return wide ? IrOpcode::Sge64 : IrOpcode::Sge32;
+    } break;
+    case IrInstructionType::Ult: {
+        return IrOpcode::Ult;
+    } break;
+    case IrInstructionType::Ule: {
+        return IrOpcode::Ule;
+    } break;
+    case IrInstructionType::Ugt: {
+        return IrOpcode::Ugt;
+    } break;
+    case IrInstructionType::Uge: {
+        return IrOpcode::Uge;
+    } break;
+    default: {
+        std::printf("ICE: No bytecode for instruction type %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+// Arguments beyond the first six would go on the stack, which a plain C call cannot express.
+static uint64_t callSymbol(IrFunction* callee, uint64_t* args, size_t count, void*) {
+    void* address = dlsym(RTLD_DEFAULT, callee->getSymbolName().c_str());
+    if (!address) {
+        std::fprintf(stderr, "Undefined symbol `%s`\n", callee->getSymbolName().c_str());
+        std::exit(1);
+    }
+    if (count > MAX_EXTERNAL_ARGUMENTS) {
+        std::printf("TODO: External call to `%s` with %zu arguments\n", callee->name.c_str(),
+                    count);
+        std::exit(1);
+    }
+    uint64_t values[MAX_EXTERNAL_ARGUMENTS] = {};
+    std::memcpy(values, args, count * sizeof(uint64_t));
+    return ((uint64_t (*)(...))address)(values[0], values[1], values[2], values[3], values[4],
+                                        values[5]);
+}
+IrInterpreter::IrInterpreter(IrModule* _module) {
+    this->module           = _module;
+    this->externalCall     = callSymbol;
+    this->externalUserData = nullptr;
+    this->stack.resize(STACK_SIZE);
+    this->globals.resize(_module->objects.size());
+    for (size_t i = 0; i < _module->objects.size(); ++i) {
+        IrObject* obj = _module->objects.at(i);
+        if (obj->value.type != IrOperandType::Const) {
+            std::printf("TODO: Initializer of global `%s` is not a constant\n", obj->name.c_str());
+            std::exit(1);
+        }
+        this->globals.at(i)        = normalize(obj->type, obj->value.constant);
+        this->globalAddresses[obj] = &this->globals.at(i);
+    }
+}
+IrInterpreter::~IrInterpreter() {
+    for (auto& [func, function] : this->functions) {
+        delete function;
+    }
+}
+void IrInterpreter::setExternalCall(ExternalCallFn fn, void* userData) {
+    this->externalCall     = fn;
+    this->externalUserData = userData;
+}
+uint64_t IrInterpreter::call(IrFunction* func, std::vector<uint64_t> args) {
+    IrDecodedFunction* function = this->getDecoded(func);
+    if (func->blocks.empty()) {
+        return normalize(func->returnType, this->externalCall(func, args.data(), args.size(),
+                                                              this->externalUserData));
+    }
+    uint64_t* frame = this->enter(function, this->stack.data());
+    for (size_t i = 0; i < args.size() && i < func->arguments.size(); ++i) {
+        IrArgument* arg    = func->arguments.at(i);
+        frame[arg->number] = normalize(arg->valueType, args.at(i));
+    }
+    return this->execute(function, frame);
+}
+int IrInterpreter::run() {
+    for (IrFunction* func : this->module->functions) {
+        if (func->name == "main" && !func->blocks.empty()) {
+            uint64_t result = this->call(func, {});
+            return func->returnType.type == IrTypeType::Void ? 0 : (int)result;
+        }
+    }
+    std::fprintf(stderr, "No `main` function to run\n");
+    std::exit(1);
+}
+IrDecodedFunction* IrInterpreter::getDecoded(IrFunction* func) {
+    IrDecodedFunction*& function = this->functions[func];
+    if (!function) {
+        function            = new IrDecodedFunction;
+        function->func      = func;
+        function->frameSize = 0;
+        function->decoded   = false;
+        function->threaded  = false;
+    }
+    return function;
+}
+// Decodes the callee if needed and sets up its frame at `frame`, arguments are left to the caller.
+uint64_t* IrInterpreter::enter(IrDecodedFunction* function, uint64_t* frame) {
+    if (!function->decoded) {
+        this->decode(function);
+    }
+    if (frame + function->frameSize > this->stack.data() + this->stack.size() ||
+        this->calls.size() >= MAX_CALL_DEPTH) {
+        std::fprintf(stderr, "Interpreter stack overflow in `%s`\n", function->func->name.c_str());
+        std::exit(1);
+    }
+    std::memcpy(frame, function->registers.data(), function->registers.size() * sizeof(uint64_t));
+    return frame;
+}
+uint32_t IrInterpreter::getRegister(IrDecodedFunction* function, IrOperand& operand) {
+    switch (operand.type) {
+    case IrOperandType::SSA: {
+        return operand.value->number;
+    } break;
+    case IrOperandType::Const: {
+        return addRegister(function, normalize(operand.irType, operand.constant));
+    } break;
+    case IrOperandType::Global: {
+        return addRegister(function, (uint64_t)this->globalAddresses.at(operand.object));
+    } break;
+    default: {
+        std::printf("ICE: Operand type %llu has no register\n", operand.type);
+        std::exit(1);
+    } break;
+    }
+}
+void IrInterpreter::decode(IrDecodedFunction* function) {
+    struct BlockTarget {
+        size_t   index;
+        bool     ifFalse;
+        IrBlock* pred;
+        IrBlock* block;
+    };
+    IrFunction*                                   func = function->func;
+    std::vector<IrBytecode>&                      code = function->code;
+    std::unordered_map<IrBlock*, uint32_t>        blockStarts;
+    std::unordered_map<IrInstruction*, uint32_t>  shadows;
+    std::vector<BlockTarget>                      targets;
+    std::vector<BlockTarget>                      edges;
+    uint32_t                                      reserveCount = 0;
+    function->registers.assign(func->nextValueNumber, 0);
+    uint32_t discard = addRegister(function, 0);
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Phi) {
+                shadows[inst] = addRegister(function, 0);
+            }
+        }
+    }
+    // Copies into the phi registers of `succ` for the edge from `pred`.
+    auto emitEdgeMoves = [&](IrBlock* pred, IrBlock* succ) {
+        for (IrInstruction* phi : succ->insts) {
+            if (phi->type != IrInstructionType::Phi) {
+                break;
+            }
+            for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+                if (phi->getOperand(i + 1).block == pred) {
+                    code.push_back(createBytecode(IrOpcode::Move, shadows.at(phi),
+                                                  this->getRegister(function, phi->getOperand(i)),
+                                                  0));
+                }
+            }
+        }
+    };
+    auto hasPhis = [](IrBlock* block) {
+        return !block->insts.empty() && block->insts.front()->type == IrInstructionType::Phi;
+    };
+    for (IrBlock* block : func->blocks) {
+        blockStarts[block] = code.size();
+        for (IrInstruction* inst : block->insts) {
+            switch (inst->type) {
+            case IrInstructionType::Phi: {
+                code.push_back(createBytecode(IrOpcode::Move, inst->number, shadows.at(inst), 0));
+            } break;
+            case IrInstructionType::Reserve: {
+                code.push_back(createBytecode(IrOpcode::Reserve, inst->number, reserveCount++, 0));
+            } break;
+            case IrInstructionType::Const: {
+                function->registers.at(inst->number) =
+                    normalize(inst->valueType, inst->getOperand(0).constant);
+            } break;
+            case IrInstructionType::Load: {
+                code.push_back(createBytecode(
+                    is64Bit(inst->valueType) ? IrOpcode::Load64 : IrOpcode::Load32, inst->number,
+                    this->getRegister(function, inst->getOperand(0)), 0));
+            } break;
+            case IrInstructionType::Store: {
+                code.push_back(createBytecode(
+                    is64Bit(inst->getOperand(1).irType) ? IrOpcode::Store64 : IrOpcode::Store32, 0,
+                    this->getRegister(function, inst->getOperand(0)),
+                    this->getRegister(function, inst->getOperand(1))));
+            } break;
+            case IrInstructionType::Trunc:
+            case IrInstructionType::Sext:
+            case IrInstructionType::Zext: {
+                bool     fromWide = is64Bit(inst->getOperand(0).irType);
+                bool     toWide   = is64Bit(inst->valueType);
+                IrOpcode opcode   = IrOpcode::Move;
+                if (fromWide && !toWide) {
+                    opcode = IrOpcode::Trunc;
+                } else if (!fromWide && toWide && inst->type == IrInstructionType::Sext) {
+                    opcode = IrOpcode::Sext;
+                }
+                code.push_back(createBytecode(opcode, inst->number,
+                                              this->getRegister(function, inst->getOperand(0)),
+                                              0));
+            } break;
+            case IrInstructionType::Add:
+            case IrInstructionType::Sub:
+            case IrInstructionType::Mul:
+            case IrInstructionType::Sdiv:
+            case IrInstructionType::Udiv:
+            case IrInstructionType::Srem:
+            case IrInstructionType::Urem:
+            case IrInstructionType::Smulh:
+            case IrInstructionType::Umulh:
+            case IrInstructionType::And:
+            case IrInstructionType::Shl:
+            case IrInstructionType::Lshr:
+            case IrInstructionType::Ashr: {
+                code.push_back(createBytecode(getOpcode(inst->type, is64Bit(inst->valueType)),
+                                              inst->number,
+                                              this->getRegister(function, inst->getOperand(0)),
+                                              this->getRegister(function, inst->getOperand(1))));
+            } break;
+            case IrInstructionType::Eq:
+            case IrInstructionType::Ne:
+            case IrInstructionType::Slt:
+            case IrInstructionType::Sle:
+            case IrInstructionType::Sgt:
+            case IrInstructionType::Sge:
+            case IrInstructionType::Ult:
+            case IrInstructionType::Ule:
+            case IrInstructionType::Ugt:
+            case IrInstructionType::Uge: {
+                code.push_back(createBytecode(
+                    getOpcode(inst->type, is64Bit(inst->getOperand(0).irType)), inst->number,
+                    this->getRegister(function, inst->getOperand(0)),
+                    this->getRegister(function, inst->getOperand(1))));
+            } break;
+            case IrInstructionType::Call: {
+                IrBytecode bytecode = createBytecode(IrOpcode::Call,
+                                                     inst->hasResult ? inst->number : discard,
+                                                     function->callees.size(),
+                                                     function->arguments.size());
+                bytecode.c          = inst->numOperands - 1;
+                function->callees.push_back(this->getDecoded(inst->getOperand(0).function));
+                for (size_t i = 1; i < inst->numOperands; ++i) {
+                    function->arguments.push_back(this->getRegister(function, inst->getOperand(i)));
+                }
+                code.push_back(bytecode);
+            } break;
+            case IrInstructionType::Return: {
+                IrOperand& value = inst->getOperand(0);
+                if (value.type == IrOperandType::Type) {
+                    code.push_back(createBytecode(IrOpcode::ReturnVoid, 0, 0, 0));
+                } else {
+                    code.push_back(createBytecode(IrOpcode::Return, 0,
+                                                  this->getRegister(function, value), 0));
+                }
+            } break;
+            case IrInstructionType::Br: {
+                IrBlock* succ = inst->getOperand(0).block;
+                emitEdgeMoves(block, succ);
+                targets.push_back({code.size(), false, block, succ});
+                code.push_back(createBytecode(IrOpcode::Jump, 0, 0, 0));
+            } break;
+            case IrInstructionType::CondBr: {
+                for (size_t i = 1; i <= 2; ++i) {
+                    IrBlock* succ = inst->getOperand(i).block;
+                    (hasPhis(succ) ? edges : targets).push_back({code.size(), i == 2, block, succ});
+                }
+                code.push_back(createBytecode(IrOpcode::Branch, 0,
+                                              this->getRegister(function, inst->getOperand(0)),
+                                              0));
+            } break;
+            default: {
+                std::printf("TODO: Interpretation of instruction type %llu\n", inst->type);
+                std::exit(1);
+            } break;
+            }
+        }
+    }
+    // Edges of a conditional branch into a block with phis get their copies out of line.
+    for (BlockTarget& edge : edges) {
+        uint32_t start = code.size();
+        emitEdgeMoves(edge.pred, edge.block);
+        targets.push_back({code.size(), false, edge.pred, edge.block});
+        code.push_back(createBytecode(IrOpcode::Jump, 0, 0, 0));
+        (edge.ifFalse ? code.at(edge.index).c : code.at(edge.index).b) = start;
+    }
+    for (BlockTarget& target : targets) {
+        (target.ifFalse ? code.at(target.index).c : code.at(target.index).b) =
+            blockStarts.at(target.block);
+    }
+    for (IrBytecode& bytecode : code) {
+        if (bytecode.opcode == IrOpcode::Reserve) {
+            bytecode.a += function->registers.size();
+        }
+    }
+    function->frameSize = function->registers.size() + reserveCount;
+    function->decoded   = true;
+}
+uint64_t IrInterpreter::execute(IrDecodedFunction* function, uint64_t* frame) {
+    // Indexed by IrOpcode.
+    static const void* handlers[] = {
+        &&Reserve, &&Load32,  &&Load64,  &&Store32, &&Store64, &&Move,    &&Trunc,  &&Sext,
+        &&Add32,   &&Add64,   &&Sub32,   &&Sub64,   &&Mul32,   &&Mul64,   &&Sdiv32, &&Sdiv64,
+        &&Udiv,    &&Srem32,  &&Srem64,  &&Urem,    &&Smulh32, &&Smulh64, &&Umulh32, &&Umulh64,
+        &&And,     &&Shl32,   &&Shl64,   &&Lshr32,  &&Lshr64,  &&Ashr32,  &&Ashr64, &&Eq,
+        &&Ne,      &&Slt32,   &&Slt64,   &&Sle32,   &&Sle64,   &&Sgt32,   &&Sgt64,  &&Sge32,
+        &&Sge64,   &&Ult,     &&Ule,     &&Ugt,     &&Uge,     &&Call,    &&Return, &&ReturnVoid,
+        &&Jump,    &&Branch,
+    };
+    auto thread = [](IrDecodedFunction* decoded) {
+        if (!decoded->threaded) {
+            for (IrBytecode& bytecode : decoded->code) {
+                bytecode.handler = handlers[(size_t)bytecode.opcode];
+            }
+            decoded->threaded = true;
+        }
+    };
+    // Returning to a frame below `base` leaves this execute(), the external call shim may run
+    // another one on top.
+    size_t base = this->calls.size();
+    thread(function);
+    IrBytecode* code = function->code.data();
+    IrBytecode* ip   = code;
+    uint64_t*   r    = frame;
+    uint64_t    result;
+#define DISPATCH() goto* ip->handler
+#define NEXT()                                                                                     \
+    ++ip;                                                                                          \
+    DISPATCH()
+    DISPATCH();
+Reserve:
+    r[ip->dst] = (uint64_t)(r + ip->a);
+    NEXT();
+Load32:
+    r[ip->dst] = *(uint32_t*)r[ip->a];
+    NEXT();
+Load64:
+    r[ip->dst] = *(uint64_t*)r[ip->a];
+    NEXT();
+Store32:
+    *(uint32_t*)r[ip->a] = r[ip->b];
+    NEXT();
+Store64:
+    *(uint64_t*)r[ip->a] = r[ip->b];
+    NEXT();
+Move:
+    r[ip->dst] = r[ip->a];
+    NEXT();
+Trunc:
+    r[ip->dst] = (uint32_t)r[ip->a];
+    NEXT();
+Sext:
+    r[ip->dst] = (uint64_t)(int64_t)(int32_t)r[ip->a];
+    NEXT();
+Add32:
+    r[ip->dst] = (uint32_t)(r[ip->a] + r[ip->b]);
+    NEXT();
+Add64:
+    r[ip->dst] = r[ip->a] + r[ip->b];
+    NEXT();
+Sub32:
+    r[ip->dst] = (uint32_t)(r[ip->a] - r[ip->b]);
+    NEXT();
+Sub64:
+    r[ip->dst] = r[ip->a] - r[ip->b];
+    NEXT();
+Mul32:
+    r[ip->dst] = (uint32_t)(r[ip->a] * r[ip->b]);
+    NEXT();
+Mul64:
+    r[ip->dst] = r[ip->a] * r[ip->b];
+    NEXT();
+// Dividing the smallest signed value by -1 overflows on the host, -1 is handled as a negation.
+Sdiv32:
+    if ((uint32_t)r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = (uint32_t)r[ip->b] == UINT32_MAX
+                     ? (uint32_t)(0 - r[ip->a])
+                     : (uint32_t)((int32_t)r[ip->a] / (int32_t)r[ip->b]);
+    NEXT();
+Sdiv64:
+    if (r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = r[ip->b] == UINT64_MAX ? 0 - r[ip->a] : (int64_t)r[ip->a] / (int64_t)r[ip->b];
+    NEXT();
+Udiv:
+    if (r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = r[ip->a] / r[ip->b];
+    NEXT();
+Srem32:
+    if ((uint32_t)r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = (uint32_t)r[ip->b] == UINT32_MAX
+                     ? 0
+                     : (uint32_t)((int32_t)r[ip->a] % (int32_t)r[ip->b]);
+    NEXT();
+Srem64:
+    if (r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = r[ip->b] == UINT64_MAX ? 0 : (int64_t)r[ip->a] % (int64_t)r[ip->b];
+    NEXT();
+Urem:
+    if (r[ip->b] == 0) {
+        goto DivisionByZero;
+    }
+    r[ip->dst] = r[ip->a] % r[ip->b];
+    NEXT();
+Smulh32:
+    r[ip->dst] = (uint32_t)(((int64_t)(int32_t)r[ip->a] * (int32_t)r[ip->b]) >> 32);
+    NEXT();
+Smulh64:
+    r[ip->dst] = ((__int128)(int64_t)r[ip->a] * (int64_t)r[ip->b]) >> 64;
+    NEXT();
+Umulh32:
+    r[ip->dst] = (r[ip->a] * r[ip->b]) >> 32;
+    NEXT();
+Umulh64:
+    r[ip->dst] = ((unsigned __int128)r[ip->a] * r[ip->b]) >> 64;
+    NEXT();
+And:
+    r[ip->dst] = r[ip->a] & r[ip->b];
+    NEXT();
+Shl32:
+    r[ip->dst] = (uint32_t)(r[ip->a] << (r[ip->b] & 31));
+    NEXT();
+Shl64:
+    r[ip->dst] = r[ip->a] << (r[ip->b] & 63);
+    NEXT();
+Lshr32:
+    r[ip->dst] = r[ip->a] >> (r[ip->b] & 31);
+    NEXT();
+Lshr64:
+    r[ip->dst] = r[ip->a] >> (r[ip->b] & 63);
+    NEXT();
+Ashr32:
+    r[ip->dst] = (uint32_t)((int32_t)r[ip->a] >> (r[ip->b] & 31));
+    NEXT();
+Ashr64:
+    r[ip->dst] = (int64_t)r[ip->a] >> (r[ip->b] & 63);
+    NEXT();
+Eq:
+    r[ip->dst] = r[ip->a] == r[ip->b];
+    NEXT();
+Ne:
+    r[ip->dst] = r[ip->a] != r[ip->b];
+    NEXT();
+Slt32:
+    r[ip->dst] = (int32_t)r[ip->a] < (int32_t)r[ip->b];
+    NEXT();
+Slt64:
+    r[ip->dst] = (int64_t)r[ip->a] < (int64_t)r[ip->b];
+    NEXT();
+Sle32:
+    r[ip->dst] = (int32_t)r[ip->a] <= (int32_t)r[ip->b];
+    NEXT();
+Sle64:
+    r[ip->dst] = (int64_t)r[ip->a] <= (int64_t)r[ip->b];
+    NEXT();
+Sgt32:
+    r[ip->dst] = (int32_t)r[ip->a] > (int32_t)r[ip->b];
+    NEXT();
+Sgt64:
+    r[ip->dst] = (int64_t)r[ip->a] > (int64_t)r[ip->b];
+    NEXT();
+Sge32:
+    r[ip->dst] = (int32_t)r[ip->a] >= (int32_t)r[ip->b];
+    NEXT();
+Sge64:
+    r[ip->dst] = (int64_t)r[ip->a] >= (int64_t)r[ip->b];
+    NEXT();
+Ult:
+    r[ip->dst] = r[ip->a] < r[ip->b];
+    NEXT();
+Ule:
+    r[ip->dst] = r[ip->a] <= r[ip->b];
+    NEXT();
+Ugt:
+    r[ip->dst] = r[ip->a] > r[ip->b];
+    NEXT();
+Uge:
+    r[ip->dst] = r[ip->a] >= r[ip->b];
+    NEXT();
+Call: {
+    IrDecodedFunction* callee    = function->callees[ip->a];
+    uint32_t*          arguments = function->arguments.data() + ip->b;
+    IrFunction*        target    = callee->func;
+    if (target->blocks.empty()) {
+        uint64_t values[MAX_EXTERNAL_ARGUMENTS * 2];
+        for (uint32_t i = 0; i < ip->c && i < MAX_EXTERNAL_ARGUMENTS * 2; ++i) {
+            values[i] = r[arguments[i]];
+        }
+        r[ip->dst] = normalize(target->returnType,
+                               this->externalCall(target, values, ip->c, this->externalUserData));
+        NEXT();
+    }
+    uint64_t* calleeFrame = this->enter(callee, r + function->frameSize);
+    for (uint32_t i = 0; i < ip->c; ++i) {
+        calleeFrame[target->arguments[i]->number] = r[arguments[i]];
+    }
+    thread(callee);
+    this->calls.push_back({function, ip, r});
+    function = callee;
+    code     = callee->code.data();
+    ip       = code;
+    r        = calleeFrame;
+    DISPATCH();
+}
+Return:
+    result = r[ip->a];
+    goto Leave;
+ReturnVoid:
+    result = 0;
+Leave:
+    if (this->calls.size() == base) {
+        return result;
+    }
+    function = this->calls.back().function;
+    ip       = this->calls.back().ip;
+    r        = this->calls.back().registers;
+    code     = function->code.data();
+    this->calls.pop_back();
+    r[ip->dst] = result;
+    NEXT();
+Jump:
+    ip = code + ip->b;
+    DISPATCH();
+Branch:
+    ip = code + (r[ip->a] ? ip->b : ip->c);
+    DISPATCH();
+DivisionByZero:
+    std::fprintf(stderr, "Division by zero in `%s`\n", function->func->name.c_str());
+    std::exit(1);
+#undef NEXT
+#undef DISPATCH
+}
+}; // namespace language
@@ -1,4 +1,6 @@
-#include <irgen.h>
+#include <cstdio>
+#include <cstdlib>
+#include <ir.h>
 
 namespace language {
 void IrModule::print() {
@@ -50,29 +52,58 @@ static std::string convertIrTypeToString(IrTypeType type) {
     } break;
     }
 }
+const char* IrType::getName() {
+    switch (this->type) {
+    case IrTypeType::I32: {
+        return "i32";
+    } break;
+    case IrTypeType::I64: {
+        return "i64";
+    } break;
+    case IrTypeType::Void: {
+        return "void";
+    } break;
+    case IrTypeType::String: {
+        return "string";
+    } break;
+    case IrTypeType::Variadic: {
+        return "variadic";
+    } break;
+    case IrTypeType::Pointer: {
+        return "ptr";
+    } break;
+    case IrTypeType::Label: {
+        return "label";
+    } break;
+    default: {
+        std::printf("TODO: Name of IrTypeType %llu\n", this->type);
+        std::exit(1);
+    } break;
+    }
+}
 void IrType::print() {
     std::printf("type %s", convertIrTypeToString(this->type).c_str());
 }
 void IrOperand::print() {
-    this->irType->print();
+    this->irType.print();
     switch (this->type) {
-    case IrOperandType::ConstI32: {
-        std::printf(" %d", this->constI32);
-    } break;
-    case IrOperandType::ConstI64: {
-        std::printf(" %ld", this->constI64);
+    case IrOperandType::Const: {
+        std::printf(" %ld", this->constant);
     } break;
     case IrOperandType::Type: {
         std::printf(" ");
     } break;
     case IrOperandType::SSA: {
-        std::printf(" #%lu", this->ssaResult);
+        std::printf(" #%u", this->value->number);
     } break;
-    case IrOperandType::Name: {
-        std::printf(" $%s", this->name.c_str());
+    case IrOperandType::Global: {
+        std::printf(" $%s", this->object->name.c_str());
     } break;
     case IrOperandType::Label: {
-        std::printf(" #%s", this->name.c_str());
+        std::printf(" #.BB%u", this->block->number);
+    } break;
+    case IrOperandType::Function: {
+        std::printf(" $%s", this->function->name.c_str());
     } break;
     default: {
         std::printf("TODO: Print IR operand type %llu\n", this->type);
@@ -109,12 +140,84 @@ std::string irInstructionTypeToString(IrInstructionType type) {
     case IrInstructionType::Add: {
         return "add";
     } break;
+    case IrInstructionType::Sub: {
+        return "sub";
+    } break;
+    case IrInstructionType::Sdiv: {
+        return "sdiv";
+    } break;
+    case IrInstructionType::Udiv: {
+        return "udiv";
+    } break;
+    case IrInstructionType::Srem: {
+        return "srem";
+    } break;
+    case IrInstructionType::Urem: {
+        return "urem";
+    } break;
+    case IrInstructionType::Smulh: {
+        return "smulh";
+    } break;
+    case IrInstructionType::Umulh: {
+        return "umulh";
+    } break;
+    case IrInstructionType::And: {
+        return "and";
+    } break;
+    case IrInstructionType::Shl: {
+        return "shl";
+    } break;
+    case IrInstructionType::Lshr: {
+        return "lshr";
+    } break;
+    case IrInstructionType::Ashr: {
+        return "ashr";
+    } break;
+    case IrInstructionType::Eq: {
+        return "eq";
+    } break;
+    case IrInstructionType::Ne: {
+        return "ne";
+    } break;
+    case IrInstructionType::Slt: {
+        return "slt";
+    } break;
+    case IrInstructionType::Sle: {
+        return "sle";
+    } break;
+    case IrInstructionType::Sgt: {
+        return "sgt";
+    } break;
+    case IrInstructionType::Sge: {
+        return "sge";
+    } break;
+    case IrInstructionType::Ult: {
+        return "ult";
+    } break;
+    case IrInstructionType::Ule: {
+        return "ule";
+    } break;
+    case IrInstructionType::Ugt: {
+        return "ugt";
+    } break;
+    case IrInstructionType::Uge: {
+        return "uge";
+    } break;
+    case IrInstructionType::Phi: {
+        return "phi";
+    } break;
+    case IrInstructionType::Call: {
+        return "call";
+    } break;
     case IrInstructionType::Return: {
         return "return";
     } break;
     case IrInstructionType::Br: {
         return "br";
     } break;
+    case IrInstructionType::CondBr: {
+        return "condbr";
+    } break;
     default: {
         std::printf("TODO: irInstructionTypeToString %llu\n", type);
         std::exit(1);
@@ -123,53 +226,444 @@ std::string irInstructionTypeToString(IrInstructionType type) {
 }
 void IrInstruction::print(size_t indent) {
     printIndent(indent);
-    if (this->result.has_value()) {
-        std::printf("#%lu = ", this->result.value());
+    if (this->hasResult) {
+        std::printf("#%u = ", this->number);
     }
     std::printf("%s ", irInstructionTypeToString(this->type).c_str());
-    for (IrOperand* operand : this->operands) {
-        operand->print();
-        if (operand != this->operands.back()) {
+    for (size_t i = 0; i < this->numOperands; ++i) {
+        this->getOperand(i).print();
+        if (i + 1 != this->numOperands) {
             std::printf(",");
         }
         std::printf(" ");
     }
     std::printf("\n");
 }
+size_t IrUse::getOperandIndex() {
+    return this - this->user->getUses();
+}
+void IrValue::addUse(IrUse* use) {
+    use->value   = this;
+    use->prevUse = nullptr;
+    use->nextUse = this->firstUse;
+    if (this->firstUse) {
+        this->firstUse->prevUse = use;
+    }
+    this->firstUse = use;
+}
+void IrValue::removeUse(IrUse* use) {
+    if (use->prevUse) {
+        use->prevUse->nextUse = use->nextUse;
+    } else {
+        this->firstUse = use->nextUse;
+    }
+    if (use->nextUse) {
+        use->nextUse->prevUse = use->prevUse;
+    }
+    use->value   = nullptr;
+    use->prevUse = nullptr;
+    use->nextUse = nullptr;
+}
+void IrValue::replaceAllUsesWith(IrValue* other) {
+    if (other == this) {
+        return;
+    }
+    while (this->firstUse) {
+        IrUse* use = this->firstUse;
+        use->user->setOperandValue(use->getOperandIndex(), other);
+    }
+}
+void IrValue::replaceAllUsesWith(IrOperand operand) {
+    if (operand.type == IrOperandType::SSA) {
+        this->replaceAllUsesWith(operand.value);
+        return;
+    }
+    while (this->firstUse) {
+        IrUse* use = this->firstUse;
+        use->user->setOperand(use->getOperandIndex(), operand);
+    }
+}
+bool IrValue::hasUses() {
+    return this->firstUse != nullptr;
+}
+size_t IrValue::getNumUses() {
+    size_t count = 0;
+    for (IrUse* use = this->firstUse; use; use = use->nextUse) {
+        count++;
+    }
+    return count;
+}
+IrValue* IrInstruction::getOperandValue(size_t index) {
+    IrOperand& operand = this->getOperand(index);
+    return operand.type == IrOperandType::SSA ? operand.value : nullptr;
+}
+void IrInstruction::setOperand(size_t index, IrOperand operand) {
+    IrUse* use = &this->getUses()[index];
+    if (use->value) {
+        use->value->removeUse(use);
+    }
+    this->getOperands()[index] = operand;
+    if (operand.type == IrOperandType::SSA) {
+        operand.value->addUse(use);
+    }
+}
+void IrInstruction::setOperandValue(size_t index, IrValue* value) {
+    this->setOperand(index, createSSAOperand(value));
+}
+void IrInstruction::dropOperands() {
+    for (size_t i = 0; i < this->numOperands; ++i) {
+        IrUse* use = &this->getUses()[i];
+        if (use->value) {
+            use->value->removeUse(use);
+        }
+    }
+}
+bool IrInstruction::isTerminator() {
+    return this->type == IrInstructionType::Return || this->type == IrInstructionType::Br ||
+           this->type == IrInstructionType::CondBr;
+}
+// Points every label operand of the instruction that names `from` at `to` instead.
+void IrInstruction::replaceSuccessor(IrBlock* from, IrBlock* to) {
+    for (size_t i = 0; i < this->numOperands; ++i) {
+        if (this->getOperand(i).type == IrOperandType::Label && this->getOperand(i).block == from) {
+            this->setOperand(i, createLabelOperand(to));
+        }
+    }
+}
+bool IrInstruction::isComparison() {
+    return this->type >= IrInstructionType::Eq && this->type <= IrInstructionType::Uge;
+}
+// Whether the instruction has to stay even when nothing reads its result. Calls are assumed to
+// touch memory.
+bool IrInstruction::hasSideEffects() {
+    return this->type == IrInstructionType::Store || this->type == IrInstructionType::Call ||
+           this->isTerminator();
+}
+void IrInstruction::removeFromParent() {
+    this->parent->remove(this);
+}
+void IrInstruction::eraseFromParent() {
+    this->dropOperands();
+    this->removeFromParent();
+}
+IrOperand createSSAOperand(IrValue* value) {
+    IrOperand op;
+    op.type   = IrOperandType::SSA;
+    op.irType = value->valueType;
+    op.value  = value;
+    return op;
+}
+IrOperand createConstOperand(IrType type, int64_t value) {
+    IrOperand op;
+    op.type     = IrOperandType::Const;
+    op.irType   = type;
+    op.constant = value;
+    return op;
+}
+IrOperand createTypeOperand(IrType type) {
+    IrOperand op;
+    op.type     = IrOperandType::Type;
+    op.irType   = type;
+    op.constant = 0;
+    return op;
+}
+IrOperand createGlobalOperand(IrObject* object, IrType type) {
+    IrOperand op;
+    op.type   = IrOperandType::Global;
+    op.irType = type;
+    op.object = object;
+    return op;
+}
+IrOperand createLabelOperand(IrBlock* block) {
+    IrOperand op;
+    op.type   = IrOperandType::Label;
+    op.irType = IrType(IrTypeType::Label);
+    op.block  = block;
+    return op;
+}
+IrOperand createFunctionOperand(IrFunction* function) {
+    IrOperand op;
+    op.type     = IrOperandType::Function;
+    op.irType   = IrType(IrTypeType::Pointer);
+    op.function = function;
+    return op;
+}
+IrType getResultType(IrInstruction* inst) {
+    switch (inst->type) {
+    case IrInstructionType::Reserve: {
+        return IrType(IrTypeType::Pointer);
+    } break;
+    case IrInstructionType::Load:
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        return inst->getOperand(1).irType;
+    } break;
+    case IrInstructionType::Const:
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem:
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh:
+    case IrInstructionType::And:
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr:
+    case IrInstructionType::Phi: {
+        return inst->getOperand(0).irType;
+    } break;
+    case IrInstructionType::Call: {
+        return inst->getOperand(0).function->returnType;
+    } break;
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge: {
+        return IrType(IrTypeType::I32);
+    } break;
+    default: {
+        return IrType(IrTypeType::Void);
+    } break;
+    }
+}
+IrArgument* IrFunction::createArgument(IrType type) {
+    IrArgument* arg = this->arena.create<IrArgument>();
+    arg->kind       = IrValueKind::Argument;
+    arg->valueType  = type;
+    arg->number     = this->nextValueNumber++;
+    arg->firstUse   = nullptr;
+    arg->index      = this->arguments.size();
+    this->arguments.push_back(arg);
+    return arg;
+}
+IrInstruction* IrFunction::createInstruction(IrInstructionType type, bool hasResult,
+                                             size_t numOperands) {
+    if (numOperands > UINT8_MAX) {
+        std::printf("ICE: Instruction with %zu operands in `%s`\n", numOperands,
+                    this->name.c_str());
+        std::exit(1);
+    }
+    size_t size   = sizeof(IrInstruction) + numOperands * (sizeof(IrOperand) + sizeof(IrUse));
+    void*  memory = this->arena.allocate(size, alignof(IrInstruction));
+    IrInstruction* inst = new (memory) IrInstruction;
+    inst->kind          = IrValueKind::Instruction;
+    inst->valueType     = IrType(IrTypeType::Void);
+    inst->number        = hasResult ? this->nextValueNumber++ : 0;
+    inst->firstUse      = nullptr;
+    inst->type          = type;
+    inst->numOperands   = numOperands;
+    inst->hasResult     = hasResult;
+    inst->parent        = nullptr;
+    inst->prev          = nullptr;
+    inst->next          = nullptr;
+    for (size_t i = 0; i < numOperands; ++i) {
+        inst->getUses()[i]     = IrUse(nullptr, inst, nullptr, nullptr);
+        inst->getOperands()[i] = createTypeOperand(IrType(IrTypeType::Void));
+    }
+    return inst;
+}
+IrInstruction* IrFunction::createInstruction(IrInstructionType type, bool hasResult,
+                                             std::initializer_list<IrOperand> operands) {
+    IrInstruction* inst  = this->createInstruction(type, hasResult, operands.size());
+    size_t         index = 0;
+    for (IrOperand operand : operands) {
+        inst->setOperand(index++, operand);
+    }
+    if (hasResult) {
+        inst->valueType = getResultType(inst);
+    }
+    return inst;
+}
+IrBlock* IrFunction::createBlock() {
+    IrBlock* block = this->arena.create<IrBlock>();
+    block->number  = this->nextBlockNumber++;
+    block->parent  = this;
+    block->prev    = nullptr;
+    block->next    = nullptr;
+    this->blocks.pushBack(block);
+    return block;
+}
+IrBlock* IrFunction::getEntryBlock() {
+    return this->blocks.front();
+}
+void IrFunction::eraseBlock(IrBlock* block) {
+    for (IrInstruction* inst : block->insts) {
+        inst->dropOperands();
+    }
+    this->blocks.remove(block);
+}
+size_t IrFunction::getInstructionCount() {
+    size_t count = 0;
+    for (IrBlock* block : this->blocks) {
+        count += block->insts.size();
+    }
+    return count;
+}
+void IrBlock::append(IrInstruction* inst) {
+    inst->parent = this;
+    this->insts.pushBack(inst);
+}
+void IrBlock::insertBefore(IrInstruction* pos, IrInstruction* inst) {
+    inst->parent = this;
+    this->insts.insertBefore(pos, inst);
+}
+void IrBlock::remove(IrInstruction* inst) {
+    this->insts.remove(inst);
+    inst->parent = nullptr;
+}
+IrInstruction* IrBlock::getTerminator() {
+    IrInstruction* last = this->insts.back();
+    return last && last->isTerminator() ? last : nullptr;
+}
+std::vector<IrBlock*> IrBlock::getSuccessors() {
+    std::vector<IrBlock*> successors;
+    IrInstruction*        terminator = this->getTerminator();
+    if (!terminator) {
+        return successors;
+    }
+    for (size_t i = 0; i < terminator->numOperands; ++i) {
+        if (terminator->getOperand(i).type == IrOperandType::Label) {
+            successors.push_back(terminator->getOperand(i).block);
+        }
+    }
+    return successors;
+}
+// Drops the incoming entries of `pred` from every phi of the block, for when the edge from `pred`
+// is about to disappear. A phi left with a single incoming value is replaced by it.
+void IrBlock::removePredecessor(IrBlock* pred) {
+    IrFunction* func = this->parent;
+    for (IrInstruction* phi : this->insts) {
+        if (phi->type != IrInstructionType::Phi) {
+            break;
+        }
+        std::vector<IrOperand> kept;
+        for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+            if (phi->getOperand(i + 1).block != pred) {
+                kept.push_back(phi->getOperand(i));
+                kept.push_back(phi->getOperand(i + 1));
+            }
+        }
+        if (kept.size() == phi->numOperands) {
+            continue;
+        }
+        bool selfReference = kept.size() == 2 && kept.at(0).type == IrOperandType::SSA &&
+                             kept.at(0).value == phi;
+        if (kept.size() == 2 && !selfReference) {
+            phi->replaceAllUsesWith(kept.at(0));
+            phi->eraseFromParent();
+            continue;
+        }
+        IrInstruction* newPhi = func->createInstruction(IrInstructionType::Phi, true, kept.size());
+        newPhi->valueType     = phi->valueType;
+        for (size_t i = 0; i < kept.size(); ++i) {
+            newPhi->setOperand(i, kept.at(i));
+        }
+        this->insertBefore(phi, newPhi);
+        phi->replaceAllUsesWith(newPhi);
+        phi->eraseFromParent();
+    }
+}
+// Relabels the incoming entries of `from` in every phi of the block as coming from `to`.
+void IrBlock::replacePredecessor(IrBlock* from, IrBlock* to) {
+    for (IrInstruction* phi : this->insts) {
+        if (phi->type != IrInstructionType::Phi) {
+            break;
+        }
+        phi->replaceSuccessor(from, to);
+    }
+}
+// Gives every phi of the block an incoming entry for the new predecessor `pred`, carrying the value
+// the phi already receives from `like`.
+void IrBlock::addPredecessor(IrBlock* pred, IrBlock* like) {
+    IrFunction* func = this->parent;
+    for (IrInstruction* phi : this->insts) {
+        if (phi->type != IrInstructionType::Phi) {
+            break;
+        }
+        IrOperand incoming = createTypeOperand(phi->valueType);
+        for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+            if (phi->getOperand(i + 1).block == like) {
+                incoming = phi->getOperand(i);
+            }
+        }
+        IrInstruction* newPhi =
+            func->createInstruction(IrInstructionType::Phi, true, phi->numOperands + 2);
+        newPhi->valueType = phi->valueType;
+        for (size_t i = 0; i < phi->numOperands; ++i) {
+            newPhi->setOperand(i, phi->getOperand(i));
+        }
+        newPhi->setOperand(phi->numOperands, incoming);
+        newPhi->setOperand(phi->numOperands + 1, createLabelOperand(pred));
+        this->insertBefore(phi, newPhi);
+        phi->replaceAllUsesWith(newPhi);
+        phi->eraseFromParent();
+    }
+}
 void IrBlock::print(size_t indent) {
     printIndent(indent);
-    std::printf("%s:\n", this->name.c_str());
+    std::printf(".BB%u:\n", this->number);
     for (IrInstruction* inst : this->insts) {
         inst->print(indent + 2);
     }
 }
+// Symbols are mangled as `_L` followed by the length of the name and the name, so they cannot
+// collide with the C library. `@attrib(no_mangle)` keeps the plain name.
+static std::string mangleName(std::string name, bool noMangle) {
+    if (noMangle) {
+        return name;
+    }
+    return "_L" + std::to_string(name.size()) + name;
+}
+std::string IrFunction::getSymbolName() {
+    return mangleName(this->name, this->noMangle);
+}
 void IrFunction::print(size_t indent) {
     printIndent(indent);
     std::printf("function ");
-    this->returnType->print();
+    this->returnType.print();
     std::printf(" $%s(", this->name.c_str());
-    for (std::pair<IrType*, size_t> arg : this->arguments) {
-        std::printf("#%lu ", arg.second);
-        arg.first->print();
-        if (arg != this->arguments.back()) {
+    for (size_t i = 0; i < this->arguments.size(); ++i) {
+        std::printf("#%u ", this->arguments.at(i)->number);
+        this->arguments.at(i)->valueType.print();
+        if (i + 1 != this->arguments.size()) {
             std::printf(", ");
         }
     }
-    std::printf(") {\n");
-    for (IrInstruction* inst : this->entryInsts) {
-        inst->print(4);
+    std::printf(")");
+    if (this->alwaysInline) {
+        std::printf(" inline");
+    }
+    if (this->noInline) {
+        std::printf(" noinline");
     }
+    if (this->noMangle) {
+        std::printf(" no_mangle");
+    }
+    std::printf(" {\n");
     for (IrBlock* block : this->blocks) {
         block->print(2);
     }
     std::printf("}\n");
 }
+std::string IrObject::getSymbolName() {
+    return mangleName(this->name, this->noMangle);
+}
 void IrObject::print(size_t indent) {
     printIndent(indent);
-    std::printf("object $%s, ", this->name.c_str());
-    this->type->print();
+    std::printf("object $%s%s, ", this->name.c_str(), this->noMangle ? " no_mangle" : "");
+    this->type.print();
     std::printf(" = ");
-    this->value->print();
+    this->value.print();
     std::printf("\n");
 }
 }; // namespace language
\ No newline at end of file
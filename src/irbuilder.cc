@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstdlib>
+#include <irbuilder.h>
+
+namespace language {
+IrBuilder::IrBuilder(IrFunction* _func) {
+    this->func   = _func;
+    this->block  = nullptr;
+    this->before = nullptr;
+}
+void IrBuilder::setInsertPoint(IrBlock* _block) {
+    this->block  = _block;
+    this->before = nullptr;
+}
+void IrBuilder::setInsertPoint(IrInstruction* _before) {
+    this->block  = _before->parent;
+    this->before = _before;
+}
+IrBlock* IrBuilder::getInsertBlock() {
+    return this->block;
+}
+IrFunction* IrBuilder::getFunction() {
+    return this->func;
+}
+IrInstruction* IrBuilder::insert(IrInstruction* inst) {
+    if (!this->block) {
+        std::printf("ICE: IrBuilder has no insertion point in `%s`\n", this->func->name.c_str());
+        std::exit(1);
+    }
+    this->block->insertBefore(this->before, inst);
+    return inst;
+}
+IrBlock* IrBuilder::createBlock() {
+    return this->func->createBlock();
+}
+IrInstruction* IrBuilder::createReserve(IrType type) {
+    return this->insert(
+        this->func->createInstruction(IrInstructionType::Reserve, true, {createTypeOperand(type)}));
+}
+IrInstruction* IrBuilder::createStore(IrOperand pointer, IrValue* value) {
+    return this->insert(this->func->createInstruction(IrInstructionType::Store, false,
+                                                      {pointer, createSSAOperand(value)}));
+}
+IrInstruction* IrBuilder::createLoad(IrOperand pointer, IrType type) {
+    return this->insert(this->func->createInstruction(IrInstructionType::Load, true,
+                                                      {pointer, createTypeOperand(type)}));
+}
+IrInstruction* IrBuilder::createCast(IrInstructionType type, IrValue* value, IrType destType) {
+    return this->insert(this->func->createInstruction(
+        type, true, {createSSAOperand(value), createTypeOperand(destType)}));
+}
+IrInstruction* IrBuilder::createConst(IrType type, int64_t value) {
+    return this->insert(this->func->createInstruction(IrInstructionType::Const, true,
+                                                      {createConstOperand(type, value)}));
+}
+IrInstruction* IrBuilder::createBinary(IrInstructionType type, IrValue* lhs, IrValue* rhs) {
+    return this->insert(this->func->createInstruction(
+        type, true, {createSSAOperand(lhs), createSSAOperand(rhs)}));
+}
+IrInstruction* IrBuilder::createCall(IrFunction* callee, const std::vector<IrValue*>& args) {
+    bool           hasResult = callee->returnType.type != IrTypeType::Void;
+    IrInstruction* inst =
+        this->func->createInstruction(IrInstructionType::Call, hasResult, args.size() + 1);
+    inst->setOperand(0, createFunctionOperand(callee));
+    for (size_t i = 0; i < args.size(); ++i) {
+        inst->setOperandValue(i + 1, args.at(i));
+    }
+    if (hasResult) {
+        inst->valueType = callee->returnType;
+    }
+    return this->insert(inst);
+}
+IrInstruction* IrBuilder::createReturn(IrValue* value) {
+    if (!value) {
+        return this->insert(this->func->createInstruction(
+            IrInstructionType::Return, false, {createTypeOperand(IrType(IrTypeType::Void))}));
+    }
+    return this->insert(this->func->createInstruction(IrInstructionType::Return, false,
+                                                      {createSSAOperand(value)}));
+}
+IrInstruction* IrBuilder::createBr(IrBlock* target) {
+    return this->insert(this->func->createInstruction(IrInstructionType::Br, false,
+                                                      {createLabelOperand(target)}));
+}
+IrInstruction* IrBuilder::createCondBr(IrValue* condition, IrBlock* ifTrue, IrBlock* ifFalse) {
+    return this->insert(this->func->createInstruction(
+        IrInstructionType::CondBr, false,
+        {createSSAOperand(condition), createLabelOperand(ifTrue), createLabelOperand(ifFalse)}));
+}
+}; // namespace language
@@ -0,0 +1,452 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <irfile.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace language {
+// Flags of a function in the index.
+static constexpr uint64_t FUNCTION_ALWAYS_INLINE = 1 << 0;
+static constexpr uint64_t FUNCTION_NO_INLINE     = 1 << 1;
+static constexpr uint64_t FUNCTION_NO_MANGLE     = 1 << 2;
+
+static uint64_t zigzagEncode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+static int64_t zigzagDecode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+bool isIrFile(std::string path) {
+    uint32_t   magic = 0;
+    std::FILE* f     = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    size_t read = std::fread(&magic, sizeof(magic), 1, f);
+    std::fclose(f);
+    return read == 1 && magic == IR_FILE_MAGIC;
+}
+IrWriter::IrWriter(IrModule* _module) {
+    this->module = _module;
+}
+void IrWriter::writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+uint32_t IrWriter::getString(std::string string) {
+    auto it = this->stringOffsets.find(string);
+    if (it != this->stringOffsets.end()) {
+        return it->second;
+    }
+    uint32_t offset = this->strings.size();
+    this->writeVarint(this->strings, string.size());
+    this->strings.insert(this->strings.end(), string.begin(), string.end());
+    this->stringOffsets[string] = offset;
+    return offset;
+}
+uint32_t IrWriter::getType(IrType type) {
+    for (size_t i = 0; i < this->types.size(); ++i) {
+        if (this->types.at(i) == (uint8_t)type.type) {
+            return i;
+        }
+    }
+    this->types.push_back((uint8_t)type.type);
+    return this->types.size() - 1;
+}
+void IrWriter::writeOperand(std::vector<uint8_t>& out, IrOperand& operand,
+                            std::unordered_map<IrBlock*, uint32_t>& blocks) {
+    out.push_back((uint8_t)operand.type);
+    this->writeVarint(out, this->getType(operand.irType));
+    switch (operand.type) {
+    case IrOperandType::Const: {
+        this->writeVarint(out, zigzagEncode(operand.constant));
+    } break;
+    case IrOperandType::Type: {
+    } break;
+    case IrOperandType::SSA: {
+        this->writeVarint(out, operand.value->number);
+    } break;
+    case IrOperandType::Global: {
+        this->writeVarint(out, this->objectIndex.at(operand.object));
+    } break;
+    case IrOperandType::Label: {
+        this->writeVarint(out, blocks.at(operand.block));
+    } break;
+    case IrOperandType::Function: {
+        this->writeVarint(out, this->functionIndex.at(operand.function));
+    } break;
+    default: {
+        std::printf("ICE: Cannot write operand type %llu\n", operand.type);
+        std::exit(1);
+    } break;
+    }
+}
+void IrWriter::writeBody(std::vector<uint8_t>& out, IrFunction* func) {
+    std::unordered_map<IrBlock*, uint32_t> blocks;
+    for (IrBlock* block : func->blocks) {
+        blocks[block] = blocks.size();
+    }
+    this->writeVarint(out, func->nextValueNumber);
+    this->writeVarint(out, func->nextBlockNumber);
+    this->writeVarint(out, blocks.size());
+    for (IrBlock* block : func->blocks) {
+        this->writeVarint(out, block->number);
+        this->writeVarint(out, block->insts.size());
+        for (IrInstruction* inst : block->insts) {
+            out.push_back((uint8_t)inst->type);
+            out.push_back(inst->hasResult);
+            this->writeVarint(out, inst->numOperands);
+            if (inst->hasResult) {
+                this->writeVarint(out, inst->number);
+                this->writeVarint(out, this->getType(inst->valueType));
+            }
+            for (size_t i = 0; i < inst->numOperands; ++i) {
+                this->writeOperand(out, inst->getOperand(i), blocks);
+            }
+        }
+    }
+}
+void IrWriter::write(std::string path) {
+    for (size_t i = 0; i < this->module->objects.size(); ++i) {
+        this->objectIndex[this->module->objects.at(i)] = i;
+    }
+    for (size_t i = 0; i < this->module->functions.size(); ++i) {
+        this->functionIndex[this->module->functions.at(i)] = i;
+    }
+    std::vector<uint8_t> objects;
+    for (IrObject* obj : this->module->objects) {
+        this->writeVarint(objects, this->getString(obj->name));
+        this->writeVarint(objects, this->getType(obj->type));
+        objects.push_back(obj->noMangle);
+        std::unordered_map<IrBlock*, uint32_t> noBlocks;
+        this->writeOperand(objects, obj->value, noBlocks);
+    }
+    std::vector<uint8_t> bodies;
+    std::vector<uint8_t> functions;
+    for (IrFunction* func : this->module->functions) {
+        uint64_t flags = (func->alwaysInline ? FUNCTION_ALWAYS_INLINE : 0) |
+                         (func->noInline ? FUNCTION_NO_INLINE : 0) |
+                         (func->noMangle ? FUNCTION_NO_MANGLE : 0);
+        this->writeVarint(functions, this->getString(func->name));
+        this->writeVarint(functions, this->getType(func->returnType));
+        this->writeVarint(functions, flags);
+        this->writeVarint(functions, func->arguments.size());
+        for (IrArgument* arg : func->arguments) {
+            this->writeVarint(functions, arg->number);
+            this->writeVarint(functions, this->getType(arg->valueType));
+        }
+        // Bodies are placed after the index, their offsets are relative to the first one.
+        uint64_t start = bodies.size();
+        if (!func->blocks.empty()) {
+            this->writeBody(bodies, func);
+        }
+        this->writeVarint(functions, start);
+        this->writeVarint(functions, bodies.size() - start);
+    }
+
+    IrFileHeader header;
+    header.magic           = IR_FILE_MAGIC;
+    header.version         = IR_FILE_VERSION;
+    header.stringsOffset   = sizeof(IrFileHeader);
+    header.stringsSize     = this->strings.size();
+    header.typesOffset     = header.stringsOffset + header.stringsSize;
+    header.typeCount       = this->types.size();
+    header.objectsOffset   = header.typesOffset + header.typeCount;
+    header.objectCount     = this->module->objects.size();
+    header.functionsOffset = header.objectsOffset + objects.size();
+    header.functionCount   = this->module->functions.size();
+    uint64_t bodiesOffset  = header.functionsOffset + functions.size();
+    uint64_t fileSize      = bodiesOffset + bodies.size();
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, fileSize) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    void* mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    uint8_t* data = (uint8_t*)mapping;
+    std::memcpy(data, &header, sizeof(IrFileHeader));
+    std::memcpy(data + header.stringsOffset, this->strings.data(), this->strings.size());
+    std::memcpy(data + header.typesOffset, this->types.data(), this->types.size());
+    std::memcpy(data + header.objectsOffset, objects.data(), objects.size());
+    std::memcpy(data + header.functionsOffset, functions.data(), functions.size());
+    std::memcpy(data + bodiesOffset, bodies.data(), bodies.size());
+    munmap(mapping, fileSize);
+}
+IrReader::IrReader(std::string _path) {
+    this->path   = _path;
+    this->data   = nullptr;
+    this->size   = 0;
+    this->module = new IrModule;
+    int fd       = open(_path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), _path.c_str());
+        std::exit(1);
+    }
+    this->size = info.st_size;
+    if (this->size < sizeof(IrFileHeader)) {
+        this->fail();
+    }
+    void* mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), _path.c_str());
+        std::exit(1);
+    }
+    this->data = (uint8_t*)mapping;
+    std::memcpy(&this->header, this->data, sizeof(IrFileHeader));
+    if (this->header.magic != IR_FILE_MAGIC || this->header.version != IR_FILE_VERSION) {
+        this->fail();
+    }
+    this->getSection(this->header.stringsOffset, this->header.stringsSize);
+    IrFileCursor cursor = {this->getSection(this->header.typesOffset, this->header.typeCount),
+                           this->data + this->header.typesOffset + this->header.typeCount};
+    for (uint64_t i = 0; i < this->header.typeCount; ++i) {
+        if (cursor.position[i] > (uint8_t)IrTypeType::Custom) {
+            this->fail();
+        }
+        this->types.push_back((IrTypeType)cursor.position[i]);
+    }
+    // Objects and functions exist before any of them is read, values and calls may name them.
+    for (uint64_t i = 0; i < this->header.objectCount; ++i) {
+        this->module->objects.push_back(new IrObject);
+    }
+    for (uint64_t i = 0; i < this->header.functionCount; ++i) {
+        this->module->functions.push_back(new IrFunction);
+    }
+    cursor = {this->getSection(this->header.objectsOffset, 0), this->data + this->size};
+    std::vector<IrBlock*> noBlocks;
+    for (IrObject* obj : this->module->objects) {
+        obj->name     = this->readString(cursor);
+        obj->type     = this->readType(cursor);
+        obj->noMangle = this->readByte(cursor);
+        obj->value    = this->readOperand(cursor, noBlocks);
+    }
+    cursor = {this->getSection(this->header.functionsOffset, 0), this->data + this->size};
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    for (IrFunction* func : this->module->functions) {
+        func->name         = this->readString(cursor);
+        func->returnType   = this->readType(cursor);
+        uint64_t flags     = this->readVarint(cursor);
+        func->alwaysInline = flags & FUNCTION_ALWAYS_INLINE;
+        func->noInline     = flags & FUNCTION_NO_INLINE;
+        func->noMangle     = flags & FUNCTION_NO_MANGLE;
+        uint64_t count     = this->readVarint(cursor);
+        for (uint64_t j = 0; j < count; ++j) {
+            uint64_t    number = this->readVarint(cursor);
+            IrArgument* arg    = func->createArgument(this->readType(cursor));
+            arg->number        = number;
+        }
+        uint64_t start = this->readVarint(cursor);
+        ranges.push_back({start, this->readVarint(cursor)});
+    }
+    uint64_t bodiesOffset = cursor.position - this->data;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        if (ranges.at(i).second != 0) {
+            uint64_t offset = bodiesOffset + ranges.at(i).first;
+            this->getSection(offset, ranges.at(i).second);
+            this->bodies[this->module->functions.at(i)] = {offset, ranges.at(i).second};
+        }
+    }
+}
+IrReader::~IrReader() {
+    if (this->data) {
+        munmap(this->data, this->size);
+    }
+}
+IrModule* IrReader::getModule() {
+    return this->module;
+}
+IrFunction* IrReader::getFunction(std::string name) {
+    for (IrFunction* func : this->module->functions) {
+        if (func->name == name) {
+            this->materialize(func);
+            return func;
+        }
+    }
+    return nullptr;
+}
+bool IrReader::isMaterialized(IrFunction* func) {
+    return !this->bodies.contains(func);
+}
+void IrReader::materialize(IrFunction* func) {
+    auto it = this->bodies.find(func);
+    if (it == this->bodies.end()) {
+        return;
+    }
+    IrFileCursor cursor = {this->data + it->second.first,
+                           this->data + it->second.first + it->second.second};
+    this->bodies.erase(it);
+
+    uint64_t              valueCount = this->readVarint(cursor);
+    uint64_t              blockCount;
+    std::vector<IrValue*> values(valueCount, nullptr);
+    std::vector<IrBlock*> blocks;
+    func->nextBlockNumber = this->readVarint(cursor);
+    blockCount            = this->readVarint(cursor);
+    for (IrArgument* arg : func->arguments) {
+        if (arg->number >= valueCount) {
+            this->fail();
+        }
+        values.at(arg->number) = arg;
+    }
+    for (uint64_t i = 0; i < blockCount; ++i) {
+        blocks.push_back(func->createBlock());
+    }
+    // SSA operands are set once every value exists, a phi may name a value defined further down.
+    struct PendingOperand {
+        IrInstruction* inst;
+        size_t         index;
+        uint64_t       number;
+    };
+    std::vector<PendingOperand> pending;
+    for (IrBlock* block : blocks) {
+        block->number = this->readVarint(cursor);
+        uint64_t count = this->readVarint(cursor);
+        for (uint64_t i = 0; i < count; ++i) {
+            uint8_t type        = this->readByte(cursor);
+            bool    hasResult   = this->readByte(cursor);
+            uint64_t numOperands = this->readVarint(cursor);
+            if (type > (uint8_t)IrInstructionType::CondBr || numOperands > UINT8_MAX) {
+                this->fail();
+            }
+            IrInstruction* inst = func->createInstruction((IrInstructionType)type, hasResult,
+                                                          numOperands);
+            if (hasResult) {
+                inst->number = this->readVarint(cursor);
+                if (inst->number >= valueCount || values.at(inst->number)) {
+                    this->fail();
+                }
+                inst->valueType         = this->readType(cursor);
+                values.at(inst->number) = inst;
+            }
+            for (size_t j = 0; j < numOperands; ++j) {
+                IrOperand operand = this->readOperand(cursor, blocks);
+                if (operand.type == IrOperandType::SSA) {
+                    pending.push_back({inst, j, (uint64_t)operand.constant});
+                } else {
+                    inst->setOperand(j, operand);
+                }
+            }
+            block->append(inst);
+        }
+    }
+    for (PendingOperand& operand : pending) {
+        if (operand.number >= valueCount || !values.at(operand.number)) {
+            this->fail();
+        }
+        operand.inst->setOperandValue(operand.index, values.at(operand.number));
+    }
+    func->nextValueNumber = valueCount;
+}
+void IrReader::materializeAll() {
+    for (IrFunction* func : this->module->functions) {
+        this->materialize(func);
+    }
+}
+void IrReader::fail() {
+    std::fprintf(stderr, "Invalid IR file `%s`\n", this->path.c_str());
+    std::exit(1);
+}
+const uint8_t* IrReader::getSection(uint64_t offset, uint64_t length) {
+    if (offset > this->size || length > this->size - offset) {
+        this->fail();
+    }
+    return this->data + offset;
+}
+uint8_t IrReader::readByte(IrFileCursor& cursor) {
+    if (cursor.position >= cursor.end) {
+        this->fail();
+    }
+    return *cursor.position++;
+}
+uint64_t IrReader::readVarint(IrFileCursor& cursor) {
+    uint64_t value = 0;
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        uint8_t byte = this->readByte(cursor);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    this->fail();
+    return 0;
+}
+IrType IrReader::readType(IrFileCursor& cursor) {
+    uint64_t index = this->readVarint(cursor);
+    if (index >= this->types.size()) {
+        this->fail();
+    }
+    return IrType(this->types.at(index));
+}
+std::string IrReader::readString(IrFileCursor& cursor) {
+    uint64_t       offset  = this->readVarint(cursor);
+    IrFileCursor   strings = {this->data + this->header.stringsOffset,
+                              this->data + this->header.stringsOffset + this->header.stringsSize};
+    if (offset >= this->header.stringsSize) {
+        this->fail();
+    }
+    strings.position += offset;
+    uint64_t length = this->readVarint(strings);
+    if (length > (uint64_t)(strings.end - strings.position)) {
+        this->fail();
+    }
+    return std::string((const char*)strings.position, length);
+}
+// An SSA operand comes back with its value number in `constant`, the caller resolves it.
+IrOperand IrReader::readOperand(IrFileCursor& cursor, std::vector<IrBlock*>& blocks) {
+    uint8_t type   = this->readByte(cursor);
+    IrType  irType = this->readType(cursor);
+    switch ((IrOperandType)type) {
+    case IrOperandType::Const: {
+        return createConstOperand(irType, zigzagDecode(this->readVarint(cursor)));
+    } break;
+    case IrOperandType::Type: {
+        return createTypeOperand(irType);
+    } break;
+    case IrOperandType::SSA: {
+        IrOperand operand = createConstOperand(irType, this->readVarint(cursor));
+        operand.type      = IrOperandType::SSA;
+        return operand;
+    } break;
+    case IrOperandType::Global: {
+        uint64_t index = this->readVarint(cursor);
+        if (index >= this->module->objects.size()) {
+            this->fail();
+        }
+        return createGlobalOperand(this->module->objects.at(index), irType);
+    } break;
+    case IrOperandType::Label: {
+        uint64_t index = this->readVarint(cursor);
+        if (index >= blocks.size()) {
+            this->fail();
+        }
+        return createLabelOperand(blocks.at(index));
+    } break;
+    case IrOperandType::Function: {
+        uint64_t index = this->readVarint(cursor);
+        if (index >= this->module->functions.size()) {
+            this->fail();
+        }
+        return createFunctionOperand(this->module->functions.at(index));
+    } break;
+    default: {
+        this->fail();
+    } break;
+    }
+    return createTypeOperand(irType);
+}
+}; // namespace language
@@ -1,4 +1,5 @@
 #include <irgen.h>
+#include <irverifier.h>
 
 namespace language {
 static TypeSpec* getBiggestType(TypeSpec* type1, TypeSpec* type2) {
@@ -23,477 +24,548 @@ static TypeSpec* getBiggestType(TypeSpec* type1, TypeSpec* type2) {
     std::printf("ICE: Implicit cast\n");
     std::exit(1);
 }
-static IrOperand* createSSAOperand(size_t ssaNumber, IrType* type) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::SSA;
-    op->irType    = type;
-    op->ssaResult = ssaNumber;
-    return op;
+static bool isComparisonOperator(std::string _operator) {
+    return _operator == "==" || _operator == "!=" || _operator == "<" || _operator == "<=" ||
+           _operator == ">" || _operator == ">=";
 }
-static IrObject* findObjectWithName(std::vector<IrObject*> objects, std::string name) {
-    for (IrObject* obj : objects) {
-        if (obj->name == name) {
-            return obj;
-        }
+// Type both operands of a binary operator are brought to. A literal alone is unsigned, in a
+// division or a comparison it takes the type of the other operand instead, so `x / 7` on an i32
+// divides signed and `x < 0` compares signed.
+static TypeSpec* getOperandType(BinaryExpressionNode* node, TypeSpec* lhs, TypeSpec* rhs) {
+    bool literalFollows = node->getOperator() == "/" || node->getOperator() == "%" ||
+                          isComparisonOperator(node->getOperator());
+    bool lhsLiteral     = node->getLhs()->getExprType() == ExpressionNodeType::NumericLiteral;
+    bool rhsLiteral     = node->getRhs()->getExprType() == ExpressionNodeType::NumericLiteral;
+    if (literalFollows && rhsLiteral && !lhsLiteral && rhs->getBitSize() <= lhs->getBitSize()) {
+        return lhs;
+    }
+    if (literalFollows && lhsLiteral && !rhsLiteral && lhs->getBitSize() <= rhs->getBitSize()) {
+        return rhs;
+    }
+    return getBiggestType(lhs, rhs);
+}
+static IrInstructionType getComparisonType(std::string _operator, bool isUnsigned) {
+    if (_operator == "==") {
+        return IrInstructionType::Eq;
+    } else if (_operator == "!=") {
+        return IrInstructionType::Ne;
+    } else if (_operator == "<") {
+        return isUnsigned ? IrInstructionType::Ult : IrInstructionType::Slt;
+    } else if (_operator == "<=") {
+        return isUnsigned ? IrInstructionType::Ule : IrInstructionType::Sle;
+    } else if (_operator == ">") {
+        return isUnsigned ? IrInstructionType::Ugt : IrInstructionType::Sgt;
+    }
+    return isUnsigned ? IrInstructionType::Uge : IrInstructionType::Sge;
+}
+static IrInstructionType getDivisionType(std::string _operator, bool isUnsigned) {
+    if (_operator == "/") {
+        return isUnsigned ? IrInstructionType::Udiv : IrInstructionType::Sdiv;
     }
-    std::printf("ICE: No object with name `%s`\n", name.c_str());
+    return isUnsigned ? IrInstructionType::Urem : IrInstructionType::Srem;
+}
+static IrOperand createConstI32Operand(int32_t value) {
+    return createConstOperand(IrType(IrTypeType::I32), value);
+}
+static IrOperand createConstI64Operand(int64_t value) {
+    return createConstOperand(IrType(IrTypeType::I64), value);
+}
+static IrType generateType(TypeSpec* type) {
+    if (type->getPointerCount() > 0) {
+        return IrType(IrTypeType::Pointer);
+    }
+    if (type->getName() == "String") {
+        return IrType(IrTypeType::String);
+    }
+    if (type->getName() == "Variadic") {
+        return IrType(IrTypeType::Variadic);
+    }
+    if (type->getName() == "void") {
+        return IrType(IrTypeType::Void);
+    }
+    if (type->getBitSize() == 32 && type->isInteger()) {
+        return IrType(IrTypeType::I32);
+    }
+    if (type->getBitSize() == 64 && type->isInteger()) {
+        return IrType(IrTypeType::I64);
+    }
+    std::printf("TODO: Generate type for typespec name `%s`\n", type->getName().c_str());
     std::exit(1);
 }
-static TypeSpec* convertExpressionToType(std::vector<IrObject*> objects, IrFunction* currentFunc,
-                                         ExpressionNode* node) {
-    switch (node->getExprType()) {
+// Same as Sema gives it, a literal above UINT32_MAX is a u64.
+static TypeSpec* getLiteralType(NumericLiteralExpressionNode* node) {
+    int64_t val = std::stol(node->getValue());
+    return new TypeSpec(0, val < 0 ? (val + UINT32_MAX >= 0 ? "i32" : "i64")
+                                   : (val > UINT32_MAX ? "u64" : "u32"));
+}
+// Operands that need no function around them, the initializers of globals are made of these. A
+// literal is as wide as its type, a cast converts the constant the way trunc, zext and sext would.
+static IrOperand generateLiteralOperand(ExpressionNode* expr) {
+    switch (expr->getExprType()) {
     case ExpressionNodeType::NumericLiteral: {
-        int64_t val = std::stol(reinterpret_cast<NumericLiteralExpressionNode*>(node)->getValue());
-        return new TypeSpec(0, val < 0 ? (val + UINT32_MAX >= 0 ? "i32" : "i64")
-                                       : (val > UINT32_MAX ? "u64" : "u32"));
-    } break;
-    case ExpressionNodeType::Unary: {
-        return new TypeSpec(0, "i32");
-    } break;
-    case ExpressionNodeType::Binary: {
-        BinaryExpressionNode* binNode = reinterpret_cast<BinaryExpressionNode*>(node);
-        TypeSpec* lhs = convertExpressionToType(objects, currentFunc, binNode->getLhs());
-        TypeSpec* rhs = convertExpressionToType(objects, currentFunc, binNode->getRhs());
-        return getBiggestType(lhs, rhs);
-    } break;
-    case ExpressionNodeType::LtoRValue: {
-        return convertExpressionToType(objects, currentFunc,
-                                       reinterpret_cast<LtoRValueCastExpression*>(node)->getExpr());
+        NumericLiteralExpressionNode* numExpr =
+            reinterpret_cast<NumericLiteralExpressionNode*>(expr);
+        int64_t val = std::stol(numExpr->getValue());
+        return getLiteralType(numExpr)->getBitSize() == 32 ? createConstI32Operand(val)
+                                                           : createConstI64Operand(val);
     } break;
     case ExpressionNodeType::Cast: {
-        return reinterpret_cast<CastExpressionNode*>(node)->getType();
-    } break;
-    case ExpressionNodeType::IdentifierLiteral: {
-        if (currentFunc->nameToSSANumber.contains(
-                reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue())) {
-            IrInstruction* inst;
-            for (IrInstruction* blockInst : currentFunc->entryInsts) {
-                if (blockInst->result.has_value() &&
-                    blockInst->result.value() ==
-                        currentFunc->nameToSSANumber.at(
-                            reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue())) {
-                    inst = blockInst;
-                    break;
-                }
-            }
-            if (!inst || inst->type != IrInstructionType::Reserve || inst->operands.size() < 1) {
-                std::printf(
-                    "ICE: Invalid point to name SSA `%s`\n",
-                    reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue().c_str());
-                std::exit(1);
-            }
-            return new TypeSpec(inst->operands.at(0)->irType->name == "ptr" ? 1 : 0,
-                                inst->operands.at(0)->irType->name);
+        CastExpressionNode* castExpr = reinterpret_cast<CastExpressionNode*>(expr);
+        ExpressionNode*     value    = castExpr->getValue();
+        IrOperand           actualOp = generateLiteralOperand(value);
+        TypeSpec*           fromType;
+        if (value->getExprType() == ExpressionNodeType::Cast) {
+            fromType = reinterpret_cast<CastExpressionNode*>(value)->getType();
         } else {
-            return new TypeSpec(
-                findObjectWithName(
-                    objects, reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue())
-                            ->type->name == "ptr"
-                    ? 1
-                    : 0,
-                findObjectWithName(
-                    objects, reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue())
-                    ->type->name);
+            fromType = getLiteralType(reinterpret_cast<NumericLiteralExpressionNode*>(value));
+        }
+        actualOp.irType = generateType(castExpr->getType());
+        if (actualOp.irType.type == IrTypeType::I32) {
+            actualOp.constant = (int32_t)actualOp.constant;
+        } else if (fromType->getBitSize() == 32) {
+            actualOp.constant = fromType->isUnsigned() ? (int64_t)(uint32_t)actualOp.constant
+                                                       : (int64_t)(int32_t)actualOp.constant;
         }
+        return actualOp;
     } break;
     default: {
-        std::printf("ICE: Unhandled expression node type for conversion %llu\n",
-                    node->getExprType());
+        std::printf("TODO: Generate operand for expression type %llu\n", expr->getExprType());
         std::exit(1);
     } break;
     }
 }
-static IrOperand* createConstI32Operand(int32_t value) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::ConstI32;
-    op->irType    = new IrType(IrTypeType::I32, "i32");
-    op->constI32  = value;
-    return op;
-}
-static IrOperand* createConstI64Operand(int64_t value) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::ConstI64;
-    op->irType    = new IrType(IrTypeType::I64, "i64");
-    op->constI64  = value;
-    return op;
-}
-static IrOperand* createTypeOperand(IrType* type) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::Type;
-    op->irType    = type;
-    return op;
-}
-static IrOperand* createNameOperand(std::string name, IrType* type) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::Name;
-    op->irType    = type;
-    op->name      = name;
-    return op;
-}
-static IrOperand* createLabelOperand(std::string label) {
-    IrOperand* op = new IrOperand;
-    op->type      = IrOperandType::Label;
-    op->name      = label;
-    op->irType    = new IrType(IrTypeType::Label, "label");
-    return op;
-}
-static size_t blockNumbers = 0;
 IrGen::IrGen(Ast* ast) {
-    this->inAst = ast;
+    this->inAst     = ast;
+    this->outModule = nullptr;
 }
 IrObject* IrGen::emitTopVariableDecl(VariableDeclarationNode* node) {
     IrObject* obj = new IrObject;
     obj->name     = node->getName();
-    obj->type     = this->generateType(node->getType());
-    obj->value    = this->generateOperand(node->getValue().value());
+    obj->type     = generateType(node->getType());
+    obj->value    = generateLiteralOperand(node->getValue().value());
+    for (AttributeNode* attrib : node->getAttribs()) {
+        if (attrib->getType() == AttributeType::NoMangle) {
+            obj->noMangle = true;
+        }
+    }
+
+    this->globals.objects[obj->name] = obj;
+    this->globals.types[obj->name]   = node->getType();
     return obj;
 }
-static size_t ssaResults = 0;
-IrFunction*   IrGen::emitTopFunctionDecl(FunctionDeclarationNode* node) {
-    IrFunction* func  = new IrFunction;
-    this->currentFunc = func;
-    func->name        = node->getName();
-    func->returnType  = this->generateType(node->getReturnType());
-    std::pair<std::vector<std::pair<IrType*, size_t>>, std::unordered_map<std::string, size_t>>
-        tempArgs                  = this->constructFuncArgs(node->getParams());
-    func->arguments               = tempArgs.first;
-    func->nameToSSANumber         = tempArgs.second;
-    ssaResults                    = func->arguments.size();
-    blockNumbers                  = 0;
-    func->blocks                  = this->generateBlocks(node->getBody());
-    IrInstruction* terminatorInst = new IrInstruction;
-    terminatorInst->type          = IrInstructionType::Br;
-    terminatorInst->operands      = {createLabelOperand(".BB0")};
-    func->entryInsts.push_back(terminatorInst);
-    return func;
-}
-std::variant<IrFunction*, IrObject*> IrGen::emitTopDeclaration(DeclarationNode* node) {
-    switch (node->getDeclType()) {
-    case DeclarationNodeType::Variable: {
-        return this->emitTopVariableDecl(reinterpret_cast<VariableDeclarationNode*>(node));
-    } break;
-    case DeclarationNodeType::Function: {
-        return this->emitTopFunctionDecl(reinterpret_cast<FunctionDeclarationNode*>(node));
-    } break;
-    default: {
-        std::printf("TODO: Top level declaration emit of node type %llu\n", node->getDeclType());
-        std::exit(1);
-    } break;
+IrFunction* IrGen::declareFunction(FunctionDeclarationNode* node) {
+    IrFunction* func = new IrFunction;
+    func->name       = node->getName();
+    func->returnType = generateType(node->getReturnType());
+
+    this->globals.functions[func->name] = func;
+    this->globals.types[func->name]     = node->getReturnType();
+    for (AttributeNode* attrib : node->getAttribs()) {
+        if (attrib->getType() == AttributeType::Inline) {
+            func->alwaysInline = true;
+        } else if (attrib->getType() == AttributeType::NoInline) {
+            func->noInline = true;
+        } else if (attrib->getType() == AttributeType::NoMangle) {
+            func->noMangle = true;
+        }
     }
-}
-std::variant<IrFunction*, IrObject*> IrGen::emitNode(AstNode* node) {
-    switch (node->getAstType()) {
-    case AstNodeType::Declaration: {
-        return this->emitTopDeclaration(reinterpret_cast<DeclarationNode*>(node));
-    } break;
-    default: {
-        std::printf("TODO: Top level emit of node type %llu\n", node->getAstType());
-        std::exit(1);
-    } break;
+    if (!node->getBody()) {
+        for (DeclarationNode* param : node->getParams()) {
+            func->createArgument(
+                generateType(reinterpret_cast<ParameterDeclarationNode*>(param)->getType()));
+        }
     }
+    return func;
 }
 void IrGen::generate() {
     this->outModule = new IrModule;
+    // Every global and function is declared up front so a body can refer to any of them, the
+    // function itself included.
+    std::vector<FunctionDeclarationNode*> bodies;
     for (AstNode* node : this->inAst->getNodes()) {
-        std::variant<IrFunction*, IrObject*> irFunctionOperand = this->emitNode(node);
-        if (irFunctionOperand.index() == 0) {
-            this->outModule->functions.push_back(std::get<IrFunction*>(irFunctionOperand));
-        } else if (irFunctionOperand.index() == 1) {
-            this->outModule->objects.push_back(std::get<IrObject*>(irFunctionOperand));
+        if (node->getAstType() != AstNodeType::Declaration) {
+            std::printf("TODO: Top level emit of node type %llu\n", node->getAstType());
+            std::exit(1);
+        }
+        DeclarationNode* declNode = reinterpret_cast<DeclarationNode*>(node);
+        switch (declNode->getDeclType()) {
+        case DeclarationNodeType::Variable: {
+            this->outModule->objects.push_back(
+                this->emitTopVariableDecl(reinterpret_cast<VariableDeclarationNode*>(declNode)));
+        } break;
+        case DeclarationNodeType::Function: {
+            FunctionDeclarationNode* funcNode =
+                reinterpret_cast<FunctionDeclarationNode*>(declNode);
+            this->outModule->functions.push_back(this->declareFunction(funcNode));
+            if (funcNode->getBody()) {
+                bodies.push_back(funcNode);
+            }
+        } break;
+        default: {
+            std::printf("TODO: Top level declaration emit of node type %llu\n",
+                        declNode->getDeclType());
+            std::exit(1);
+        } break;
         }
     }
+    // Workers only read the globals, the functions they fill in are already in source order.
+    ThreadPool pool(std::min(ThreadPool::getDefaultThreadCount(), bodies.size()));
+    pool.parallelFor(bodies.size(), [&](size_t i) {
+        IrFunctionGen funcGen(&this->globals, this->globals.functions.at(bodies.at(i)->getName()));
+        funcGen.generate(bodies.at(i));
+    });
 }
-IrType* IrGen::generateType(TypeSpec* type) {
-    if (type->getPointerCount() > 0) {
-        return new IrType(IrTypeType::Pointer, "ptr");
-    }
-    if (type->getName() == "String") {
-        return new IrType(IrTypeType::String, "string");
-    }
-    if (type->getName() == "Variadic") {
-        return new IrType(IrTypeType::Variadic, "variadic");
-    }
-    if (type->getName() == "void") {
-        return new IrType(IrTypeType::Void, "void");
+IrModule* IrGen::getModule() {
+    this->generate();
+    return this->outModule;
+}
+IrFunctionGen::IrFunctionGen(const IrGenGlobals* _globals, IrFunction* _func) {
+    this->globals = _globals;
+    this->func    = _func;
+    this->builder = new IrBuilder(_func);
+}
+IrFunctionGen::~IrFunctionGen() {
+    delete this->builder;
+}
+void IrFunctionGen::generate(FunctionDeclarationNode* node) {
+    this->builder->setInsertPoint(this->builder->createBlock());
+    this->constructFuncArgs(node->getParams());
+    this->generateBlocks(node->getBody());
+    IrVerifier verifier(this->func);
+    if (!verifier.verify()) {
+        std::printf("ICE: Generated invalid IR for `%s`: %s\n", this->func->name.c_str(),
+                    verifier.getMessage().c_str());
+        std::exit(1);
     }
-    if (type->getBitSize() == 32 && type->isInteger()) {
-        return new IrType(IrTypeType::I32, "i32");
+}
+TypeSpec* IrFunctionGen::getNameType(std::string name) {
+    auto local = this->nameToType.find(name);
+    if (local != this->nameToType.end()) {
+        return local->second;
     }
-    if (type->getBitSize() == 64 && type->isInteger()) {
-        return new IrType(IrTypeType::I64, "i64");
+    auto global = this->globals->types.find(name);
+    if (global == this->globals->types.end()) {
+        std::printf("ICE: No type for name `%s`\n", name.c_str());
+        std::exit(1);
     }
-    std::printf("TODO: Generate type for typespec name `%s`\n", type->getName().c_str());
-    std::exit(1);
+    return global->second;
 }
-IrOperand* IrGen::generateOperand(ExpressionNode* expr) {
-    switch (expr->getExprType()) {
+TypeSpec* IrFunctionGen::convertExpressionToType(ExpressionNode* node) {
+    switch (node->getExprType()) {
     case ExpressionNodeType::NumericLiteral: {
-        NumericLiteralExpressionNode* numExpr =
-            reinterpret_cast<NumericLiteralExpressionNode*>(expr);
-        int64_t val = std::stol(numExpr->getValue());
-        return val + UINT32_MAX >= 0 ? createConstI32Operand(val) : createConstI64Operand(val);
+        return getLiteralType(reinterpret_cast<NumericLiteralExpressionNode*>(node));
+    } break;
+    case ExpressionNodeType::Unary: {
+        ExpressionNode* expr = reinterpret_cast<UnaryExpressionNode*>(node)->getExpr();
+        // A negated literal is signed and as wide as the literal.
+        if (expr->getExprType() == ExpressionNodeType::NumericLiteral) {
+            TypeSpec* literalType =
+                getLiteralType(reinterpret_cast<NumericLiteralExpressionNode*>(expr));
+            return new TypeSpec(0, literalType->getBitSize() == 32 ? "i32" : "i64");
+        }
+        return this->convertExpressionToType(expr);
+    } break;
+    case ExpressionNodeType::Binary: {
+        BinaryExpressionNode* binNode = reinterpret_cast<BinaryExpressionNode*>(node);
+        if (isComparisonOperator(binNode->getOperator())) {
+            return new TypeSpec(0, "i32");
+        }
+        TypeSpec* lhs = this->convertExpressionToType(binNode->getLhs());
+        TypeSpec* rhs = this->convertExpressionToType(binNode->getRhs());
+        return getOperandType(binNode, lhs, rhs);
+    } break;
+    case ExpressionNodeType::LtoRValue: {
+        return this->convertExpressionToType(
+            reinterpret_cast<LtoRValueCastExpression*>(node)->getExpr());
     } break;
     case ExpressionNodeType::Cast: {
-        IrOperand* actualOp =
-            this->generateOperand(reinterpret_cast<CastExpressionNode*>(expr)->getValue());
-        actualOp->irType =
-            this->generateType(reinterpret_cast<CastExpressionNode*>(expr)->getType());
-        return actualOp;
+        return reinterpret_cast<CastExpressionNode*>(node)->getType();
     } break;
     case ExpressionNodeType::IdentifierLiteral: {
-        std::string name = reinterpret_cast<IdentifierLiteralExpressionNode*>(expr)->getValue();
-        if (this->currentFunc->nameToSSANumber.contains(name)) {
-            return createSSAOperand(this->currentFunc->nameToSSANumber.at(name),
-                                    new IrType(IrTypeType::Pointer, "ptr"));
-        } else {
-            return createNameOperand(findObjectWithName(this->outModule->objects, name)->name,
-                                     new IrType(IrTypeType::Pointer, "ptr"));
-        }
+        return this->getNameType(
+            reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue());
+    } break;
+    case ExpressionNodeType::FunctionCall: {
+        return this->convertExpressionToType(
+            reinterpret_cast<FunctionCallExpressionNode*>(node)->getCallee());
+    } break;
+    case ExpressionNodeType::Assignment: {
+        return this->convertExpressionToType(
+            reinterpret_cast<AssignmentExpressionNode*>(node)->getAssignee());
     } break;
     default: {
-        std::printf("TODO: Generate operand for expression type %llu\n", expr->getExprType());
+        std::printf("ICE: Unhandled expression node type for conversion %llu\n",
+                    node->getExprType());
         std::exit(1);
     } break;
     }
 }
-std::pair<std::vector<std::pair<IrType*, size_t>>, std::unordered_map<std::string, size_t>>
-IrGen::constructFuncArgs(std::vector<DeclarationNode*> nodes) {
-    std::pair<std::vector<std::pair<IrType*, size_t>>, std::unordered_map<std::string, size_t>>
-        args;
+IrOperand IrFunctionGen::generateOperand(ExpressionNode* expr) {
+    if (expr->getExprType() != ExpressionNodeType::IdentifierLiteral) {
+        return generateLiteralOperand(expr);
+    }
+    std::string name = reinterpret_cast<IdentifierLiteralExpressionNode*>(expr)->getValue();
+    if (this->func->nameToValue.contains(name)) {
+        return createSSAOperand(this->func->nameToValue.at(name));
+    }
+    auto global = this->globals->objects.find(name);
+    if (global == this->globals->objects.end()) {
+        std::printf("ICE: No object with name `%s`\n", name.c_str());
+        std::exit(1);
+    }
+    return createGlobalOperand(global->second, IrType(IrTypeType::Pointer));
+}
+void IrFunctionGen::constructFuncArgs(std::vector<DeclarationNode*> nodes) {
     for (DeclarationNode* node : nodes) {
         ParameterDeclarationNode* paramDeclNode = reinterpret_cast<ParameterDeclarationNode*>(node);
-        paramDeclNode->getType();
-        size_t number = args.first.size();
-        args.first.push_back({this->generateType(paramDeclNode->getType()), number});
-        args.second.insert({paramDeclNode->getName(), number});
+        IrArgument* arg = this->func->createArgument(generateType(paramDeclNode->getType()));
+        // Parameters live in their own slot like any other local, mem2reg turns the slot back
+        // into the argument value.
+        IrInstruction* slot = this->generateReserve(arg->valueType);
+        this->builder->createStore(createSSAOperand(slot), arg);
+        this->func->nameToValue[paramDeclNode->getName()] = slot;
+        this->nameToType[paramDeclNode->getName()]        = paramDeclNode->getType();
     }
-    return args;
-}
-size_t newSSAResult() {
-    return ssaResults++;
 }
-std::vector<IrInstruction*> IrGen::genInstsFromExpr(ExpressionNode* node) {
+IrValue* IrFunctionGen::generateExpr(ExpressionNode* node) {
     switch (node->getExprType()) {
     case ExpressionNodeType::NumericLiteral: {
-        NumericLiteralExpressionNode* numExpr =
-            reinterpret_cast<NumericLiteralExpressionNode*>(node);
-        IrInstruction* inst = new IrInstruction;
-        inst->type          = IrInstructionType::Const;
-        inst->result        = newSSAResult();
-        inst->operands      = {this->generateOperand(numExpr)};
-        return {inst};
+        IrOperand op = this->generateOperand(node);
+        return this->builder->createConst(op.irType, op.constant);
     } break;
     case ExpressionNodeType::Cast: {
-        CastExpressionNode*         castExpr = reinterpret_cast<CastExpressionNode*>(node);
-        std::vector<IrInstruction*> retInsts = this->genInstsFromExpr(castExpr->getValue());
-        if (castExpr->getType()->getBitSize() != convertExpressionToType(this->outModule->objects,
-                                                                         this->currentFunc,
-                                                                         castExpr->getValue())
-                                                     ->getBitSize()) {
-            IrInstruction* castInst = new IrInstruction;
-            castInst->result        = newSSAResult();
-            if (castExpr->getType()->getBitSize() <
-                convertExpressionToType(this->outModule->objects, this->currentFunc,
-                                        castExpr->getValue())
-                    ->getBitSize()) {
-                castInst->type = IrInstructionType::Trunc;
-            } else {
-                castInst->type = convertExpressionToType(this->outModule->objects,
-                                                         this->currentFunc, castExpr->getValue())
-                                         ->isUnsigned()
-                                     ? IrInstructionType::Zext
-                                     : IrInstructionType::Sext;
-            }
-            castInst->operands = {
-                createSSAOperand(ssaResults - 2, this->generateType(convertExpressionToType(
-                                                     this->outModule->objects, this->currentFunc,
-                                                     castExpr->getValue()))),
-                createTypeOperand(this->generateType(castExpr->getType()))};
-            retInsts.push_back(castInst);
+        CastExpressionNode* castExpr = reinterpret_cast<CastExpressionNode*>(node);
+        IrValue*            value    = this->generateExpr(castExpr->getValue());
+        TypeSpec*           fromType = this->convertExpressionToType(castExpr->getValue());
+        if (castExpr->getType()->getBitSize() == fromType->getBitSize()) {
+            return value;
+        }
+        IrInstructionType castType;
+        if (castExpr->getType()->getBitSize() < fromType->getBitSize()) {
+            castType = IrInstructionType::Trunc;
+        } else {
+            castType = fromType->isUnsigned() ? IrInstructionType::Zext : IrInstructionType::Sext;
         }
-        return retInsts;
+        return this->builder->createCast(castType, value, generateType(castExpr->getType()));
     } break;
     case ExpressionNodeType::Binary: {
-        BinaryExpressionNode*       binExpr  = reinterpret_cast<BinaryExpressionNode*>(node);
-        std::vector<IrInstruction*> lhsInsts = this->genInstsFromExpr(binExpr->getLhs());
-        size_t                      lastLhs  = ssaResults - 1;
-        std::vector<IrInstruction*> rhsInsts = this->genInstsFromExpr(binExpr->getRhs());
-        size_t                      lastRhs  = ssaResults - 1;
-        std::vector<IrInstruction*> retInsts;
-        for (IrInstruction* inst : lhsInsts) {
-            retInsts.push_back(inst);
+        BinaryExpressionNode* binExpr = reinterpret_cast<BinaryExpressionNode*>(node);
+        IrValue*              lhs     = this->generateExpr(binExpr->getLhs());
+        IrValue*              rhs     = this->generateExpr(binExpr->getRhs());
+        if (isComparisonOperator(binExpr->getOperator())) {
+            TypeSpec* type =
+                getOperandType(binExpr, this->convertExpressionToType(binExpr->getLhs()),
+                               this->convertExpressionToType(binExpr->getRhs()));
+            return this->builder->createBinary(
+                getComparisonType(binExpr->getOperator(), type->isUnsigned()), lhs, rhs);
+        } else if (binExpr->getOperator() == "*") {
+            return this->builder->createBinary(IrInstructionType::Mul, lhs, rhs);
+        } else if (binExpr->getOperator() == "+") {
+            return this->builder->createBinary(IrInstructionType::Add, lhs, rhs);
+        } else if (binExpr->getOperator() == "-") {
+            return this->builder->createBinary(IrInstructionType::Sub, lhs, rhs);
+        } else if (binExpr->getOperator() == "/" || binExpr->getOperator() == "%") {
+            TypeSpec* type =
+                getOperandType(binExpr, this->convertExpressionToType(binExpr->getLhs()),
+                               this->convertExpressionToType(binExpr->getRhs()));
+            return this->builder->createBinary(
+                getDivisionType(binExpr->getOperator(), type->isUnsigned()), lhs, rhs);
         }
-        for (IrInstruction* inst : rhsInsts) {
-            retInsts.push_back(inst);
+        std::printf("TODO: Generate binary operator `%s`\n", binExpr->getOperator().c_str());
+        std::exit(1);
+    } break;
+    case ExpressionNodeType::Unary: {
+        UnaryExpressionNode* unaryExpr = reinterpret_cast<UnaryExpressionNode*>(node);
+        IrValue*             value     = this->generateExpr(unaryExpr->getExpr());
+        if (unaryExpr->getOperator() == "-") {
+            IrValue* zero = this->builder->createConst(value->valueType, 0);
+            return this->builder->createBinary(IrInstructionType::Sub, zero, value);
         }
-        if (binExpr->getOperator() == "*") {
-            retInsts.push_back(new IrInstruction(
-                newSSAResult(), IrInstructionType::Mul,
-                {createSSAOperand(
-                     lastLhs, this->generateType(convertExpressionToType(
-                                  this->outModule->objects, this->currentFunc, binExpr->getLhs()))),
-                 createSSAOperand(lastRhs, this->generateType(convertExpressionToType(
-                                               this->outModule->objects, this->currentFunc,
-                                               binExpr->getRhs())))}));
-        } else if (binExpr->getOperator() == "+") {
-            retInsts.push_back(new IrInstruction(
-                newSSAResult(), IrInstructionType::Add,
-                {createSSAOperand(
-                     lastLhs, this->generateType(convertExpressionToType(
-                                  this->outModule->objects, this->currentFunc, binExpr->getLhs()))),
-                 createSSAOperand(lastRhs, this->generateType(convertExpressionToType(
-                                               this->outModule->objects, this->currentFunc,
-                                               binExpr->getRhs())))}));
-        } else {
-            std::printf("TODO: Generate binary operator `%s`\n", binExpr->getOperator().c_str());
+        std::printf("TODO: Generate unary operator `%s`\n", unaryExpr->getOperator().c_str());
+        std::exit(1);
+    } break;
+    case ExpressionNodeType::FunctionCall: {
+        FunctionCallExpressionNode* callExpr = reinterpret_cast<FunctionCallExpressionNode*>(node);
+        std::string                 name =
+            reinterpret_cast<IdentifierLiteralExpressionNode*>(callExpr->getCallee())->getValue();
+        std::vector<IrValue*> args;
+        for (ExpressionNode* arg : callExpr->getArguments()) {
+            args.push_back(this->generateExpr(arg));
+        }
+        auto callee = this->globals->functions.find(name);
+        if (callee == this->globals->functions.end()) {
+            std::printf("ICE: No function with name `%s`\n", name.c_str());
             std::exit(1);
         }
-        return retInsts;
+        return this->builder->createCall(callee->second, args);
     } break;
     case ExpressionNodeType::LtoRValue: {
-        IrInstruction* inst               = new IrInstruction;
-        inst->type                        = IrInstructionType::Load;
-        inst->result                      = newSSAResult();
         LtoRValueCastExpression* LtoRExpr = reinterpret_cast<LtoRValueCastExpression*>(node);
-        inst->operands                    = {this->generateOperand(LtoRExpr->getExpr()),
-                                             createTypeOperand(this->generateType(convertExpressionToType(
-                              this->outModule->objects, this->currentFunc, LtoRExpr->getExpr())))};
-        return {inst};
+        return this->builder->createLoad(
+            this->generateOperand(LtoRExpr->getExpr()),
+            generateType(this->convertExpressionToType(LtoRExpr->getExpr())));
+    } break;
+    case ExpressionNodeType::Assignment: {
+        AssignmentExpressionNode* assignExpr = reinterpret_cast<AssignmentExpressionNode*>(node);
+        IrValue*                  value      = this->generateExpr(assignExpr->getValue());
+        this->builder->createStore(this->generateOperand(assignExpr->getAssignee()), value);
+        return value;
     } break;
     default: {
         std::printf("TODO: Generate expr %llu\n", node->getExprType());
         std::exit(1);
     } break;
     }
-    return {};
 }
-bool isPrimaryExpressionType(ExpressionNodeType type) {
-    if (type == ExpressionNodeType::NumericLiteral) {
-        return true;
+// Slots are kept together at the top of the entry block, in front of the first instruction that is
+// not a `reserve`.
+IrInstruction* IrFunctionGen::generateReserve(IrType type) {
+    IrBlock*       current = this->builder->getInsertBlock();
+    IrInstruction* before  = this->func->getEntryBlock()->insts.front();
+    while (before && before->type == IrInstructionType::Reserve) {
+        before = before->next;
+    }
+    if (before) {
+        this->builder->setInsertPoint(before);
+    } else {
+        this->builder->setInsertPoint(this->func->getEntryBlock());
     }
-    return false;
+    IrInstruction* slot = this->builder->createReserve(type);
+    this->builder->setInsertPoint(current);
+    return slot;
 }
-static bool isTerminatorInst(IrInstructionType type) {
-    return type == IrInstructionType::Return || type == IrInstructionType::Br;
+// Continues emission in `block`, which moves to the end of the function so blocks are laid out in
+// the order they are filled. The current block falls through to it unless it is terminated.
+void IrFunctionGen::emitBlock(IrBlock* block) {
+    if (!this->builder->getInsertBlock()->getTerminator()) {
+        this->builder->createBr(block);
+    }
+    this->func->blocks.remove(block);
+    this->func->blocks.pushBack(block);
+    this->builder->setInsertPoint(block);
 }
-std::vector<IrBlock*> IrGen::generateCompoundBlocks(CompoundStatementNode* node) {
-    std::vector<IrBlock*> blocks;
-    IrBlock*              currentBlock = new IrBlock;
-    currentBlock->name                 = ".BB" + std::to_string(blockNumbers++);
-    auto insertBlock = [&blocks](IrBlock* block, std::optional<std::string> nextName) {
-        if ((block->insts.empty() || !isTerminatorInst(block->insts.back()->type)) &&
-            nextName.has_value()) {
-            IrInstruction* terminatorInst = new IrInstruction;
-            terminatorInst->type          = IrInstructionType::Br;
-            terminatorInst->operands      = {createLabelOperand(nextName.value())};
-            block->insts.push_back(terminatorInst);
-        }
-        if (block->insts.empty() || !isTerminatorInst(block->insts.back()->type)) {
-            std::printf(
-                "ICE: Failed to insert terminator instruction in block `%s` to block `%s`\n",
-                block->name.c_str(),
-                nextName.has_value() ? nextName.value().c_str() : "std::nullopt");
-            std::exit(1);
-        }
-        blocks.push_back(block);
-    };
-    for (StatementNode* stmtNode : node->getNodes()) {
-        if (!currentBlock ||
-            (!currentBlock->insts.empty() && isTerminatorInst(currentBlock->insts.back()->type))) {
-            currentBlock       = new IrBlock;
-            currentBlock->name = ".BB" + std::to_string(blockNumbers++);
+void IrFunctionGen::generateIfStatement(IfStatementNode* node) {
+    IrValue* condition  = this->generateExpr(node->getCondition());
+    IrBlock* thenBlock  = this->builder->createBlock();
+    IrBlock* mergeBlock = this->builder->createBlock();
+    IrBlock* elseBlock  = mergeBlock;
+    if (node->getFalseBody().has_value()) {
+        elseBlock = this->builder->createBlock();
+    }
+    this->builder->createCondBr(condition, thenBlock, elseBlock);
+    this->emitBlock(thenBlock);
+    this->generateStatement(node->getTrueBody());
+    if (node->getFalseBody().has_value()) {
+        if (!this->builder->getInsertBlock()->getTerminator()) {
+            this->builder->createBr(mergeBlock);
         }
-        switch (stmtNode->getStmtType()) {
-        case StatementNodeType::Declaration: {
-            DeclarationNode* declNode =
-                reinterpret_cast<DeclarationStatementNode*>(stmtNode)->getDeclNode();
-            switch (declNode->getDeclType()) {
-            case DeclarationNodeType::Variable: {
-                VariableDeclarationNode* varDecl =
-                    reinterpret_cast<VariableDeclarationNode*>(declNode);
-                this->currentFunc->entryInsts.push_back(new IrInstruction(
-                    newSSAResult(), IrInstructionType::Reserve,
-                    {new IrOperand(IrOperandType::Type, this->generateType(varDecl->getType()))}));
-                this->currentFunc->nameToSSANumber.insert({varDecl->getName(), ssaResults - 1});
-                for (IrInstruction* inst : this->genInstsFromExpr(varDecl->getValue().value())) {
-                    currentBlock->insts.push_back(inst);
-                }
-                if (isPrimaryExpressionType(varDecl->getValue().value()->getExprType())) {
-                    currentBlock->insts.push_back(new IrInstruction(
-                        newSSAResult(), IrInstructionType::Store,
-                        {createSSAOperand(ssaResults - 2, new IrType(IrTypeType::Pointer, "ptr")),
-                         createConstI32Operand(
-                             std::stol(reinterpret_cast<NumericLiteralExpressionNode*>(
-                                           varDecl->getValue().value())
-                                           ->getValue()))}));
-                } else {
-                    currentBlock->insts.push_back(new IrInstruction(
-                        newSSAResult(), IrInstructionType::Store,
-                        {createSSAOperand(this->currentFunc->nameToSSANumber.at(varDecl->getName()),
-                                          new IrType(IrTypeType::Pointer, "ptr")),
-                         createSSAOperand(ssaResults - 2,
-                                          this->generateType(convertExpressionToType(
-                                              this->outModule->objects, this->currentFunc,
-                                              varDecl->getValue().value())))}));
-                }
-            } break;
-            default: {
-                std::printf("TODO: Generate decl %llu\n", declNode->getDeclType());
-                std::exit(1);
-            } break;
-            }
-        } break;
-        case StatementNodeType::Return: {
-            ReturnStatementNode*        retStmt = reinterpret_cast<ReturnStatementNode*>(stmtNode);
-            std::vector<IrInstruction*> insts;
-            if (retStmt->getExpr() == nullptr) {
-                insts.push_back(new IrInstruction(
-                    std::nullopt, IrInstructionType::Return,
-                    {createTypeOperand(this->generateType(new TypeSpec(0, "void")))}));
-            } else {
-                insts = this->genInstsFromExpr(retStmt->getExpr());
-                insts.push_back(new IrInstruction(
-                    std::nullopt, IrInstructionType::Return,
-                    {createSSAOperand(
-                        ssaResults - 1,
-                        this->generateType(convertExpressionToType(
-                            this->outModule->objects, this->currentFunc, retStmt->getExpr())))}));
-            }
-            currentBlock->insts.insert(currentBlock->insts.end(), insts.begin(), insts.end());
-            insertBlock(currentBlock, std::nullopt);
-            currentBlock = nullptr;
-        } break;
-        case StatementNodeType::Compound: {
-            std::string nextName = ".BB" + std::to_string(blockNumbers);
-            insertBlock(currentBlock, nextName);
-
-            auto compoundBlocks =
-                generateCompoundBlocks(reinterpret_cast<CompoundStatementNode*>(stmtNode));
-
-            blocks.insert(blocks.end(), compoundBlocks.begin(), compoundBlocks.end());
-            IrBlock* last = compoundBlocks.back();
-            if (!last->insts.empty() && isTerminatorInst(last->insts.back()->type)) {
-                currentBlock = nullptr;
-            } else {
-                currentBlock       = new IrBlock;
-                currentBlock->name = ".BB" + std::to_string(blockNumbers++);
-            }
+        this->emitBlock(elseBlock);
+        this->generateStatement(node->getFalseBody().value());
+    }
+    this->emitBlock(mergeBlock);
+}
+// The condition is tested in a header block that the body jumps back to.
+void IrFunctionGen::generateWhileStatement(WhileStatementNode* node) {
+    IrBlock* header = this->builder->createBlock();
+    IrBlock* body   = this->builder->createBlock();
+    IrBlock* exit   = this->builder->createBlock();
+    this->emitBlock(header);
+    this->builder->createCondBr(this->generateExpr(node->getCondition()), body, exit);
+    this->emitBlock(body);
+    this->generateStatement(node->getBody());
+    if (!this->builder->getInsertBlock()->getTerminator()) {
+        this->builder->createBr(header);
+    }
+    this->emitBlock(exit);
+}
+// Like `while`, with the step in a latch block of its own between the body and the header.
+void IrFunctionGen::generateForStatement(ForStatementNode* node) {
+    if (node->getInit().has_value()) {
+        this->generateStatement(node->getInit().value());
+    }
+    IrBlock* header = this->builder->createBlock();
+    IrBlock* body   = this->builder->createBlock();
+    IrBlock* latch  = this->builder->createBlock();
+    IrBlock* exit   = this->builder->createBlock();
+    this->emitBlock(header);
+    if (node->getCondition().has_value()) {
+        IrValue* condition = this->generateExpr(node->getCondition().value());
+        this->builder->createCondBr(condition, body, exit);
+    }
+    this->emitBlock(body);
+    this->generateStatement(node->getBody());
+    this->emitBlock(latch);
+    if (node->getStep().has_value()) {
+        (void)this->generateExpr(node->getStep().value());
+    }
+    this->builder->createBr(header);
+    this->emitBlock(exit);
+}
+void IrFunctionGen::generateStatement(StatementNode* node) {
+    switch (node->getStmtType()) {
+    case StatementNodeType::Declaration: {
+        DeclarationNode* declNode =
+            reinterpret_cast<DeclarationStatementNode*>(node)->getDeclNode();
+        switch (declNode->getDeclType()) {
+        case DeclarationNodeType::Variable: {
+            VariableDeclarationNode* varDecl = reinterpret_cast<VariableDeclarationNode*>(declNode);
+            IrInstruction* slot = this->generateReserve(generateType(varDecl->getType()));
+            // Sibling scopes may declare the same name, each declaration gets a fresh slot.
+            this->func->nameToValue[varDecl->getName()] = slot;
+            this->nameToType[varDecl->getName()]        = varDecl->getType();
+            IrValue* value = this->generateExpr(varDecl->getValue().value());
+            this->builder->createStore(createSSAOperand(slot), value);
         } break;
         default: {
-            std::printf("TODO: Generate stmt %llu\n", stmtNode->getStmtType());
+            std::printf("TODO: Generate decl %llu\n", declNode->getDeclType());
             std::exit(1);
         } break;
         }
+    } break;
+    case StatementNodeType::Return: {
+        ReturnStatementNode* retStmt = reinterpret_cast<ReturnStatementNode*>(node);
+        if (retStmt->getExpr() == nullptr) {
+            this->builder->createReturn(nullptr);
+        } else {
+            this->builder->createReturn(this->generateExpr(retStmt->getExpr()));
+        }
+    } break;
+    case StatementNodeType::Compound: {
+        this->generateCompoundBlocks(reinterpret_cast<CompoundStatementNode*>(node));
+    } break;
+    case StatementNodeType::Expression: {
+        ExpressionStatementNode* exprStmt = reinterpret_cast<ExpressionStatementNode*>(node);
+        (void)this->generateExpr(exprStmt->getExpr());
+    } break;
+    case StatementNodeType::If: {
+        this->generateIfStatement(reinterpret_cast<IfStatementNode*>(node));
+    } break;
+    case StatementNodeType::While: {
+        this->generateWhileStatement(reinterpret_cast<WhileStatementNode*>(node));
+    } break;
+    case StatementNodeType::For: {
+        this->generateForStatement(reinterpret_cast<ForStatementNode*>(node));
+    } break;
+    default: {
+        std::printf("TODO: Generate stmt %llu\n", node->getStmtType());
+        std::exit(1);
+    } break;
     }
-    if (currentBlock && !currentBlock->insts.empty() && blocks.empty()) {
-        insertBlock(currentBlock, ".BB" + std::to_string(blockNumbers));
+}
+// A compound statement only opens a scope, its statements continue in the current block. Code
+// following a terminator starts a fresh block that has no predecessors.
+void IrFunctionGen::generateCompoundBlocks(CompoundStatementNode* node) {
+    for (StatementNode* stmtNode : node->getNodes()) {
+        if (this->builder->getInsertBlock()->getTerminator()) {
+            this->builder->setInsertPoint(this->builder->createBlock());
+        }
+        this->generateStatement(stmtNode);
     }
-    return blocks;
 }
-std::vector<IrBlock*> IrGen::generateBlocks(StatementNode* node) {
+void IrFunctionGen::generateBlocks(StatementNode* node) {
     switch (node->getStmtType()) {
     case StatementNodeType::Compound: {
-        return this->generateCompoundBlocks(reinterpret_cast<CompoundStatementNode*>(node));
+        this->generateCompoundBlocks(reinterpret_cast<CompoundStatementNode*>(node));
     } break;
     default: {
         std::printf("TODO: generateBlocks %llu\n", node->getStmtType());
@@ -501,8 +573,4 @@ std::vector<IrBlock*> IrGen::generateBlocks(StatementNode* node) {
     } break;
     }
 }
-IrModule* IrGen::getModule() {
-    this->generate();
-    return this->outModule;
-}
-}; // namespace language
\ No newline at end of file
+}; // namespace language
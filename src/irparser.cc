@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <irparser.h>
+#include <irverifier.h>
+
+namespace language {
+static std::vector<std::pair<IrTypeType, std::string>> typeNames = {
+    {IrTypeType::I32, "i32"},           {IrTypeType::I64, "i64"},
+    {IrTypeType::Void, "void"},         {IrTypeType::String, "string"},
+    {IrTypeType::Variable, "variable"}, {IrTypeType::Variadic, "variadic"},
+    {IrTypeType::Pointer, "pointer"},   {IrTypeType::Label, "label"},
+    {IrTypeType::Custom, "custom"},
+};
+static std::vector<std::pair<IrInstructionType, std::string>> instructionNames = {
+    {IrInstructionType::Reserve, "reserve"}, {IrInstructionType::Store, "store"},
+    {IrInstructionType::Load, "load"},       {IrInstructionType::Trunc, "trunc"},
+    {IrInstructionType::Sext, "sext"},       {IrInstructionType::Zext, "zext"},
+    {IrInstructionType::Const, "const"},     {IrInstructionType::Add, "add"},
+    {IrInstructionType::Sub, "sub"},         {IrInstructionType::Mul, "mul"},
+    {IrInstructionType::Sdiv, "sdiv"},       {IrInstructionType::Udiv, "udiv"},
+    {IrInstructionType::Srem, "srem"},       {IrInstructionType::Urem, "urem"},
+    {IrInstructionType::Smulh, "smulh"},     {IrInstructionType::Umulh, "umulh"},
+    {IrInstructionType::And, "and"},         {IrInstructionType::Shl, "shl"},
+    {IrInstructionType::Lshr, "lshr"},       {IrInstructionType::Ashr, "ashr"},
+    {IrInstructionType::Eq, "eq"},           {IrInstructionType::Ne, "ne"},
+    {IrInstructionType::Slt, "slt"},         {IrInstructionType::Sle, "sle"},
+    {IrInstructionType::Sgt, "sgt"},         {IrInstructionType::Sge, "sge"},
+    {IrInstructionType::Ult, "ult"},         {IrInstructionType::Ule, "ule"},
+    {IrInstructionType::Ugt, "ugt"},         {IrInstructionType::Uge, "uge"},
+    {IrInstructionType::Phi, "phi"},         {IrInstructionType::Call, "call"},
+    {IrInstructionType::Return, "return"},   {IrInstructionType::Br, "br"},
+    {IrInstructionType::CondBr, "condbr"},
+};
+
+IrParser::IrParser(std::string source) {
+    this->tokenIndex = 0;
+    this->lineIndex  = 0;
+    this->module     = nullptr;
+    this->func       = nullptr;
+    size_t start     = 0;
+    while (start <= source.size()) {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos) {
+            end = source.size();
+        }
+        this->lines.push_back(source.substr(start, end - start));
+        start = end + 1;
+    }
+}
+IrModule* IrParser::getModule() {
+    if (this->module) {
+        return this->module;
+    }
+    this->module = new IrModule;
+    std::vector<std::pair<IrObject*, size_t>>   objectLines;
+    std::vector<std::pair<IrFunction*, size_t>> functionLines;
+    for (size_t line = 0; line < this->lines.size(); ++line) {
+        this->tokenize(line);
+        if (this->tokens.empty() || this->peek() == "Module") {
+            continue;
+        }
+        if (this->peek() == "object") {
+            this->declareObject(line);
+            objectLines.push_back({this->module->objects.back(), line});
+        } else if (this->peek() == "function") {
+            size_t header = line;
+            line          = this->declareFunction(line);
+            functionLines.push_back({this->module->functions.back(), header});
+        } else {
+            this->fail("Expected `object` or `function`");
+        }
+    }
+    for (auto& [obj, line] : objectLines) {
+        this->parseObject(obj, line);
+    }
+    for (auto& [function, line] : functionLines) {
+        this->parseFunction(function, line);
+    }
+    return this->module;
+}
+void IrParser::declareObject(size_t line) {
+    this->tokenize(line);
+    this->expect("object");
+    std::string name = this->next();
+    if (name.size() < 2 || name.front() != '$') {
+        this->fail("Expected the name of an object");
+    }
+    IrObject* obj = new IrObject;
+    obj->name     = name.substr(1);
+    obj->noMangle = this->accept("no_mangle");
+    this->expect(",");
+    obj->type = this->parseType();
+    if (this->objects.contains(obj->name)) {
+        this->fail("Redefinition of `" + obj->name + "`");
+    }
+    this->objects[obj->name] = obj;
+    this->module->objects.push_back(obj);
+}
+// Reads the signature and returns the line of the closing brace.
+size_t IrParser::declareFunction(size_t line) {
+    this->tokenize(line);
+    this->expect("function");
+    IrFunction* function = new IrFunction;
+    function->returnType = this->parseType();
+    std::string name     = this->next();
+    if (name.size() < 2 || name.front() != '$') {
+        this->fail("Expected the name of a function");
+    }
+    function->name = name.substr(1);
+    this->expect("(");
+    while (!this->accept(")")) {
+        if (!function->arguments.empty()) {
+            this->expect(",");
+        }
+        uint32_t    number = this->parseNumber(this->next(), 1);
+        IrArgument* arg    = function->createArgument(this->parseType());
+        arg->number        = number;
+    }
+    while (!this->accept("{")) {
+        std::string attribute = this->next();
+        if (attribute == "inline") {
+            function->alwaysInline = true;
+        } else if (attribute == "noinline") {
+            function->noInline = true;
+        } else if (attribute == "no_mangle") {
+            function->noMangle = true;
+        } else {
+            this->fail("Invalid function attribute `" + attribute + "`");
+        }
+    }
+    if (this->functions.contains(function->name)) {
+        this->fail("Redefinition of `" + function->name + "`");
+    }
+    this->functions[function->name] = function;
+    this->module->functions.push_back(function);
+    for (++line; line < this->lines.size(); ++line) {
+        this->tokenize(line);
+        if (this->accept("}")) {
+            return line;
+        }
+    }
+    this->lineIndex = this->lines.size() - 1;
+    this->fail("Expected `}` at the end of `" + function->name + "`");
+    return line;
+}
+void IrParser::parseObject(IrObject* obj, size_t line) {
+    this->tokenize(line);
+    while (!this->accept("=")) {
+        this->next();
+    }
+    bool     isPending = false;
+    uint32_t number    = 0;
+    obj->value         = this->parseOperand(false, isPending, number);
+    if (isPending || obj->value.type == IrOperandType::Label) {
+        this->fail("An object cannot be initialized with a local value");
+    }
+}
+void IrParser::parseFunction(IrFunction* function, size_t line) {
+    this->func = function;
+    this->values.clear();
+    this->blocks.clear();
+    this->defined.clear();
+    this->pending.clear();
+    this->blockLines.clear();
+    this->instructionLines.clear();
+    uint32_t nextValue = 0;
+    for (IrArgument* arg : function->arguments) {
+        if (this->values.contains(arg->number)) {
+            this->fail("Redefinition of #" + std::to_string(arg->number));
+        }
+        this->values[arg->number] = arg;
+        nextValue                 = std::max(nextValue, arg->number + 1);
+    }
+    IrBlock* block = nullptr;
+    for (++line;; ++line) {
+        this->tokenize(line);
+        if (this->tokens.empty()) {
+            continue;
+        }
+        if (this->accept("}")) {
+            break;
+        }
+        std::string token = this->peek();
+        if (token.starts_with(".BB")) {
+            this->next();
+            this->expect(":");
+            block = this->getBlock(token);
+            if (this->defined[block]) {
+                this->fail("Redefinition of block " + token);
+            }
+            this->defined[block]    = true;
+            this->blockLines[block] = line;
+            // Blocks named by a branch before their definition are moved to where they are defined.
+            function->blocks.remove(block);
+            function->blocks.pushBack(block);
+            continue;
+        }
+        if (!block) {
+            this->fail("Expected a block label");
+        }
+        this->parseInstruction(block);
+        IrInstruction* inst = block->insts.back();
+        if (inst->hasResult) {
+            nextValue = std::max(nextValue, inst->number + 1);
+        }
+    }
+    for (auto& [number, target] : this->blocks) {
+        if (!this->defined[target]) {
+            this->fail("Undefined block .BB" + std::to_string(number));
+        }
+        function->nextBlockNumber = std::max(function->nextBlockNumber, number + 1);
+    }
+    for (IrPendingOperand& operand : this->pending) {
+        auto it = this->values.find(operand.number);
+        if (it == this->values.end()) {
+            this->lineIndex = operand.line;
+            this->fail("Undefined value #" + std::to_string(operand.number));
+        }
+        operand.inst->setOperandValue(operand.index, it->second);
+    }
+    function->nextValueNumber = nextValue;
+    IrVerifier verifier(function);
+    if (!verifier.verify()) {
+        IrInstruction* inst = verifier.getInstruction();
+        this->lineIndex =
+            inst ? this->instructionLines.at(inst) : this->blockLines.at(verifier.getBlock());
+        this->fail(verifier.getMessage());
+    }
+}
+void IrParser::parseInstruction(IrBlock* block) {
+    uint32_t number    = 0;
+    bool     hasResult = false;
+    if (this->peek().starts_with("#")) {
+        number    = this->parseNumber(this->next(), 1);
+        hasResult = true;
+        this->expect("=");
+        if (this->values.contains(number)) {
+            this->fail("Redefinition of #" + std::to_string(number));
+        }
+    }
+    std::string       name  = this->next();
+    IrInstructionType type  = IrInstructionType::Reserve;
+    bool              found = false;
+    for (auto& [instructionType, instructionName] : instructionNames) {
+        if (instructionName == name) {
+            type  = instructionType;
+            found = true;
+        }
+    }
+    if (!found) {
+        this->fail("Invalid instruction `" + name + "`");
+    }
+    std::vector<IrOperand> operands;
+    std::vector<size_t>    pendingIndices;
+    std::vector<uint32_t>  pendingNumbers;
+    while (this->tokenIndex < this->tokens.size()) {
+        if (!operands.empty()) {
+            this->expect(",");
+        }
+        bool     isPending     = false;
+        uint32_t pendingNumber = 0;
+        bool     callee        = type == IrInstructionType::Call && operands.empty();
+        operands.push_back(this->parseOperand(callee, isPending, pendingNumber));
+        if (isPending) {
+            pendingIndices.push_back(operands.size() - 1);
+            pendingNumbers.push_back(pendingNumber);
+        }
+    }
+    IrInstruction* inst = this->func->createInstruction(type, hasResult, operands.size());
+    for (size_t i = 0; i < operands.size(); ++i) {
+        inst->setOperand(i, operands.at(i));
+    }
+    block->append(inst);
+    this->instructionLines[inst] = this->lineIndex;
+    // The result type is computed from the operands, their shape has to be right before.
+    IrVerifier verifier(this->func);
+    if (!verifier.verifyInstruction(inst)) {
+        this->fail(verifier.getMessage());
+    }
+    if (hasResult) {
+        inst->number               = number;
+        inst->valueType            = getResultType(inst);
+        this->values[inst->number] = inst;
+    }
+    for (size_t i = 0; i < pendingIndices.size(); ++i) {
+        this->pending.push_back(
+            {inst, pendingIndices.at(i), pendingNumbers.at(i), this->lineIndex});
+    }
+}
+// SSA operands come back as a constant of the right type and set `pending`, they are filled in once
+// the whole function is read.
+IrOperand IrParser::parseOperand(bool callee, bool& isPending, uint32_t& number) {
+    IrType      type  = this->parseType();
+    std::string token = this->tokenIndex < this->tokens.size() ? this->peek() : ",";
+    if (token == ",") {
+        return createTypeOperand(type);
+    }
+    this->next();
+    if (token.starts_with("#.BB")) {
+        return createLabelOperand(this->getBlock(token.substr(1)));
+    }
+    if (token.starts_with("#")) {
+        isPending = true;
+        number    = this->parseNumber(token, 1);
+        return createConstOperand(type, 0);
+    }
+    if (token.starts_with("$")) {
+        std::string name = token.substr(1);
+        if (!callee && this->objects.contains(name)) {
+            return createGlobalOperand(this->objects.at(name), type);
+        }
+        if (this->functions.contains(name)) {
+            return createFunctionOperand(this->functions.at(name));
+        }
+        this->fail("Undefined symbol `" + name + "`");
+    }
+    size_t digits = token.front() == '-' ? 1 : 0;
+    if (digits == token.size() ||
+        token.find_first_not_of("0123456789", digits) != std::string::npos) {
+        this->fail("Invalid operand `" + token + "`");
+    }
+    // An i32 is written either sign or zero extended, everything else as a signed 64 bit value.
+    int64_t value  = 0;
+    auto    result = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (result.ec != std::errc() ||
+        (type.type == IrTypeType::I32 && (value < INT32_MIN || value > UINT32_MAX))) {
+        this->fail("Constant `" + token + "` out of range for `" + type.getName() + "`");
+    }
+    return createConstOperand(type, value);
+}
+IrType IrParser::parseType() {
+    this->expect("type");
+    std::string name = this->next();
+    for (auto& [type, typeName] : typeNames) {
+        if (typeName == name) {
+            return IrType(type);
+        }
+    }
+    this->fail("Invalid type `" + name + "`");
+    return IrType(IrTypeType::Void);
+}
+// `token` is a label without the leading `#`, blocks are created the first time they are named.
+IrBlock* IrParser::getBlock(std::string token) {
+    uint32_t number = this->parseNumber(token, 3);
+    auto     it     = this->blocks.find(number);
+    if (it != this->blocks.end()) {
+        return it->second;
+    }
+    IrBlock* block       = this->func->createBlock();
+    block->number        = number;
+    this->blocks[number] = block;
+    this->defined[block] = false;
+    return block;
+}
+uint32_t IrParser::parseNumber(std::string token, size_t prefix) {
+    if (token.size() <= prefix || token.size() > prefix + 9 ||
+        token.find_first_not_of("0123456789", prefix) != std::string::npos) {
+        this->fail("Invalid number `" + token + "`");
+    }
+    return std::stoul(token.substr(prefix));
+}
+// Punctuation is a token of its own, everything else is split at whitespace.
+void IrParser::tokenize(size_t line) {
+    std::string& text = this->lines.at(line);
+    this->lineIndex   = line;
+    this->tokenIndex  = 0;
+    this->tokens.clear();
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text.at(i);
+        if (std::isspace(c)) {
+            ++i;
+        } else if (c == ',' || c == '(' || c == ')' || c == '{' || c == '}' || c == '=' ||
+                   c == ':') {
+            this->tokens.push_back(std::string(1, c));
+            ++i;
+        } else {
+            size_t start = i;
+            while (i < text.size() && !std::isspace(text.at(i)) &&
+                   std::string(",(){}=:").find(text.at(i)) == std::string::npos) {
+                ++i;
+            }
+            this->tokens.push_back(text.substr(start, i - start));
+        }
+    }
+}
+std::string IrParser::peek() {
+    if (this->tokenIndex >= this->tokens.size()) {
+        this->fail("Unexpected end of line");
+    }
+    return this->tokens.at(this->tokenIndex);
+}
+std::string IrParser::next() {
+    std::string token = this->peek();
+    ++this->tokenIndex;
+    return token;
+}
+bool IrParser::accept(std::string token) {
+    if (this->tokenIndex < this->tokens.size() && this->tokens.at(this->tokenIndex) == token) {
+        ++this->tokenIndex;
+        return true;
+    }
+    return false;
+}
+void IrParser::expect(std::string token) {
+    if (!this->accept(token)) {
+        this->fail("Expected `" + token + "`");
+    }
+}
+void IrParser::fail(std::string message) {
+    std::fprintf(stderr, "IR:%zu: %s\n", this->lineIndex + 1, message.c_str());
+    std::exit(1);
+}
+}; // namespace language
@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <irverifier.h>
+
+namespace language {
+static bool isValue(IrOperand& operand) {
+    return operand.type == IrOperandType::Const || operand.type == IrOperandType::SSA ||
+           operand.type == IrOperandType::Global;
+}
+static std::string getBlockName(IrBlock* block) {
+    return ".BB" + std::to_string(block->number);
+}
+static std::string getTypeName(IrType type) {
+    return std::string("`") + type.getName() + "`";
+}
+// Type of the values stored in and loaded from `address`, or Void when it is not known.
+static IrType getSlotType(IrOperand& address) {
+    if (address.type == IrOperandType::Global) {
+        return address.object->type;
+    }
+    if (address.type == IrOperandType::SSA && address.value->kind == IrValueKind::Instruction &&
+        static_cast<IrInstruction*>(address.value)->type == IrInstructionType::Reserve) {
+        return static_cast<IrInstruction*>(address.value)->getOperand(0).irType;
+    }
+    return IrType(IrTypeType::Void);
+}
+
+IrVerifier::IrVerifier(IrFunction* _func) {
+    this->func       = _func;
+    this->errorBlock = nullptr;
+    this->errorInst  = nullptr;
+}
+bool IrVerifier::verify() {
+    if (this->func->blocks.empty()) {
+        return true;
+    }
+    for (IrBlock* block : this->func->blocks) {
+        if (!this->verifyBlock(block)) {
+            return false;
+        }
+    }
+    for (IrBlock* block : this->func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (!this->verifyTypes(inst)) {
+                return false;
+            }
+        }
+    }
+    IrCFG           cfg(this->func);
+    IrDominatorTree domTree(&cfg, false);
+    for (IrBlock* block : this->func->blocks) {
+        if (!cfg.isReachable(block)) {
+            continue;
+        }
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Phi && !this->verifyPhi(inst, &cfg)) {
+                return false;
+            }
+            if (!this->verifyUses(inst, &domTree)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+bool IrVerifier::verifyInstruction(IrInstruction* inst) {
+    IrBlock*    block    = inst->parent;
+    std::string name     = "`" + irInstructionTypeToString(inst->type) + "`";
+    size_t      count    = inst->numOperands;
+    bool        valid    = false;
+    bool        produces = true;
+    std::string expected;
+    switch (inst->type) {
+    case IrInstructionType::Reserve: {
+        valid    = count == 1 && inst->getOperand(0).type == IrOperandType::Type;
+        expected = "a type";
+    } break;
+    case IrInstructionType::Store: {
+        valid    = count == 2 && isValue(inst->getOperand(0)) && isValue(inst->getOperand(1));
+        expected = "an address and a value";
+        produces = false;
+    } break;
+    case IrInstructionType::Load: {
+        valid = count == 2 && isValue(inst->getOperand(0)) &&
+                inst->getOperand(1).type == IrOperandType::Type;
+        expected = "an address and a type";
+    } break;
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        valid = count == 2 && isValue(inst->getOperand(0)) &&
+                inst->getOperand(1).type == IrOperandType::Type;
+        expected = "a value and a type";
+    } break;
+    case IrInstructionType::Const: {
+        valid    = count == 1 && inst->getOperand(0).type == IrOperandType::Const;
+        expected = "a constant";
+    } break;
+    case IrInstructionType::Phi: {
+        valid = count >= 2 && count % 2 == 0;
+        for (size_t i = 0; valid && i < count; i += 2) {
+            valid = isValue(inst->getOperand(i)) &&
+                    inst->getOperand(i + 1).type == IrOperandType::Label;
+        }
+        expected = "pairs of a value and a label";
+    } break;
+    case IrInstructionType::Call: {
+        valid = count >= 1 && inst->getOperand(0).type == IrOperandType::Function;
+        for (size_t i = 1; valid && i < count; ++i) {
+            valid = isValue(inst->getOperand(i));
+        }
+        expected = "a function and values";
+        produces = valid && inst->getOperand(0).function->returnType.type != IrTypeType::Void;
+    } break;
+    case IrInstructionType::Return: {
+        valid = count == 1 && (isValue(inst->getOperand(0)) ||
+                               (inst->getOperand(0).type == IrOperandType::Type &&
+                                inst->getOperand(0).irType.type == IrTypeType::Void));
+        expected = "a value or `type void`";
+        produces = false;
+    } break;
+    case IrInstructionType::Br: {
+        valid    = count == 1 && inst->getOperand(0).type == IrOperandType::Label;
+        expected = "a label";
+        produces = false;
+    } break;
+    case IrInstructionType::CondBr: {
+        valid = count == 3 && isValue(inst->getOperand(0)) &&
+                inst->getOperand(1).type == IrOperandType::Label &&
+                inst->getOperand(2).type == IrOperandType::Label;
+        expected = "a value and two labels";
+        produces = false;
+    } break;
+    default: {
+        valid    = count == 2 && isValue(inst->getOperand(0)) && isValue(inst->getOperand(1));
+        expected = "two values";
+    } break;
+    }
+    if (!valid) {
+        return this->fail(block, inst, name + " takes " + expected);
+    }
+    if (inst->type == IrInstructionType::Call) {
+        IrFunction*               callee    = inst->getOperand(0).function;
+        std::vector<IrArgument*>& arguments = callee->arguments;
+        bool variadic =
+            !arguments.empty() && arguments.back()->valueType.type == IrTypeType::Variadic;
+        size_t needed = variadic ? arguments.size() - 1 : arguments.size();
+        if (count - 1 < needed || (!variadic && count - 1 > needed)) {
+            return this->fail(block, inst,
+                              "`" + callee->name + "` takes " + std::to_string(needed) +
+                                  " arguments, the call passes " + std::to_string(count - 1));
+        }
+    }
+    if (inst->hasResult != produces) {
+        return this->fail(block, inst, name + (produces ? " needs a result" : " has no result"));
+    }
+    return true;
+}
+IrBlock* IrVerifier::getBlock() {
+    return this->errorBlock;
+}
+IrInstruction* IrVerifier::getInstruction() {
+    return this->errorInst;
+}
+std::string IrVerifier::getMessage() {
+    return this->message;
+}
+// SSA operands have the type of their value, the operands of arithmetic, comparisons and phis agree
+// with each other, stores and loads with their slot, and calls and returns with the signature.
+bool IrVerifier::verifyTypes(IrInstruction* inst) {
+    IrBlock*    block = inst->parent;
+    std::string name  = "`" + irInstructionTypeToString(inst->type) + "`";
+    for (size_t i = 0; i < inst->numOperands; ++i) {
+        IrOperand& operand = inst->getOperand(i);
+        if (operand.type == IrOperandType::SSA && !(operand.irType == operand.value->valueType)) {
+            return this->fail(block, inst,
+                              "#" + std::to_string(operand.value->number) + " is used as " +
+                                  getTypeName(operand.irType) + " but is " +
+                                  getTypeName(operand.value->valueType));
+        }
+    }
+    switch (inst->type) {
+    case IrInstructionType::Store:
+    case IrInstructionType::Load: {
+        IrType slot  = getSlotType(inst->getOperand(0));
+        IrType value = inst->getOperand(1).irType;
+        if (slot.type != IrTypeType::Void && !(slot == value)) {
+            return this->fail(block, inst,
+                              name + " of " + getTypeName(value) + " with a slot of " +
+                                  getTypeName(slot));
+        }
+    } break;
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        IrTypeType from   = inst->getOperand(0).irType.type;
+        IrTypeType to     = inst->getOperand(1).irType.type;
+        IrTypeType narrow = inst->type == IrInstructionType::Trunc ? to : from;
+        IrTypeType wide   = inst->type == IrInstructionType::Trunc ? from : to;
+        if (narrow != IrTypeType::I32 || wide != IrTypeType::I64) {
+            return this->fail(block, inst,
+                              name + " from " + getTypeName(inst->getOperand(0).irType) + " to " +
+                                  getTypeName(inst->getOperand(1).irType));
+        }
+    } break;
+    case IrInstructionType::Phi: {
+        for (size_t i = 2; i < inst->numOperands; i += 2) {
+            if (!(inst->getOperand(i).irType == inst->getOperand(0).irType)) {
+                return this->fail(block, inst, name + " of values with different types");
+            }
+        }
+    } break;
+    case IrInstructionType::Call: {
+        std::vector<IrArgument*>& arguments = inst->getOperand(0).function->arguments;
+        for (size_t i = 1; i < inst->numOperands && i <= arguments.size(); ++i) {
+            IrType type = arguments.at(i - 1)->valueType;
+            if (type.type != IrTypeType::Variadic && !(inst->getOperand(i).irType == type)) {
+                return this->fail(block, inst,
+                                  "Argument " + std::to_string(i - 1) + " is " +
+                                      getTypeName(inst->getOperand(i).irType) + " instead of " +
+                                      getTypeName(type));
+            }
+        }
+    } break;
+    case IrInstructionType::Return: {
+        if (!(inst->getOperand(0).irType == this->func->returnType)) {
+            return this->fail(block, inst,
+                              name + " of " + getTypeName(inst->getOperand(0).irType) +
+                                  " from a function returning " +
+                                  getTypeName(this->func->returnType));
+        }
+    } break;
+    case IrInstructionType::Reserve:
+    case IrInstructionType::Const:
+    case IrInstructionType::Br:
+    case IrInstructionType::CondBr: {
+    } break;
+    default: {
+        if (!(inst->getOperand(0).irType == inst->getOperand(1).irType)) {
+            return this->fail(block, inst,
+                              name + " of " + getTypeName(inst->getOperand(0).irType) + " and " +
+                                  getTypeName(inst->getOperand(1).irType));
+        }
+    } break;
+    }
+    return true;
+}
+// Phis have to come before everything else and the terminator after it.
+bool IrVerifier::verifyBlock(IrBlock* block) {
+    if (block->insts.empty()) {
+        return this->fail(block, nullptr, "Block " + getBlockName(block) + " is empty");
+    }
+    bool seenOther = false;
+    for (IrInstruction* inst : block->insts) {
+        if (!this->verifyInstruction(inst)) {
+            return false;
+        }
+        if (inst->type == IrInstructionType::Phi && seenOther) {
+            return this->fail(block, inst, "`phi` after other instructions");
+        }
+        seenOther = inst->type != IrInstructionType::Phi;
+        if (inst->isTerminator() && inst != block->insts.back()) {
+            return this->fail(block, inst, "Terminator before the end of " + getBlockName(block));
+        }
+    }
+    if (!block->insts.back()->isTerminator()) {
+        return this->fail(block, nullptr,
+                          "Block " + getBlockName(block) + " does not end in a terminator");
+    }
+    return true;
+}
+bool IrVerifier::verifyPhi(IrInstruction* phi, IrCFG* cfg) {
+    std::vector<IrBlock*>& preds = cfg->getPredecessors(phi->parent);
+    std::vector<IrBlock*>  incoming;
+    for (size_t i = 1; i < phi->numOperands; i += 2) {
+        IrBlock* block = phi->getOperand(i).block;
+        if (std::find(preds.begin(), preds.end(), block) == preds.end()) {
+            return this->fail(phi->parent, phi,
+                              getBlockName(block) + " is not a predecessor of " +
+                                  getBlockName(phi->parent));
+        }
+        if (std::find(incoming.begin(), incoming.end(), block) != incoming.end()) {
+            return this->fail(phi->parent, phi, "Two values for " + getBlockName(block));
+        }
+        incoming.push_back(block);
+    }
+    for (IrBlock* pred : preds) {
+        if (std::find(incoming.begin(), incoming.end(), pred) == incoming.end()) {
+            return this->fail(phi->parent, phi, "No value for " + getBlockName(pred));
+        }
+    }
+    return true;
+}
+// A phi uses its values at the end of the incoming block, everything else where it stands.
+bool IrVerifier::verifyUses(IrInstruction* inst, IrDominatorTree* domTree) {
+    for (size_t i = 0; i < inst->numOperands; ++i) {
+        IrOperand& operand = inst->getOperand(i);
+        if (operand.type != IrOperandType::SSA) {
+            continue;
+        }
+        std::string value = "#" + std::to_string(operand.value->number);
+        if (operand.value->kind == IrValueKind::Argument) {
+            IrArgument* arg = static_cast<IrArgument*>(operand.value);
+            if (arg->index >= this->func->arguments.size() ||
+                this->func->arguments.at(arg->index) != arg) {
+                return this->fail(inst->parent, inst,
+                                  value + " is an argument of another function");
+            }
+            continue;
+        }
+        IrInstruction* def = static_cast<IrInstruction*>(operand.value);
+        if (!def->parent || def->parent->parent != this->func) {
+            return this->fail(inst->parent, inst, value + " is not defined in this function");
+        }
+        bool dominates;
+        if (inst->type == IrInstructionType::Phi) {
+            dominates = domTree->dominates(def->parent, inst->getOperand(i + 1).block);
+        } else {
+            dominates = def != inst && domTree->dominates(def, inst);
+        }
+        if (!dominates) {
+            return this->fail(inst->parent, inst, value + " does not dominate this use");
+        }
+    }
+    return true;
+}
+bool IrVerifier::fail(IrBlock* block, IrInstruction* inst, std::string reason) {
+    this->errorBlock = block;
+    this->errorInst  = inst;
+    this->message    = reason;
+    return false;
+}
+}; // namespace language
@@ -0,0 +1,159 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <jit.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <x86gen.h>
+
+namespace language {
+// `jmp QWORD PTR [rip]` followed by the absolute target.
+static const uint8_t    stubCode[] = {0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+static constexpr size_t STUB_SIZE  = sizeof(stubCode) + 8;
+
+static uint64_t alignTo(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+Jit::Jit(PassManager* _passManager) {
+    this->passManager = _passManager;
+    this->module      = _passManager->getModule();
+    this->memory      = nullptr;
+    this->memorySize  = 0;
+}
+Jit::~Jit() {
+    if (this->memory) {
+        munmap(this->memory, this->memorySize);
+    }
+}
+void Jit::compile() {
+    X86Gen x86gen(this->passManager);
+    x86gen.generate();
+    X86Assembler assembler(x86gen.getAssembly());
+    assembler.assemble();
+    std::vector<X86Section>& sections = assembler.getSections();
+    uint64_t                 pageSize = sysconf(_SC_PAGESIZE);
+
+    std::vector<uint64_t> offsets(sections.size());
+    uint64_t              size = 0;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        if (sections.at(i).executable) {
+            size          = alignTo(size, sections.at(i).alignment);
+            offsets.at(i) = size;
+            size += sections.at(i).bytes.size();
+        }
+    }
+    std::vector<std::string> externals;
+    for (X86Relocation& relocation : assembler.getRelocations()) {
+        X86Symbol* symbol = assembler.findSymbol(relocation.symbol);
+        if (symbol->section < 0 && relocation.kind == X86RelocationKind::Branch &&
+            !this->addresses.contains(symbol->name)) {
+            this->addresses[symbol->name] = nullptr;
+            externals.push_back(symbol->name);
+        }
+    }
+    size                = alignTo(size, 8);
+    uint64_t stubOffset = size;
+    uint64_t codeSize   = alignTo(size + STUB_SIZE * externals.size(), pageSize);
+    size                = codeSize;
+    for (size_t i = 0; i < sections.size(); ++i) {
+        if (!sections.at(i).executable && !sections.at(i).bytes.empty()) {
+            size          = alignTo(size, sections.at(i).alignment);
+            offsets.at(i) = size;
+            size += sections.at(i).bytes.size();
+        }
+    }
+    this->memorySize = alignTo(std::max<uint64_t>(size, 1), pageSize);
+    void* mapping    = mmap(nullptr, this->memorySize, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "Could not map JIT memory: %s\n", std::strerror(errno));
+        std::exit(1);
+    }
+    this->memory = (uint8_t*)mapping;
+
+    for (size_t i = 0; i < sections.size(); ++i) {
+        std::memcpy(this->memory + offsets.at(i), sections.at(i).bytes.data(),
+                    sections.at(i).bytes.size());
+    }
+    for (X86Symbol& symbol : assembler.getSymbols()) {
+        if (symbol.section >= 0) {
+            this->addresses[symbol.name] =
+                this->memory + offsets.at(symbol.section) + symbol.offset;
+        }
+    }
+    for (size_t i = 0; i < externals.size(); ++i) {
+        void* target = dlsym(RTLD_DEFAULT, externals.at(i).c_str());
+        if (!target) {
+            std::fprintf(stderr, "Undefined symbol `%s`\n", externals.at(i).c_str());
+            std::exit(1);
+        }
+        uint8_t* stub = this->memory + stubOffset + STUB_SIZE * i;
+        std::memcpy(stub, stubCode, sizeof(stubCode));
+        std::memcpy(stub + sizeof(stubCode), &target, 8);
+        this->addresses[externals.at(i)] = stub;
+    }
+    for (X86Relocation& relocation : assembler.getRelocations()) {
+        void* target = this->getSymbolAddress(relocation.symbol);
+        if (!target) {
+            target = dlsym(RTLD_DEFAULT, relocation.symbol.c_str());
+        }
+        if (!target) {
+            std::fprintf(stderr, "Undefined symbol `%s`\n", relocation.symbol.c_str());
+            std::exit(1);
+        }
+        uint8_t* field = this->memory + offsets.at(relocation.section) + relocation.offset;
+        int64_t  value = (int64_t)target + relocation.addend - (int64_t)field;
+        if (value != (int32_t)value) {
+            std::printf("ICE: Relocation against `%s` is out of range\n",
+                        relocation.symbol.c_str());
+            std::exit(1);
+        }
+        int32_t field32 = value;
+        std::memcpy(field, &field32, 4);
+    }
+    if (mprotect(this->memory, codeSize, PROT_READ | PROT_EXEC) != 0) {
+        std::fprintf(stderr, "Could not protect JIT code: %s\n", std::strerror(errno));
+        std::exit(1);
+    }
+    this->writePerfMap(&assembler);
+}
+void* Jit::getSymbolAddress(std::string name) {
+    auto it = this->addresses.find(name);
+    return it == this->addresses.end() ? nullptr : it->second;
+}
+int Jit::run() {
+    IrFunction* entry = nullptr;
+    for (IrFunction* func : this->module->functions) {
+        if (func->name == "main" && !func->blocks.empty()) {
+            entry = func;
+        }
+    }
+    if (!entry) {
+        std::fprintf(stderr, "No `main` function to run\n");
+        std::exit(1);
+    }
+    uint64_t (*function)() = (uint64_t (*)())this->getSymbolAddress(entry->getSymbolName());
+    uint64_t result        = function();
+    return entry->returnType.type == IrTypeType::Void ? 0 : (int)result;
+}
+// One `start size name` line per function, see tools/perf/Documentation/jit-interface.txt.
+void Jit::writePerfMap(X86Assembler* assembler) {
+    std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+    std::FILE*  f    = std::fopen(path.c_str(), "w");
+    if (!f) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        return;
+    }
+    for (IrFunction* func : this->module->functions) {
+        X86Symbol* symbol = assembler->findSymbol(func->getSymbolName());
+        if (!func->blocks.empty() && symbol) {
+            std::fprintf(f, "%llx %llx %s\n",
+                         (unsigned long long)this->getSymbolAddress(symbol->name),
+                         (unsigned long long)symbol->size, func->name.c_str());
+        }
+    }
+    std::fclose(f);
+}
+}; // namespace language
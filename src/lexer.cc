@@ -55,7 +55,8 @@ Token* Lexer::nextToken() {
     case '-':
     case '+':
     case '.':
-    case '*': {
+    case '*':
+    case '/': {
         ret->set_type(static_cast<TokenType>(this->c));
         ret->set_value(std::string(1, this->c));
         this->next_char();
@@ -71,6 +72,29 @@ Token* Lexer::nextToken() {
             ret->set_value(std::string(1, '='));
         }
     } break;
+    case '!': {
+        this->next_char();
+        if (this->c != '=') {
+            std::printf("Invalid character found with the value of `!`\n");
+            std::exit(1);
+        }
+        this->next_char();
+        ret->set_type(TokenType::NotEqual);
+        ret->set_value("!=");
+    } break;
+    case '<':
+    case '>': {
+        char first = this->c;
+        this->next_char();
+        if (this->c == '=') {
+            this->next_char();
+            ret->set_type(first == '<' ? TokenType::LessEqual : TokenType::GreaterEqual);
+            ret->set_value(std::string(1, first) + "=");
+        } else {
+            ret->set_type(static_cast<TokenType>(first));
+            ret->set_value(std::string(1, first));
+        }
+    } break;
     case ':': {
         this->next_char();
         if (this->c == ':') {
@@ -118,6 +142,7 @@ std::vector<std::pair<std::string, TokenType>> keywords = {
     {"else", TokenType::Else},     {"as", TokenType::As},         {"return", TokenType::Return},
     {"void", TokenType::Void},     {"u64", TokenType::U64},       {"u32", TokenType::U32},
     {"i32", TokenType::I32},       {"String", TokenType::String}, {"Variadic", TokenType::Variadic},
+    {"while", TokenType::While},   {"for", TokenType::For},
 };
 TokenType getTokenTypeIdentifierKeyword(std::string buffer) {
     for (std::pair<std::string, TokenType> keyword : keywords) {
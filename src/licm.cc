@@ -0,0 +1,218 @@
+#include <passes.h>
+
+namespace language {
+static IrOperand getIncoming(IrInstruction* phi, IrBlock* pred) {
+    for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+        if (phi->getOperand(i + 1).block == pred) {
+            return phi->getOperand(i);
+        }
+    }
+    return createTypeOperand(phi->valueType);
+}
+// Puts a block in front of the header that every edge from outside the loop goes through. Phis of
+// the header get a single entry for it, merged by a phi in the new block when there were several
+// outside predecessors.
+static void insertPreheader(IrLoopInfo* loopInfo, IrLoop* loop) {
+    IrBlock*              header    = loop->header;
+    IrFunction*           func      = header->parent;
+    std::vector<IrBlock*> outside   = loopInfo->getOutsidePredecessors(loop);
+    IrBlock*              preheader = func->createBlock();
+    func->blocks.remove(preheader);
+    func->blocks.insertBefore(header, preheader);
+    for (IrInstruction* phi : header->insts) {
+        if (phi->type != IrInstructionType::Phi) {
+            break;
+        }
+        IrOperand entering = getIncoming(phi, outside.front());
+        if (outside.size() > 1) {
+            IrInstruction* merged =
+                func->createInstruction(IrInstructionType::Phi, true, outside.size() * 2);
+            merged->valueType = phi->valueType;
+            for (size_t i = 0; i < outside.size(); ++i) {
+                merged->setOperand(i * 2, getIncoming(phi, outside.at(i)));
+                merged->setOperand(i * 2 + 1, createLabelOperand(outside.at(i)));
+            }
+            preheader->append(merged);
+            entering = createSSAOperand(merged);
+        }
+        std::vector<IrOperand> operands;
+        for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+            if (loop->contains(phi->getOperand(i + 1).block)) {
+                operands.push_back(phi->getOperand(i));
+                operands.push_back(phi->getOperand(i + 1));
+            }
+        }
+        operands.push_back(entering);
+        operands.push_back(createLabelOperand(preheader));
+        IrInstruction* newPhi =
+            func->createInstruction(IrInstructionType::Phi, true, operands.size());
+        newPhi->valueType = phi->valueType;
+        for (size_t i = 0; i < operands.size(); ++i) {
+            newPhi->setOperand(i, operands.at(i));
+        }
+        header->insertBefore(phi, newPhi);
+        phi->replaceAllUsesWith(newPhi);
+        phi->eraseFromParent();
+    }
+    for (IrBlock* pred : outside) {
+        pred->getTerminator()->replaceSuccessor(header, preheader);
+    }
+    preheader->append(
+        func->createInstruction(IrInstructionType::Br, false, {createLabelOperand(header)}));
+}
+static bool isInvariant(IrLoop* loop, IrOperand& operand) {
+    if (operand.type != IrOperandType::SSA) {
+        return true;
+    }
+    if (operand.value->kind == IrValueKind::Argument) {
+        return true;
+    }
+    return !loop->contains(static_cast<IrInstruction*>(operand.value)->parent);
+}
+// Globals and slots are always valid to read, so a load from one can run before the loop even when
+// the loop would not have executed it.
+static bool isDereferenceable(IrOperand& pointer) {
+    if (pointer.type == IrOperandType::Global) {
+        return true;
+    }
+    return pointer.type == IrOperandType::SSA && pointer.value->kind == IrValueKind::Instruction &&
+           static_cast<IrInstruction*>(pointer.value)->type == IrInstructionType::Reserve;
+}
+// Distinct globals and distinct slots never overlap, anything else might.
+static bool mayAlias(IrOperand& a, IrOperand& b) {
+    if (!isDereferenceable(a) || !isDereferenceable(b)) {
+        return true;
+    }
+    if (a.type != b.type) {
+        return false;
+    }
+    return a.type == IrOperandType::Global ? a.object == b.object : a.value == b.value;
+}
+static bool isLoadInvariant(IrLoop* loop, IrInstruction* load) {
+    IrOperand& pointer = load->getOperand(0);
+    if (!isInvariant(loop, pointer) || !isDereferenceable(pointer)) {
+        return false;
+    }
+    for (IrBlock* block : loop->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Call) {
+                return false;
+            }
+            if (inst->type == IrInstructionType::Store && mayAlias(inst->getOperand(0), pointer)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+// Hoisting a division runs it on paths that may never have reached it, which is only safe when
+// the divisor is a constant it cannot trap on.
+static bool isSafeDivisor(IrInstruction* inst) {
+    IrOperand& divisor = inst->getOperand(1);
+    if (divisor.type != IrOperandType::Const) {
+        return false;
+    }
+    bool isSigned = inst->type == IrInstructionType::Sdiv || inst->type == IrInstructionType::Srem;
+    int64_t value = divisor.constant;
+    if (divisor.irType.type == IrTypeType::I32) {
+        value = (int32_t)value;
+    }
+    return value != 0 && !(isSigned && value == -1);
+}
+static bool canHoist(IrLoop* loop, IrInstruction* inst) {
+    switch (inst->type) {
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem: {
+        return isSafeDivisor(inst) && isInvariant(loop, inst->getOperand(0));
+    } break;
+    case IrInstructionType::Const:
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh:
+    case IrInstructionType::And:
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr:
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge:
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        for (size_t i = 0; i < inst->numOperands; ++i) {
+            if (!isInvariant(loop, inst->getOperand(i))) {
+                return false;
+            }
+        }
+        return true;
+    } break;
+    case IrInstructionType::Load: {
+        return isLoadInvariant(loop, inst);
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+}
+// Moves every instruction of the loop whose operands are all defined outside of it in front of the
+// preheader's terminator. None of the hoisted instructions can trap, so they may run even when the
+// loop body would not have.
+static bool hoistFromLoop(IrLoop* loop, IrBlock* preheader) {
+    bool changed = false;
+    bool sweep   = true;
+    while (sweep) {
+        sweep = false;
+        for (IrBlock* block : loop->blocks) {
+            IrInstruction* inst = block->insts.front();
+            while (inst) {
+                IrInstruction* next = inst->next;
+                if (canHoist(loop, inst)) {
+                    inst->removeFromParent();
+                    preheader->insertBefore(preheader->getTerminator(), inst);
+                    sweep = true;
+                }
+                inst = next;
+            }
+        }
+        changed |= sweep;
+    }
+    return changed;
+}
+// Preheaders are created for all loops first, the loop info is rebuilt once afterwards. Inner
+// loops are visited first, what they hoist into their preheader may leave the outer loop next.
+bool hoistLoopInvariants(IrFunction* func, IrAnalysisCache* analyses) {
+    if (func->blocks.empty()) {
+        return false;
+    }
+    bool        changed  = false;
+    IrLoopInfo* loopInfo = analyses->getLoopInfo();
+    for (IrLoop* loop : loopInfo->getLoops()) {
+        if (!loopInfo->getPreheader(loop) && !loopInfo->getOutsidePredecessors(loop).empty()) {
+            insertPreheader(loopInfo, loop);
+            changed = true;
+        }
+    }
+    if (changed) {
+        analyses->invalidate();
+        loopInfo = analyses->getLoopInfo();
+    }
+    for (IrLoop* loop : loopInfo->getLoops()) {
+        IrBlock* preheader = loopInfo->getPreheader(loop);
+        if (preheader) {
+            changed |= hoistFromLoop(loop, preheader);
+        }
+    }
+    return changed;
+}
+}; // namespace language
@@ -0,0 +1,861 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <linker.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace language {
+static constexpr uint64_t BASE_ADDRESS         = 0x400000;
+static constexpr uint64_t PAGE_SIZE            = 0x1000;
+static constexpr size_t   PROGRAM_HEADER_COUNT = 7;
+static constexpr size_t   PLT_ENTRY_SIZE       = 8;
+static const char*        INTERPRETER          = "/lib64/ld-linux-x86-64.so.2";
+// Where libc's start files and libraries are looked for, in order.
+static const char* libraryDirectories[] = {"/usr/lib/x86_64-linux-gnu", "/usr/lib64",
+                                           "/lib/x86_64-linux-gnu", "/lib64", "/usr/lib"};
+// Input sections are combined by these prefixes, `.text.foo` goes into `.text`.
+static const char* outputPrefixes[] = {".text",       ".rodata",     ".data.rel.ro",
+                                       ".data",       ".bss",        ".init_array",
+                                       ".fini_array", ".preinit_array"};
+// Symbols the linker defines when an object refers to them without defining them.
+static const char* linkerSymbols[] = {"_GLOBAL_OFFSET_TABLE_",
+                                      "_DYNAMIC",
+                                      "__ehdr_start",
+                                      "__executable_start",
+                                      "__preinit_array_start",
+                                      "__preinit_array_end",
+                                      "__init_array_start",
+                                      "__init_array_end",
+                                      "__fini_array_start",
+                                      "__fini_array_end",
+                                      "_etext",
+                                      "etext",
+                                      "_edata",
+                                      "edata",
+                                      "__bss_start",
+                                      "_end",
+                                      "end"};
+
+static uint64_t alignTo(uint64_t value, uint64_t alignment) {
+    return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+static uint32_t addString(std::vector<uint8_t>& table, std::string string) {
+    uint32_t offset = table.size();
+    table.insert(table.end(), string.begin(), string.end());
+    table.push_back(0);
+    return offset;
+}
+template <typename T> static void appendBytes(std::vector<uint8_t>& bytes, T& value) {
+    bytes.insert(bytes.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof(T));
+}
+static bool isLinkerSymbol(std::string name) {
+    for (const char* symbol : linkerSymbols) {
+        if (name == symbol) {
+            return true;
+        }
+    }
+    return false;
+}
+static std::string getOutputName(std::string name) {
+    for (const char* prefix : outputPrefixes) {
+        std::string string = prefix;
+        if (name == string || name.starts_with(string + ".")) {
+            return string;
+        }
+    }
+    return name;
+}
+// 0 for the read only segment, 1 for code and 2 for writable data.
+static int getSegment(uint64_t flags) {
+    if (flags & SHF_EXECINSTR) {
+        return 1;
+    }
+    return flags & SHF_WRITE ? 2 : 0;
+}
+static bool isGotRelocation(uint32_t type) {
+    return type == R_X86_64_GOTPCREL || type == R_X86_64_GOTPCRELX ||
+           type == R_X86_64_REX_GOTPCRELX;
+}
+std::string findLibraryFile(std::string name) {
+    for (const char* directory : libraryDirectories) {
+        std::string path = std::string(directory) + "/" + name;
+        if (access(path.c_str(), R_OK) == 0) {
+            return path;
+        }
+    }
+    std::fprintf(stderr, "Cannot find `%s`\n", name.c_str());
+    std::exit(1);
+}
+Linker::Linker() {
+    this->fileSize = 0;
+}
+void Linker::addObject(ElfObject* object) {
+    this->objects.push_back(object);
+}
+void Linker::link(std::string path) {
+    this->objects.insert(this->objects.begin(),
+                         {new ElfObject(findLibraryFile("crt1.o")),
+                          new ElfObject(findLibraryFile("crti.o"))});
+    this->objects.push_back(new ElfObject(findLibraryFile("crtn.o")));
+    this->addLibrary(findLibraryFile("libc.so.6"));
+    this->resolveSymbols();
+    this->collectGarbage();
+    this->resolveReferences();
+    this->createOutputSections();
+    this->layout();
+    this->createDynamicSections();
+    this->writeImage(path);
+}
+// Only the exported symbols of the library are read. Versions are not recorded, an unversioned
+// reference binds to the default version of a symbol, so the ones hidden behind an older version
+// are left out.
+void Linker::addLibrary(std::string path) {
+    int         fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    uint64_t size    = info.st_size;
+    void*    mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    const uint8_t* data  = (const uint8_t*)mapping;
+    auto           valid = [&](uint64_t offset, uint64_t length) {
+        return offset <= size && length <= size - offset;
+    };
+    const Elf64_Ehdr* header = (const Elf64_Ehdr*)data;
+    if (!valid(0, sizeof(Elf64_Ehdr)) || std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != ELFCLASS64 || header->e_type != ET_DYN ||
+        header->e_machine != EM_X86_64 ||
+        !valid(header->e_shoff, header->e_shnum * sizeof(Elf64_Shdr))) {
+        std::fprintf(stderr, "`%s` is not an x86-64 shared library\n", path.c_str());
+        std::exit(1);
+    }
+    const Elf64_Shdr* headers = (const Elf64_Shdr*)(data + header->e_shoff);
+    const Elf64_Shdr* dynsym  = nullptr;
+    const Elf64_Shdr* versym  = nullptr;
+    for (size_t i = 0; i < header->e_shnum; ++i) {
+        if (headers[i].sh_type == SHT_DYNSYM) {
+            dynsym = &headers[i];
+        } else if (headers[i].sh_type == SHT_GNU_versym) {
+            versym = &headers[i];
+        }
+    }
+    if (!dynsym || dynsym->sh_link >= header->e_shnum ||
+        !valid(dynsym->sh_offset, dynsym->sh_size) ||
+        !valid(headers[dynsym->sh_link].sh_offset, headers[dynsym->sh_link].sh_size)) {
+        std::fprintf(stderr, "`%s` is not an x86-64 shared library\n", path.c_str());
+        std::exit(1);
+    }
+    const Elf64_Sym* symbols     = (const Elf64_Sym*)(data + dynsym->sh_offset);
+    size_t           symbolCount = dynsym->sh_size / sizeof(Elf64_Sym);
+    const char*      strings     = (const char*)(data + headers[dynsym->sh_link].sh_offset);
+    uint64_t         stringsSize = headers[dynsym->sh_link].sh_size;
+    const uint16_t*  versions    = nullptr;
+    if (versym && valid(versym->sh_offset, symbolCount * sizeof(uint16_t))) {
+        versions = (const uint16_t*)(data + versym->sh_offset);
+    }
+    for (size_t i = 1; i < symbolCount; ++i) {
+        const Elf64_Sym& sym     = symbols[i];
+        uint8_t          binding = ELF64_ST_BIND(sym.st_info);
+        if (sym.st_shndx == SHN_UNDEF || (binding != STB_GLOBAL && binding != STB_WEAK) ||
+            sym.st_name >= stringsSize || (versions && (versions[i] & 0x8000))) {
+            continue;
+        }
+        std::string name(strings + sym.st_name,
+                         strnlen(strings + sym.st_name, stringsSize - sym.st_name));
+        this->exports[name] = ELF64_ST_TYPE(sym.st_info);
+    }
+    munmap(mapping, size);
+    this->library = path.substr(path.rfind('/') + 1);
+}
+// A strong definition wins over a weak one, two strong ones are an error. An undefined symbol
+// stays weak as long as every reference to it is weak.
+void Linker::resolveSymbols() {
+    bool duplicates = false;
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        std::vector<ElfSymbol>& symbols = this->objects.at(i)->getSymbols();
+        for (size_t j = 1; j < symbols.size(); ++j) {
+            ElfSymbol& symbol = symbols.at(j);
+            bool       weak   = symbol.binding == STB_WEAK;
+            if (symbol.binding == STB_LOCAL) {
+                continue;
+            }
+            auto it = this->globals.find(symbol.name);
+            if (it == this->globals.end()) {
+                LinkerSymbol global = {-1, 0, weak, false, false, 0, -1, -1, -1};
+                it                  = this->globals.insert({symbol.name, global}).first;
+            }
+            LinkerSymbol& global = it->second;
+            if (symbol.section == ELF_UNDEFINED) {
+                if (global.object < 0) {
+                    global.weak = global.weak && weak;
+                }
+                continue;
+            }
+            if (global.object < 0 || (global.weak && !weak)) {
+                global.object = i;
+                global.index  = j;
+                global.weak   = weak;
+            } else if (!global.weak && !weak) {
+                std::string& first = this->objects.at(global.object)->getName();
+                std::fprintf(stderr, "Duplicate symbol `%s` in `%s` and `%s`\n",
+                             symbol.name.c_str(), first.c_str(),
+                             this->objects.at(i)->getName().c_str());
+                duplicates = true;
+            }
+        }
+    }
+    if (duplicates) {
+        std::exit(1);
+    }
+}
+LinkerSymbol* Linker::getGlobal(uint32_t object, uint32_t index) {
+    ElfSymbol& symbol = this->objects.at(object)->getSymbols().at(index);
+    if (symbol.binding == STB_LOCAL) {
+        return nullptr;
+    }
+    return &this->globals.at(symbol.name);
+}
+// Marks the section and everything its relocations reach.
+void Linker::markSection(uint32_t object, uint32_t section) {
+    std::vector<LinkerInput> worklist = {{object, section}};
+    while (!worklist.empty()) {
+        LinkerInput input = worklist.back();
+        worklist.pop_back();
+        ElfSection& inputSection = this->objects.at(input.object)->getSections().at(input.section);
+        if (this->live.at(input.object).at(input.section) || !(inputSection.flags & SHF_ALLOC)) {
+            continue;
+        }
+        this->live.at(input.object).at(input.section) = true;
+        std::vector<ElfRelocation>& relocations = this->objects.at(input.object)->getRelocations();
+        for (size_t index : this->sectionRelocations.at(input.object).at(input.section)) {
+            uint32_t      symbolIndex = relocations.at(index).symbol;
+            ElfSymbol&    symbol = this->objects.at(input.object)->getSymbols().at(symbolIndex);
+            LinkerSymbol* global = this->getGlobal(input.object, symbolIndex);
+            if (!global) {
+                if (symbol.section >= 0) {
+                    worklist.push_back({input.object, (uint32_t)symbol.section});
+                }
+                continue;
+            }
+            global->referenced = true;
+            if (global->object >= 0) {
+                ElfSymbol& definition =
+                    this->objects.at(global->object)->getSymbols().at(global->index);
+                if (definition.section >= 0) {
+                    worklist.push_back({(uint32_t)global->object, (uint32_t)definition.section});
+                }
+            }
+        }
+    }
+}
+// The roots are the section of `_start` and the code and tables the dynamic loader and libc run
+// before and after `main`.
+void Linker::collectGarbage() {
+    for (ElfObject* object : this->objects) {
+        size_t count = object->getSections().size();
+        this->sectionRelocations.push_back(std::vector<std::vector<size_t>>(count));
+        this->live.push_back(std::vector<bool>(count));
+        this->addresses.push_back(std::vector<uint64_t>(count));
+        std::vector<ElfRelocation>& relocations = object->getRelocations();
+        for (size_t i = 0; i < relocations.size(); ++i) {
+            this->sectionRelocations.back().at(relocations.at(i).section).push_back(i);
+        }
+    }
+    auto start = this->globals.find("_start");
+    if (start == this->globals.end() || start->second.object < 0) {
+        std::fprintf(stderr, "Undefined symbol `_start`\n");
+        std::exit(1);
+    }
+    LinkerSymbol& entry        = start->second;
+    ElfSymbol&    definition   = this->objects.at(entry.object)->getSymbols().at(entry.index);
+    int32_t       entrySection = definition.section;
+    entry.referenced           = true;
+    if (entrySection >= 0) {
+        this->markSection(entry.object, entrySection);
+    }
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        std::vector<ElfSection>& inputSections = this->objects.at(i)->getSections();
+        for (size_t j = 0; j < inputSections.size(); ++j) {
+            ElfSection& section = inputSections.at(j);
+            std::string name    = getOutputName(section.name);
+            if (name == ".init" || name == ".fini" || name == ".init_array" ||
+                name == ".fini_array" || name == ".preinit_array" ||
+                section.type == SHT_INIT_ARRAY || section.type == SHT_FINI_ARRAY ||
+                section.type == SHT_PREINIT_ARRAY || (section.flags & SHF_GNU_RETAIN)) {
+                this->markSection(i, j);
+            }
+        }
+    }
+    // `_init` and `_fini` are named in the dynamic section.
+    for (const char* name : {"_init", "_fini"}) {
+        auto it = this->globals.find(name);
+        if (it != this->globals.end() && it->second.object >= 0) {
+            it->second.referenced = true;
+        }
+    }
+}
+// Symbols referenced by live sections and defined by no object come from the library, from the
+// linker or stay zero as weak references. GOT and PLT entries are made for the references that
+// need them.
+void Linker::resolveReferences() {
+    // Sorted, so the dynamic symbols come out the same on every run.
+    std::vector<std::string> names;
+    for (auto& [name, global] : this->globals) {
+        if (global.referenced && global.object < 0 && !isLinkerSymbol(name)) {
+            names.push_back(name);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    bool undefined = false;
+    for (std::string& name : names) {
+        LinkerSymbol& global = this->globals.at(name);
+        if (this->exports.contains(name)) {
+            global.imported     = true;
+            global.dynamicIndex = this->imports.size() + 1;
+            this->imports.push_back(name);
+        } else if (!global.weak) {
+            std::fprintf(stderr, "Undefined symbol `%s`\n", name.c_str());
+            undefined = true;
+        }
+    }
+    if (undefined) {
+        std::exit(1);
+    }
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        ElfObject* object = this->objects.at(i);
+        for (size_t j = 0; j < object->getSections().size(); ++j) {
+            if (!this->live.at(i).at(j)) {
+                continue;
+            }
+            for (size_t index : this->sectionRelocations.at(i).at(j)) {
+                ElfRelocation& relocation = object->getRelocations().at(index);
+                LinkerSymbol*  global     = this->getGlobal(i, relocation.symbol);
+                std::string&   name = object->getSymbols().at(relocation.symbol).name;
+                if (isGotRelocation(relocation.type)) {
+                    if (!global) {
+                        std::fprintf(stderr, "TODO: GOT entry for the local symbol `%s` in `%s`\n",
+                                     name.c_str(), object->getName().c_str());
+                        std::exit(1);
+                    }
+                    if (global->gotIndex < 0) {
+                        global->gotIndex = this->gotEntries.size();
+                        this->gotEntries.push_back(name);
+                    }
+                    continue;
+                }
+                if (!global || !global->imported || relocation.type == R_X86_64_NONE) {
+                    continue;
+                }
+                uint8_t type = this->exports.at(name);
+                if ((relocation.type != R_X86_64_PC32 && relocation.type != R_X86_64_PLT32) ||
+                    (type != STT_FUNC && type != STT_GNU_IFUNC)) {
+                    std::fprintf(stderr, "TODO: Direct reference to `%s` of `%s` in `%s`\n",
+                                 name.c_str(), this->library.c_str(), object->getName().c_str());
+                    std::exit(1);
+                }
+                if (global->pltIndex < 0) {
+                    global->pltIndex = this->pltEntries.size();
+                    this->pltEntries.push_back(name);
+                }
+                if (global->gotIndex < 0) {
+                    global->gotIndex = this->gotEntries.size();
+                    this->gotEntries.push_back(name);
+                }
+            }
+        }
+    }
+}
+LinkerOutputSection* Linker::getOutputSection(std::string name) {
+    for (LinkerOutputSection& section : this->sections) {
+        if (section.name == name) {
+            return &section;
+        }
+    }
+    return nullptr;
+}
+// Output sections in the order of the segments. Within a segment the sections the linker makes
+// come first, except `.plt` behind the code and `.bss` at the very end of the image.
+void Linker::createOutputSections() {
+    std::vector<LinkerOutputSection> inputSections;
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        std::vector<ElfSection>& objectSections = this->objects.at(i)->getSections();
+        for (size_t j = 0; j < objectSections.size(); ++j) {
+            ElfSection& section = objectSections.at(j);
+            if (!this->live.at(i).at(j)) {
+                continue;
+            }
+            if (section.flags & SHF_TLS) {
+                std::fprintf(stderr, "TODO: Thread local section `%s` in `%s`\n",
+                             section.name.c_str(), this->objects.at(i)->getName().c_str());
+                std::exit(1);
+            }
+            std::string          name   = getOutputName(section.name);
+            LinkerOutputSection* output = nullptr;
+            for (LinkerOutputSection& candidate : inputSections) {
+                if (candidate.name == name) {
+                    output = &candidate;
+                }
+            }
+            if (!output) {
+                inputSections.push_back({name, section.type, 0, 1, 0, 0, {}, {}});
+                output = &inputSections.back();
+            }
+            output->flags |= section.flags & (SHF_ALLOC | SHF_WRITE | SHF_EXECINSTR);
+            output->alignment = std::max(output->alignment, section.alignment);
+            output->inputs.push_back({(uint32_t)i, (uint32_t)j});
+        }
+    }
+
+    std::vector<uint8_t> interp(INTERPRETER, INTERPRETER + std::strlen(INTERPRETER) + 1);
+    std::vector<uint8_t> hash;
+    std::vector<uint8_t> dynsym;
+    std::vector<uint8_t> dynstr = {0};
+    addString(dynstr, this->library);
+    // A single bucket chains all dynamic symbols, they are all undefined and never found anyway.
+    uint32_t symbolCount = this->imports.size() + 1;
+    uint32_t hashHeader[] = {1, symbolCount, symbolCount > 1 ? 1u : 0u};
+    hash.insert(hash.end(), (uint8_t*)hashHeader, (uint8_t*)hashHeader + sizeof(hashHeader));
+    for (uint32_t i = 0; i < symbolCount; ++i) {
+        uint32_t next = i == 0 || i + 1 == symbolCount ? 0 : i + 1;
+        appendBytes(hash, next);
+    }
+    Elf64_Sym null = {};
+    appendBytes(dynsym, null);
+    for (std::string& name : this->imports) {
+        Elf64_Sym sym = {};
+        sym.st_name   = addString(dynstr, name);
+        sym.st_info   = ELF64_ST_INFO(STB_GLOBAL, this->exports.at(name));
+        appendBytes(dynsym, sym);
+    }
+
+    this->sections.push_back({".interp", SHT_PROGBITS, SHF_ALLOC, 1, 0, 0, {}, interp});
+    this->sections.push_back({".hash", SHT_HASH, SHF_ALLOC, 8, 0, 0, {}, hash});
+    this->sections.push_back({".dynsym", SHT_DYNSYM, SHF_ALLOC, 8, 0, 0, {}, dynsym});
+    this->sections.push_back({".dynstr", SHT_STRTAB, SHF_ALLOC, 1, 0, 0, {}, dynstr});
+    this->sections.push_back({".rela.dyn", SHT_RELA, SHF_ALLOC, 8, 0, 0, {}, {}});
+    for (LinkerOutputSection& section : inputSections) {
+        if (getSegment(section.flags) == 0) {
+            this->sections.push_back(section);
+        }
+    }
+    for (LinkerOutputSection& section : inputSections) {
+        if (getSegment(section.flags) == 1) {
+            this->sections.push_back(section);
+        }
+    }
+    this->sections.push_back(
+        {".plt", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 16, 0, 0, {}, {}});
+    for (LinkerOutputSection& section : inputSections) {
+        if (getSegment(section.flags) == 2 &&
+            (section.type == SHT_INIT_ARRAY || section.type == SHT_FINI_ARRAY ||
+             section.type == SHT_PREINIT_ARRAY)) {
+            this->sections.push_back(section);
+        }
+    }
+    this->sections.push_back({".dynamic", SHT_DYNAMIC, SHF_ALLOC | SHF_WRITE, 8, 0, 0, {}, {}});
+    this->sections.push_back({".got", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, 8, 0, 0, {}, {}});
+    for (LinkerOutputSection& section : inputSections) {
+        if (getSegment(section.flags) == 2 && section.type != SHT_NOBITS &&
+            section.type != SHT_INIT_ARRAY && section.type != SHT_FINI_ARRAY &&
+            section.type != SHT_PREINIT_ARRAY) {
+            this->sections.push_back(section);
+        }
+    }
+    for (LinkerOutputSection& section : inputSections) {
+        if (getSegment(section.flags) == 2 && section.type == SHT_NOBITS) {
+            this->sections.push_back(section);
+        }
+    }
+    // Sizes of the sections that are only filled in once addresses are known.
+    size_t relocationCount = 0;
+    for (std::string& name : this->gotEntries) {
+        relocationCount += this->globals.at(name).imported ? 1 : 0;
+    }
+    this->getOutputSection(".rela.dyn")->bytes.resize(relocationCount * sizeof(Elf64_Rela));
+    this->getOutputSection(".plt")->bytes.resize(this->pltEntries.size() * PLT_ENTRY_SIZE);
+    this->getOutputSection(".got")->bytes.resize(this->gotEntries.size() * 8);
+    this->getOutputSection(".dynamic")
+        ->bytes.resize(this->getDynamicEntries().size() * sizeof(Elf64_Dyn));
+}
+// Sections are laid out in order, each segment starting on a new page. File offsets are the
+// addresses minus the base, the mapped segments are then plain ranges of the file.
+void Linker::layout() {
+    uint64_t address         = BASE_ADDRESS + sizeof(Elf64_Ehdr) +
+                       PROGRAM_HEADER_COUNT * sizeof(Elf64_Phdr);
+    int      segment         = 0;
+    this->segmentStarts[0]   = BASE_ADDRESS;
+    this->segmentFileEnds[2] = 0;
+    for (LinkerOutputSection& section : this->sections) {
+        int sectionSegment = getSegment(section.flags);
+        while (segment < sectionSegment) {
+            this->segmentEnds[segment] = address;
+            address                    = alignTo(address, PAGE_SIZE);
+            this->segmentStarts[++segment] = address;
+        }
+        if (section.type == SHT_NOBITS && this->segmentFileEnds[2] == 0) {
+            this->segmentFileEnds[2] = address;
+        }
+        address         = alignTo(address, section.alignment);
+        section.address = address;
+        if (section.inputs.empty()) {
+            address += section.bytes.size();
+        }
+        for (LinkerInput& input : section.inputs) {
+            ElfSection& inputSection =
+                this->objects.at(input.object)->getSections().at(input.section);
+            address = alignTo(address, inputSection.alignment);
+            this->addresses.at(input.object).at(input.section) = address;
+            address += inputSection.size;
+        }
+        section.size = address - section.address;
+    }
+    this->segmentEnds[2] = address;
+    if (this->segmentFileEnds[2] == 0) {
+        this->segmentFileEnds[2] = address;
+    }
+    this->fileSize = this->segmentFileEnds[2] - BASE_ADDRESS;
+
+    for (auto& [name, global] : this->globals) {
+        if (!global.referenced || global.object >= 0 || !isLinkerSymbol(name)) {
+            continue;
+        }
+        std::string          prefix = name;
+        LinkerOutputSection* array  = nullptr;
+        for (const char* arrayName : {"__preinit_array", "__init_array", "__fini_array"}) {
+            if (name.starts_with(arrayName)) {
+                array = this->getOutputSection(std::string(arrayName).substr(1));
+                prefix = arrayName;
+            }
+        }
+        if (name == "_GLOBAL_OFFSET_TABLE_") {
+            global.address = this->getOutputSection(".got")->address;
+        } else if (name == "_DYNAMIC") {
+            global.address = this->getOutputSection(".dynamic")->address;
+        } else if (name == "__ehdr_start" || name == "__executable_start") {
+            global.address = BASE_ADDRESS;
+        } else if (prefix != name) {
+            uint64_t start = array ? array->address : this->segmentStarts[2];
+            global.address = name.ends_with("_end") && array ? start + array->size : start;
+        } else if (name == "_etext" || name == "etext") {
+            global.address = this->segmentEnds[1];
+        } else if (name == "_edata" || name == "edata" || name == "__bss_start") {
+            global.address = this->segmentFileEnds[2];
+        } else {
+            global.address = this->segmentEnds[2];
+        }
+    }
+}
+uint64_t Linker::getSymbolAddress(uint32_t object, uint32_t index) {
+    LinkerSymbol* global = this->getGlobal(object, index);
+    if (global) {
+        if (global->object < 0) {
+            if (global->pltIndex >= 0) {
+                return this->getOutputSection(".plt")->address + global->pltIndex * PLT_ENTRY_SIZE;
+            }
+            return global->address;
+        }
+        object = global->object;
+        index  = global->index;
+    }
+    ElfSymbol& symbol = this->objects.at(object)->getSymbols().at(index);
+    if (symbol.section >= 0) {
+        return this->addresses.at(object).at(symbol.section) + symbol.value;
+    }
+    return symbol.section == ELF_ABSOLUTE ? symbol.value : 0;
+}
+std::vector<Elf64_Dyn> Linker::getDynamicEntries() {
+    std::vector<Elf64_Dyn> entries;
+    auto add = [&](int64_t tag, uint64_t value) { entries.push_back({tag, {value}}); };
+    auto addSection = [&](std::string name, int64_t tag, int64_t sizeTag) {
+        LinkerOutputSection* section = this->getOutputSection(name);
+        if (section) {
+            add(tag, section->address);
+            add(sizeTag, section->size);
+        }
+    };
+    add(DT_NEEDED, 1);
+    add(DT_HASH, this->getOutputSection(".hash")->address);
+    add(DT_STRTAB, this->getOutputSection(".dynstr")->address);
+    add(DT_SYMTAB, this->getOutputSection(".dynsym")->address);
+    add(DT_STRSZ, this->getOutputSection(".dynstr")->bytes.size());
+    add(DT_SYMENT, sizeof(Elf64_Sym));
+    if (!this->getOutputSection(".rela.dyn")->bytes.empty()) {
+        add(DT_RELA, this->getOutputSection(".rela.dyn")->address);
+        add(DT_RELASZ, this->getOutputSection(".rela.dyn")->bytes.size());
+        add(DT_RELAENT, sizeof(Elf64_Rela));
+    }
+    for (auto [name, tag] : {std::pair{"_init", DT_INIT}, std::pair{"_fini", DT_FINI}}) {
+        auto it = this->globals.find(name);
+        if (it != this->globals.end() && it->second.object >= 0) {
+            add(tag, this->getSymbolAddress(it->second.object, it->second.index));
+        }
+    }
+    addSection(".preinit_array", DT_PREINIT_ARRAY, DT_PREINIT_ARRAYSZ);
+    addSection(".init_array", DT_INIT_ARRAY, DT_INIT_ARRAYSZ);
+    addSection(".fini_array", DT_FINI_ARRAY, DT_FINI_ARRAYSZ);
+    add(DT_DEBUG, 0);
+    add(DT_FLAGS, DF_BIND_NOW);
+    add(DT_FLAGS_1, DF_1_NOW);
+    add(DT_NULL, 0);
+    return entries;
+}
+// Everything is bound when the program is loaded, so the GOT entries of library functions hold
+// their final address before `_start` runs and a PLT entry is a single indirect jump.
+void Linker::createDynamicSections() {
+    LinkerOutputSection* got  = this->getOutputSection(".got");
+    LinkerOutputSection* plt  = this->getOutputSection(".plt");
+    LinkerOutputSection* rela = this->getOutputSection(".rela.dyn");
+    rela->bytes.clear();
+    for (size_t i = 0; i < this->gotEntries.size(); ++i) {
+        LinkerSymbol& global  = this->globals.at(this->gotEntries.at(i));
+        uint64_t      address = got->address + i * 8;
+        uint64_t      value   = 0;
+        if (global.imported) {
+            Elf64_Rela entry;
+            entry.r_offset = address;
+            entry.r_info   = ELF64_R_INFO(global.dynamicIndex, R_X86_64_GLOB_DAT);
+            entry.r_addend = 0;
+            appendBytes(rela->bytes, entry);
+        } else if (global.object >= 0) {
+            value = this->getSymbolAddress(global.object, global.index);
+        } else {
+            value = global.address;
+        }
+        std::memcpy(got->bytes.data() + i * 8, &value, 8);
+    }
+    // `jmp QWORD PTR [rip + GOT entry]` and two `int3`.
+    for (size_t i = 0; i < this->pltEntries.size(); ++i) {
+        LinkerSymbol& global = this->globals.at(this->pltEntries.at(i));
+        uint8_t*      stub   = plt->bytes.data() + i * PLT_ENTRY_SIZE;
+        int32_t       offset = got->address + global.gotIndex * 8 -
+                         (plt->address + i * PLT_ENTRY_SIZE + 6);
+        stub[0]              = 0xFF;
+        stub[1]              = 0x25;
+        std::memcpy(stub + 2, &offset, 4);
+        stub[6] = 0xCC;
+        stub[7] = 0xCC;
+    }
+    std::vector<Elf64_Dyn> entries = this->getDynamicEntries();
+    std::memcpy(this->getOutputSection(".dynamic")->bytes.data(), entries.data(),
+                entries.size() * sizeof(Elf64_Dyn));
+}
+void Linker::applyRelocations(std::vector<uint8_t>& image) {
+    for (size_t i = 0; i < this->objects.size(); ++i) {
+        ElfObject* object = this->objects.at(i);
+        for (size_t j = 0; j < object->getSections().size(); ++j) {
+            if (!this->live.at(i).at(j)) {
+                continue;
+            }
+            ElfSection& section = object->getSections().at(j);
+            for (size_t index : this->sectionRelocations.at(i).at(j)) {
+                ElfRelocation& relocation = object->getRelocations().at(index);
+                std::string&   name   = object->getSymbols().at(relocation.symbol).name;
+                LinkerSymbol*  global = this->getGlobal(i, relocation.symbol);
+                uint64_t       place  = this->addresses.at(i).at(j) + relocation.offset;
+                uint64_t       symbol = this->getSymbolAddress(i, relocation.symbol);
+                int64_t        value  = 0;
+                size_t         size   = 4;
+                bool           inRange = true;
+                switch (relocation.type) {
+                case R_X86_64_NONE: {
+                    continue;
+                } break;
+                case R_X86_64_64: {
+                    value   = symbol + relocation.addend;
+                    size    = 8;
+                    inRange = true;
+                } break;
+                case R_X86_64_PC64: {
+                    value   = symbol + relocation.addend - place;
+                    size    = 8;
+                    inRange = true;
+                } break;
+                case R_X86_64_PC32:
+                case R_X86_64_PLT32: {
+                    value   = symbol + relocation.addend - place;
+                    inRange = value == (int32_t)value;
+                } break;
+                case R_X86_64_32: {
+                    value   = symbol + relocation.addend;
+                    inRange = value == (uint32_t)value;
+                } break;
+                case R_X86_64_32S: {
+                    value   = symbol + relocation.addend;
+                    inRange = value == (int32_t)value;
+                } break;
+                case R_X86_64_GOTPCREL:
+                case R_X86_64_GOTPCRELX:
+                case R_X86_64_REX_GOTPCRELX: {
+                    uint64_t entry = this->getOutputSection(".got")->address + global->gotIndex * 8;
+                    value          = entry + relocation.addend - place;
+                    inRange        = value == (int32_t)value;
+                } break;
+                default: {
+                    std::fprintf(stderr, "TODO: Relocation type %u against `%s` in `%s`\n",
+                                 relocation.type, name.c_str(), object->getName().c_str());
+                    std::exit(1);
+                } break;
+                }
+                if (relocation.offset + size > section.size) {
+                    std::fprintf(stderr, "Relocation outside of `%s` in `%s`\n",
+                                 section.name.c_str(), object->getName().c_str());
+                    std::exit(1);
+                }
+                if (!inRange) {
+                    std::fprintf(stderr, "Relocation against `%s` in `%s` is out of range\n",
+                                 name.c_str(), object->getName().c_str());
+                    std::exit(1);
+                }
+                std::memcpy(image.data() + (place - BASE_ADDRESS), &value, size);
+            }
+        }
+    }
+}
+// The section headers and their names go behind the image, they are not loaded.
+void Linker::writeImage(std::string path) {
+    std::vector<uint8_t> image(this->fileSize);
+    for (LinkerOutputSection& section : this->sections) {
+        if (section.type == SHT_NOBITS) {
+            continue;
+        }
+        uint8_t* start = image.data() + (section.address - BASE_ADDRESS);
+        if (section.inputs.empty()) {
+            std::memcpy(start, section.bytes.data(), section.bytes.size());
+            continue;
+        }
+        // Padding between pieces of code is `int3`.
+        if (section.flags & SHF_EXECINSTR) {
+            std::memset(start, 0xCC, section.size);
+        }
+        for (LinkerInput& input : section.inputs) {
+            ElfSection& inputSection =
+                this->objects.at(input.object)->getSections().at(input.section);
+            uint64_t address = this->addresses.at(input.object).at(input.section);
+            std::memcpy(image.data() + (address - BASE_ADDRESS), inputSection.bytes.data(),
+                        inputSection.bytes.size());
+        }
+    }
+    this->applyRelocations(image);
+
+    LinkerOutputSection* interp  = this->getOutputSection(".interp");
+    LinkerOutputSection* dynamic = this->getOutputSection(".dynamic");
+    std::vector<Elf64_Phdr> phdrs(PROGRAM_HEADER_COUNT);
+    phdrs.at(0) = {PT_PHDR, PF_R, sizeof(Elf64_Ehdr), BASE_ADDRESS + sizeof(Elf64_Ehdr),
+                   BASE_ADDRESS + sizeof(Elf64_Ehdr), PROGRAM_HEADER_COUNT * sizeof(Elf64_Phdr),
+                   PROGRAM_HEADER_COUNT * sizeof(Elf64_Phdr), 8};
+    phdrs.at(1) = {PT_INTERP, PF_R, interp->address - BASE_ADDRESS, interp->address,
+                   interp->address, interp->size, interp->size, 1};
+    uint32_t segmentFlags[] = {PF_R, PF_R | PF_X, PF_R | PF_W};
+    for (int i = 0; i < 3; ++i) {
+        uint64_t fileEnd = i == 2 ? this->segmentFileEnds[2] : this->segmentEnds[i];
+        phdrs.at(2 + i)  = {PT_LOAD,
+                            segmentFlags[i],
+                            this->segmentStarts[i] - BASE_ADDRESS,
+                            this->segmentStarts[i],
+                            this->segmentStarts[i],
+                            fileEnd - this->segmentStarts[i],
+                            this->segmentEnds[i] - this->segmentStarts[i],
+                            PAGE_SIZE};
+    }
+    phdrs.at(5) = {PT_DYNAMIC, PF_R | PF_W, dynamic->address - BASE_ADDRESS, dynamic->address,
+                   dynamic->address, dynamic->size, dynamic->size, 8};
+    phdrs.at(6) = {PT_GNU_STACK, PF_R | PF_W, 0, 0, 0, 0, 0, 16};
+
+    std::vector<uint8_t>    shstrtab = {0};
+    std::vector<Elf64_Shdr> shdrs(1);
+    auto getIndex = [&](std::string name) {
+        for (size_t i = 0; i < this->sections.size(); ++i) {
+            if (this->sections.at(i).name == name) {
+                return (uint32_t)(i + 1);
+            }
+        }
+        return (uint32_t)0;
+    };
+    for (LinkerOutputSection& section : this->sections) {
+        Elf64_Shdr shdr   = {};
+        shdr.sh_name      = addString(shstrtab, section.name);
+        shdr.sh_type      = section.type;
+        shdr.sh_flags     = section.flags;
+        shdr.sh_addr      = section.address;
+        shdr.sh_offset    = section.address - BASE_ADDRESS;
+        shdr.sh_size      = section.size;
+        shdr.sh_addralign = section.alignment;
+        if (section.type == SHT_HASH || section.type == SHT_RELA) {
+            shdr.sh_link = getIndex(".dynsym");
+        } else if (section.type == SHT_DYNSYM || section.type == SHT_DYNAMIC) {
+            shdr.sh_link = getIndex(".dynstr");
+            shdr.sh_info = section.type == SHT_DYNSYM ? 1 : 0;
+        }
+        shdr.sh_entsize = section.type == SHT_HASH      ? 4
+                          : section.type == SHT_DYNSYM  ? sizeof(Elf64_Sym)
+                          : section.type == SHT_RELA    ? sizeof(Elf64_Rela)
+                          : section.type == SHT_DYNAMIC ? sizeof(Elf64_Dyn)
+                                                        : 0;
+        shdrs.push_back(shdr);
+    }
+    Elf64_Shdr shstrtabHeader   = {};
+    shstrtabHeader.sh_name      = addString(shstrtab, ".shstrtab");
+    shstrtabHeader.sh_type      = SHT_STRTAB;
+    shstrtabHeader.sh_offset    = image.size();
+    shstrtabHeader.sh_size      = shstrtab.size();
+    shstrtabHeader.sh_addralign = 1;
+    shdrs.push_back(shstrtabHeader);
+    image.insert(image.end(), shstrtab.begin(), shstrtab.end());
+    image.resize(alignTo(image.size(), 8));
+    uint64_t headersOffset = image.size();
+    for (Elf64_Shdr& shdr : shdrs) {
+        appendBytes(image, shdr);
+    }
+
+    LinkerSymbol& entry  = this->globals.at("_start");
+    Elf64_Ehdr    header = {};
+    std::memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS]   = ELFCLASS64;
+    header.e_ident[EI_DATA]    = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI]   = ELFOSABI_SYSV;
+    header.e_type              = ET_EXEC;
+    header.e_machine           = EM_X86_64;
+    header.e_version           = EV_CURRENT;
+    header.e_entry             = this->getSymbolAddress(entry.object, entry.index);
+    header.e_phoff             = sizeof(Elf64_Ehdr);
+    header.e_shoff             = headersOffset;
+    header.e_ehsize            = sizeof(Elf64_Ehdr);
+    header.e_phentsize         = sizeof(Elf64_Phdr);
+    header.e_phnum             = phdrs.size();
+    header.e_shentsize         = sizeof(Elf64_Shdr);
+    header.e_shnum             = shdrs.size();
+    header.e_shstrndx          = shdrs.size() - 1;
+    std::memcpy(image.data(), &header, sizeof(Elf64_Ehdr));
+    std::memcpy(image.data() + sizeof(Elf64_Ehdr), phdrs.data(),
+                phdrs.size() * sizeof(Elf64_Phdr));
+
+    // A new file, so the mode applies even if `path` existed.
+    unlink(path.c_str());
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0755);
+    if (fd < 0 || ftruncate(fd, image.size()) != 0) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    void* mapping = mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), path.c_str());
+        std::exit(1);
+    }
+    std::memcpy(mapping, image.data(), image.size());
+    munmap(mapping, image.size());
+}
+}; // namespace language
@@ -0,0 +1,410 @@
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <llvmgen.h>
+
+namespace language {
+static std::string getTypeName(IrType type) {
+    switch (type.type) {
+    case IrTypeType::I32: {
+        return "i32";
+    } break;
+    case IrTypeType::I64: {
+        return "i64";
+    } break;
+    case IrTypeType::Pointer: {
+        return "i8*";
+    } break;
+    case IrTypeType::Void: {
+        return "void";
+    } break;
+    default: {
+        std::printf("TODO: LLVM type for IR type %llu\n", type.type);
+        std::exit(1);
+    } break;
+    }
+}
+static uint32_t getBitWidth(IrType type) {
+    return type.type == IrTypeType::I32 ? 32 : 64;
+}
+static const char* getLinkage(bool noMangle) {
+    return noMangle ? "" : "internal ";
+}
+static std::string getConstant(IrType type, int64_t value) {
+    return std::to_string(type.type == IrTypeType::I32 ? (int32_t)value : value);
+}
+static const char* getOpcode(IrInstructionType type) {
+    switch (type) {
+    case IrInstructionType::Add: {
+        return "add";
+    } break;
+    case IrInstructionType::Sub: {
+        return "sub";
+    } break;
+    case IrInstructionType::Mul: {
+        return "mul";
+    } break;
+    case IrInstructionType::Sdiv: {
+        return "sdiv";
+    } break;
+    case IrInstructionType::Udiv: {
+        return "udiv";
+    } break;
+    case IrInstructionType::Srem: {
+        return "srem";
+    } break;
+    case IrInstructionType::Urem: {
+        return "urem";
+    } break;
+    case IrInstructionType::And: {
+        return "and";
+    } break;
+    case IrInstructionType::Shl: {
+        return "shl";
+    } break;
+    case IrInstructionType::Lshr: {
+        return "lshr";
+    } break;
+    case IrInstructionType::Ashr: {
+        return "ashr";
+    } break;
+    case IrInstructionType::Eq: {
+        return "eq";
+    } break;
+    case IrInstructionType::Ne: {
+        return "ne";
+    } break;
+    case IrInstructionType::Slt: {
+        return "slt";
+    } break;
+    case IrInstructionType::Sle: {
+        return "sle";
+    } break;
+    case IrInstructionType::Sgt: {
+        return "sgt";
+    } break;
+    case IrInstructionType::Sge: {
+        return "sge";
+    } break;
+    case IrInstructionType::Ult: {
+        return "ult";
+    } break;
+    case IrInstructionType::Ule: {
+        return "ule";
+    } break;
+    case IrInstructionType::Ugt: {
+        return "ugt";
+    } break;
+    case IrInstructionType::Uge: {
+        return "uge";
+    } break;
+    default: {
+        std::printf("ICE: No LLVM opcode for instruction type %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+LlvmGen::LlvmGen(IrModule* _module) {
+    this->module         = _module;
+    this->temporaryCount = 0;
+}
+LlvmGen::~LlvmGen() {
+}
+void LlvmGen::emit(const char* format, ...) {
+    va_list args;
+    va_list copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    int length = std::vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    std::string line(length, '\0');
+    std::vsnprintf(line.data(), length + 1, format, args);
+    va_end(args);
+    this->assembly += line;
+}
+void LlvmGen::generate() {
+    this->assembly.clear();
+    for (IrObject* obj : this->module->objects) {
+        this->emitObject(obj);
+    }
+    for (IrFunction* func : this->module->functions) {
+        this->emit("\n");
+        if (func->blocks.empty()) {
+            this->emitDeclaration(func);
+        } else {
+            this->emitFunction(func);
+        }
+    }
+    for (IrFunction* func : this->module->functions) {
+        if (func->name == "main" && !func->blocks.empty() && !func->noMangle) {
+            this->emitEntryPoint(func);
+        }
+    }
+}
+std::string LlvmGen::getAssembly() {
+    return this->assembly;
+}
+void LlvmGen::emitObject(IrObject* obj) {
+    if (obj->value.type != IrOperandType::Const) {
+        std::printf("TODO: Initializer of global `%s` is not a constant\n", obj->name.c_str());
+        std::exit(1);
+    }
+    this->emit("@%s = %sglobal %s %s\n", obj->getSymbolName().c_str(), getLinkage(obj->noMangle),
+               getTypeName(obj->type).c_str(), getConstant(obj->type, obj->value.constant).c_str());
+}
+void LlvmGen::emitDeclaration(IrFunction* func) {
+    this->emit("declare %s @%s(", getTypeName(func->returnType).c_str(),
+               func->getSymbolName().c_str());
+    for (size_t i = 0; i < func->arguments.size(); ++i) {
+        this->emit("%s%s", i ? ", " : "", getTypeName(func->arguments.at(i)->valueType).c_str());
+    }
+    this->emit(")\n");
+}
+void LlvmGen::emitFunction(IrFunction* func) {
+    this->temporaryCount = 0;
+    this->emit("define %s%s @%s(", getLinkage(func->noMangle),
+               getTypeName(func->returnType).c_str(), func->getSymbolName().c_str());
+    for (size_t i = 0; i < func->arguments.size(); ++i) {
+        IrArgument* arg = func->arguments.at(i);
+        this->emit("%s%s %%v%u", i ? ", " : "", getTypeName(arg->valueType).c_str(), arg->number);
+    }
+    this->emit(")%s%s {\n", func->alwaysInline ? " alwaysinline" : "",
+               func->noInline ? " noinline" : "");
+    for (IrBlock* block : func->blocks) {
+        this->emit("bb%u:\n", block->number);
+        for (IrInstruction* inst : block->insts) {
+            this->emitInstruction(inst);
+        }
+    }
+    this->emit("}\n");
+}
+// `lli` and the C start files call the external `main`, a mangled `main` is called from there.
+void LlvmGen::emitEntryPoint(IrFunction* func) {
+    std::string name = func->getSymbolName();
+    this->emit("\ndefine i32 @main() {\n");
+    switch (func->returnType.type) {
+    case IrTypeType::Void: {
+        this->emit("  call void @%s()\n", name.c_str());
+        this->emit("  ret i32 0\n");
+    } break;
+    case IrTypeType::I32: {
+        this->emit("  %%t0 = call i32 @%s()\n", name.c_str());
+        this->emit("  ret i32 %%t0\n");
+    } break;
+    default: {
+        std::string type = getTypeName(func->returnType);
+        this->emit("  %%t0 = call %s @%s()\n", type.c_str(), name.c_str());
+        this->emit("  %%t1 = trunc %s %%t0 to i32\n", type.c_str());
+        this->emit("  ret i32 %%t1\n");
+    } break;
+    }
+    this->emit("}\n");
+}
+std::string LlvmGen::getValue(IrOperand& operand) {
+    switch (operand.type) {
+    case IrOperandType::Const: {
+        return getConstant(operand.irType, operand.constant);
+    } break;
+    case IrOperandType::SSA: {
+        IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+        if (operand.value->kind == IrValueKind::Instruction &&
+            inst->type == IrInstructionType::Const) {
+            return getConstant(inst->valueType, inst->getOperand(0).constant);
+        }
+        return "%v" + std::to_string(operand.value->number);
+    } break;
+    case IrOperandType::Global: {
+        return "@" + operand.object->getSymbolName();
+    } break;
+    default: {
+        std::printf("TODO: LLVM value for operand type %llu\n", operand.type);
+        std::exit(1);
+    } break;
+    }
+}
+// `type*` operand for a memory access of `type`. Slots and globals already point to their own
+// type, other pointers are cast first.
+std::string LlvmGen::getPointer(IrOperand& pointer, IrType type) {
+    std::string value   = this->getValue(pointer);
+    std::string pointee = "i8";
+    if (pointer.type == IrOperandType::Global) {
+        pointee = getTypeName(pointer.object->type);
+    } else if (pointer.type == IrOperandType::SSA &&
+               pointer.value->kind == IrValueKind::Instruction &&
+               static_cast<IrInstruction*>(pointer.value)->type == IrInstructionType::Reserve) {
+        pointee = getTypeName(static_cast<IrInstruction*>(pointer.value)->getOperand(0).irType);
+    }
+    std::string typeName = getTypeName(type);
+    if (pointee == typeName) {
+        return typeName + "* " + value;
+    }
+    std::string temporary = "%t" + std::to_string(this->temporaryCount++);
+    this->emit("  %s = bitcast %s* %s to %s*\n", temporary.c_str(), pointee.c_str(),
+               value.c_str(), typeName.c_str());
+    return typeName + "* " + temporary;
+}
+void LlvmGen::emitInstruction(IrInstruction* inst) {
+    switch (inst->type) {
+    case IrInstructionType::Reserve: {
+        this->emit("  %%v%u = alloca %s\n", inst->number,
+                   getTypeName(inst->getOperand(0).irType).c_str());
+    } break;
+    case IrInstructionType::Store: {
+        IrOperand&  value   = inst->getOperand(1);
+        std::string pointer = this->getPointer(inst->getOperand(0), value.irType);
+        this->emit("  store %s %s, %s\n", getTypeName(value.irType).c_str(),
+                   this->getValue(value).c_str(), pointer.c_str());
+    } break;
+    case IrInstructionType::Load: {
+        std::string pointer = this->getPointer(inst->getOperand(0), inst->valueType);
+        this->emit("  %%v%u = load %s, %s\n", inst->number, getTypeName(inst->valueType).c_str(),
+                   pointer.c_str());
+    } break;
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        this->emitCast(inst);
+    } break;
+    case IrInstructionType::Const: {
+    } break;
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem:
+    case IrInstructionType::And: {
+        this->emit("  %%v%u = %s %s %s, %s\n", inst->number, getOpcode(inst->type),
+                   getTypeName(inst->valueType).c_str(),
+                   this->getValue(inst->getOperand(0)).c_str(),
+                   this->getValue(inst->getOperand(1)).c_str());
+    } break;
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge: {
+        this->emit("  %%c%u = icmp %s %s %s, %s\n", inst->number, getOpcode(inst->type),
+                   getTypeName(inst->getOperand(0).irType).c_str(),
+                   this->getValue(inst->getOperand(0)).c_str(),
+                   this->getValue(inst->getOperand(1)).c_str());
+        this->emit("  %%v%u = zext i1 %%c%u to i32\n", inst->number, inst->number);
+    } break;
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr: {
+        this->emitShift(inst);
+    } break;
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh: {
+        this->emitMultiplyHigh(inst);
+    } break;
+    case IrInstructionType::Phi: {
+        this->emit("  %%v%u = phi %s ", inst->number, getTypeName(inst->valueType).c_str());
+        for (size_t i = 0; i + 1 < inst->numOperands; i += 2) {
+            this->emit("%s[ %s, %%bb%u ]", i ? ", " : "",
+                       this->getValue(inst->getOperand(i)).c_str(),
+                       inst->getOperand(i + 1).block->number);
+        }
+        this->emit("\n");
+    } break;
+    case IrInstructionType::Call: {
+        this->emitCall(inst);
+    } break;
+    case IrInstructionType::Return: {
+        IrOperand& value = inst->getOperand(0);
+        if (value.type == IrOperandType::Type) {
+            this->emit("  ret void\n");
+        } else {
+            this->emit("  ret %s %s\n", getTypeName(inst->parent->parent->returnType).c_str(),
+                       this->getValue(value).c_str());
+        }
+    } break;
+    case IrInstructionType::Br: {
+        this->emit("  br label %%bb%u\n", inst->getOperand(0).block->number);
+    } break;
+    case IrInstructionType::CondBr: {
+        IrOperand&  condition = inst->getOperand(0);
+        std::string temporary = "%t" + std::to_string(this->temporaryCount++);
+        this->emit("  %s = icmp ne %s %s, 0\n", temporary.c_str(),
+                   getTypeName(condition.irType).c_str(), this->getValue(condition).c_str());
+        this->emit("  br i1 %s, label %%bb%u, label %%bb%u\n", temporary.c_str(),
+                   inst->getOperand(1).block->number, inst->getOperand(2).block->number);
+    } break;
+    default: {
+        std::printf("TODO: LLVM lowering of instruction type %llu\n", inst->type);
+        std::exit(1);
+    } break;
+    }
+}
+void LlvmGen::emitCast(IrInstruction* inst) {
+    IrOperand&  operand = inst->getOperand(0);
+    IrType      from    = operand.irType;
+    IrType      to      = inst->valueType;
+    const char* opcode  = "bitcast";
+    if (from.type == IrTypeType::Pointer && to.type != IrTypeType::Pointer) {
+        opcode = "ptrtoint";
+    } else if (from.type != IrTypeType::Pointer && to.type == IrTypeType::Pointer) {
+        opcode = "inttoptr";
+    } else if (getBitWidth(from) > getBitWidth(to)) {
+        opcode = "trunc";
+    } else if (getBitWidth(from) < getBitWidth(to)) {
+        opcode = inst->type == IrInstructionType::Sext ? "sext" : "zext";
+    }
+    this->emit("  %%v%u = %s %s %s to %s\n", inst->number, opcode, getTypeName(from).c_str(),
+               this->getValue(operand).c_str(), getTypeName(to).c_str());
+}
+// A shift by the width or more is poison in LLVM, the IR takes the amount modulo the width.
+void LlvmGen::emitShift(IrInstruction* inst) {
+    std::string type      = getTypeName(inst->valueType);
+    std::string temporary = "%t" + std::to_string(this->temporaryCount++);
+    this->emit("  %s = and %s %s, %u\n", temporary.c_str(), type.c_str(),
+               this->getValue(inst->getOperand(1)).c_str(), getBitWidth(inst->valueType) - 1);
+    this->emit("  %%v%u = %s %s %s, %s\n", inst->number, getOpcode(inst->type), type.c_str(),
+               this->getValue(inst->getOperand(0)).c_str(), temporary.c_str());
+}
+// The product is computed at twice the width and its upper half taken.
+void LlvmGen::emitMultiplyHigh(IrInstruction* inst) {
+    uint32_t    width     = getBitWidth(inst->valueType);
+    std::string type      = getTypeName(inst->valueType);
+    std::string wideType  = "i" + std::to_string(2 * width);
+    const char* extension = inst->type == IrInstructionType::Smulh ? "sext" : "zext";
+    std::string operands[2];
+    for (size_t i = 0; i < 2; ++i) {
+        operands[i] = "%t" + std::to_string(this->temporaryCount++);
+        this->emit("  %s = %s %s %s to %s\n", operands[i].c_str(), extension, type.c_str(),
+                   this->getValue(inst->getOperand(i)).c_str(), wideType.c_str());
+    }
+    std::string product = "%t" + std::to_string(this->temporaryCount++);
+    std::string high    = "%t" + std::to_string(this->temporaryCount++);
+    this->emit("  %s = mul %s %s, %s\n", product.c_str(), wideType.c_str(), operands[0].c_str(),
+               operands[1].c_str());
+    this->emit("  %s = lshr %s %s, %u\n", high.c_str(), wideType.c_str(), product.c_str(), width);
+    this->emit("  %%v%u = trunc %s %s to %s\n", inst->number, wideType.c_str(), high.c_str(),
+               type.c_str());
+}
+void LlvmGen::emitCall(IrInstruction* inst) {
+    IrFunction* callee = inst->getOperand(0).function;
+    std::string args;
+    for (size_t i = 1; i < inst->numOperands; ++i) {
+        if (i > 1) {
+            args += ", ";
+        }
+        args += getTypeName(callee->arguments.at(i - 1)->valueType) + " " +
+                this->getValue(inst->getOperand(i));
+    }
+    if (inst->hasResult) {
+        this->emit("  %%v%u = call %s @%s(%s)\n", inst->number,
+                   getTypeName(callee->returnType).c_str(), callee->getSymbolName().c_str(),
+                   args.c_str());
+    } else {
+        this->emit("  call void @%s(%s)\n", callee->getSymbolName().c_str(), args.c_str());
+    }
+}
+}; // namespace language
@@ -1,18 +1,47 @@
+#include <cerrno>
+#include <cgen.h>
 #include <clopts.h>
 #include <cstdio>
+#include <cstring>
+#include <elfobject.h>
 #include <execinfo.h>
 #include <filesystem>
+#include <interpreter.h>
+#include <irfile.h>
 #include <irgen.h>
+#include <jit.h>
+#include <linker.h>
+#include <llvmgen.h>
 #include <parser.h>
+#include <passmanager.h>
 #include <sema.h>
 #include <string>
+#include <threadpool.h>
 #include <unistd.h>
+#include <x86asm.h>
+#include <x86gen.h>
 
 using namespace command_line_opts;
-std::string inputFile;
-std::string outputFile;
-bool        dumpAst;
-bool        dumpIr;
+enum struct EmitTarget {
+    Asm,
+    Llvm,
+    C,
+    Ir,
+    Object,
+    Executable,
+};
+std::string              inputFile;
+std::vector<std::string> objectFiles;
+std::string              outputFile;
+bool                     dumpAst;
+bool                     dumpIr;
+bool                     dumpAsm;
+bool                     timePasses;
+bool                     runJit;
+bool                     interpret;
+language::OptLevel       optLevel = language::OptLevel::O0;
+std::string              inlineThreshold;
+EmitTarget               emitTarget = EmitTarget::Asm;
 
 void handleWarnings(std::string warning) {
     std::printf("TODO warning: %s\n", warning.c_str());
@@ -29,12 +58,84 @@ void handleDump(std::string tree) {
         dumpAst = true;
     } else if (tree == "ir") {
         dumpIr = true;
+    } else if (tree == "asm") {
+        dumpAsm = true;
     } else {
         std::fprintf(stderr, "Invalid tree to dump `%s`\n", tree.c_str());
         std::exit(1);
     }
 }
+void setEmitTarget(std::string target) {
+    if (target == "asm") {
+        emitTarget = EmitTarget::Asm;
+    } else if (target == "llvm") {
+        emitTarget = EmitTarget::Llvm;
+    } else if (target == "c") {
+        emitTarget = EmitTarget::C;
+    } else if (target == "ir") {
+        emitTarget = EmitTarget::Ir;
+    } else if (target == "obj") {
+        emitTarget = EmitTarget::Object;
+    } else if (target == "exe") {
+        emitTarget = EmitTarget::Executable;
+    } else {
+        std::fprintf(stderr, "Invalid emit target `%s`\n", target.c_str());
+        std::exit(1);
+    }
+}
+void setOptLevel(std::string level) {
+    if (level == "0") {
+        optLevel = language::OptLevel::O0;
+    } else if (level == "1") {
+        optLevel = language::OptLevel::O1;
+    } else if (level == "2") {
+        optLevel = language::OptLevel::O2;
+    } else if (level == "s") {
+        optLevel = language::OptLevel::Os;
+    } else {
+        std::fprintf(stderr, "Invalid optimization level `-O%s`\n", level.c_str());
+        std::exit(1);
+    }
+}
+void handleTime(std::string what) {
+    if (what == "passes") {
+        timePasses = true;
+    } else {
+        std::fprintf(stderr, "Invalid thing to time `%s`\n", what.c_str());
+        std::exit(1);
+    }
+}
+void setThreadCount(std::string count) {
+    if (count.find_first_not_of("0123456789") != std::string::npos || std::stoull(count) == 0) {
+        std::fprintf(stderr, "Invalid thread count `-j%s`\n", count.c_str());
+        std::exit(1);
+    }
+    language::ThreadPool::setDefaultThreadCount(std::stoull(count));
+}
+void setInlineThreshold(std::string threshold) {
+    size_t digits = threshold.front() == '-' ? 1 : 0;
+    if (digits == threshold.size() ||
+        threshold.find_first_not_of("0123456789", digits) != std::string::npos) {
+        std::fprintf(stderr, "Invalid inline threshold `%s`\n", threshold.c_str());
+        std::exit(1);
+    }
+    inlineThreshold = threshold;
+}
+// Flags without a value never reach the option handlers, clopts only calls those with a value.
 int unknownArg(std::string path) {
+    if (path == "--run") {
+        runJit = true;
+        return 0;
+    }
+    if (path == "--interpret") {
+        interpret = true;
+        return 0;
+    }
+    // Objects are only linked in, the module comes from the one source or IR file.
+    if (std::filesystem::exists(path) && language::isElfFile(path)) {
+        objectFiles.push_back(path);
+        return 0;
+    }
     if (std::filesystem::exists(path)) {
         if (!inputFile.empty()) {
             std::fprintf(stderr, "Cannot have multiple input files yet\n");
@@ -45,9 +146,15 @@ int unknownArg(std::string path) {
     }
     return 1;
 }
-clopts_opt_t clopts = {
-    {{"-W", handleWarnings, false}, {"-o", setOutput, true}, {"-dump-", handleDump, false}},
-    unknownArg};
+clopts_opt_t clopts = {{{"-W", handleWarnings, false},
+                        {"-o", setOutput, true},
+                        {"-O", setOptLevel, false},
+                        {"-dump-", handleDump, false},
+                        {"-emit=", setEmitTarget, false},
+                        {"-time-", handleTime, false},
+                        {"-inline-threshold=", setInlineThreshold, false},
+                        {"-j", setThreadCount, false}},
+                       unknownArg};
 
 void printStacktrace() {
     void*  buffer[100];
@@ -63,19 +170,113 @@ void printStacktrace() {
 
 int main(int argc, char** argv) {
     std::atexit(printStacktrace);
-    std::string contents;
     clopts.parse(argc, argv);
-    contents                 = clopts.handleFile(inputFile);
-    language::Lexer*  lexer  = new language::Lexer(contents);
-    language::Parser* parser = new language::Parser(lexer);
-    language::Sema*   sema   = new language::Sema(parser->getAst());
-    language::Ast*    ast    = sema->getNewAst();
-    if (dumpAst) {
-        ast->print();
-    }
-    language::IrGen*    irgen   = new language::IrGen(ast);
-    language::IrModule* _module = irgen->getModule();
+    if (!objectFiles.empty() && emitTarget != EmitTarget::Executable) {
+        std::fprintf(stderr, "Object files can only be linked with -emit=exe\n");
+        std::exit(1);
+    }
+    language::IrModule* _module;
+    if (language::isIrFile(inputFile)) {
+        language::IrReader* reader = new language::IrReader(inputFile);
+        reader->materializeAll();
+        _module = reader->getModule();
+    } else {
+        std::string       contents = clopts.handleFile(inputFile);
+        language::Lexer*  lexer    = new language::Lexer(contents);
+        language::Parser* parser   = new language::Parser(lexer);
+        language::Sema*   sema     = new language::Sema(parser->getAst());
+        language::Ast*    ast      = sema->getNewAst();
+        if (dumpAst) {
+            ast->print();
+        }
+        language::IrGen* irgen = new language::IrGen(ast);
+        _module                = irgen->getModule();
+    }
+    language::PassManager passManager(_module);
+    passManager.addPipeline(optLevel);
+    if (!inlineThreshold.empty()) {
+        passManager.setInlineThreshold(std::stoll(inlineThreshold));
+    }
+    passManager.run();
+    if (timePasses) {
+        passManager.printTimings();
+    }
     if (dumpIr) {
         _module->print();
     }
+    if (runJit) {
+        language::Jit jit(&passManager);
+        jit.compile();
+        return jit.run();
+    }
+    if (interpret) {
+        language::IrInterpreter interpreter(_module);
+        return interpreter.run();
+    }
+    if (!dumpAsm && outputFile.empty()) {
+        return 0;
+    }
+    if (emitTarget == EmitTarget::Ir) {
+        if (!outputFile.empty()) {
+            language::IrWriter writer(_module);
+            writer.write(outputFile);
+        }
+        return 0;
+    }
+    if (emitTarget == EmitTarget::Object || emitTarget == EmitTarget::Executable) {
+        language::X86Gen x86gen(&passManager);
+        x86gen.generate();
+        if (dumpAsm) {
+            std::printf("%s", x86gen.getAssembly().c_str());
+        }
+        if (outputFile.empty()) {
+            return 0;
+        }
+        language::X86Assembler assembler(x86gen.getAssembly());
+        assembler.assemble();
+        language::ElfObject* object = new language::ElfObject(&assembler, inputFile);
+        if (emitTarget == EmitTarget::Object) {
+            object->write(outputFile);
+            return 0;
+        }
+        // crt1.o calls `main` by its C name.
+        for (language::IrFunction* func : _module->functions) {
+            if (func->name == "main" && !func->blocks.empty() && func->getSymbolName() != "main") {
+                object->addAlias("main", func->getSymbolName());
+            }
+        }
+        language::Linker linker;
+        linker.addObject(object);
+        for (std::string& path : objectFiles) {
+            linker.addObject(new language::ElfObject(path));
+        }
+        linker.link(outputFile);
+        return 0;
+    }
+    std::string assembly;
+    if (emitTarget == EmitTarget::Llvm) {
+        language::LlvmGen llvmgen(_module);
+        llvmgen.generate();
+        assembly = llvmgen.getAssembly();
+    } else if (emitTarget == EmitTarget::C) {
+        language::CGen cgen(_module);
+        cgen.generate();
+        assembly = cgen.getSource();
+    } else {
+        language::X86Gen x86gen(&passManager);
+        x86gen.generate();
+        assembly = x86gen.getAssembly();
+    }
+    if (dumpAsm) {
+        std::printf("%s", assembly.c_str());
+    }
+    if (!outputFile.empty()) {
+        std::FILE* f = std::fopen(outputFile.c_str(), "wb");
+        if (!f) {
+            std::fprintf(stderr, "%s `%s`\n", std::strerror(errno), outputFile.c_str());
+            std::exit(1);
+        }
+        std::fwrite(assembly.data(), 1, assembly.size(), f);
+        std::fclose(f);
+    }
 }
\ No newline at end of file
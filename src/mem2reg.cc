@@ -0,0 +1,226 @@
+#include <cstdio>
+#include <cstdlib>
+#include <passes.h>
+#include <unordered_map>
+
+namespace language {
+// A slot can be promoted when its address is only ever used as the pointer of loads and stores of
+// exactly the reserved type.
+static bool isPromotable(IrInstruction* slot) {
+    IrType slotType = slot->getOperand(0).irType;
+    for (IrUse* use = slot->firstUse; use; use = use->nextUse) {
+        IrInstruction* user  = use->user;
+        size_t         index = use->getOperandIndex();
+        if (user->type == IrInstructionType::Load && index == 0 && user->valueType == slotType) {
+            continue;
+        }
+        if (user->type == IrInstructionType::Store && index == 0 &&
+            user->getOperand(1).irType == slotType) {
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+static IrValue* getPromotedSlot(IrInstruction* inst,
+                                std::unordered_map<IrValue*, size_t>& slotIndex) {
+    if (inst->type != IrInstructionType::Load && inst->type != IrInstructionType::Store) {
+        return nullptr;
+    }
+    IrValue* pointer = inst->getOperandValue(0);
+    return pointer && slotIndex.contains(pointer) ? pointer : nullptr;
+}
+bool promoteMemoryToRegisters(IrFunction* func, IrAnalysisCache* analyses) {
+    if (func->blocks.empty()) {
+        return false;
+    }
+    IrBlock*                             entry = func->getEntryBlock();
+    std::vector<IrInstruction*>          slots;
+    std::unordered_map<IrValue*, size_t> slotIndex;
+    for (IrInstruction* inst : entry->insts) {
+        if (inst->type == IrInstructionType::Reserve && isPromotable(inst)) {
+            slotIndex.insert({inst, slots.size()});
+            slots.push_back(inst);
+        }
+    }
+    if (slots.empty()) {
+        return false;
+    }
+    IrCFG*           cfg     = analyses->getCFG();
+    IrDominatorTree* domTree = analyses->getDominatorTree();
+
+    // Reads of a slot before any store see zero, one constant per type is enough.
+    std::unordered_map<IrTypeType, IrInstruction*> zeros;
+    auto getZero = [&](IrType type) -> IrValue* {
+        if (!zeros.contains(type.type)) {
+            IrInstruction* zero = func->createInstruction(IrInstructionType::Const, true,
+                                                          {createConstOperand(type, 0)});
+            entry->insertBefore(entry->getTerminator(), zero);
+            zeros.insert({type.type, zero});
+        }
+        return zeros.at(type.type);
+    };
+
+    std::unordered_map<IrInstruction*, size_t> phiSlot;
+    std::vector<IrInstruction*>                phis;
+    for (size_t s = 0; s < slots.size(); ++s) {
+        std::vector<IrBlock*> worklist;
+        std::vector<bool>     hasPhi(func->nextBlockNumber, false);
+        std::vector<bool>     queued(func->nextBlockNumber, false);
+        for (IrUse* use = slots.at(s)->firstUse; use; use = use->nextUse) {
+            IrBlock* block = use->user->parent;
+            if (use->user->type == IrInstructionType::Store && !queued.at(block->number) &&
+                cfg->isReachable(block)) {
+                queued.at(block->number) = true;
+                worklist.push_back(block);
+            }
+        }
+        while (!worklist.empty()) {
+            IrBlock* block = worklist.back();
+            worklist.pop_back();
+            for (IrBlock* frontier : domTree->getFrontier(block)) {
+                if (hasPhi.at(frontier->number)) {
+                    continue;
+                }
+                std::vector<IrBlock*>& preds = cfg->getPredecessors(frontier);
+                IrInstruction*         phi =
+                    func->createInstruction(IrInstructionType::Phi, true, preds.size() * 2);
+                phi->valueType = slots.at(s)->getOperand(0).irType;
+                for (size_t i = 0; i < preds.size(); ++i) {
+                    phi->setOperand(i * 2 + 1, createLabelOperand(preds.at(i)));
+                }
+                frontier->insertBefore(frontier->insts.front(), phi);
+                phiSlot.insert({phi, s});
+                phis.push_back(phi);
+                hasPhi.at(frontier->number) = true;
+                if (!queued.at(frontier->number)) {
+                    queued.at(frontier->number) = true;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+
+    // Rename along the dominator tree. `current` holds the reaching definition of every slot and
+    // `undo` remembers what to restore when leaving a subtree.
+    std::vector<IrValue*>                    current(slots.size(), nullptr);
+    std::vector<std::pair<size_t, IrValue*>> undo;
+    auto setCurrent = [&](size_t s, IrValue* value) {
+        undo.push_back({s, current.at(s)});
+        current.at(s) = value;
+    };
+    auto reaching = [&](size_t s) -> IrValue* {
+        return current.at(s) ? current.at(s) : getZero(slots.at(s)->getOperand(0).irType);
+    };
+    auto fillPhis = [&](IrBlock* pred, IrBlock* succ, bool reachable) {
+        for (IrInstruction* inst : succ->insts) {
+            if (inst->type != IrInstructionType::Phi) {
+                break;
+            }
+            if (!phiSlot.contains(inst)) {
+                continue;
+            }
+            size_t s = phiSlot.at(inst);
+            for (size_t i = 0; i < inst->numOperands / 2; ++i) {
+                if (inst->getOperand(i * 2 + 1).block == pred &&
+                    inst->getOperand(i * 2).type == IrOperandType::Type) {
+                    inst->setOperandValue(i * 2,
+                                          reachable ? reaching(s) : getZero(inst->valueType));
+                }
+            }
+        }
+    };
+    auto renameBlock = [&](IrBlock* block, bool reachable) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Phi && phiSlot.contains(inst)) {
+                setCurrent(phiSlot.at(inst), inst);
+                continue;
+            }
+            IrValue* slot = getPromotedSlot(inst, slotIndex);
+            if (!slot) {
+                continue;
+            }
+            size_t s = slotIndex.at(slot);
+            if (inst->type == IrInstructionType::Load) {
+                inst->replaceAllUsesWith(reachable ? reaching(s) : getZero(inst->valueType));
+            } else {
+                setCurrent(s, inst->getOperandValue(1));
+            }
+            inst->eraseFromParent();
+        }
+        for (IrBlock* succ : cfg->getSuccessors(block)) {
+            fillPhis(block, succ, reachable);
+        }
+    };
+    std::vector<std::pair<IrBlock*, size_t>> stack;
+    std::vector<size_t>                      undoMarks;
+    stack.push_back({entry, 0});
+    undoMarks.push_back(undo.size());
+    renameBlock(entry, true);
+    while (!stack.empty()) {
+        IrBlock* block = stack.back().first;
+        size_t   index = stack.back().second;
+        if (index < domTree->getChildren(block).size()) {
+            stack.back().second++;
+            IrBlock* child = domTree->getChildren(block).at(index);
+            stack.push_back({child, 0});
+            undoMarks.push_back(undo.size());
+            renameBlock(child, true);
+            continue;
+        }
+        while (undo.size() > undoMarks.back()) {
+            current.at(undo.back().first) = undo.back().second;
+            undo.pop_back();
+        }
+        undoMarks.pop_back();
+        stack.pop_back();
+    }
+    for (IrBlock* block : func->blocks) {
+        if (!cfg->isReachable(block)) {
+            renameBlock(block, false);
+        }
+    }
+    for (IrInstruction* slot : slots) {
+        slot->eraseFromParent();
+    }
+
+    // Phis are placed without liveness information, drop the ones nothing ends up reading.
+    std::vector<IrInstruction*>              worklist;
+    std::unordered_map<IrInstruction*, bool> live;
+    for (IrInstruction* phi : phis) {
+        for (IrUse* use = phi->firstUse; use; use = use->nextUse) {
+            if (use->user->type != IrInstructionType::Phi || !phiSlot.contains(use->user)) {
+                live[phi] = true;
+                worklist.push_back(phi);
+                break;
+            }
+        }
+    }
+    while (!worklist.empty()) {
+        IrInstruction* phi = worklist.back();
+        worklist.pop_back();
+        for (size_t i = 0; i < phi->numOperands; i += 2) {
+            IrValue* value = phi->getOperandValue(i);
+            if (!value || value->kind != IrValueKind::Instruction) {
+                continue;
+            }
+            IrInstruction* operand = static_cast<IrInstruction*>(value);
+            if (phiSlot.contains(operand) && !live[operand]) {
+                live[operand] = true;
+                worklist.push_back(operand);
+            }
+        }
+    }
+    for (IrInstruction* phi : phis) {
+        if (!live[phi]) {
+            phi->dropOperands();
+        }
+    }
+    for (IrInstruction* phi : phis) {
+        if (!live[phi]) {
+            phi->removeFromParent();
+        }
+    }
+    return true;
+}
+}; // namespace language
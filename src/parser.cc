@@ -61,7 +61,9 @@ Token* Parser::expect(std::vector<TokenType> types, bool advance) {
 }
 static bool isBinaryOp(TokenType type) {
     if (type == TokenType::Plus || type == TokenType::Minus || type == TokenType::Star ||
-        type == TokenType::Percent || type == TokenType::EqualEqual) {
+        type == TokenType::Slash || type == TokenType::Percent || type == TokenType::EqualEqual ||
+        type == TokenType::NotEqual || type == TokenType::Less || type == TokenType::LessEqual ||
+        type == TokenType::Greater || type == TokenType::GreaterEqual) {
         return true;
     }
     return false;
@@ -75,11 +77,18 @@ static bool isUnaryOp(TokenType type) {
 static size_t getPrecedence(TokenType type) {
     switch (type) {
     case TokenType::EqualEqual:
+    case TokenType::NotEqual:
         return 8;
+    case TokenType::Less:
+    case TokenType::LessEqual:
+    case TokenType::Greater:
+    case TokenType::GreaterEqual:
+        return 9;
     case TokenType::Plus:
     case TokenType::Minus:
         return 11;
     case TokenType::Percent:
+    case TokenType::Slash:
     case TokenType::Star:
         return 12;
     default:
@@ -131,6 +140,34 @@ StatementNode* Parser::parseIfStatement() {
     return new IfStatementNode(condition, trueBody,
                                falseBody ? std::make_optional(falseBody) : std::nullopt);
 }
+StatementNode* Parser::parseWhileStatement() {
+    this->advance();
+    this->expect(TokenType::Openparen, true);
+    ExpressionNode* condition = this->parseExpression();
+    this->expect(TokenType::Closeparen, true);
+    return new WhileStatementNode(condition, this->parseStatement());
+}
+StatementNode* Parser::parseForStatement() {
+    this->advance();
+    this->expect(TokenType::Openparen, true);
+    std::optional<StatementNode*> init;
+    if (this->getCurrentToken()->get_type() == TokenType::Semicolon) {
+        this->advance();
+    } else {
+        init = this->parseStatement();
+    }
+    std::optional<ExpressionNode*> condition;
+    if (this->getCurrentToken()->get_type() != TokenType::Semicolon) {
+        condition = this->parseExpression();
+    }
+    this->expect(TokenType::Semicolon, true);
+    std::optional<ExpressionNode*> step;
+    if (this->getCurrentToken()->get_type() != TokenType::Closeparen) {
+        step = this->parseExpression();
+    }
+    this->expect(TokenType::Closeparen, true);
+    return new ForStatementNode(init, condition, step, this->parseStatement());
+}
 StatementNode* Parser::parseReturnStatement() {
     this->advance();
     ExpressionNode* expr = this->parseExpression();
@@ -150,6 +187,12 @@ StatementNode* Parser::parseStatement() {
     case TokenType::If: {
         return this->parseIfStatement();
     } break;
+    case TokenType::While: {
+        return this->parseWhileStatement();
+    } break;
+    case TokenType::For: {
+        return this->parseForStatement();
+    } break;
     case TokenType::Openbrace: {
         return this->parseCompoundStatement();
     } break;
@@ -323,6 +366,8 @@ std::vector<std::pair<AttributeType, std::string>> attribToName{
     {AttributeType::Public, "public"},
     {AttributeType::Private, "private"},
     {AttributeType::NoMangle, "no_mangle"},
+    {AttributeType::Inline, "inline"},
+    {AttributeType::NoInline, "noinline"},
 };
 AttributeType getAttribType(std::string name) {
     for (std::pair<AttributeType, std::string> attrib : attribToName) {
@@ -487,7 +532,13 @@ DeclarationNode* Parser::parseFuncDecl() {
     } else {
         returnType = this->parseTypeSpecWithColon();
     }
-    StatementNode* body = this->parseStatement();
+    // A declaration without a body names a function defined outside of the module.
+    StatementNode* body = nullptr;
+    if (this->getCurrentToken()->get_type() == TokenType::Semicolon) {
+        this->advance();
+    } else {
+        body = this->parseStatement();
+    }
     return new FunctionDeclarationNode(name, attrs, params, returnType, body);
 }
 std::vector<DeclarationNode*> Parser::parseDecl() {
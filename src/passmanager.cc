@@ -0,0 +1,254 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <passes.h>
+#include <passmanager.h>
+
+namespace language {
+static size_t countInstructions(IrModule* module) {
+    size_t count = 0;
+    for (IrFunction* func : module->functions) {
+        count += func->getInstructionCount();
+    }
+    return count;
+}
+static size_t countBlocks(IrModule* module) {
+    size_t count = 0;
+    for (IrFunction* func : module->functions) {
+        count += func->blocks.size();
+    }
+    return count;
+}
+// Passes that can be named on their own, `lng-opt -passes=` builds its pipeline from these.
+static const PassInfo namedPasses[] = {
+    {"mem2reg", promoteMemoryToRegisters, nullptr, true},
+    {"sccp", propagateConstants, nullptr, false},
+    {"instcombine", combineInstructions, nullptr, true},
+    {"strengthreduce", reduceStrength, nullptr, true},
+    {"simplifycfg", simplifyCFG, nullptr, false},
+    {"tailcallelim", eliminateTailCalls, nullptr, false},
+    {"licm", hoistLoopInvariants, nullptr, false},
+    {"gvn", numberValues, nullptr, true},
+    {"dce", eliminateDeadCode, nullptr, true},
+    {"inline", nullptr, inlineFunctions, false},
+};
+
+PassManager::PassManager(IrModule* _module) {
+    this->module = _module;
+    this->level  = OptLevel::O0;
+    this->pool   = new ThreadPool(ThreadPool::getDefaultThreadCount());
+}
+PassManager::~PassManager() {
+    for (auto& [func, cache] : this->analyses) {
+        delete cache;
+    }
+    delete this->pool;
+}
+void PassManager::addFunctionPass(const char* name, FunctionPassFn fn, bool preservesCFG) {
+    this->passes.push_back({name, fn, nullptr, preservesCFG});
+}
+void PassManager::addModulePass(const char* name, ModulePassFn fn) {
+    this->passes.push_back({name, nullptr, fn, false});
+}
+bool PassManager::addPass(std::string name) {
+    for (const PassInfo& pass : namedPasses) {
+        if (name == pass.name) {
+            this->passes.push_back(pass);
+            return true;
+        }
+    }
+    return false;
+}
+void PassManager::addPipeline(OptLevel _level) {
+    this->level = _level;
+    if (_level == OptLevel::O0) {
+        return;
+    }
+    this->addFunctionPass("mem2reg", promoteMemoryToRegisters, true);
+    this->addFunctionPass("sccp", propagateConstants, false);
+    this->addFunctionPass("instcombine", combineInstructions, true);
+    this->addFunctionPass("simplifycfg", simplifyCFG, false);
+    this->addFunctionPass("tailcallelim", eliminateTailCalls, false);
+    this->addFunctionPass("gvn", numberValues, true);
+    this->addFunctionPass("dce", eliminateDeadCode, true);
+    // Callees are simplified before they are costed.
+    this->addModulePass("inline", inlineFunctions);
+    switch (_level) {
+    case OptLevel::O0: {
+    } break;
+    // One round is enough to clean up after the inliner when compile time matters more.
+    case OptLevel::O1: {
+        this->addFunctionPass("strengthreduce", reduceStrength, true);
+        this->addFunctionPass("simplifycfg", simplifyCFG, false);
+        this->addFunctionPass("dce", eliminateDeadCode, true);
+    } break;
+    // The inlined copies get another round. A division by a constant that is not a power of two
+    // takes more bytes as a multiplication than as a `div`, -Os keeps those.
+    case OptLevel::O2:
+    case OptLevel::Os: {
+        this->addFunctionPass("sccp", propagateConstants, false);
+        this->addFunctionPass("instcombine", combineInstructions, true);
+        if (_level == OptLevel::Os) {
+            this->addFunctionPass("strengthreduce", reduceStrengthForSize, true);
+        } else {
+            this->addFunctionPass("strengthreduce", reduceStrength, true);
+        }
+        // Loop preheaders left empty by licm are cleaned up again by simplifycfg.
+        this->addFunctionPass("licm", hoistLoopInvariants, false);
+        this->addFunctionPass("simplifycfg", simplifyCFG, false);
+        this->addFunctionPass("gvn", numberValues, true);
+        this->addFunctionPass("dce", eliminateDeadCode, true);
+    } break;
+    }
+}
+IrModule* PassManager::getModule() {
+    return this->module;
+}
+OptLevel PassManager::getOptLevel() {
+    return this->level;
+}
+void PassManager::setInlineThreshold(int64_t threshold) {
+    this->inlineThreshold = threshold;
+}
+// Largest cost a call site may have and still be inlined. Unless overridden on the command line
+// it follows the level, -Os only inlines what is about as small as the call it replaces.
+int64_t PassManager::getInlineThreshold() {
+    if (this->inlineThreshold.has_value()) {
+        return this->inlineThreshold.value();
+    }
+    switch (this->level) {
+    case OptLevel::O0: {
+        return 0;
+    } break;
+    case OptLevel::O1: {
+        return 15;
+    } break;
+    case OptLevel::O2: {
+        return 45;
+    } break;
+    case OptLevel::Os: {
+        return 3;
+    } break;
+    }
+    return 0;
+}
+ThreadPool* PassManager::getThreadPool() {
+    return this->pool;
+}
+IrAnalysisCache* PassManager::getAnalyses(IrFunction* func) {
+    std::lock_guard<std::mutex> lock(this->analysesMutex);
+    auto                        it = this->analyses.find(func);
+    if (it != this->analyses.end()) {
+        return it->second;
+    }
+    IrAnalysisCache* cache = new IrAnalysisCache(func);
+    this->analyses.insert({func, cache});
+    return cache;
+}
+void PassManager::invalidate(IrFunction* func) {
+    std::lock_guard<std::mutex> lock(this->analysesMutex);
+    auto                        it = this->analyses.find(func);
+    if (it != this->analyses.end()) {
+        it->second->invalidate();
+    }
+}
+bool PassManager::run() {
+    this->timings.clear();
+    size_t i = 0;
+    while (i < this->passes.size()) {
+        if (this->passes.at(i).function) {
+            size_t last = i;
+            while (last < this->passes.size() && this->passes.at(last).function) {
+                last++;
+            }
+            this->runFunctionPasses(i, last);
+            i = last;
+            continue;
+        }
+        PassTiming timing;
+        timing.instsBefore  = countInstructions(this->module);
+        timing.blocksBefore = countBlocks(this->module);
+        timing.changed      = 0;
+        auto start          = std::chrono::steady_clock::now();
+        if (this->passes.at(i).module(this->module, this)) {
+            timing.changed++;
+        }
+        auto elapsed       = std::chrono::steady_clock::now() - start;
+        timing.nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        timing.instsAfter  = countInstructions(this->module);
+        timing.blocksAfter = countBlocks(this->module);
+        this->timings.push_back(timing);
+        i++;
+    }
+    bool changedAny = false;
+    for (PassTiming& timing : this->timings) {
+        changedAny |= timing.changed != 0;
+    }
+    return changedAny;
+}
+// Runs the function passes `first` up to `last` on every function. Each function records its own
+// numbers per pass, they are added up in module order once all functions are done.
+void PassManager::runFunctionPasses(size_t first, size_t last) {
+    std::vector<IrFunction*>& functions = this->module->functions;
+    size_t                    count     = last - first;
+    std::vector<PassTiming>   perFunction(functions.size() * count);
+    this->pool->parallelFor(functions.size(), [&](size_t index) {
+        IrFunction*      func  = functions.at(index);
+        IrAnalysisCache* cache = this->getAnalyses(func);
+        for (size_t i = 0; i < count; ++i) {
+            PassInfo&   pass   = this->passes.at(first + i);
+            PassTiming& timing = perFunction.at(index * count + i);
+            timing.instsBefore  = func->getInstructionCount();
+            timing.blocksBefore = func->blocks.size();
+            timing.changed      = 0;
+            auto start          = std::chrono::steady_clock::now();
+            if (pass.function(func, cache)) {
+                timing.changed = 1;
+                if (pass.preservesCFG) {
+                    cache->invalidateLiveness();
+                } else {
+                    cache->invalidate();
+                }
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            timing.nanoseconds =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+            timing.instsAfter  = func->getInstructionCount();
+            timing.blocksAfter = func->blocks.size();
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        PassTiming total = {0, 0, 0, 0, 0, 0};
+        for (size_t index = 0; index < functions.size(); ++index) {
+            PassTiming& timing = perFunction.at(index * count + i);
+            total.nanoseconds += timing.nanoseconds;
+            total.instsBefore += timing.instsBefore;
+            total.instsAfter += timing.instsAfter;
+            total.blocksBefore += timing.blocksBefore;
+            total.blocksAfter += timing.blocksAfter;
+            total.changed += timing.changed;
+        }
+        this->timings.push_back(total);
+    }
+}
+void PassManager::printTimings() {
+    uint64_t total = 0;
+    std::fprintf(stderr, "=== Pass timings ===\n");
+    std::fprintf(stderr, "%-20s %12s %22s %18s %8s\n", "pass", "time (ms)", "instructions",
+                 "blocks", "changed");
+    for (size_t i = 0; i < this->passes.size() && i < this->timings.size(); ++i) {
+        PassTiming& timing = this->timings.at(i);
+        long long   delta  = (long long)timing.instsAfter - (long long)timing.instsBefore;
+        char        insts[48];
+        char        blocks[48];
+        std::snprintf(insts, sizeof(insts), "%zu -> %zu (%+lld)", timing.instsBefore,
+                      timing.instsAfter, delta);
+        std::snprintf(blocks, sizeof(blocks), "%zu -> %zu", timing.blocksBefore,
+                      timing.blocksAfter);
+        std::fprintf(stderr, "%-20s %12.3f %22s %18s %8zu\n", this->passes.at(i).name,
+                     timing.nanoseconds / 1e6, insts, blocks, timing.changed);
+        total += timing.nanoseconds;
+    }
+    std::fprintf(stderr, "%-20s %12.3f\n", "total", total / 1e6);
+}
+}; // namespace language
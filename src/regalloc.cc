@@ -0,0 +1,686 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <regalloc.h>
+
+namespace language {
+static constexpr uint32_t MAX_POSITION = UINT32_MAX;
+
+bool Location::operator==(const Location& other) const {
+    if (this->kind != other.kind) {
+        return false;
+    }
+    switch (this->kind) {
+    case LocationKind::Register:
+    case LocationKind::Stack: {
+        return this->index == other.index;
+    } break;
+    case LocationKind::Constant: {
+        return this->constant == other.constant;
+    } break;
+    default: {
+        return true;
+    } break;
+    }
+}
+uint32_t LiveInterval::getStart() {
+    return this->ranges.front().from;
+}
+uint32_t LiveInterval::getEnd() {
+    return this->ranges.back().to;
+}
+bool LiveInterval::covers(uint32_t position) {
+    for (LiveRange& range : this->ranges) {
+        if (position < range.from) {
+            return false;
+        }
+        if (position < range.to) {
+            return true;
+        }
+    }
+    return false;
+}
+// First position both intervals are live at.
+uint32_t LiveInterval::nextIntersection(LiveInterval* other) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < this->ranges.size() && j < other->ranges.size()) {
+        LiveRange& a = this->ranges.at(i);
+        LiveRange& b = other->ranges.at(j);
+        if (a.to <= b.from) {
+            i++;
+        } else if (b.to <= a.from) {
+            j++;
+        } else {
+            return std::max(a.from, b.from);
+        }
+    }
+    return MAX_POSITION;
+}
+uint32_t LiveInterval::nextRegisterUse(uint32_t position) {
+    for (UsePosition& use : this->uses) {
+        if (use.position >= position && use.needsRegister) {
+            return use.position;
+        }
+    }
+    return MAX_POSITION;
+}
+static bool isRematerializable(LiveInterval* interval) {
+    return interval->value && interval->value->kind == IrValueKind::Instruction &&
+           static_cast<IrInstruction*>(interval->value)->type == IrInstructionType::Const;
+}
+IrRegisterAllocation::IrRegisterAllocation(IrFunction* _func, IrAnalysisCache* _analyses,
+                                           RegisterInfo* _info) {
+    this->func          = _func;
+    this->analyses      = _analyses;
+    this->info          = _info;
+    this->nextSpillSlot = 0;
+    this->usedRegisters.assign(_info->count, false);
+    if (_func->blocks.empty()) {
+        return;
+    }
+    this->numberInstructions();
+    this->buildIntervals();
+    this->allocate();
+    this->resolve();
+}
+IrRegisterAllocation::~IrRegisterAllocation() {
+    for (LiveInterval* interval : this->intervals) {
+        if (!interval) {
+            continue;
+        }
+        for (LiveInterval* child : interval->children) {
+            delete child;
+        }
+        delete interval;
+    }
+    for (LiveInterval* interval : this->fixedIntervals) {
+        delete interval;
+    }
+}
+// Blocks are laid out in reverse post order. Every block gets a label position, then two positions
+// per instruction, phis share the label position.
+void IrRegisterAllocation::numberInstructions() {
+    this->order = this->analyses->getCFG()->getReversePostOrder();
+    this->blockStart.assign(this->func->nextBlockNumber, 0);
+    this->positions.clear();
+    uint32_t position = 0;
+    for (IrBlock* block : this->order) {
+        this->blockStart.at(block->number) = position;
+        position += 2;
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Phi) {
+                this->positions[inst] = this->blockStart.at(block->number);
+                continue;
+            }
+            this->positions[inst] = position;
+            position += 2;
+        }
+    }
+}
+bool IrRegisterAllocation::needsLocation(IrValue* value) {
+    if (value->kind == IrValueKind::Argument) {
+        return true;
+    }
+    IrInstruction* inst = static_cast<IrInstruction*>(value);
+    return inst->hasResult && inst->type != IrInstructionType::Reserve;
+}
+IrBlock* IrRegisterAllocation::getBlockAt(uint32_t position) {
+    size_t low  = 0;
+    size_t high = this->order.size();
+    while (high - low > 1) {
+        size_t middle = (low + high) / 2;
+        if (this->blockStart.at(this->order.at(middle)->number) <= position) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return this->order.at(low);
+}
+uint32_t IrRegisterAllocation::getBlockEnd(IrBlock* block) {
+    IrInstruction* terminator = block->insts.back();
+    return this->positions.at(terminator) + 2;
+}
+// Walks the blocks backwards. Values live out of a block are live in all of it until their
+// definition shortens the range, uses extend it back to the start of the block.
+void IrRegisterAllocation::buildIntervals() {
+    IrLiveness* liveness = this->analyses->getLiveness();
+    this->intervals.assign(this->func->nextValueNumber, nullptr);
+    auto getInterval = [&](IrValue* value) {
+        LiveInterval*& interval = this->intervals.at(value->number);
+        if (!interval) {
+            interval          = new LiveInterval;
+            interval->value   = value;
+            interval->parent  = nullptr;
+            interval->reg     = -1;
+            interval->spilled = false;
+            interval->fixed   = false;
+        }
+        return interval;
+    };
+    // Ranges come in backwards, so they are collected in descending order and reversed at the end.
+    auto addRange = [&](IrValue* value, uint32_t from, uint32_t to) {
+        std::vector<LiveRange>& ranges = getInterval(value)->ranges;
+        if (!ranges.empty() && ranges.back().from <= to) {
+            ranges.back().from = std::min(ranges.back().from, from);
+            ranges.back().to   = std::max(ranges.back().to, to);
+        } else {
+            ranges.push_back({from, to});
+        }
+    };
+    auto define = [&](IrValue* value, uint32_t position) {
+        LiveInterval* interval = getInterval(value);
+        if (interval->ranges.empty()) {
+            interval->ranges.push_back({position, position + 1});
+        } else {
+            interval->ranges.back().from = position;
+        }
+    };
+    std::vector<uint32_t> calls;
+    for (auto it = this->order.rbegin(); it != this->order.rend(); ++it) {
+        IrBlock* block = *it;
+        uint32_t from  = this->blockStart.at(block->number);
+        for (IrValue* value : liveness->getLiveOut(block)) {
+            if (this->needsLocation(value)) {
+                addRange(value, from, this->getBlockEnd(block));
+            }
+        }
+        for (IrInstruction* inst = block->insts.back(); inst; inst = inst->prev) {
+            if (inst->type == IrInstructionType::Phi) {
+                define(inst, from);
+                continue;
+            }
+            uint32_t position = this->positions.at(inst);
+            if (this->needsLocation(inst)) {
+                define(inst, position);
+            }
+            if (inst->type == IrInstructionType::Call) {
+                calls.push_back(position);
+            }
+            // Calls and returns move their operands into fixed registers, anything else wants
+            // them in a register of their own.
+            bool needsRegister =
+                inst->type != IrInstructionType::Call && inst->type != IrInstructionType::Return;
+            for (size_t i = 0; i < inst->numOperands; ++i) {
+                IrValue* value = inst->getOperandValue(i);
+                if (!value || !this->needsLocation(value)) {
+                    continue;
+                }
+                addRange(value, from, position);
+                getInterval(value)->uses.push_back({position, needsRegister});
+            }
+        }
+    }
+    for (LiveInterval* interval : this->intervals) {
+        if (interval) {
+            std::reverse(interval->ranges.begin(), interval->ranges.end());
+            std::reverse(interval->uses.begin(), interval->uses.end());
+        }
+    }
+    // Calls clobber every caller saved register for the position of the call.
+    if (calls.empty()) {
+        return;
+    }
+    std::reverse(calls.begin(), calls.end());
+    for (uint32_t reg = 0; reg < this->info->count; ++reg) {
+        if (!this->info->callerSaved.at(reg)) {
+            continue;
+        }
+        LiveInterval* interval = new LiveInterval;
+        interval->value        = nullptr;
+        interval->parent       = nullptr;
+        interval->reg          = reg;
+        interval->spilled      = false;
+        interval->fixed        = true;
+        for (uint32_t call : calls) {
+            interval->ranges.push_back({call, call + 1});
+        }
+        this->fixedIntervals.push_back(interval);
+    }
+}
+// Unhandled intervals are kept sorted by descending start, the next one to allocate is at the back.
+void IrRegisterAllocation::addUnhandled(LiveInterval* interval) {
+    auto position = std::upper_bound(this->unhandled.begin(), this->unhandled.end(), interval,
+                                     [](LiveInterval* a, LiveInterval* b) {
+                                         return a->getStart() > b->getStart();
+                                     });
+    this->unhandled.insert(position, interval);
+}
+LiveInterval* IrRegisterAllocation::split(LiveInterval* interval, uint32_t position) {
+    LiveInterval* child = new LiveInterval;
+    child->value        = interval->value;
+    child->parent       = interval->parent ? interval->parent : interval;
+    child->reg          = -1;
+    child->spilled      = false;
+    child->fixed        = false;
+    child->parent->children.push_back(child);
+    std::vector<LiveRange> head;
+    for (LiveRange& range : interval->ranges) {
+        if (range.to <= position) {
+            head.push_back(range);
+        } else if (range.from >= position) {
+            child->ranges.push_back(range);
+        } else {
+            head.push_back({range.from, position});
+            child->ranges.push_back({position, range.to});
+        }
+    }
+    interval->ranges = head;
+    std::vector<UsePosition> headUses;
+    for (UsePosition& use : interval->uses) {
+        if (use.position < position) {
+            headUses.push_back(use);
+        } else {
+            child->uses.push_back(use);
+        }
+    }
+    interval->uses = headUses;
+    return child;
+}
+// The latest block boundary in (minPosition, maxPosition] of least loop depth, or maxPosition when
+// there is no boundary in between that is less deeply nested.
+uint32_t IrRegisterAllocation::findSplitPosition(uint32_t minPosition, uint32_t maxPosition) {
+    if (minPosition >= maxPosition) {
+        return maxPosition;
+    }
+    IrLoopInfo* loopInfo  = this->analyses->getLoopInfo();
+    IrBlock*    minBlock  = this->getBlockAt(minPosition - 1);
+    IrBlock*    maxBlock  = this->getBlockAt(maxPosition - 1);
+    uint32_t    best      = maxPosition;
+    uint32_t    bestDepth = loopInfo->getLoopDepth(maxBlock);
+    for (IrBlock* block = maxBlock; block != minBlock;) {
+        uint32_t depth = loopInfo->getLoopDepth(block);
+        if (depth < bestDepth) {
+            best      = this->blockStart.at(block->number);
+            bestDepth = depth;
+        }
+        block = this->getBlockAt(this->blockStart.at(block->number) - 1);
+    }
+    return best;
+}
+// Moves inside a block go between two instructions, at an odd position, so that they cannot
+// overwrite the operands of the next instruction. The position after a terminator belongs to the
+// start of the next block, where the moves go on the edges instead.
+uint32_t IrRegisterAllocation::normalizeSplitPosition(uint32_t position) {
+    if (this->blockStart.at(this->getBlockAt(position)->number) == position) {
+        return position;
+    }
+    if (position % 2 == 0) {
+        return position - 1;
+    }
+    IrBlock* next = this->getBlockAt(position + 1);
+    return this->blockStart.at(next->number) == position + 1 ? position + 1 : position;
+}
+bool IrRegisterAllocation::tryAllocateFreeRegister(LiveInterval* current) {
+    std::vector<uint32_t> freeUntil(this->info->count, MAX_POSITION);
+    for (LiveInterval* interval : this->active) {
+        freeUntil.at(interval->reg) = 0;
+    }
+    for (LiveInterval* interval : this->inactive) {
+        uint32_t intersection = interval->nextIntersection(current);
+        freeUntil.at(interval->reg) = std::min(freeUntil.at(interval->reg), intersection);
+    }
+    // Staying in the register of the piece before a split saves a move.
+    int32_t hint = -1;
+    if (current->parent) {
+        for (LiveInterval* sibling : current->parent->children) {
+            if (sibling->reg >= 0 && sibling->getEnd() == current->getStart()) {
+                hint = sibling->reg;
+            }
+        }
+        if (current->parent->reg >= 0 && current->parent->getEnd() == current->getStart()) {
+            hint = current->parent->reg;
+        }
+    }
+    uint32_t reg = 0;
+    for (uint32_t i = 1; i < this->info->count; ++i) {
+        if (freeUntil.at(i) > freeUntil.at(reg)) {
+            reg = i;
+        }
+    }
+    if (hint >= 0 && freeUntil.at(hint) >= current->getEnd()) {
+        reg = hint;
+    }
+    uint32_t start = current->getStart();
+    if (freeUntil.at(reg) <= start + 1) {
+        return false;
+    }
+    if (freeUntil.at(reg) < current->getEnd()) {
+        uint32_t position =
+            this->normalizeSplitPosition(this->findSplitPosition(start + 1, freeUntil.at(reg)));
+        if (position <= start) {
+            return false;
+        }
+        if (position < current->getEnd()) {
+            this->addUnhandled(this->split(current, position));
+        }
+    }
+    current->reg = reg;
+    return true;
+}
+// The piece of `interval` in memory goes back to the unhandled list from just before its next use
+// that needs a register.
+void IrRegisterAllocation::spill(LiveInterval* interval) {
+    interval->reg     = -1;
+    interval->spilled = true;
+    uint32_t start    = interval->getStart();
+    uint32_t use      = interval->nextRegisterUse(start);
+    if (use == MAX_POSITION) {
+        return;
+    }
+    uint32_t position = this->normalizeSplitPosition(this->findSplitPosition(start + 1, use - 1));
+    if (position > start && position < interval->getEnd()) {
+        this->addUnhandled(this->split(interval, position));
+    } else {
+        interval->spilled = false;
+        this->addUnhandled(interval);
+    }
+}
+// Takes the register away from `interval` from `position` on.
+void IrRegisterAllocation::spillFrom(LiveInterval* interval, uint32_t position) {
+    position = this->normalizeSplitPosition(position);
+    if (position > interval->getStart() && position < interval->getEnd()) {
+        this->spill(this->split(interval, position));
+    } else if (position <= interval->getStart()) {
+        this->spill(interval);
+    }
+}
+// No register is free for all of `current`. The register whose intervals are used again last is
+// taken from them, unless `current` itself is used even later, then it goes to memory until its
+// first use. Constants count as never used again, reloading one is a single move of an immediate.
+void IrRegisterAllocation::allocateBlockedRegister(LiveInterval* current) {
+    uint32_t              start = current->getStart();
+    std::vector<uint32_t> usePosition(this->info->count, MAX_POSITION);
+    std::vector<uint32_t> blockPosition(this->info->count, MAX_POSITION);
+    auto                  nextUse = [&](LiveInterval* interval) {
+        return isRematerializable(interval) ? MAX_POSITION - 1 : interval->nextRegisterUse(start);
+    };
+    for (LiveInterval* interval : this->active) {
+        uint32_t reg = interval->reg;
+        if (interval->fixed) {
+            usePosition.at(reg)   = 0;
+            blockPosition.at(reg) = 0;
+        } else {
+            usePosition.at(reg) = std::min(usePosition.at(reg), nextUse(interval));
+        }
+    }
+    for (LiveInterval* interval : this->inactive) {
+        uint32_t intersection = interval->nextIntersection(current);
+        uint32_t reg          = interval->reg;
+        if (intersection == MAX_POSITION) {
+            continue;
+        }
+        if (interval->fixed) {
+            usePosition.at(reg)   = std::min(usePosition.at(reg), intersection);
+            blockPosition.at(reg) = std::min(blockPosition.at(reg), intersection);
+        } else {
+            usePosition.at(reg) = std::min(usePosition.at(reg), nextUse(interval));
+        }
+    }
+    uint32_t reg = 0;
+    for (uint32_t i = 1; i < this->info->count; ++i) {
+        if (usePosition.at(i) > usePosition.at(reg)) {
+            reg = i;
+        }
+    }
+    uint32_t firstUse = current->nextRegisterUse(start);
+    if (usePosition.at(reg) < firstUse || usePosition.at(reg) <= start + 1) {
+        this->spill(current);
+        return;
+    }
+    current->reg = reg;
+    if (blockPosition.at(reg) < current->getEnd()) {
+        uint32_t position = this->normalizeSplitPosition(
+            this->findSplitPosition(start + 1, blockPosition.at(reg)));
+        if (position > start && position < current->getEnd()) {
+            this->addUnhandled(this->split(current, position));
+        }
+    }
+    std::vector<LiveInterval*> evicted;
+    for (size_t i = 0; i < this->active.size();) {
+        LiveInterval* interval = this->active.at(i);
+        if (!interval->fixed && interval->reg == (int32_t)reg) {
+            evicted.push_back(interval);
+            this->active.erase(this->active.begin() + i);
+            continue;
+        }
+        i++;
+    }
+    for (size_t i = 0; i < this->inactive.size();) {
+        LiveInterval* interval = this->inactive.at(i);
+        if (!interval->fixed && interval->reg == (int32_t)reg &&
+            interval->nextIntersection(current) != MAX_POSITION) {
+            evicted.push_back(interval);
+            this->inactive.erase(this->inactive.begin() + i);
+            continue;
+        }
+        i++;
+    }
+    for (LiveInterval* interval : evicted) {
+        this->spillFrom(interval, start);
+    }
+}
+void IrRegisterAllocation::allocate() {
+    for (LiveInterval* interval : this->intervals) {
+        if (interval) {
+            this->addUnhandled(interval);
+        }
+    }
+    this->inactive = this->fixedIntervals;
+    while (!this->unhandled.empty()) {
+        LiveInterval* current = this->unhandled.back();
+        this->unhandled.pop_back();
+        uint32_t position = current->getStart();
+        for (size_t i = 0; i < this->active.size();) {
+            LiveInterval* interval = this->active.at(i);
+            if (interval->getEnd() <= position || !interval->covers(position)) {
+                this->active.erase(this->active.begin() + i);
+                if (interval->getEnd() > position) {
+                    this->inactive.push_back(interval);
+                }
+                continue;
+            }
+            i++;
+        }
+        for (size_t i = 0; i < this->inactive.size();) {
+            LiveInterval* interval = this->inactive.at(i);
+            if (interval->getEnd() <= position || interval->covers(position)) {
+                this->inactive.erase(this->inactive.begin() + i);
+                if (interval->getEnd() > position) {
+                    this->active.push_back(interval);
+                }
+                continue;
+            }
+            i++;
+        }
+        if (!this->tryAllocateFreeRegister(current)) {
+            this->allocateBlockedRegister(current);
+        }
+        if (current->reg >= 0) {
+            this->usedRegisters.at(current->reg) = true;
+            this->active.push_back(current);
+        }
+    }
+}
+LiveInterval* IrRegisterAllocation::getIntervalAt(IrValue* value, uint32_t position) {
+    LiveInterval* interval = this->intervals.at(value->number);
+    if (interval && interval->covers(position)) {
+        return interval;
+    }
+    for (LiveInterval* child : interval ? interval->children : std::vector<LiveInterval*>()) {
+        if (child->covers(position)) {
+            return child;
+        }
+    }
+    std::printf("ICE: Value #%u is not live at position %u\n", value->number, position);
+    std::exit(1);
+}
+Location IrRegisterAllocation::getLocation(LiveInterval* interval) {
+    if (interval->reg >= 0) {
+        return {LocationKind::Register, (uint32_t)interval->reg, 0};
+    }
+    if (!interval->spilled) {
+        std::printf("ICE: Interval of #%u was never allocated\n", interval->value->number);
+        std::exit(1);
+    }
+    if (isRematerializable(interval)) {
+        IrInstruction* inst = static_cast<IrInstruction*>(interval->value);
+        return {LocationKind::Constant, 0, inst->getOperand(0).constant};
+    }
+    int64_t& slot = this->spillSlots.at(interval->value->number);
+    if (slot < 0) {
+        slot = this->nextSpillSlot++;
+    }
+    return {LocationKind::Stack, (uint32_t)slot, 0};
+}
+// A rematerialized constant is recreated wherever it is read, nothing is ever moved into it.
+static bool needsMove(Location from, Location to) {
+    return !(from == to) && to.kind != LocationKind::Constant;
+}
+static uint64_t getEdgeKey(IrBlock* pred, IrBlock* succ) {
+    return (uint64_t)pred->number << 32 | succ->number;
+}
+// Pieces of an interval that continue right where the previous one ended inside a block need a
+// move there. On every edge the values live into the successor, and the phis of the successor,
+// move from where they are at the end of the predecessor to where the successor expects them.
+void IrRegisterAllocation::resolve() {
+    this->spillSlots.assign(this->func->nextValueNumber, -1);
+    for (LiveInterval* interval : this->intervals) {
+        if (!interval) {
+            continue;
+        }
+        for (LiveInterval* child : interval->children) {
+            uint32_t position = child->getStart();
+            if (this->blockStart.at(this->getBlockAt(position)->number) == position) {
+                continue;
+            }
+            Location from = this->getLocation(this->getIntervalAt(interval->value, position - 1));
+            Location to   = this->getLocation(child);
+            if (needsMove(from, to)) {
+                this->splitMoves[position].push_back({from, to, interval->value->valueType});
+            }
+        }
+    }
+    IrLiveness* liveness = this->analyses->getLiveness();
+    for (IrBlock* pred : this->order) {
+        uint32_t              end = this->getBlockEnd(pred) - 2;
+        std::vector<IrBlock*> succs;
+        for (IrBlock* succ : pred->getSuccessors()) {
+            if (std::find(succs.begin(), succs.end(), succ) == succs.end()) {
+                succs.push_back(succ);
+            }
+        }
+        for (IrBlock* succ : succs) {
+            uint32_t             start = this->blockStart.at(succ->number);
+            std::vector<RegMove> moves;
+            for (IrValue* value : liveness->getLiveIn(succ)) {
+                if (!this->needsLocation(value)) {
+                    continue;
+                }
+                Location from = this->getLocation(this->getIntervalAt(value, end));
+                Location to   = this->getLocation(this->getIntervalAt(value, start));
+                if (needsMove(from, to)) {
+                    moves.push_back({from, to, value->valueType});
+                }
+            }
+            for (IrInstruction* phi : succ->insts) {
+                if (phi->type != IrInstructionType::Phi) {
+                    break;
+                }
+                Location to = this->getLocation(this->getIntervalAt(phi, start));
+                for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+                    if (phi->getOperand(i + 1).block != pred) {
+                        continue;
+                    }
+                    IrOperand& incoming = phi->getOperand(i);
+                    Location   from     = {LocationKind::Constant, 0, incoming.constant};
+                    if (incoming.type == IrOperandType::SSA) {
+                        from = this->getLocation(this->getIntervalAt(incoming.value, end));
+                    }
+                    if (needsMove(from, to)) {
+                        moves.push_back({from, to, phi->valueType});
+                    }
+                    break;
+                }
+            }
+            if (!moves.empty()) {
+                this->edgeMoves[getEdgeKey(pred, succ)] = moves;
+            }
+        }
+    }
+}
+std::vector<IrBlock*>& IrRegisterAllocation::getBlockOrder() {
+    return this->order;
+}
+Location IrRegisterAllocation::getInputLocation(IrValue* value, IrInstruction* user) {
+    if (!this->needsLocation(value)) {
+        return {LocationKind::None, 0, 0};
+    }
+    return this->getLocation(this->getIntervalAt(value, this->positions.at(user) - 1));
+}
+Location IrRegisterAllocation::getOutputLocation(IrValue* value) {
+    if (!this->needsLocation(value) || !this->intervals.at(value->number)) {
+        return {LocationKind::None, 0, 0};
+    }
+    uint32_t position = 0;
+    if (value->kind == IrValueKind::Instruction) {
+        position = this->positions.at(static_cast<IrInstruction*>(value));
+    }
+    return this->getLocation(this->getIntervalAt(value, position));
+}
+// Moves to run right before `inst`.
+std::vector<RegMove>& IrRegisterAllocation::getMovesBefore(IrInstruction* inst) {
+    auto it = this->splitMoves.find(this->positions.at(inst) - 1);
+    return it == this->splitMoves.end() ? this->noMoves : it->second;
+}
+std::vector<RegMove> IrRegisterAllocation::getEdgeMoves(IrBlock* pred, IrBlock* succ) {
+    auto it = this->edgeMoves.find(getEdgeKey(pred, succ));
+    return it == this->edgeMoves.end() ? std::vector<RegMove>() : it->second;
+}
+uint32_t IrRegisterAllocation::getSpillSlotCount() {
+    return this->nextSpillSlot;
+}
+bool IrRegisterAllocation::isRegisterUsed(uint32_t reg) {
+    return this->usedRegisters.at(reg);
+}
+static void printLocation(Location location) {
+    switch (location.kind) {
+    case LocationKind::Register: {
+        std::printf("r%u", location.index);
+    } break;
+    case LocationKind::Stack: {
+        std::printf("slot %u", location.index);
+    } break;
+    case LocationKind::Constant: {
+        std::printf("const %lld", (long long)location.constant);
+    } break;
+    default: {
+        std::printf("none");
+    } break;
+    }
+}
+void IrRegisterAllocation::print() {
+    std::printf("Register allocation of `%s`, %u spill slots:\n", this->func->name.c_str(),
+                this->nextSpillSlot);
+    for (LiveInterval* interval : this->intervals) {
+        if (!interval) {
+            continue;
+        }
+        std::vector<LiveInterval*> pieces = {interval};
+        pieces.insert(pieces.end(), interval->children.begin(), interval->children.end());
+        std::sort(pieces.begin(), pieces.end(),
+                  [](LiveInterval* a, LiveInterval* b) { return a->getStart() < b->getStart(); });
+        std::printf("  #%u:", interval->value->number);
+        for (LiveInterval* piece : pieces) {
+            for (LiveRange& range : piece->ranges) {
+                std::printf(" [%u, %u)", range.from, range.to);
+            }
+            std::printf(" ");
+            printLocation(this->getLocation(piece));
+            std::printf(";");
+        }
+        std::printf("\n");
+    }
+}
+}; // namespace language
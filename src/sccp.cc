@@ -0,0 +1,453 @@
+#include <cstdio>
+#include <cstdlib>
+#include <passes.h>
+#include <unordered_set>
+
+namespace language {
+enum struct LatticeState : uint8_t {
+    Undefined,
+    Constant,
+    Overdefined,
+};
+struct LatticeValue {
+    LatticeState state;
+    int64_t      constant;
+    bool         operator==(const LatticeValue& other) const {
+        return this->state == other.state &&
+               (this->state != LatticeState::Constant || this->constant == other.constant);
+    }
+};
+static LatticeValue overdefined() {
+    return {LatticeState::Overdefined, 0};
+}
+static LatticeValue constant(IrType type, int64_t value) {
+    // i32 values are kept sign extended so equal bit patterns compare equal.
+    if (type.type == IrTypeType::I32) {
+        value = static_cast<int32_t>(value);
+    }
+    return {LatticeState::Constant, value};
+}
+static LatticeValue meet(LatticeValue a, LatticeValue b) {
+    if (a.state == LatticeState::Undefined) {
+        return b;
+    }
+    if (b.state == LatticeState::Undefined || a == b) {
+        return a;
+    }
+    return overdefined();
+}
+// Division by zero and the one signed division that overflows are left to run, whatever they do.
+static bool canFoldBinary(IrInstructionType type, IrType valueType, int64_t lhs, int64_t rhs) {
+    if (type != IrInstructionType::Sdiv && type != IrInstructionType::Udiv &&
+        type != IrInstructionType::Srem && type != IrInstructionType::Urem) {
+        return true;
+    }
+    int64_t min = valueType.type == IrTypeType::I32 ? INT32_MIN : INT64_MIN;
+    return rhs != 0 && !((type == IrInstructionType::Sdiv || type == IrInstructionType::Srem) &&
+                         lhs == min && rhs == -1);
+}
+// Operands are sign extended lattice values, unsigned operations of i32s look at the low half.
+static int64_t foldBinary(IrInstructionType type, IrType valueType, int64_t lhs, int64_t rhs) {
+    bool     wide  = valueType.type != IrTypeType::I32;
+    uint64_t a     = wide ? (uint64_t)lhs : (uint32_t)lhs;
+    uint64_t b     = wide ? (uint64_t)rhs : (uint32_t)rhs;
+    uint32_t shift = rhs & (wide ? 63 : 31);
+    switch (type) {
+    case IrInstructionType::Add: {
+        return a + b;
+    } break;
+    case IrInstructionType::Sub: {
+        return a - b;
+    } break;
+    case IrInstructionType::Mul: {
+        return a * b;
+    } break;
+    case IrInstructionType::Sdiv: {
+        return lhs / rhs;
+    } break;
+    case IrInstructionType::Udiv: {
+        return a / b;
+    } break;
+    case IrInstructionType::Srem: {
+        return lhs % rhs;
+    } break;
+    case IrInstructionType::Urem: {
+        return a % b;
+    } break;
+    case IrInstructionType::Smulh: {
+        if (!wide) {
+            return (lhs * rhs) >> 32;
+        }
+        return ((__int128)lhs * rhs) >> 64;
+    } break;
+    case IrInstructionType::Umulh: {
+        if (!wide) {
+            return (a * b) >> 32;
+        }
+        return ((unsigned __int128)a * b) >> 64;
+    } break;
+    case IrInstructionType::And: {
+        return a & b;
+    } break;
+    case IrInstructionType::Shl: {
+        return a << shift;
+    } break;
+    case IrInstructionType::Lshr: {
+        return a >> shift;
+    } break;
+    case IrInstructionType::Ashr: {
+        return lhs >> shift;
+    } break;
+    default: {
+        std::printf("ICE: Cannot fold binary instruction %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+// Operands are sign extended lattice values, unsigned comparisons of i32s look at the low half.
+static int64_t foldCompare(IrInstructionType type, IrType operandType, int64_t lhs, int64_t rhs) {
+    uint64_t a = lhs;
+    uint64_t b = rhs;
+    if (operandType.type == IrTypeType::I32) {
+        a = static_cast<uint32_t>(lhs);
+        b = static_cast<uint32_t>(rhs);
+    }
+    switch (type) {
+    case IrInstructionType::Eq: {
+        return lhs == rhs;
+    } break;
+    case IrInstructionType::Ne: {
+        return lhs != rhs;
+    } break;
+    case IrInstructionType::Slt: {
+        return lhs < rhs;
+    } break;
+    case IrInstructionType::Sle: {
+        return lhs <= rhs;
+    } break;
+    case IrInstructionType::Sgt: {
+        return lhs > rhs;
+    } break;
+    case IrInstructionType::Sge: {
+        return lhs >= rhs;
+    } break;
+    case IrInstructionType::Ult: {
+        return a < b;
+    } break;
+    case IrInstructionType::Ule: {
+        return a <= b;
+    } break;
+    case IrInstructionType::Ugt: {
+        return a > b;
+    } break;
+    case IrInstructionType::Uge: {
+        return a >= b;
+    } break;
+    default: {
+        std::printf("ICE: Cannot fold comparison %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+static int64_t foldCast(IrInstructionType type, IrType from, int64_t value) {
+    switch (type) {
+    case IrInstructionType::Trunc: {
+        return static_cast<int32_t>(value);
+    } break;
+    case IrInstructionType::Sext: {
+        return from.type == IrTypeType::I32 ? static_cast<int32_t>(value) : value;
+    } break;
+    case IrInstructionType::Zext: {
+        return from.type == IrTypeType::I32 ? static_cast<uint32_t>(value) : value;
+    } break;
+    default: {
+        std::printf("ICE: Cannot fold cast instruction %llu\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+// Wegman-Zadeck: values start out undefined and only ever move down the lattice, blocks and CFG
+// edges start out unreachable and are only marked executable once a visited terminator can take
+// them.
+struct SCCPSolver {
+    IrFunction*                  func;
+    IrCFG*                       cfg;
+    std::vector<LatticeValue>    values;
+    std::vector<bool>            executable;
+    std::unordered_set<uint64_t> executableEdges;
+    std::vector<IrBlock*>        blockWorklist;
+    std::vector<IrInstruction*>  instWorklist;
+
+    LatticeValue get(IrOperand& operand) {
+        switch (operand.type) {
+        case IrOperandType::Const: {
+            return constant(operand.irType, operand.constant);
+        } break;
+        case IrOperandType::SSA: {
+            return this->values.at(operand.value->number);
+        } break;
+        default: {
+            return overdefined();
+        } break;
+        }
+    }
+    void update(IrInstruction* inst, LatticeValue value) {
+        if (this->values.at(inst->number) == value) {
+            return;
+        }
+        this->values.at(inst->number) = value;
+        for (IrUse* use = inst->firstUse; use; use = use->nextUse) {
+            this->instWorklist.push_back(use->user);
+        }
+    }
+    bool isEdgeExecutable(IrBlock* from, IrBlock* to) {
+        return this->executableEdges.contains((uint64_t)from->number << 32 | to->number);
+    }
+    void markEdge(IrBlock* from, IrBlock* to) {
+        if (!this->executableEdges.insert((uint64_t)from->number << 32 | to->number).second) {
+            return;
+        }
+        if (!this->executable.at(to->number)) {
+            this->executable.at(to->number) = true;
+            this->blockWorklist.push_back(to);
+            return;
+        }
+        // Only the phis can see the new edge.
+        for (IrInstruction* inst : to->insts) {
+            if (inst->type != IrInstructionType::Phi) {
+                break;
+            }
+            this->visit(inst);
+        }
+    }
+    void visit(IrInstruction* inst) {
+        switch (inst->type) {
+        case IrInstructionType::Const: {
+            this->update(inst, this->get(inst->getOperand(0)));
+        } break;
+        case IrInstructionType::Phi: {
+            LatticeValue result = {LatticeState::Undefined, 0};
+            for (size_t i = 0; i + 1 < inst->numOperands; i += 2) {
+                if (this->isEdgeExecutable(inst->getOperand(i + 1).block, inst->parent)) {
+                    result = meet(result, this->get(inst->getOperand(i)));
+                }
+            }
+            this->update(inst, result);
+        } break;
+        case IrInstructionType::Add:
+        case IrInstructionType::Sub:
+        case IrInstructionType::Mul:
+        case IrInstructionType::Sdiv:
+        case IrInstructionType::Udiv:
+        case IrInstructionType::Srem:
+        case IrInstructionType::Urem:
+        case IrInstructionType::Smulh:
+        case IrInstructionType::Umulh:
+        case IrInstructionType::And:
+        case IrInstructionType::Shl:
+        case IrInstructionType::Lshr:
+        case IrInstructionType::Ashr: {
+            LatticeValue lhs = this->get(inst->getOperand(0));
+            LatticeValue rhs = this->get(inst->getOperand(1));
+            bool         absorbing =
+                inst->type == IrInstructionType::Mul || inst->type == IrInstructionType::And ||
+                inst->type == IrInstructionType::Smulh || inst->type == IrInstructionType::Umulh;
+            if (absorbing && ((lhs.state == LatticeState::Constant && lhs.constant == 0) ||
+                              (rhs.state == LatticeState::Constant && rhs.constant == 0))) {
+                this->update(inst, constant(inst->valueType, 0));
+            } else if (lhs.state == LatticeState::Overdefined ||
+                       rhs.state == LatticeState::Overdefined) {
+                this->update(inst, overdefined());
+            } else if (lhs.state == LatticeState::Constant && rhs.state == LatticeState::Constant) {
+                if (!canFoldBinary(inst->type, inst->valueType, lhs.constant, rhs.constant)) {
+                    this->update(inst, overdefined());
+                } else {
+                    this->update(inst,
+                                 constant(inst->valueType, foldBinary(inst->type, inst->valueType,
+                                                                      lhs.constant, rhs.constant)));
+                }
+            }
+        } break;
+        case IrInstructionType::Eq:
+        case IrInstructionType::Ne:
+        case IrInstructionType::Slt:
+        case IrInstructionType::Sle:
+        case IrInstructionType::Sgt:
+        case IrInstructionType::Sge:
+        case IrInstructionType::Ult:
+        case IrInstructionType::Ule:
+        case IrInstructionType::Ugt:
+        case IrInstructionType::Uge: {
+            IrOperand&   operand = inst->getOperand(0);
+            LatticeValue lhs     = this->get(operand);
+            LatticeValue rhs     = this->get(inst->getOperand(1));
+            if (lhs.state == LatticeState::Overdefined || rhs.state == LatticeState::Overdefined) {
+                this->update(inst, overdefined());
+            } else if (lhs.state == LatticeState::Constant && rhs.state == LatticeState::Constant) {
+                int64_t folded =
+                    foldCompare(inst->type, operand.irType, lhs.constant, rhs.constant);
+                this->update(inst, constant(inst->valueType, folded));
+            }
+        } break;
+        case IrInstructionType::Trunc:
+        case IrInstructionType::Sext:
+        case IrInstructionType::Zext: {
+            LatticeValue value = this->get(inst->getOperand(0));
+            if (value.state == LatticeState::Constant) {
+                int64_t folded = foldCast(inst->type, inst->getOperand(0).irType, value.constant);
+                this->update(inst, constant(inst->valueType, folded));
+            } else if (value.state == LatticeState::Overdefined) {
+                this->update(inst, overdefined());
+            }
+        } break;
+        case IrInstructionType::Br: {
+            this->markEdge(inst->parent, inst->getOperand(0).block);
+        } break;
+        case IrInstructionType::CondBr: {
+            LatticeValue condition = this->get(inst->getOperand(0));
+            if (condition.state == LatticeState::Constant) {
+                this->markEdge(inst->parent, inst->getOperand(condition.constant ? 1 : 2).block);
+            } else if (condition.state == LatticeState::Overdefined) {
+                this->markEdge(inst->parent, inst->getOperand(1).block);
+                this->markEdge(inst->parent, inst->getOperand(2).block);
+            }
+        } break;
+        case IrInstructionType::Store:
+        case IrInstructionType::Return: {
+        } break;
+        default: {
+            if (inst->hasResult) {
+                this->update(inst, overdefined());
+            }
+        } break;
+        }
+    }
+    void solve() {
+        while (!this->blockWorklist.empty() || !this->instWorklist.empty()) {
+            while (!this->instWorklist.empty()) {
+                IrInstruction* inst = this->instWorklist.back();
+                this->instWorklist.pop_back();
+                if (this->executable.at(inst->parent->number)) {
+                    this->visit(inst);
+                }
+            }
+            while (!this->blockWorklist.empty()) {
+                IrBlock* block = this->blockWorklist.back();
+                this->blockWorklist.pop_back();
+                for (IrInstruction* inst : block->insts) {
+                    this->visit(inst);
+                }
+            }
+        }
+    }
+    // A branch on a value that stayed undefined would leave its successors unreachable. Such
+    // values only come from undefined reads, so give up on them and let both edges through.
+    bool resolveUndefinedBranches() {
+        bool resolved = false;
+        for (IrBlock* block : this->func->blocks) {
+            IrInstruction* terminator = block->getTerminator();
+            if (!this->executable.at(block->number) || !terminator ||
+                terminator->type != IrInstructionType::CondBr ||
+                this->get(terminator->getOperand(0)).state != LatticeState::Undefined) {
+                continue;
+            }
+            IrValue* condition = terminator->getOperandValue(0);
+            if (condition->kind == IrValueKind::Instruction) {
+                this->update(static_cast<IrInstruction*>(condition), overdefined());
+            } else {
+                this->values.at(condition->number) = overdefined();
+            }
+            this->visit(terminator);
+            resolved = true;
+        }
+        return resolved;
+    }
+};
+bool propagateConstants(IrFunction* func, IrAnalysisCache* analyses) {
+    if (func->blocks.empty()) {
+        return false;
+    }
+    SCCPSolver solver;
+    solver.func = func;
+    solver.cfg  = analyses->getCFG();
+    solver.values.assign(func->nextValueNumber, {LatticeState::Undefined, 0});
+    solver.executable.assign(func->nextBlockNumber, false);
+    for (IrArgument* arg : func->arguments) {
+        solver.values.at(arg->number) = overdefined();
+    }
+    IrBlock* entry                      = func->getEntryBlock();
+    solver.executable.at(entry->number) = true;
+    solver.blockWorklist.push_back(entry);
+    solver.solve();
+    while (solver.resolveUndefinedBranches()) {
+        solver.solve();
+    }
+
+    // Fold constants into the operands of their users.
+    bool changed = false;
+    for (IrBlock* block : func->blocks) {
+        if (!solver.executable.at(block->number)) {
+            continue;
+        }
+        for (IrInstruction* inst : block->insts) {
+            if (!inst->hasResult || inst->hasSideEffects() ||
+                solver.values.at(inst->number).state != LatticeState::Constant) {
+                continue;
+            }
+            inst->replaceAllUsesWith(
+                createConstOperand(inst->valueType, solver.values.at(inst->number).constant));
+            inst->eraseFromParent();
+            changed = true;
+        }
+    }
+
+    // Branches on constants become unconditional.
+    for (IrBlock* block : func->blocks) {
+        IrInstruction* terminator = block->getTerminator();
+        if (!solver.executable.at(block->number) || !terminator ||
+            terminator->type != IrInstructionType::CondBr ||
+            terminator->getOperand(0).type != IrOperandType::Const) {
+            continue;
+        }
+        bool     taken    = terminator->getOperand(0).constant != 0;
+        IrBlock* target   = terminator->getOperand(taken ? 1 : 2).block;
+        IrBlock* notTaken = terminator->getOperand(taken ? 2 : 1).block;
+        if (notTaken != target) {
+            notTaken->removePredecessor(block);
+        }
+        terminator->eraseFromParent();
+        block->append(func->createInstruction(IrInstructionType::Br, false,
+                                              {createLabelOperand(target)}));
+        changed = true;
+    }
+
+    // Blocks that never execute go away, after their edges into live blocks are gone.
+    std::vector<IrBlock*> dead;
+    for (IrBlock* block : func->blocks) {
+        if (solver.executable.at(block->number)) {
+            continue;
+        }
+        dead.push_back(block);
+        std::vector<IrBlock*> succs = solver.cfg->getSuccessors(block);
+        for (size_t i = 0; i < succs.size(); ++i) {
+            bool seen = false;
+            for (size_t j = 0; j < i; ++j) {
+                seen |= succs.at(j) == succs.at(i);
+            }
+            if (!seen && solver.executable.at(succs.at(i)->number)) {
+                succs.at(i)->removePredecessor(block);
+            }
+        }
+    }
+    for (IrBlock* block : dead) {
+        for (IrInstruction* inst : block->insts) {
+            inst->dropOperands();
+        }
+    }
+    for (IrBlock* block : dead) {
+        func->eraseBlock(block);
+        changed = true;
+    }
+    return changed;
+}
+}; // namespace language
@@ -47,6 +47,26 @@ static TypeSpec* getBiggestType(TypeSpec* type1, TypeSpec* type2) {
     std::printf("TODO: Implicit cast\n");
     std::exit(1);
 }
+static bool isComparisonOperator(std::string _operator) {
+    return _operator == "==" || _operator == "!=" || _operator == "<" || _operator == "<=" ||
+           _operator == ">" || _operator == ">=";
+}
+// Type both operands of a binary operator are brought to. A literal alone is unsigned, in a
+// division or a comparison it takes the type of the other operand instead, so `x / 7` on an i32
+// divides signed and `x < 0` compares signed.
+static TypeSpec* getOperandType(BinaryExpressionNode* node, TypeSpec* lhs, TypeSpec* rhs) {
+    bool literalFollows = node->getOperator() == "/" || node->getOperator() == "%" ||
+                          isComparisonOperator(node->getOperator());
+    bool lhsLiteral     = node->getLhs()->getExprType() == ExpressionNodeType::NumericLiteral;
+    bool rhsLiteral     = node->getRhs()->getExprType() == ExpressionNodeType::NumericLiteral;
+    if (literalFollows && rhsLiteral && !lhsLiteral && rhs->getBitSize() <= lhs->getBitSize()) {
+        return lhs;
+    }
+    if (literalFollows && lhsLiteral && !rhsLiteral && lhs->getBitSize() <= rhs->getBitSize()) {
+        return rhs;
+    }
+    return getBiggestType(lhs, rhs);
+}
 static TypeSpec* convertExpressionToType(SymbolTable* table, ExpressionNode* node) {
     switch (node->getExprType()) {
     case ExpressionNodeType::NumericLiteral: {
@@ -55,13 +75,22 @@ static TypeSpec* convertExpressionToType(SymbolTable* table, ExpressionNode* nod
                                        : (val > UINT32_MAX ? "u64" : "u32"));
     } break;
     case ExpressionNodeType::Unary: {
-        return new TypeSpec(0, "i32");
+        ExpressionNode* expr = reinterpret_cast<UnaryExpressionNode*>(node)->getExpr();
+        // A negated literal is signed and as wide as the literal.
+        if (expr->getExprType() == ExpressionNodeType::NumericLiteral) {
+            TypeSpec* literalType = convertExpressionToType(table, expr);
+            return new TypeSpec(0, literalType->getBitSize() == 32 ? "i32" : "i64");
+        }
+        return convertExpressionToType(table, expr);
     } break;
     case ExpressionNodeType::Binary: {
         BinaryExpressionNode* binNode = reinterpret_cast<BinaryExpressionNode*>(node);
-        TypeSpec*             lhs     = convertExpressionToType(table, binNode->getLhs());
-        TypeSpec*             rhs     = convertExpressionToType(table, binNode->getRhs());
-        return getBiggestType(lhs, rhs);
+        if (isComparisonOperator(binNode->getOperator())) {
+            return new TypeSpec(0, "i32");
+        }
+        TypeSpec* lhs = convertExpressionToType(table, binNode->getLhs());
+        TypeSpec* rhs = convertExpressionToType(table, binNode->getRhs());
+        return getOperandType(binNode, lhs, rhs);
     } break;
     case ExpressionNodeType::IdentifierLiteral: {
         return table->lookup(reinterpret_cast<IdentifierLiteralExpressionNode*>(node)->getValue())
@@ -74,6 +103,14 @@ static TypeSpec* convertExpressionToType(SymbolTable* table, ExpressionNode* nod
     case ExpressionNodeType::Cast: {
         return reinterpret_cast<CastExpressionNode*>(node)->getType();
     } break;
+    case ExpressionNodeType::FunctionCall: {
+        return convertExpressionToType(
+            table, reinterpret_cast<FunctionCallExpressionNode*>(node)->getCallee());
+    } break;
+    case ExpressionNodeType::Assignment: {
+        return convertExpressionToType(
+            table, reinterpret_cast<AssignmentExpressionNode*>(node)->getAssignee());
+    } break;
     default: {
         std::printf("TODO: Unhandled expression node type for conversion %llu\n",
                     node->getExprType());
@@ -89,11 +126,16 @@ static bool exprCanBeFolded(ExpressionNode* node) {
     case ExpressionNodeType::LtoRValue: {
         return exprCanBeFolded(reinterpret_cast<LtoRValueCastExpression*>(node)->getExpr());
     } break;
+    case ExpressionNodeType::Unary: {
+        return exprCanBeFolded(reinterpret_cast<UnaryExpressionNode*>(node)->getExpr());
+    } break;
     case ExpressionNodeType::Binary: {
         return exprCanBeFolded(reinterpret_cast<BinaryExpressionNode*>(node)->getLhs()) &&
                exprCanBeFolded(reinterpret_cast<BinaryExpressionNode*>(node)->getRhs());
     } break;
-    case ExpressionNodeType::IdentifierLiteral: {
+    case ExpressionNodeType::IdentifierLiteral:
+    case ExpressionNodeType::FunctionCall:
+    case ExpressionNodeType::Assignment: {
         return false;
     } break;
     case ExpressionNodeType::NumericLiteral: {
@@ -128,8 +170,14 @@ DeclarationNode* Sema::checkFunctionDecl(FunctionDeclarationNode* node) {
         paramSym->attrs  = {};
         paramSym->kind   = DeclarationNodeType::Parameter;
         funcTable->insert(paramSym);
+        sym->params.push_back(paramSym->type);
     }
     this->tables.push(funcTable);
+    if (!node->getBody()) {
+        this->tables.pop();
+        return new FunctionDeclarationNode(node->getName(), node->getAttribs(), node->getParams(),
+                                           node->getReturnType(), nullptr);
+    }
     StatementNode* newBody = this->checkStatement(node->getBody());
     if (newBody->getStmtType() != StatementNodeType::Compound) {
         newBody = new CompoundStatementNode({newBody});
@@ -214,13 +262,16 @@ DeclarationNode* Sema::checkDeclarationNode(DeclarationNode* node) {
     } break;
     }
 }
-StatementNode* Sema::checkCompoundStatement(CompoundStatementNode* node) {
+void Sema::pushBlockScope() {
     static size_t blocks;
     SymbolTable*  tempTable = new SymbolTable;
     tempTable->name         = "tempBlockScope" + std::to_string(blocks++);
     tempTable->parent       = this->getCurrentTable();
     tempTable->symbols.clear();
     this->tables.push(tempTable);
+}
+StatementNode* Sema::checkCompoundStatement(CompoundStatementNode* node) {
+    this->pushBlockScope();
     std::vector<StatementNode*> newNodes;
     for (StatementNode* child : node->getNodes()) {
         newNodes.push_back(this->checkStatement(child));
@@ -248,6 +299,51 @@ StatementNode* Sema::checkReturnStatement(ReturnStatementNode* node) {
     }
     return new ReturnStatementNode(newRetExpr);
 }
+// Conditions are integers, zero is false.
+ExpressionNode* Sema::checkCondition(ExpressionNode* node) {
+    ExpressionNode* condition = this->checkExpression(node);
+    if (condition->getValCatagory() == ValueCatagory::Lvalue) {
+        condition = new LtoRValueCastExpression(condition);
+    }
+    TypeSpec* type = convertExpressionToType(this->getCurrentTable(), condition);
+    if (!type->isInteger()) {
+        std::printf("Condition of type `%s` is not an integer\n", type->getName().c_str());
+        std::exit(1);
+    }
+    return condition;
+}
+StatementNode* Sema::checkIfStatement(IfStatementNode* node) {
+    ExpressionNode*               condition = this->checkCondition(node->getCondition());
+    StatementNode*                trueBody  = this->checkStatement(node->getTrueBody());
+    std::optional<StatementNode*> falseBody;
+    if (node->getFalseBody().has_value()) {
+        falseBody = this->checkStatement(node->getFalseBody().value());
+    }
+    return new IfStatementNode(condition, trueBody, falseBody);
+}
+StatementNode* Sema::checkWhileStatement(WhileStatementNode* node) {
+    ExpressionNode* condition = this->checkCondition(node->getCondition());
+    return new WhileStatementNode(condition, this->checkStatement(node->getBody()));
+}
+// The init statement of a `for` is scoped to the loop.
+StatementNode* Sema::checkForStatement(ForStatementNode* node) {
+    this->pushBlockScope();
+    std::optional<StatementNode*>  init;
+    std::optional<ExpressionNode*> condition;
+    std::optional<ExpressionNode*> step;
+    if (node->getInit().has_value()) {
+        init = this->checkStatement(node->getInit().value());
+    }
+    if (node->getCondition().has_value()) {
+        condition = this->checkCondition(node->getCondition().value());
+    }
+    if (node->getStep().has_value()) {
+        step = this->checkExpression(node->getStep().value());
+    }
+    StatementNode* body = this->checkStatement(node->getBody());
+    this->tables.pop();
+    return new ForStatementNode(init, condition, step, body);
+}
 StatementNode* Sema::checkStatement(StatementNode* node) {
     switch (node->getStmtType()) {
     case StatementNodeType::Compound: {
@@ -260,6 +356,19 @@ StatementNode* Sema::checkStatement(StatementNode* node) {
     case StatementNodeType::Return: {
         return this->checkReturnStatement(reinterpret_cast<ReturnStatementNode*>(node));
     } break;
+    case StatementNodeType::Expression: {
+        return new ExpressionStatementNode(
+            this->checkExpression(reinterpret_cast<ExpressionStatementNode*>(node)->getExpr()));
+    } break;
+    case StatementNodeType::If: {
+        return this->checkIfStatement(reinterpret_cast<IfStatementNode*>(node));
+    } break;
+    case StatementNodeType::While: {
+        return this->checkWhileStatement(reinterpret_cast<WhileStatementNode*>(node));
+    } break;
+    case StatementNodeType::For: {
+        return this->checkForStatement(reinterpret_cast<ForStatementNode*>(node));
+    } break;
     default: {
         std::printf("Unhandled Sema stmt type %llu\n", node->getStmtType());
         std::exit(1);
@@ -275,12 +384,11 @@ TypeSpec* Sema::checkTypeSpec(TypeSpec* type) {
 }
 static bool canHaveOperatorApplied(TypeSpec* lhs, TypeSpec* rhs, std::string _operator) {
     // Arithmetic operators
-    // if (_operator == "+" || _operator == "-" || _operator == "*" || _operator == "/" || _operator
-    // == "%") {
-    //     return lhs->isInteger() && rhs->isInteger();
-    // }
-
-    if (_operator == "*" || _operator == "+") {
+    if (_operator == "+" || _operator == "-" || _operator == "*" || _operator == "/" ||
+        _operator == "%") {
+        return lhs->isInteger() && rhs->isInteger();
+    }
+    if (isComparisonOperator(_operator)) {
         return lhs->isInteger() && rhs->isInteger();
     }
 
@@ -315,7 +423,7 @@ ExpressionNode* Sema::checkBinaryExpression(BinaryExpressionNode* node) {
     if (rhs->getValCatagory() == ValueCatagory::Lvalue) {
         rhs = new LtoRValueCastExpression(rhs);
     }
-    TypeSpec* commonType       = getBiggestType(lhsType, rhsType);
+    TypeSpec* commonType       = getOperandType(node, lhsType, rhsType);
     auto      needsLiteralCast = [&](ExpressionNode* expr, TypeSpec* exprType) {
         return expr->getExprType() == ExpressionNodeType::NumericLiteral &&
                commonType->getName() != "i32" && exprType->getName() != commonType->getName();
@@ -334,7 +442,91 @@ ExpressionNode* Sema::checkBinaryExpression(BinaryExpressionNode* node) {
     }
     return new BinaryExpressionNode(lhs, rhs, node->getOperator());
 }
-
+ExpressionNode* Sema::checkUnaryExpression(UnaryExpressionNode* node) {
+    ExpressionNode* expr = this->checkExpression(node->getExpr());
+    if (node->getOperator() != "-") {
+        std::printf("Invalid or unhandled unary operator `%s`\n", node->getOperator().c_str());
+        std::exit(1);
+    }
+    if (!convertExpressionToType(this->getCurrentTable(), expr)->isInteger()) {
+        std::printf("Invalid unary operator `%s` for type `%s`\n", node->getOperator().c_str(),
+                    convertExpressionToType(this->getCurrentTable(), expr)->getName().c_str());
+        std::exit(1);
+    }
+    if (expr->getValCatagory() == ValueCatagory::Lvalue) {
+        expr = new LtoRValueCastExpression(expr);
+    }
+    return new UnaryExpressionNode(node->getOperator(), expr);
+}
+ExpressionNode* Sema::checkCastExpression(CastExpressionNode* node) {
+    ExpressionNode* value = this->checkExpression(node->getValue());
+    TypeSpec*       type  = this->checkTypeSpec(node->getType());
+    if (value->getValCatagory() == ValueCatagory::Lvalue) {
+        value = new LtoRValueCastExpression(value);
+    }
+    TypeSpec* fromType = convertExpressionToType(this->getCurrentTable(), value);
+    if (!fromType->isInteger() || !type->isInteger()) {
+        std::printf("TODO: Cast from `%s` to `%s`\n", fromType->getName().c_str(),
+                    type->getName().c_str());
+        std::exit(1);
+    }
+    return new CastExpressionNode(value, type);
+}
+ExpressionNode* Sema::checkFunctionCallExpression(FunctionCallExpressionNode* node) {
+    if (node->getCallee()->getExprType() != ExpressionNodeType::IdentifierLiteral) {
+        std::printf("TODO: Call through a callee that is not an identifier\n");
+        std::exit(1);
+    }
+    std::string name =
+        reinterpret_cast<IdentifierLiteralExpressionNode*>(node->getCallee())->getValue();
+    Symbol* sym = this->getCurrentTable()->lookup(name);
+    if (!sym) {
+        std::printf("Use of undeclared function `%s`\n", name.c_str());
+        std::exit(1);
+    }
+    if (sym->kind != DeclarationNodeType::Function) {
+        std::printf("Attempted to call `%s` which is not a function\n", name.c_str());
+        std::exit(1);
+    }
+    if (node->getArguments().size() != sym->params.size()) {
+        std::printf("Function `%s` takes %zu arguments but %zu were given\n", name.c_str(),
+                    sym->params.size(), node->getArguments().size());
+        std::exit(1);
+    }
+    std::vector<ExpressionNode*> newArgs;
+    for (size_t i = 0; i < sym->params.size(); ++i) {
+        ExpressionNode* arg = this->checkExpression(node->getArguments().at(i));
+        if (arg->getValCatagory() == ValueCatagory::Lvalue) {
+            arg = new LtoRValueCastExpression(arg);
+        }
+        if (*convertExpressionToType(this->getCurrentTable(), arg) != *sym->params.at(i)) {
+            arg = new CastExpressionNode(arg, sym->params.at(i));
+        }
+        newArgs.push_back(arg);
+    }
+    return new FunctionCallExpressionNode(node->getCallee(), newArgs);
+}
+ExpressionNode* Sema::checkAssignmentExpression(AssignmentExpressionNode* node) {
+    ExpressionNode* assignee = this->checkExpression(node->getAssignee());
+    if (assignee->getExprType() != ExpressionNodeType::IdentifierLiteral) {
+        std::printf("TODO: Assignment to an expression that is not an identifier\n");
+        std::exit(1);
+    }
+    std::string name = reinterpret_cast<IdentifierLiteralExpressionNode*>(assignee)->getValue();
+    Symbol*     sym  = this->getCurrentTable()->lookup(name);
+    if (sym->kind == DeclarationNodeType::Function) {
+        std::printf("Attempted to assign to function `%s`\n", name.c_str());
+        std::exit(1);
+    }
+    ExpressionNode* value = this->checkExpression(node->getValue());
+    if (value->getValCatagory() == ValueCatagory::Lvalue) {
+        value = new LtoRValueCastExpression(value);
+    }
+    if (*convertExpressionToType(this->getCurrentTable(), value) != *sym->type) {
+        value = new CastExpressionNode(value, sym->type);
+    }
+    return new AssignmentExpressionNode(assignee, value);
+}
 ExpressionNode* Sema::checkExpression(ExpressionNode* node) {
     switch (node->getExprType()) {
     case ExpressionNodeType::Binary: {
@@ -350,7 +542,19 @@ ExpressionNode* Sema::checkExpression(ExpressionNode* node) {
         }
         return node;
     } break;
-    case ExpressionNodeType::Unary:
+    case ExpressionNodeType::Unary: {
+        return this->checkUnaryExpression(reinterpret_cast<UnaryExpressionNode*>(node));
+    } break;
+    case ExpressionNodeType::Cast: {
+        return this->checkCastExpression(reinterpret_cast<CastExpressionNode*>(node));
+    } break;
+    case ExpressionNodeType::FunctionCall: {
+        return this->checkFunctionCallExpression(
+            reinterpret_cast<FunctionCallExpressionNode*>(node));
+    } break;
+    case ExpressionNodeType::Assignment: {
+        return this->checkAssignmentExpression(reinterpret_cast<AssignmentExpressionNode*>(node));
+    } break;
     case ExpressionNodeType::NumericLiteral: {
         return node;
     } break;
@@ -0,0 +1,275 @@
+#include <passes.h>
+
+namespace language {
+static bool hasPhis(IrBlock* block) {
+    return !block->insts.empty() && block->insts.front()->type == IrInstructionType::Phi;
+}
+static bool contains(std::vector<IrBlock*>& blocks, IrBlock* block) {
+    for (IrBlock* other : blocks) {
+        if (other == block) {
+            return true;
+        }
+    }
+    return false;
+}
+static std::vector<IrBlock*> getUniquePredecessors(IrCFG& cfg, IrBlock* block) {
+    std::vector<IrBlock*> preds;
+    for (IrBlock* pred : cfg.getPredecessors(block)) {
+        if (!contains(preds, pred)) {
+            preds.push_back(pred);
+        }
+    }
+    return preds;
+}
+static void replaceTerminator(IrBlock* block, IrBlock* target) {
+    block->getTerminator()->eraseFromParent();
+    block->append(block->parent->createInstruction(IrInstructionType::Br, false,
+                                                   {createLabelOperand(target)}));
+}
+// `condbr` on a constant, or with the same block on both sides, becomes a `br`.
+static bool foldBranches(IrFunction* func) {
+    bool changed = false;
+    for (IrBlock* block : func->blocks) {
+        IrInstruction* terminator = block->getTerminator();
+        if (!terminator || terminator->type != IrInstructionType::CondBr) {
+            continue;
+        }
+        IrBlock* ifTrue  = terminator->getOperand(1).block;
+        IrBlock* ifFalse = terminator->getOperand(2).block;
+        if (ifTrue == ifFalse) {
+            replaceTerminator(block, ifTrue);
+            changed = true;
+        } else if (terminator->getOperand(0).type == IrOperandType::Const) {
+            bool taken = terminator->getOperand(0).constant != 0;
+            (taken ? ifFalse : ifTrue)->removePredecessor(block);
+            replaceTerminator(block, taken ? ifTrue : ifFalse);
+            changed = true;
+        }
+    }
+    return changed;
+}
+static bool removeUnreachableBlocks(IrFunction* func) {
+    IrCFG                 cfg(func);
+    std::vector<IrBlock*> dead;
+    for (IrBlock* block : func->blocks) {
+        if (cfg.isReachable(block)) {
+            continue;
+        }
+        dead.push_back(block);
+        std::vector<IrBlock*> succs;
+        for (IrBlock* succ : cfg.getSuccessors(block)) {
+            if (!contains(succs, succ) && cfg.isReachable(succ)) {
+                succs.push_back(succ);
+                succ->removePredecessor(block);
+            }
+        }
+    }
+    for (IrBlock* block : dead) {
+        for (IrInstruction* inst : block->insts) {
+            inst->dropOperands();
+        }
+    }
+    for (IrBlock* block : dead) {
+        func->eraseBlock(block);
+    }
+    return !dead.empty();
+}
+// Folds `succ` into `block`, which ends in a `br` to it and is its only predecessor.
+static void mergeIntoPredecessor(IrBlock* block, IrBlock* succ) {
+    while (hasPhis(succ)) {
+        IrInstruction* phi = succ->insts.front();
+        phi->replaceAllUsesWith(phi->getOperand(0));
+        phi->eraseFromParent();
+    }
+    block->getTerminator()->eraseFromParent();
+    while (!succ->insts.empty()) {
+        IrInstruction* inst = succ->insts.front();
+        inst->removeFromParent();
+        block->append(inst);
+    }
+    for (IrBlock* next : block->getSuccessors()) {
+        next->replacePredecessor(succ, block);
+    }
+    block->parent->eraseBlock(succ);
+}
+// Every predecessor of the empty `block` jumps straight to `succ` instead. With phis in `succ` that
+// only works when no predecessor already reaches `succ` on its own, the phi could not tell the two
+// edges apart.
+static bool canForward(IrCFG& cfg, IrBlock* block, IrBlock* succ) {
+    if (!hasPhis(succ)) {
+        return true;
+    }
+    for (IrBlock* pred : cfg.getPredecessors(block)) {
+        if (contains(cfg.getPredecessors(succ), pred)) {
+            return false;
+        }
+    }
+    return true;
+}
+static void forwardBlock(IrCFG& cfg, IrBlock* block, IrBlock* succ) {
+    for (IrBlock* pred : getUniquePredecessors(cfg, block)) {
+        pred->getTerminator()->replaceSuccessor(block, succ);
+        succ->addPredecessor(pred, block);
+    }
+    succ->removePredecessor(block);
+    block->parent->eraseBlock(block);
+}
+// A block made of a phi and a `condbr` on it is skipped by every predecessor that feeds the phi a
+// constant through a `br`, that predecessor already knows where the branch goes.
+static bool threadJump(IrCFG& cfg, IrBlock* block, std::vector<bool>& touched) {
+    IrInstruction* phi        = block->insts.front();
+    IrInstruction* terminator = block->insts.back();
+    if (block->insts.size() != 2 || phi->type != IrInstructionType::Phi ||
+        terminator->type != IrInstructionType::CondBr || terminator->getOperandValue(0) != phi ||
+        phi->getNumUses() != 1) {
+        return false;
+    }
+    for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+        IrOperand& incoming = phi->getOperand(i);
+        IrBlock*   pred     = phi->getOperand(i + 1).block;
+        if (incoming.type != IrOperandType::Const || touched.at(pred->number) ||
+            pred->getTerminator()->type != IrInstructionType::Br) {
+            continue;
+        }
+        IrBlock* target = terminator->getOperand(incoming.constant ? 1 : 2).block;
+        if (target == block || touched.at(target->number) ||
+            (hasPhis(target) && contains(cfg.getPredecessors(target), pred))) {
+            continue;
+        }
+        pred->getTerminator()->replaceSuccessor(block, target);
+        target->addPredecessor(pred, block);
+        block->removePredecessor(pred);
+        touched.at(pred->number)   = true;
+        touched.at(target->number) = true;
+        return true;
+    }
+    return false;
+}
+static bool isSameValue(IrOperand& a, IrOperand& b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    switch (a.type) {
+    case IrOperandType::SSA: {
+        return a.value == b.value;
+    } break;
+    case IrOperandType::Const: {
+        return a.irType == b.irType && a.constant == b.constant;
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+}
+// A phi whose incoming values are all the same, not counting itself, is that value.
+static bool foldTrivialPhis(IrFunction* func) {
+    bool changed = false;
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* phi : block->insts) {
+            if (phi->type != IrInstructionType::Phi) {
+                break;
+            }
+            IrOperand* same    = nullptr;
+            bool       trivial = true;
+            for (size_t i = 0; i + 1 < phi->numOperands && trivial; i += 2) {
+                IrOperand& incoming = phi->getOperand(i);
+                if (incoming.type == IrOperandType::SSA && incoming.value == phi) {
+                    continue;
+                }
+                if (!same) {
+                    same = &incoming;
+                } else if (!isSameValue(incoming, *same)) {
+                    trivial = false;
+                }
+            }
+            if (!trivial || !same) {
+                continue;
+            }
+            phi->replaceAllUsesWith(*same);
+            phi->eraseFromParent();
+            changed = true;
+        }
+    }
+    return changed;
+}
+static bool threadJumps(IrFunction* func) {
+    IrCFG             cfg(func);
+    std::vector<bool> touched(func->nextBlockNumber, false);
+    bool              changed = false;
+    for (IrBlock* block : cfg.getReversePostOrder()) {
+        if (block != func->getEntryBlock() && !touched.at(block->number) &&
+            threadJump(cfg, block, touched)) {
+            touched.at(block->number) = true;
+            changed                   = true;
+        }
+    }
+    return changed;
+}
+static bool mergeBlocks(IrFunction* func) {
+    IrCFG             cfg(func);
+    IrBlock*          entry = func->getEntryBlock();
+    std::vector<bool> touched(func->nextBlockNumber, false);
+    bool              changed = false;
+    for (IrBlock* block : cfg.getReversePostOrder()) {
+        if (touched.at(block->number)) {
+            continue;
+        }
+        std::vector<IrBlock*>& succs = cfg.getSuccessors(block);
+        IrInstruction*         term  = block->getTerminator();
+        IrBlock*               succ  = succs.size() == 1 ? succs.front() : nullptr;
+        if (!succ || succ == block || touched.at(succ->number)) {
+            continue;
+        }
+        if (term->type == IrInstructionType::Br && succ != entry &&
+            cfg.getPredecessors(succ).size() == 1) {
+            touched.at(block->number) = true;
+            touched.at(succ->number)  = true;
+            for (IrBlock* next : cfg.getSuccessors(succ)) {
+                touched.at(next->number) = true;
+            }
+            mergeIntoPredecessor(block, succ);
+            changed = true;
+            continue;
+        }
+        if (block == entry || block->insts.size() != 1 || !canForward(cfg, block, succ)) {
+            continue;
+        }
+        bool predsTouched = false;
+        for (IrBlock* pred : cfg.getPredecessors(block)) {
+            predsTouched |= touched.at(pred->number);
+        }
+        if (predsTouched) {
+            continue;
+        }
+        for (IrBlock* pred : cfg.getPredecessors(block)) {
+            touched.at(pred->number) = true;
+        }
+        touched.at(block->number) = true;
+        touched.at(succ->number)  = true;
+        forwardBlock(cfg, block, succ);
+        changed = true;
+    }
+    return changed;
+}
+// Each step works on a fresh CFG and leaves blocks alone once a rewrite touched them, so what the
+// CFG says about the rest stays true. Chains shrink by half per sweep at worst. Jumps are threaded
+// before empty blocks are forwarded, forwarding would turn the `br` threading needs into a branch
+// of the predecessor.
+bool simplifyCFG(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    if (func->blocks.empty()) {
+        return false;
+    }
+    bool changed = false;
+    bool sweep   = true;
+    while (sweep) {
+        sweep = foldBranches(func);
+        sweep |= removeUnreachableBlocks(func);
+        sweep |= foldTrivialPhis(func);
+        sweep |= threadJumps(func);
+        sweep |= mergeBlocks(func);
+        changed |= sweep;
+    }
+    return changed;
+}
+}; // namespace language
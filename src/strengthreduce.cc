@@ -0,0 +1,244 @@
+#include <bit>
+#include <passes.h>
+
+namespace language {
+// How a division by a constant that is not a power of two is done with a multiplication, see
+// Hacker's Delight, chapter 10. The quotient is the high half of the product with `magic`, shifted
+// right by `shift`. When the exact magic number needs one bit more than the width, `add` is set and
+// the dividend is added back in.
+struct DivisionMagic {
+    uint64_t magic;
+    uint32_t shift;
+    bool     add;
+};
+
+static uint32_t getBitWidth(IrType type) {
+    return type.type == IrTypeType::I32 ? 32 : 64;
+}
+static uint64_t getMask(IrType type) {
+    return type.type == IrTypeType::I32 ? UINT32_MAX : UINT64_MAX;
+}
+// i32 constants are compared sign extended.
+static int64_t normalize(IrType type, int64_t value) {
+    return type.type == IrTypeType::I32 ? static_cast<int32_t>(value) : value;
+}
+static bool getConstant(IrOperand& operand, int64_t& value) {
+    if (operand.type == IrOperandType::Const) {
+        value = normalize(operand.irType, operand.constant);
+        return true;
+    }
+    if (operand.type != IrOperandType::SSA || operand.value->kind != IrValueKind::Instruction) {
+        return false;
+    }
+    IrInstruction* inst = static_cast<IrInstruction*>(operand.value);
+    return inst->type == IrInstructionType::Const && getConstant(inst->getOperand(0), value);
+}
+static IrOperand createConstant(IrType type, int64_t value) {
+    return createConstOperand(type, normalize(type, value));
+}
+// Inserts `type lhs, rhs` in front of `before`.
+static IrOperand insertBinary(IrInstruction* before, IrInstructionType type, IrOperand lhs,
+                              IrOperand rhs) {
+    IrInstruction* inst = before->parent->parent->createInstruction(type, true, {lhs, rhs});
+    before->parent->insertBefore(before, inst);
+    return createSSAOperand(inst);
+}
+// 2^(width + l) / d for l = floor(log2 d). The remainder decides whether that quotient plus one is
+// close enough to exact, otherwise one more bit of precision is taken and `add` set.
+static DivisionMagic getUnsignedMagic(uint64_t divisor, uint32_t width) {
+    uint32_t          log      = std::bit_width(divisor) - 1;
+    unsigned __int128 dividend = (unsigned __int128)1 << (width + log);
+    unsigned __int128 magic    = dividend / divisor;
+    unsigned __int128 rem      = dividend % divisor;
+    if (divisor - rem < ((uint64_t)1 << log)) {
+        return {(uint64_t)(magic + 1), log, false};
+    }
+    magic = 2 * magic + (2 * rem >= divisor ? 1 : 0);
+    return {(uint64_t)(magic + 1), log, true};
+}
+// Same for the absolute value of a signed divisor, based on 2^(width + l - 1) / |d|. The magic
+// number is negated for a negative divisor.
+static DivisionMagic getSignedMagic(int64_t divisor, uint32_t width) {
+    uint64_t          absolute = divisor < 0 ? 0 - (uint64_t)divisor : divisor;
+    uint32_t          log      = std::bit_width(absolute) - 1;
+    unsigned __int128 dividend = (unsigned __int128)1 << (width + log - 1);
+    unsigned __int128 magic    = dividend / absolute;
+    unsigned __int128 rem      = dividend % absolute;
+    DivisionMagic     result   = {0, log - 1, false};
+    if (absolute - rem >= ((uint64_t)1 << log)) {
+        magic  = 2 * magic + (2 * rem >= absolute ? 1 : 0);
+        result = {0, log, true};
+    }
+    result.magic = (uint64_t)(magic + 1);
+    if (divisor < 0) {
+        result.magic = 0 - result.magic;
+    }
+    return result;
+}
+static IrOperand reduceUnsignedDivision(IrInstruction* inst, IrOperand x, uint64_t divisor) {
+    IrType   type  = inst->valueType;
+    uint32_t width = getBitWidth(type);
+    if (divisor == 1) {
+        return x;
+    }
+    if (std::has_single_bit(divisor)) {
+        return insertBinary(inst, IrInstructionType::Lshr, x,
+                            createConstant(type, std::countr_zero(divisor)));
+    }
+    DivisionMagic magic = getUnsignedMagic(divisor, width);
+    IrOperand     q     = insertBinary(inst, IrInstructionType::Umulh, x,
+                                       createConstant(type, magic.magic));
+    if (magic.add) {
+        IrOperand t = insertBinary(inst, IrInstructionType::Sub, x, q);
+        t           = insertBinary(inst, IrInstructionType::Lshr, t, createConstant(type, 1));
+        q           = insertBinary(inst, IrInstructionType::Add, t, q);
+    }
+    if (magic.shift != 0) {
+        q = insertBinary(inst, IrInstructionType::Lshr, q, createConstant(type, magic.shift));
+    }
+    return q;
+}
+// Signed division rounds towards zero. A power of two adds 2^k - 1 to negative dividends before the
+// arithmetic shift, the magic numbers add one to negative quotients afterwards.
+static IrOperand reduceSignedDivision(IrInstruction* inst, IrOperand x, int64_t divisor) {
+    IrType   type     = inst->valueType;
+    uint32_t width    = getBitWidth(type);
+    uint64_t absolute = divisor < 0 ? 0 - (uint64_t)divisor : divisor;
+    if (divisor == 1) {
+        return x;
+    }
+    if (divisor == -1) {
+        return insertBinary(inst, IrInstructionType::Sub, createConstant(type, 0), x);
+    }
+    IrOperand q;
+    if (std::has_single_bit(absolute)) {
+        uint32_t  log  = std::countr_zero(absolute);
+        IrOperand sign = insertBinary(inst, IrInstructionType::Ashr, x,
+                                      createConstant(type, width - 1));
+        IrOperand bias = insertBinary(inst, IrInstructionType::Lshr, sign,
+                                      createConstant(type, width - log));
+        q = insertBinary(inst, IrInstructionType::Add, x, bias);
+        q = insertBinary(inst, IrInstructionType::Ashr, q, createConstant(type, log));
+        if (divisor < 0) {
+            q = insertBinary(inst, IrInstructionType::Sub, createConstant(type, 0), q);
+        }
+        return q;
+    }
+    DivisionMagic magic = getSignedMagic(divisor, width);
+    q = insertBinary(inst, IrInstructionType::Smulh, x, createConstant(type, magic.magic));
+    if (magic.add) {
+        q = insertBinary(inst, divisor > 0 ? IrInstructionType::Add : IrInstructionType::Sub, q, x);
+    }
+    if (magic.shift != 0) {
+        q = insertBinary(inst, IrInstructionType::Ashr, q, createConstant(type, magic.shift));
+    }
+    IrOperand sign =
+        insertBinary(inst, IrInstructionType::Lshr, q, createConstant(type, width - 1));
+    return insertBinary(inst, IrInstructionType::Add, q, sign);
+}
+// `x - (x / d) * d`, the quotient is shared with a division of the same operands once gvn ran.
+static IrOperand reduceRemainder(IrInstruction* inst, IrOperand x, IrOperand quotient,
+                                 uint64_t divisor) {
+    IrType    type = inst->valueType;
+    IrOperand product;
+    if (std::has_single_bit(divisor)) {
+        product = insertBinary(inst, IrInstructionType::Shl, quotient,
+                               createConstant(type, std::countr_zero(divisor)));
+    } else {
+        product =
+            insertBinary(inst, IrInstructionType::Mul, quotient, createConstant(type, divisor));
+    }
+    return insertBinary(inst, IrInstructionType::Sub, x, product);
+}
+// The replacement for `inst`, or false when it stays as it is. `forSize` keeps divisions by
+// constants that are not powers of two, their magic number sequences are longer than a `div`.
+static bool reduceInstruction(IrInstruction* inst, bool forSize, IrOperand& result) {
+    IrType    type = inst->valueType;
+    IrOperand x    = inst->getOperand(0);
+    int64_t   value;
+    if (!getConstant(inst->getOperand(1), value)) {
+        return false;
+    }
+    uint64_t divisor  = (uint64_t)value & getMask(type);
+    int64_t  minimum  = normalize(type, (int64_t)1 << (getBitWidth(type) - 1));
+    uint64_t absolute = value < 0 ? 0 - (uint64_t)value : value;
+    switch (inst->type) {
+    case IrInstructionType::Mul: {
+        if (divisor < 2 || !std::has_single_bit(divisor)) {
+            return false;
+        }
+        result = insertBinary(inst, IrInstructionType::Shl, x,
+                              createConstant(type, std::countr_zero(divisor)));
+    } break;
+    case IrInstructionType::Udiv: {
+        if (divisor == 0 || (forSize && !std::has_single_bit(divisor))) {
+            return false;
+        }
+        result = reduceUnsignedDivision(inst, x, divisor);
+    } break;
+    case IrInstructionType::Urem: {
+        if (divisor == 0 || (forSize && !std::has_single_bit(divisor))) {
+            return false;
+        }
+        if (std::has_single_bit(divisor)) {
+            result =
+                insertBinary(inst, IrInstructionType::And, x, createConstant(type, divisor - 1));
+        } else {
+            result = reduceRemainder(inst, x, reduceUnsignedDivision(inst, x, divisor), divisor);
+        }
+    } break;
+    case IrInstructionType::Sdiv: {
+        if (value == 0 || value == minimum || (forSize && !std::has_single_bit(absolute))) {
+            return false;
+        }
+        result = reduceSignedDivision(inst, x, value);
+    } break;
+    case IrInstructionType::Srem: {
+        // The sign of the remainder follows the dividend, dividing by -d leaves it unchanged.
+        if (value == 0 || value == minimum || (forSize && !std::has_single_bit(absolute))) {
+            return false;
+        }
+        if (value == 1 || value == -1) {
+            result = createConstant(type, 0);
+        } else {
+            result = reduceRemainder(inst, x, reduceSignedDivision(inst, x, (int64_t)absolute),
+                                     (int64_t)absolute);
+        }
+    } break;
+    default: {
+        return false;
+    } break;
+    }
+    return true;
+}
+static bool reduceFunction(IrFunction* func, bool forSize) {
+    std::vector<IrInstruction*> candidates;
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Mul || inst->type == IrInstructionType::Udiv ||
+                inst->type == IrInstructionType::Urem || inst->type == IrInstructionType::Sdiv ||
+                inst->type == IrInstructionType::Srem) {
+                candidates.push_back(inst);
+            }
+        }
+    }
+    bool changed = false;
+    for (IrInstruction* inst : candidates) {
+        IrOperand result;
+        if (reduceInstruction(inst, forSize, result)) {
+            inst->replaceAllUsesWith(result);
+            inst->eraseFromParent();
+            changed = true;
+        }
+    }
+    return changed;
+}
+bool reduceStrength(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    return reduceFunction(func, false);
+}
+bool reduceStrengthForSize(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    return reduceFunction(func, true);
+}
+}; // namespace language
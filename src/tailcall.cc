@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <passes.h>
+
+namespace language {
+// A call of the function to itself whose value, if any, is what the function returns next. The
+// return is either right behind the call or in a block of phis and a `return` that the call's
+// block jumps to.
+struct TailCall {
+    IrInstruction* call;
+    IrBlock*       returnBlock;
+};
+static bool isVoidReturn(IrInstruction* ret) {
+    return ret->numOperands == 0 || ret->getOperand(0).type == IrOperandType::Type;
+}
+static bool returnsValue(IrInstruction* ret, IrValue* value) {
+    return !isVoidReturn(ret) && ret->getOperand(0).type == IrOperandType::SSA &&
+           ret->getOperand(0).value == value;
+}
+// The block `br` jumps to when it holds nothing but phis and a `return`.
+static IrBlock* getReturnBlock(IrInstruction* br) {
+    IrBlock* target = br->getOperand(0).block;
+    for (IrInstruction* inst : target->insts) {
+        if (inst->type == IrInstructionType::Return) {
+            return target;
+        }
+        if (inst->type != IrInstructionType::Phi) {
+            break;
+        }
+    }
+    return nullptr;
+}
+// A slot passed to the call would be the caller's slot again once the call is a jump, so those
+// calls stay.
+static bool passesSlot(IrInstruction* call) {
+    for (size_t i = 1; i < call->numOperands; ++i) {
+        IrOperand& operand = call->getOperand(i);
+        if (operand.type == IrOperandType::SSA &&
+            operand.value->kind == IrValueKind::Instruction &&
+            static_cast<IrInstruction*>(operand.value)->type == IrInstructionType::Reserve) {
+            return true;
+        }
+    }
+    return false;
+}
+static bool getTailCall(IrInstruction* call, TailCall& tailCall) {
+    IrFunction*    func = call->parent->parent;
+    IrInstruction* term = call->next;
+    if (call->getOperand(0).function != func || !term || passesSlot(call)) {
+        return false;
+    }
+    tailCall = {call, nullptr};
+    if (term->type == IrInstructionType::Return) {
+        return isVoidReturn(term) || returnsValue(term, call);
+    }
+    if (term->type != IrInstructionType::Br) {
+        return false;
+    }
+    tailCall.returnBlock = getReturnBlock(term);
+    if (!tailCall.returnBlock || tailCall.returnBlock == call->parent) {
+        return false;
+    }
+    IrInstruction* ret = tailCall.returnBlock->getTerminator();
+    if (isVoidReturn(ret)) {
+        return true;
+    }
+    IrOperand& value = ret->getOperand(0);
+    if (value.type != IrOperandType::SSA) {
+        return false;
+    }
+    if (value.value == call) {
+        return true;
+    }
+    // The returned phi has to take the call's value on the edge from the call.
+    if (value.value->kind != IrValueKind::Instruction) {
+        return false;
+    }
+    IrInstruction* phi = static_cast<IrInstruction*>(value.value);
+    if (phi->type != IrInstructionType::Phi || phi->parent != tailCall.returnBlock) {
+        return false;
+    }
+    for (size_t i = 0; i + 1 < phi->numOperands; i += 2) {
+        IrOperand& incoming = phi->getOperand(i);
+        if (phi->getOperand(i + 1).block == call->parent) {
+            return incoming.type == IrOperandType::SSA && incoming.value == call;
+        }
+    }
+    return false;
+}
+static bool hasPredecessors(IrFunction* func, IrBlock* target) {
+    for (IrBlock* block : func->blocks) {
+        std::vector<IrBlock*> succs = block->getSuccessors();
+        if (std::find(succs.begin(), succs.end(), target) != succs.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+// The old entry block becomes the loop header. A new entry block in front of it keeps the
+// `reserve`s and every argument turns into a phi of the incoming value and the ones the tail calls
+// pass.
+static IrBlock* createLoopHeader(IrFunction* func, std::vector<TailCall>& tailCalls) {
+    IrBlock* header = func->getEntryBlock();
+    IrBlock* entry  = func->createBlock();
+    func->blocks.remove(entry);
+    func->blocks.pushFront(entry);
+    while (!header->insts.empty() && header->insts.front()->type == IrInstructionType::Reserve) {
+        IrInstruction* reserve = header->insts.front();
+        reserve->removeFromParent();
+        entry->append(reserve);
+    }
+    entry->append(
+        func->createInstruction(IrInstructionType::Br, false, {createLabelOperand(header)}));
+    IrInstruction* firstInst = header->insts.front();
+    for (size_t i = 0; i < func->arguments.size(); ++i) {
+        IrArgument* argument = func->arguments.at(i);
+        if (!argument->hasUses()) {
+            continue;
+        }
+        IrInstruction* phi =
+            func->createInstruction(IrInstructionType::Phi, true, 2 + tailCalls.size() * 2);
+        phi->valueType = argument->valueType;
+        argument->replaceAllUsesWith(phi);
+        phi->setOperand(0, createSSAOperand(argument));
+        phi->setOperand(1, createLabelOperand(entry));
+        for (size_t j = 0; j < tailCalls.size(); ++j) {
+            IrInstruction* call = tailCalls.at(j).call;
+            phi->setOperand(2 + j * 2, call->getOperand(i + 1));
+            phi->setOperand(3 + j * 2, createLabelOperand(call->parent));
+        }
+        header->insertBefore(firstInst, phi);
+    }
+    return header;
+}
+bool eliminateTailCalls(IrFunction* func, IrAnalysisCache* analyses) {
+    (void)analyses;
+    std::vector<TailCall> tailCalls;
+    for (IrBlock* block : func->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            TailCall tailCall;
+            if (inst->type == IrInstructionType::Call && getTailCall(inst, tailCall)) {
+                tailCalls.push_back(tailCall);
+            }
+        }
+    }
+    if (tailCalls.empty()) {
+        return false;
+    }
+    IrBlock* header = createLoopHeader(func, tailCalls);
+    for (TailCall& tailCall : tailCalls) {
+        IrBlock* block = tailCall.call->parent;
+        block->getTerminator()->eraseFromParent();
+        block->append(
+            func->createInstruction(IrInstructionType::Br, false, {createLabelOperand(header)}));
+    }
+    // A return block only tail calls jumped to is gone with them, that drops its uses of the calls
+    // before they are erased.
+    std::vector<IrBlock*> returnBlocks;
+    for (TailCall& tailCall : tailCalls) {
+        IrBlock* returnBlock = tailCall.returnBlock;
+        bool     seen        = std::find(returnBlocks.begin(), returnBlocks.end(), returnBlock) !=
+                    returnBlocks.end();
+        if (returnBlock && !seen) {
+            returnBlocks.push_back(returnBlock);
+        }
+    }
+    for (IrBlock* returnBlock : returnBlocks) {
+        if (!hasPredecessors(func, returnBlock)) {
+            func->eraseBlock(returnBlock);
+            continue;
+        }
+        for (TailCall& tailCall : tailCalls) {
+            if (tailCall.returnBlock == returnBlock) {
+                returnBlock->removePredecessor(tailCall.call->parent);
+            }
+        }
+    }
+    for (TailCall& tailCall : tailCalls) {
+        tailCall.call->eraseFromParent();
+    }
+    return true;
+}
+}; // namespace language
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <threadpool.h>
+
+namespace language {
+// Zero until `-j` sets it, then every pool is created with that many threads.
+size_t ThreadPool::defaultThreadCount = 0;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    this->ranges    = std::vector<WorkRange>(std::max(threadCount, (size_t)1));
+    this->remaining = 0;
+    this->batch     = 0;
+    this->stopping  = false;
+    for (size_t i = 1; i < threadCount; ++i) {
+        this->workers.emplace_back([this, i] { this->runWorker(i); });
+    }
+}
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wakeWorkers.notify_all();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+size_t ThreadPool::getThreadCount() {
+    return this->workers.size() + 1;
+}
+size_t ThreadPool::getDefaultThreadCount() {
+    if (defaultThreadCount != 0) {
+        return defaultThreadCount;
+    }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+void ThreadPool::setDefaultThreadCount(size_t threadCount) {
+    defaultThreadCount = threadCount;
+}
+void ThreadPool::parallelFor(size_t count, std::function<void(size_t)> _task) {
+    if (this->workers.empty() || count <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            _task(i);
+        }
+        return;
+    }
+    // The task is set before any range is filled, a thread only reads it after taking an index out
+    // of a range under that range's lock.
+    size_t threadCount = this->ranges.size();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->task      = _task;
+        this->remaining = count;
+        for (size_t i = 0; i < threadCount; ++i) {
+            std::lock_guard<std::mutex> rangeLock(this->ranges.at(i).mutex);
+            this->ranges.at(i).begin = i * count / threadCount;
+            this->ranges.at(i).end   = (i + 1) * count / threadCount;
+        }
+        this->batch++;
+    }
+    this->wakeWorkers.notify_all();
+    this->runTasks(0);
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->batchDone.wait(lock, [this] { return this->remaining == 0; });
+    this->task = nullptr;
+}
+void ThreadPool::runTasks(size_t index) {
+    size_t next;
+    while (this->takeTask(index, next)) {
+        this->task(next);
+        if (this->remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->batchDone.notify_all();
+        }
+    }
+}
+// Takes the front of the thread's own range. When that is empty the back half of the first other
+// range that still has work becomes the thread's range, returns false once every range is empty.
+bool ThreadPool::takeTask(size_t index, size_t& next) {
+    WorkRange& own = this->ranges.at(index);
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+            next = own.begin++;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < this->ranges.size(); ++i) {
+        WorkRange& victim = this->ranges.at((index + i) % this->ranges.size());
+        size_t     begin;
+        size_t     end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end) {
+                continue;
+            }
+            begin      = victim.begin + (victim.end - victim.begin) / 2;
+            end        = victim.end;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        next      = begin;
+        own.begin = begin + 1;
+        own.end   = end;
+        return true;
+    }
+    return false;
+}
+void ThreadPool::runWorker(size_t index) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wakeWorkers.wait(lock, [&] { return this->stopping || this->batch != seen; });
+            if (this->stopping) {
+                return;
+            }
+            seen = this->batch;
+        }
+        this->runTasks(index);
+    }
+}
+}; // namespace language
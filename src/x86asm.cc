@@ -0,0 +1,495 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <x86asm.h>
+
+namespace language {
+static const char* registerNames64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                        "r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15"};
+static const char* registerNames32[] = {"eax", "ecx", "edx",  "ebx",  "esp",  "ebp",
+                                        "esi", "edi", "r8d",  "r9d",  "r10d", "r11d",
+                                        "r12d", "r13d", "r14d", "r15d"};
+static const char* registerNames8[]  = {"al",  "cl",  "dl",   "bl",   "spl",  "bpl",
+                                        "sil", "dil", "r8b",  "r9b",  "r10b", "r11b",
+                                        "r12b", "r13b", "r14b", "r15b"};
+// Indexed by the condition code encoding of `jcc` and `setcc`.
+static const char* conditionCodes[] = {"o", "no", "b", "ae", "e", "ne", "be", "a",
+                                       "s", "ns", "p", "np", "l", "ge", "le", "g"};
+struct AluInstruction {
+    const char* name;
+    uint8_t     store;
+    uint8_t     load;
+    uint8_t     extension;
+};
+static const AluInstruction aluInstructions[] = {
+    {"add", 0x01, 0x03, 0},
+    {"sub", 0x29, 0x2B, 5},
+    {"cmp", 0x39, 0x3B, 7},
+    {"and", 0x21, 0x23, 4},
+    {"xor", 0x31, 0x33, 6},
+};
+// Instructions of the 0xF7 group and the shift group, told apart by the reg field of the ModRM.
+struct GroupInstruction {
+    const char* name;
+    uint8_t     extension;
+};
+static const GroupInstruction unaryInstructions[] = {
+    {"mul", 4},
+    {"imul", 5},
+    {"div", 6},
+    {"idiv", 7},
+};
+static const GroupInstruction shiftInstructions[] = {
+    {"shl", 4},
+    {"shr", 5},
+    {"sar", 7},
+};
+static int32_t findExtension(const GroupInstruction* group, size_t count, std::string mnemonic) {
+    for (size_t i = 0; i < count; ++i) {
+        if (mnemonic == group[i].name) {
+            return group[i].extension;
+        }
+    }
+    return -1;
+}
+static std::string trim(std::string text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    return text.substr(start, text.find_last_not_of(" \t") - start + 1);
+}
+static bool findRegister(std::string name, X86Register* reg, uint8_t* size) {
+    for (size_t i = 0; i < 16; ++i) {
+        *reg = (X86Register)i;
+        if (name == registerNames64[i]) {
+            *size = 8;
+            return true;
+        } else if (name == registerNames32[i]) {
+            *size = 4;
+            return true;
+        } else if (name == registerNames8[i]) {
+            *size = 1;
+            return true;
+        }
+    }
+    return false;
+}
+static int32_t findCondition(std::string code) {
+    for (size_t i = 0; i < 16; ++i) {
+        if (code == conditionCodes[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+static bool fitsInByte(int64_t value) {
+    return value == (int8_t)value;
+}
+// spl, bpl, sil and dil only exist with a REX prefix, without one the encodings name ah to bh.
+static bool needsRexForByte(X86AsmOperand& operand) {
+    return operand.operand.kind == X86OperandKind::Register && operand.size == 1 &&
+           (uint8_t)operand.operand.reg >= 4 && (uint8_t)operand.operand.reg < 8;
+}
+static void unsupported(std::string mnemonic) {
+    std::printf("ICE: Cannot assemble `%s` with these operands\n", mnemonic.c_str());
+    std::exit(1);
+}
+X86Assembler::X86Assembler(std::string _source) {
+    this->source         = _source;
+    this->currentSection = 0;
+}
+X86Assembler::~X86Assembler() {
+}
+void X86Assembler::assemble() {
+    this->switchSection(".text", "");
+    size_t start = 0;
+    while (start < this->source.size()) {
+        size_t end = this->source.find('\n', start);
+        if (end == std::string::npos) {
+            end = this->source.size();
+        }
+        this->assembleLine(this->source.substr(start, end - start));
+        start = end + 1;
+    }
+    this->resolveFixups();
+}
+std::vector<X86Section>& X86Assembler::getSections() {
+    return this->sections;
+}
+std::vector<X86Symbol>& X86Assembler::getSymbols() {
+    return this->symbols;
+}
+std::vector<X86Relocation>& X86Assembler::getRelocations() {
+    return this->relocations;
+}
+X86Symbol* X86Assembler::findSymbol(std::string name) {
+    auto it = this->symbolIndex.find(name);
+    return it == this->symbolIndex.end() ? nullptr : &this->symbols.at(it->second);
+}
+X86Symbol* X86Assembler::getSymbol(std::string name) {
+    auto it = this->symbolIndex.find(name);
+    if (it != this->symbolIndex.end()) {
+        return &this->symbols.at(it->second);
+    }
+    this->symbolIndex[name] = this->symbols.size();
+    this->symbols.push_back({name, -1, 0, 0, false, false});
+    return &this->symbols.back();
+}
+void X86Assembler::switchSection(std::string name, std::string flags) {
+    for (size_t i = 0; i < this->sections.size(); ++i) {
+        if (this->sections.at(i).name == name) {
+            this->currentSection = i;
+            return;
+        }
+    }
+    X86Section section;
+    section.name         = name;
+    section.alignment    = 1;
+    section.executable   = flags.find('x') != std::string::npos || name.starts_with(".text");
+    section.writable     = flags.find('w') != std::string::npos || name.starts_with(".data");
+    section.allocated    = flags.find('a') != std::string::npos || section.executable ||
+                        section.writable;
+    this->currentSection = this->sections.size();
+    this->sections.push_back(section);
+}
+void X86Assembler::assembleLine(std::string line) {
+    line = trim(line);
+    if (line.empty()) {
+        return;
+    }
+    if (line.back() == ':') {
+        X86Symbol* symbol = this->getSymbol(line.substr(0, line.size() - 1));
+        if (symbol->section >= 0) {
+            std::printf("ICE: Symbol `%s` is defined twice\n", symbol->name.c_str());
+            std::exit(1);
+        }
+        symbol->section = this->currentSection;
+        symbol->offset  = this->sections.at(this->currentSection).bytes.size();
+        return;
+    }
+    size_t      space = line.find_first_of(" \t");
+    std::string name  = line.substr(0, space);
+    std::string rest  = space == std::string::npos ? "" : trim(line.substr(space));
+    if (name.front() == '.') {
+        this->assembleDirective(name, rest);
+        return;
+    }
+    std::vector<X86AsmOperand> operands;
+    size_t                     start = 0;
+    while (start < rest.size()) {
+        size_t comma = rest.find(',', start);
+        if (comma == std::string::npos) {
+            comma = rest.size();
+        }
+        operands.push_back(this->parseOperand(trim(rest.substr(start, comma - start))));
+        start = comma + 1;
+    }
+    size_t firstFixup = this->fixups.size();
+    this->assembleInstruction(name, operands);
+    // rel32 fields count from the end of the instruction, an immediate may still follow the field.
+    int64_t end = this->sections.at(this->currentSection).bytes.size();
+    for (size_t i = firstFixup; i < this->fixups.size(); ++i) {
+        this->fixups.at(i).addend = (int64_t)this->fixups.at(i).offset - end;
+    }
+}
+void X86Assembler::assembleDirective(std::string directive, std::string arguments) {
+    X86Section& section = this->sections.at(this->currentSection);
+    std::string name    = trim(arguments.substr(0, arguments.find(',')));
+    if (directive == ".intel_syntax") {
+    } else if (directive == ".text" || directive == ".data") {
+        this->switchSection(directive, "");
+    } else if (directive == ".section") {
+        size_t      quote = arguments.find('"');
+        std::string flags;
+        if (quote != std::string::npos) {
+            flags = arguments.substr(quote + 1, arguments.find('"', quote + 1) - quote - 1);
+        }
+        this->switchSection(name, flags);
+    } else if (directive == ".globl") {
+        this->getSymbol(name)->global = true;
+    } else if (directive == ".type") {
+        this->getSymbol(name)->function = arguments.find("@function") != std::string::npos;
+    } else if (directive == ".size") {
+        X86Symbol* symbol = this->getSymbol(name);
+        if (trim(arguments.substr(arguments.find(',') + 1)) != ".-" + name) {
+            std::printf("TODO: Size expression in `.size %s`\n", arguments.c_str());
+            std::exit(1);
+        }
+        symbol->size = section.bytes.size() - symbol->offset;
+    } else if (directive == ".p2align") {
+        uint32_t alignment = 1u << std::atoi(arguments.c_str());
+        section.alignment  = std::max(section.alignment, alignment);
+        while (section.bytes.size() % alignment) {
+            this->emitByte(section.executable ? 0x90 : 0x00);
+        }
+    } else if (directive == ".quad") {
+        this->emitImmediate(std::strtoll(arguments.c_str(), nullptr, 10), 8);
+    } else if (directive == ".long") {
+        this->emitImmediate(std::strtoll(arguments.c_str(), nullptr, 10), 4);
+    } else {
+        std::printf("TODO: Assembler directive `%s`\n", directive.c_str());
+        std::exit(1);
+    }
+}
+X86AsmOperand X86Assembler::parseOperand(std::string text) {
+    X86AsmOperand result = {{X86OperandKind::Immediate, X86Register::Rax, 0, 0, ""}, 0, false};
+    if (text.starts_with("QWORD PTR ")) {
+        result.size = 8;
+    } else if (text.starts_with("DWORD PTR ")) {
+        result.size = 4;
+    } else if (text.starts_with("BYTE PTR ")) {
+        result.size = 1;
+    }
+    if (result.size) {
+        text = trim(text.substr(text.find("PTR") + 3));
+    }
+    if (text.front() == '[') {
+        std::string inner        = trim(text.substr(1, text.size() - 2));
+        size_t      sign         = inner.find_first_of("+-");
+        std::string base         = trim(inner.substr(0, sign));
+        std::string displacement = sign == std::string::npos ? "" : trim(inner.substr(sign + 1));
+        if (base == "rip") {
+            result.operand.kind   = X86OperandKind::Symbol;
+            result.operand.symbol = displacement;
+            return result;
+        }
+        uint8_t size;
+        if (!findRegister(base, &result.operand.reg, &size) || size != 8) {
+            std::printf("ICE: Invalid base register in `%s`\n", text.c_str());
+            std::exit(1);
+        }
+        result.operand.kind   = X86OperandKind::Memory;
+        result.operand.offset = std::strtol(displacement.c_str(), nullptr, 10);
+        if (sign != std::string::npos && inner.at(sign) == '-') {
+            result.operand.offset = -result.operand.offset;
+        }
+        return result;
+    }
+    if (findRegister(text, &result.operand.reg, &result.size)) {
+        result.operand.kind = X86OperandKind::Register;
+        return result;
+    }
+    if (std::isdigit(text.front()) || text.front() == '-') {
+        result.operand.immediate = std::strtoll(text.c_str(), nullptr, 10);
+        return result;
+    }
+    result.operand.kind   = X86OperandKind::Symbol;
+    result.operand.symbol = text;
+    result.label          = true;
+    return result;
+}
+void X86Assembler::emitByte(uint8_t byte) {
+    this->sections.at(this->currentSection).bytes.push_back(byte);
+}
+void X86Assembler::emitImmediate(int64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        this->emitByte((uint8_t)((uint64_t)value >> (8 * i)));
+    }
+}
+void X86Assembler::emitRex(bool wide, uint8_t reg, X86AsmOperand& rm, bool byteRegister) {
+    uint8_t rex = 0x40 | (wide ? 0x08 : 0) | (reg & 8 ? 0x04 : 0);
+    if (rm.operand.kind == X86OperandKind::Register || rm.operand.kind == X86OperandKind::Memory) {
+        rex |= (uint8_t)rm.operand.reg & 8 ? 0x01 : 0;
+    }
+    if (rex != 0x40 || byteRegister) {
+        this->emitByte(rex);
+    }
+}
+// rsp and r12 as a base need a SIB byte, rbp and r13 cannot go without a displacement.
+void X86Assembler::emitModRM(uint8_t reg, X86AsmOperand& rm) {
+    uint8_t regField = (reg & 7) << 3;
+    switch (rm.operand.kind) {
+    case X86OperandKind::Register: {
+        this->emitByte(0xC0 | regField | ((uint8_t)rm.operand.reg & 7));
+    } break;
+    case X86OperandKind::Memory: {
+        uint8_t base   = (uint8_t)rm.operand.reg & 7;
+        int32_t offset = rm.operand.offset;
+        uint8_t mod    = 0x80;
+        if (offset == 0 && base != 5) {
+            mod = 0x00;
+        } else if (fitsInByte(offset)) {
+            mod = 0x40;
+        }
+        this->emitByte(mod | regField | base);
+        if (base == 4) {
+            this->emitByte(0x24);
+        }
+        if (mod == 0x40) {
+            this->emitImmediate(offset, 1);
+        } else if (mod == 0x80) {
+            this->emitImmediate(offset, 4);
+        }
+    } break;
+    case X86OperandKind::Symbol: {
+        this->emitByte(regField | 5);
+        this->emitRelative(rm.operand.symbol, X86RelocationKind::PcRelative);
+    } break;
+    default: {
+        std::printf("ICE: Immediate used as a register or memory operand\n");
+        std::exit(1);
+    } break;
+    }
+}
+void X86Assembler::emitInstruction(std::vector<uint8_t> opcode, uint8_t reg, X86AsmOperand& rm,
+                                   bool wide) {
+    this->emitRex(wide, reg, rm, false);
+    for (uint8_t byte : opcode) {
+        this->emitByte(byte);
+    }
+    this->emitModRM(reg, rm);
+}
+void X86Assembler::emitRelative(std::string symbol, X86RelocationKind kind) {
+    this->getSymbol(symbol);
+    this->fixups.push_back({this->currentSection,
+                            this->sections.at(this->currentSection).bytes.size(), symbol, 0, kind});
+    this->emitImmediate(0, 4);
+}
+void X86Assembler::assembleInstruction(std::string mnemonic, std::vector<X86AsmOperand>& operands) {
+    if (operands.empty()) {
+        if (mnemonic == "ret") {
+            this->emitByte(0xC3);
+        } else if (mnemonic == "leave") {
+            this->emitByte(0xC9);
+        } else if (mnemonic == "cqo") {
+            this->emitByte(0x48);
+            this->emitByte(0x99);
+        } else if (mnemonic == "cdq") {
+            this->emitByte(0x99);
+        } else {
+            unsupported(mnemonic);
+        }
+        return;
+    }
+    X86AsmOperand& dst = operands.front();
+    if (dst.label) {
+        if (mnemonic == "call") {
+            this->emitByte(0xE8);
+        } else if (mnemonic == "jmp") {
+            this->emitByte(0xE9);
+        } else if (mnemonic.front() == 'j' && findCondition(mnemonic.substr(1)) >= 0) {
+            this->emitByte(0x0F);
+            this->emitByte(0x80 + findCondition(mnemonic.substr(1)));
+        } else {
+            unsupported(mnemonic);
+        }
+        this->emitRelative(dst.operand.symbol, X86RelocationKind::Branch);
+        return;
+    }
+    uint8_t dstReg    = (uint8_t)dst.operand.reg;
+    bool    wide      = dst.size == 8;
+    int32_t extension = -1;
+    if (operands.size() == 1) {
+        extension = findExtension(unaryInstructions, std::size(unaryInstructions), mnemonic);
+        if (mnemonic == "push" && dst.operand.kind == X86OperandKind::Register) {
+            this->emitRex(false, 0, dst, false);
+            this->emitByte(0x50 + (dstReg & 7));
+        } else if (mnemonic == "push" && dst.operand.kind == X86OperandKind::Immediate) {
+            bool small = fitsInByte(dst.operand.immediate);
+            this->emitByte(small ? 0x6A : 0x68);
+            this->emitImmediate(dst.operand.immediate, small ? 1 : 4);
+        } else if (mnemonic == "push") {
+            this->emitInstruction({0xFF}, 6, dst, false);
+        } else if (mnemonic == "pop" && dst.operand.kind == X86OperandKind::Register) {
+            this->emitRex(false, 0, dst, false);
+            this->emitByte(0x58 + (dstReg & 7));
+        } else if (mnemonic.starts_with("set") && findCondition(mnemonic.substr(3)) >= 0) {
+            this->emitRex(false, 0, dst, needsRexForByte(dst));
+            this->emitByte(0x0F);
+            this->emitByte(0x90 + findCondition(mnemonic.substr(3)));
+            this->emitModRM(0, dst);
+        } else if (extension >= 0 && dst.operand.kind != X86OperandKind::Immediate) {
+            this->emitInstruction({0xF7}, extension, dst, wide);
+        } else {
+            unsupported(mnemonic);
+        }
+        return;
+    }
+    if (operands.size() != 2) {
+        unsupported(mnemonic);
+    }
+    X86AsmOperand& src       = operands.at(1);
+    uint8_t        srcReg    = (uint8_t)src.operand.reg;
+    bool           immediate = src.operand.kind == X86OperandKind::Immediate;
+    bool           small     = immediate && fitsInByte(src.operand.immediate);
+    for (const AluInstruction& alu : aluInstructions) {
+        if (mnemonic != alu.name) {
+            continue;
+        }
+        if (immediate) {
+            this->emitInstruction({(uint8_t)(small ? 0x83 : 0x81)}, alu.extension, dst, wide);
+            this->emitImmediate(src.operand.immediate, small ? 1 : 4);
+        } else if (src.operand.kind == X86OperandKind::Register) {
+            this->emitInstruction({alu.store}, srcReg, dst, wide);
+        } else {
+            this->emitInstruction({alu.load}, dstReg, src, wide);
+        }
+        return;
+    }
+    // Shifts take the count as an 8 bit immediate or in cl, a shift by one has its own opcode.
+    extension = findExtension(shiftInstructions, std::size(shiftInstructions), mnemonic);
+    if (extension >= 0 && immediate && src.operand.immediate == 1) {
+        this->emitInstruction({0xD1}, extension, dst, wide);
+        return;
+    } else if (extension >= 0 && immediate) {
+        this->emitInstruction({0xC1}, extension, dst, wide);
+        this->emitImmediate(src.operand.immediate, 1);
+        return;
+    } else if (extension >= 0 && src.operand.kind == X86OperandKind::Register &&
+               src.operand.reg == X86Register::Rcx && src.size == 1) {
+        this->emitInstruction({0xD3}, extension, dst, wide);
+        return;
+    }
+    if (mnemonic == "mov" && immediate && dst.operand.kind == X86OperandKind::Register && !wide) {
+        this->emitRex(false, 0, dst, false);
+        this->emitByte(0xB8 + (dstReg & 7));
+        this->emitImmediate(src.operand.immediate, 4);
+    } else if (mnemonic == "mov" && immediate) {
+        this->emitInstruction({0xC7}, 0, dst, wide);
+        this->emitImmediate(src.operand.immediate, 4);
+    } else if (mnemonic == "mov" && src.operand.kind == X86OperandKind::Register) {
+        this->emitInstruction({0x89}, srcReg, dst, wide);
+    } else if (mnemonic == "mov") {
+        this->emitInstruction({0x8B}, dstReg, src, wide);
+    } else if (mnemonic == "movabs" && immediate && dst.operand.kind == X86OperandKind::Register) {
+        this->emitRex(true, 0, dst, false);
+        this->emitByte(0xB8 + (dstReg & 7));
+        this->emitImmediate(src.operand.immediate, 8);
+    } else if (mnemonic == "lea" && src.operand.kind != X86OperandKind::Register) {
+        this->emitInstruction({0x8D}, dstReg, src, true);
+    } else if (mnemonic == "movsxd") {
+        this->emitInstruction({0x63}, dstReg, src, true);
+    } else if (mnemonic == "movzx") {
+        this->emitRex(false, dstReg, src, needsRexForByte(src));
+        this->emitByte(0x0F);
+        this->emitByte(0xB6);
+        this->emitModRM(dstReg, src);
+    } else if (mnemonic == "test" && src.operand.kind == X86OperandKind::Register) {
+        this->emitInstruction({0x85}, srcReg, dst, wide);
+    } else if (mnemonic == "imul" && immediate) {
+        this->emitInstruction({(uint8_t)(small ? 0x6B : 0x69)}, dstReg, dst, wide);
+        this->emitImmediate(src.operand.immediate, small ? 1 : 4);
+    } else if (mnemonic == "imul") {
+        this->emitInstruction({0x0F, 0xAF}, dstReg, src, wide);
+    } else {
+        unsupported(mnemonic);
+    }
+}
+void X86Assembler::resolveFixups() {
+    for (X86Relocation& fixup : this->fixups) {
+        X86Symbol* symbol = this->findSymbol(fixup.symbol);
+        if (symbol->section != (int32_t)fixup.section || symbol->global) {
+            this->relocations.push_back(fixup);
+            continue;
+        }
+        int64_t               value = symbol->offset + fixup.addend - fixup.offset;
+        std::vector<uint8_t>& bytes = this->sections.at(fixup.section).bytes;
+        for (size_t i = 0; i < 4; ++i) {
+            bytes.at(fixup.offset + i) = (uint8_t)((uint64_t)value >> (8 * i));
+        }
+    }
+}
+}; // namespace language
@@ -0,0 +1,935 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <x86gen.h>
+
+namespace language {
+static const char* registerNames64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+                                        "r8",  "r9",  "r10", "r11", "r12", "r13", "r14", "r15"};
+static const char* registerNames32[] = {"eax", "ecx", "edx",  "ebx",  "esp",  "ebp",
+                                        "esi", "edi", "r8d",  "r9d",  "r10d", "r11d",
+                                        "r12d", "r13d", "r14d", "r15d"};
+static const char* registerNames8[]  = {"al",  "cl",  "dl",   "bl",   "spl",  "bpl",
+                                        "sil", "dil", "r8b",  "r9b",  "r10b", "r11b",
+                                        "r12b", "r13b", "r14b", "r15b"};
+// Caller saved registers come first, a value that does not live across a call then costs no save
+// and restore in the prologue and epilogue.
+static const X86Register allocatableRegisters[] = {
+    X86Register::Rcx, X86Register::Rdx, X86Register::Rsi, X86Register::Rdi,
+    X86Register::R8,  X86Register::R9,  X86Register::R10, X86Register::Rbx,
+    X86Register::R12, X86Register::R13, X86Register::R14, X86Register::R15,
+};
+static constexpr uint32_t CALLER_SAVED_COUNT = 7;
+static const X86Register  argumentRegisters[] = {X86Register::Rdi, X86Register::Rsi,
+                                                 X86Register::Rdx, X86Register::Rcx,
+                                                 X86Register::R8,  X86Register::R9};
+static constexpr size_t   ARGUMENT_REGISTER_COUNT = 6;
+
+bool X86Operand::operator==(const X86Operand& other) const {
+    if (this->kind != other.kind) {
+        return false;
+    }
+    switch (this->kind) {
+    case X86OperandKind::Register: {
+        return this->reg == other.reg;
+    } break;
+    case X86OperandKind::Immediate: {
+        return this->immediate == other.immediate;
+    } break;
+    case X86OperandKind::Memory: {
+        return this->reg == other.reg && this->offset == other.offset;
+    } break;
+    case X86OperandKind::Symbol: {
+        return this->symbol == other.symbol;
+    } break;
+    }
+    return false;
+}
+static X86Operand createRegister(X86Register reg) {
+    return {X86OperandKind::Register, reg, 0, 0, ""};
+}
+static X86Operand createImmediate(int64_t value) {
+    return {X86OperandKind::Immediate, X86Register::Rax, 0, value, ""};
+}
+static X86Operand createMemory(X86Register base, int32_t offset) {
+    return {X86OperandKind::Memory, base, offset, 0, ""};
+}
+static X86Operand createSymbol(std::string symbol) {
+    return {X86OperandKind::Symbol, X86Register::Rax, 0, 0, symbol};
+}
+static bool is64Bit(IrType type) {
+    return type.type != IrTypeType::I32;
+}
+static bool fitsInImmediate(int64_t value) {
+    return value == (int32_t)value;
+}
+static std::string formatOperand(X86Operand operand, bool wide) {
+    switch (operand.kind) {
+    case X86OperandKind::Register: {
+        return (wide ? registerNames64 : registerNames32)[(size_t)operand.reg];
+    } break;
+    case X86OperandKind::Immediate: {
+        return std::to_string(wide ? operand.immediate : (int32_t)operand.immediate);
+    } break;
+    case X86OperandKind::Memory: {
+        std::string memory = std::string(wide ? "QWORD" : "DWORD") + " PTR [" +
+                             registerNames64[(size_t)operand.reg];
+        if (operand.offset < 0) {
+            memory += " - " + std::to_string(-(int64_t)operand.offset);
+        } else if (operand.offset > 0) {
+            memory += " + " + std::to_string(operand.offset);
+        }
+        return memory + "]";
+    } break;
+    case X86OperandKind::Symbol: {
+        return std::string(wide ? "QWORD" : "DWORD") + " PTR [rip + " + operand.symbol + "]";
+    } break;
+    }
+    return "";
+}
+static const char* getConditionCode(IrInstructionType type) {
+    switch (type) {
+    case IrInstructionType::Eq: {
+        return "e";
+    } break;
+    case IrInstructionType::Ne: {
+        return "ne";
+    } break;
+    case IrInstructionType::Slt: {
+        return "l";
+    } break;
+    case IrInstructionType::Sle: {
+        return "le";
+    } break;
+    case IrInstructionType::Sgt: {
+        return "g";
+    } break;
+    case IrInstructionType::Sge: {
+        return "ge";
+    } break;
+    case IrInstructionType::Ult: {
+        return "b";
+    } break;
+    case IrInstructionType::Ule: {
+        return "be";
+    } break;
+    case IrInstructionType::Ugt: {
+        return "a";
+    } break;
+    case IrInstructionType::Uge: {
+        return "ae";
+    } break;
+    default: {
+        std::printf("ICE: Instruction type %llu is not a comparison\n", type);
+        std::exit(1);
+    } break;
+    }
+}
+// The comparison that holds exactly when `type` does not.
+static IrInstructionType invertComparison(IrInstructionType type) {
+    switch (type) {
+    case IrInstructionType::Eq: {
+        return IrInstructionType::Ne;
+    } break;
+    case IrInstructionType::Ne: {
+        return IrInstructionType::Eq;
+    } break;
+    case IrInstructionType::Slt: {
+        return IrInstructionType::Sge;
+    } break;
+    case IrInstructionType::Sle: {
+        return IrInstructionType::Sgt;
+    } break;
+    case IrInstructionType::Sgt: {
+        return IrInstructionType::Sle;
+    } break;
+    case IrInstructionType::Sge: {
+        return IrInstructionType::Slt;
+    } break;
+    case IrInstructionType::Ult: {
+        return IrInstructionType::Uge;
+    } break;
+    case IrInstructionType::Ule: {
+        return IrInstructionType::Ugt;
+    } break;
+    case IrInstructionType::Ugt: {
+        return IrInstructionType::Ule;
+    } break;
+    default: {
+        return IrInstructionType::Ult;
+    } break;
+    }
+}
+// The comparison that gives the same result with its operands swapped.
+static IrInstructionType swapComparison(IrInstructionType type) {
+    switch (type) {
+    case IrInstructionType::Slt: {
+        return IrInstructionType::Sgt;
+    } break;
+    case IrInstructionType::Sle: {
+        return IrInstructionType::Sge;
+    } break;
+    case IrInstructionType::Sgt: {
+        return IrInstructionType::Slt;
+    } break;
+    case IrInstructionType::Sge: {
+        return IrInstructionType::Sle;
+    } break;
+    case IrInstructionType::Ult: {
+        return IrInstructionType::Ugt;
+    } break;
+    case IrInstructionType::Ule: {
+        return IrInstructionType::Uge;
+    } break;
+    case IrInstructionType::Ugt: {
+        return IrInstructionType::Ult;
+    } break;
+    case IrInstructionType::Uge: {
+        return IrInstructionType::Ule;
+    } break;
+    default: {
+        return type;
+    } break;
+    }
+}
+// Register to compute a result in, the destination itself when it is one.
+static X86Operand getTarget(X86Operand out) {
+    return out.kind == X86OperandKind::Register ? out : createRegister(X86Register::Rax);
+}
+static bool isReserve(IrValue* value) {
+    return value->kind == IrValueKind::Instruction &&
+           static_cast<IrInstruction*>(value)->type == IrInstructionType::Reserve;
+}
+X86Gen::X86Gen(PassManager* _passManager) {
+    this->passManager    = _passManager;
+    this->module         = _passManager->getModule();
+    this->func           = nullptr;
+    this->allocation     = nullptr;
+    this->spillOffset    = 0;
+    this->frameSize      = 0;
+    this->nextBlock      = nullptr;
+    this->fusedCompare   = nullptr;
+    this->fusedCondition = IrInstructionType::Ne;
+    this->functionIndex  = 0;
+    this->stubCount      = 0;
+
+    this->registerInfo.count = sizeof(allocatableRegisters) / sizeof(allocatableRegisters[0]);
+    for (uint32_t i = 0; i < this->registerInfo.count; ++i) {
+        this->registerInfo.callerSaved.push_back(i < CALLER_SAVED_COUNT);
+    }
+}
+X86Gen::~X86Gen() {
+}
+void X86Gen::emit(const char* format, ...) {
+    va_list args;
+    va_list copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    int length = std::vsnprintf(nullptr, 0, format, copy);
+    va_end(copy);
+    std::string line(length, '\0');
+    std::vsnprintf(line.data(), length + 1, format, args);
+    va_end(args);
+    this->assembly += line;
+}
+void X86Gen::generate() {
+    this->assembly.clear();
+    this->emit("    .intel_syntax noprefix\n");
+    for (IrObject* obj : this->module->objects) {
+        this->emitObject(obj);
+    }
+    // Every function is emitted by its own X86Gen into its own buffer, the buffers are joined in
+    // module order. Labels carry the index of the function, so they do not depend on the thread.
+    std::vector<IrFunction*>& functions = this->module->functions;
+    std::vector<std::string>  buffers(functions.size());
+    this->passManager->getThreadPool()->parallelFor(functions.size(), [&](size_t index) {
+        if (functions.at(index)->blocks.empty()) {
+            return;
+        }
+        X86Gen functionGen(this->passManager);
+        functionGen.functionIndex = index;
+        functionGen.emitFunction(functions.at(index));
+        buffers.at(index) = std::move(functionGen.assembly);
+    });
+    for (std::string& buffer : buffers) {
+        this->assembly += buffer;
+    }
+    this->emit("    .section .note.GNU-stack,\"\",@progbits\n");
+}
+std::string X86Gen::getAssembly() {
+    return this->assembly;
+}
+void X86Gen::emitObject(IrObject* obj) {
+    if (obj->value.type != IrOperandType::Const) {
+        std::printf("TODO: Initializer of global `%s` is not a constant\n", obj->name.c_str());
+        std::exit(1);
+    }
+    std::string symbol = obj->getSymbolName();
+    bool        wide   = is64Bit(obj->type);
+    this->emit("    .section .data.%s,\"aw\",@progbits\n", symbol.c_str());
+    this->emit("    .globl %s\n", symbol.c_str());
+    this->emit("    .p2align %d\n", wide ? 3 : 2);
+    this->emit("%s:\n", symbol.c_str());
+    this->emit("    .%s %s\n", wide ? "quad" : "long",
+               formatOperand(createImmediate(obj->value.constant), wide).c_str());
+}
+std::string X86Gen::getBlockLabel(IrBlock* block) {
+    return ".LBB" + std::to_string(this->functionIndex) + "_" + std::to_string(block->number);
+}
+// Below the saved rbp come the callee saved registers the function uses, then one 8 byte slot per
+// `reserve`, then the spill slots, padded so that rsp stays 16 byte aligned for calls.
+void X86Gen::emitFunction(IrFunction* function) {
+    IrRegisterAllocation registers(function, this->passManager->getAnalyses(function),
+                                   &this->registerInfo);
+    this->func       = function;
+    this->allocation = &registers;
+    this->savedRegisters.clear();
+    this->reserveOffsets.clear();
+    for (uint32_t i = CALLER_SAVED_COUNT; i < this->registerInfo.count; ++i) {
+        if (registers.isRegisterUsed(i)) {
+            this->savedRegisters.push_back(allocatableRegisters[i]);
+        }
+    }
+    int32_t offset = 8 * this->savedRegisters.size();
+    for (IrBlock* block : function->blocks) {
+        for (IrInstruction* inst : block->insts) {
+            if (inst->type == IrInstructionType::Reserve) {
+                offset += 8;
+                this->reserveOffsets[inst] = -offset;
+            }
+        }
+    }
+    this->spillOffset = -offset;
+    offset += 8 * registers.getSpillSlotCount();
+    this->frameSize = offset - 8 * this->savedRegisters.size() + (offset % 16 ? 8 : 0);
+
+    std::string symbol = function->getSymbolName();
+    this->emit("    .section .text.%s,\"ax\",@progbits\n", symbol.c_str());
+    this->emit("    .globl %s\n", symbol.c_str());
+    this->emit("    .type %s, @function\n", symbol.c_str());
+    this->emit("%s:\n", symbol.c_str());
+    this->emitPrologue();
+    // Arguments arrive in the System V argument registers and above the return address.
+    std::vector<X86Move> moves;
+    for (size_t i = 0; i < function->arguments.size(); ++i) {
+        Location location = registers.getOutputLocation(function->arguments.at(i));
+        if (location.kind == LocationKind::None) {
+            continue;
+        }
+        X86Operand from = createMemory(X86Register::Rbp, 16 + 8 * (i - ARGUMENT_REGISTER_COUNT));
+        if (i < ARGUMENT_REGISTER_COUNT) {
+            from = createRegister(argumentRegisters[i]);
+        }
+        moves.push_back({from, this->getLocation(location)});
+    }
+    this->emitParallelMove(moves);
+    std::vector<IrBlock*>& order = registers.getBlockOrder();
+    for (size_t i = 0; i < order.size(); ++i) {
+        this->nextBlock = i + 1 < order.size() ? order.at(i + 1) : nullptr;
+        this->emit("%s:\n", this->getBlockLabel(order.at(i)).c_str());
+        for (IrInstruction* inst : order.at(i)->insts) {
+            if (inst->type == IrInstructionType::Phi) {
+                continue;
+            }
+            this->emitInstruction(inst);
+            if (this->isSiblingCall(inst)) {
+                break;
+            }
+        }
+    }
+    this->emit("    .size %s, .-%s\n", symbol.c_str(), symbol.c_str());
+    this->allocation = nullptr;
+    this->func       = nullptr;
+}
+void X86Gen::emitPrologue() {
+    this->emit("    push rbp\n");
+    this->emit("    mov rbp, rsp\n");
+    for (X86Register reg : this->savedRegisters) {
+        this->emit("    push %s\n", registerNames64[(size_t)reg]);
+    }
+    if (this->frameSize > 0) {
+        this->emit("    sub rsp, %d\n", this->frameSize);
+    }
+}
+void X86Gen::emitEpilogue() {
+    this->emitFrameRestore();
+    this->emit("    ret\n");
+}
+// Leaves rsp pointing at the return address with rbp and the callee saved registers as the caller
+// had them. Argument registers are not touched.
+void X86Gen::emitFrameRestore() {
+    if (this->savedRegisters.empty()) {
+        this->emit("    leave\n");
+    } else {
+        this->emit("    lea rsp, [rbp - %zu]\n", 8 * this->savedRegisters.size());
+        for (auto it = this->savedRegisters.rbegin(); it != this->savedRegisters.rend(); ++it) {
+            this->emit("    pop %s\n", registerNames64[(size_t)*it]);
+        }
+        this->emit("    pop rbp\n");
+    }
+}
+X86Operand X86Gen::getLocation(Location location) {
+    switch (location.kind) {
+    case LocationKind::Register: {
+        return createRegister(allocatableRegisters[location.index]);
+    } break;
+    case LocationKind::Stack: {
+        return createMemory(X86Register::Rbp, this->spillOffset - 8 * (location.index + 1));
+    } break;
+    case LocationKind::Constant: {
+        return createImmediate(location.constant);
+    } break;
+    default: {
+        std::printf("ICE: Asked for the x86 operand of a value without a location\n");
+        std::exit(1);
+    } break;
+    }
+}
+X86Operand X86Gen::getInput(IrOperand& operand, IrInstruction* user) {
+    switch (operand.type) {
+    case IrOperandType::Const: {
+        return createImmediate(operand.constant);
+    } break;
+    case IrOperandType::SSA: {
+        if (isReserve(operand.value)) {
+            std::printf("TODO: Using the address of a `reserve` as a value\n");
+            std::exit(1);
+        }
+        return this->getLocation(this->allocation->getInputLocation(operand.value, user));
+    } break;
+    default: {
+        std::printf("TODO: x86 operand of type %llu\n", operand.type);
+        std::exit(1);
+    } break;
+    }
+}
+// An immediate when nothing needs to be written, the value is dead or rematerialized where used.
+X86Operand X86Gen::getOutput(IrInstruction* inst) {
+    Location location = this->allocation->getOutputLocation(inst);
+    if (location.kind == LocationKind::None || location.kind == LocationKind::Constant) {
+        return createImmediate(0);
+    }
+    return this->getLocation(location);
+}
+// Memory operand for a `load` or `store`. Pointers that are not a global or a `reserve` go through
+// r11.
+X86Operand X86Gen::getAddress(IrOperand& pointer, IrInstruction* user) {
+    if (pointer.type == IrOperandType::Global) {
+        return createSymbol(pointer.object->getSymbolName());
+    }
+    if (pointer.type == IrOperandType::SSA && isReserve(pointer.value)) {
+        return createMemory(X86Register::Rbp,
+                            this->reserveOffsets.at(static_cast<IrInstruction*>(pointer.value)));
+    }
+    this->emitMove(createRegister(X86Register::R11), this->getInput(pointer, user));
+    return createMemory(X86Register::R11, 0);
+}
+// Full 64 bit move between any two operands, going through rax when neither side is a register. A
+// move to an immediate, see getOutput, does nothing. Only `mov` is used, moves may sit between a
+// compare and the branch on its flags.
+void X86Gen::emitMove(X86Operand to, X86Operand from) {
+    if (to == from || to.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    if (to.kind == X86OperandKind::Register) {
+        if (from.kind == X86OperandKind::Immediate && !fitsInImmediate(from.immediate)) {
+            if (from.immediate == (int64_t)(uint32_t)from.immediate) {
+                this->emit("    mov %s, %s\n", formatOperand(to, false).c_str(),
+                           formatOperand(from, false).c_str());
+            } else {
+                this->emit("    movabs %s, %lld\n", formatOperand(to, true).c_str(),
+                           (long long)from.immediate);
+            }
+            return;
+        }
+        this->emit("    mov %s, %s\n", formatOperand(to, true).c_str(),
+                   formatOperand(from, true).c_str());
+        return;
+    }
+    if (from.kind != X86OperandKind::Register &&
+        !(from.kind == X86OperandKind::Immediate && fitsInImmediate(from.immediate))) {
+        this->emitMove(createRegister(X86Register::Rax), from);
+        from = createRegister(X86Register::Rax);
+    }
+    this->emit("    mov %s, %s\n", formatOperand(to, true).c_str(),
+               formatOperand(from, true).c_str());
+}
+// Moves whose destination is no longer needed as a source go first. When only cycles are left one
+// destination is saved to r11, which breaks its cycle. Every location is written at most once, so
+// the rest of that cycle and whatever hangs off it drains before r11 could be needed again.
+void X86Gen::emitParallelMove(std::vector<X86Move> moves) {
+    std::vector<X86Move> pending;
+    for (X86Move& move : moves) {
+        if (!(move.from == move.to)) {
+            pending.push_back(move);
+        }
+    }
+    while (!pending.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < pending.size() && !progress; ++i) {
+            bool blocked = false;
+            for (size_t j = 0; j < pending.size(); ++j) {
+                blocked |= j != i && pending.at(j).from == pending.at(i).to;
+            }
+            if (!blocked) {
+                this->emitMove(pending.at(i).to, pending.at(i).from);
+                pending.erase(pending.begin() + i);
+                progress = true;
+            }
+        }
+        if (progress) {
+            continue;
+        }
+        X86Operand saved = pending.front().to;
+        this->emitMove(createRegister(X86Register::R11), saved);
+        for (X86Move& move : pending) {
+            if (move.from == saved) {
+                move.from = createRegister(X86Register::R11);
+            }
+        }
+    }
+}
+void X86Gen::emitInstruction(IrInstruction* inst) {
+    std::vector<X86Move> moves;
+    for (RegMove& move : this->allocation->getMovesBefore(inst)) {
+        moves.push_back({this->getLocation(move.from), this->getLocation(move.to)});
+    }
+    this->emitParallelMove(moves);
+    switch (inst->type) {
+    case IrInstructionType::Reserve: {
+    } break;
+    case IrInstructionType::Store: {
+        this->emitStore(inst);
+    } break;
+    case IrInstructionType::Load: {
+        this->emitLoad(inst);
+    } break;
+    case IrInstructionType::Trunc:
+    case IrInstructionType::Sext:
+    case IrInstructionType::Zext: {
+        this->emitCast(inst);
+    } break;
+    case IrInstructionType::Const: {
+        this->emitMove(this->getOutput(inst), createImmediate(inst->getOperand(0).constant));
+    } break;
+    case IrInstructionType::Add:
+    case IrInstructionType::Sub:
+    case IrInstructionType::Mul:
+    case IrInstructionType::And: {
+        this->emitBinary(inst);
+    } break;
+    case IrInstructionType::Sdiv:
+    case IrInstructionType::Udiv:
+    case IrInstructionType::Srem:
+    case IrInstructionType::Urem:
+    case IrInstructionType::Smulh:
+    case IrInstructionType::Umulh: {
+        this->emitDoubleWidth(inst);
+    } break;
+    case IrInstructionType::Shl:
+    case IrInstructionType::Lshr:
+    case IrInstructionType::Ashr: {
+        this->emitShift(inst);
+    } break;
+    case IrInstructionType::Eq:
+    case IrInstructionType::Ne:
+    case IrInstructionType::Slt:
+    case IrInstructionType::Sle:
+    case IrInstructionType::Sgt:
+    case IrInstructionType::Sge:
+    case IrInstructionType::Ult:
+    case IrInstructionType::Ule:
+    case IrInstructionType::Ugt:
+    case IrInstructionType::Uge: {
+        this->emitCompare(inst);
+    } break;
+    case IrInstructionType::Call: {
+        if (this->isSiblingCall(inst)) {
+            this->emitSiblingCall(inst);
+        } else {
+            this->emitCall(inst);
+        }
+    } break;
+    case IrInstructionType::Return: {
+        this->emitReturn(inst);
+    } break;
+    case IrInstructionType::Br: {
+        this->emitEdge(inst->parent, inst->getOperand(0).block, true);
+    } break;
+    case IrInstructionType::CondBr: {
+        this->emitCondBranch(inst);
+    } break;
+    default: {
+        std::printf("TODO: x86 instruction selection for instruction type %llu\n", inst->type);
+        std::exit(1);
+    } break;
+    }
+}
+void X86Gen::emitLoad(IrInstruction* inst) {
+    X86Operand out = this->getOutput(inst);
+    if (out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    bool       wide    = is64Bit(inst->valueType);
+    X86Operand address = this->getAddress(inst->getOperand(0), inst);
+    X86Operand target  = getTarget(out);
+    this->emit("    mov %s, %s\n", formatOperand(target, wide).c_str(),
+               formatOperand(address, wide).c_str());
+    this->emitMove(out, target);
+}
+void X86Gen::emitStore(IrInstruction* inst) {
+    IrOperand& value   = inst->getOperand(1);
+    bool       wide    = is64Bit(value.irType);
+    X86Operand source  = this->getInput(value, inst);
+    X86Operand address = this->getAddress(inst->getOperand(0), inst);
+    if (source.kind == X86OperandKind::Memory ||
+        (source.kind == X86OperandKind::Immediate && wide && !fitsInImmediate(source.immediate))) {
+        this->emitMove(createRegister(X86Register::Rax), source);
+        source = createRegister(X86Register::Rax);
+    }
+    this->emit("    mov %s, %s\n", formatOperand(address, wide).c_str(),
+               formatOperand(source, wide).c_str());
+}
+// Registers holding an i32 have undefined upper halves, so `zext` and `sext` always write all 64
+// bits, writing a 32 bit register clears the upper half.
+void X86Gen::emitCast(IrInstruction* inst) {
+    X86Operand out = this->getOutput(inst);
+    if (out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    IrOperand& operand = inst->getOperand(0);
+    bool       narrow  = operand.irType.type == IrTypeType::I32;
+    X86Operand source  = this->getInput(operand, inst);
+    if (source.kind == X86OperandKind::Immediate) {
+        int64_t value = source.immediate;
+        if (inst->type != IrInstructionType::Zext) {
+            value = (int32_t)value;
+        } else if (narrow) {
+            value = (uint32_t)value;
+        }
+        this->emitMove(out, createImmediate(value));
+        return;
+    }
+    X86Operand target = getTarget(out);
+    if (inst->type == IrInstructionType::Sext && narrow) {
+        this->emit("    movsxd %s, %s\n", formatOperand(target, true).c_str(),
+                   formatOperand(source, false).c_str());
+    } else if (inst->type == IrInstructionType::Trunc || narrow) {
+        if (!(inst->type == IrInstructionType::Trunc && target == source)) {
+            this->emit("    mov %s, %s\n", formatOperand(target, false).c_str(),
+                       formatOperand(source, false).c_str());
+        }
+    } else {
+        this->emitMove(target, source);
+    }
+    this->emitMove(out, target);
+}
+// Two address form, the left operand is copied into the destination first. A destination that
+// holds the right operand of a `sub` is computed in rax instead.
+void X86Gen::emitBinary(IrInstruction* inst) {
+    X86Operand out = this->getOutput(inst);
+    if (out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    bool       wide = is64Bit(inst->valueType);
+    X86Operand lhs  = this->getInput(inst->getOperand(0), inst);
+    X86Operand rhs  = this->getInput(inst->getOperand(1), inst);
+    if (inst->type != IrInstructionType::Sub &&
+        (lhs.kind == X86OperandKind::Immediate || rhs == out)) {
+        std::swap(lhs, rhs);
+    }
+    if (rhs.kind == X86OperandKind::Immediate && wide && !fitsInImmediate(rhs.immediate)) {
+        this->emitMove(createRegister(X86Register::R11), rhs);
+        rhs = createRegister(X86Register::R11);
+    }
+    X86Operand target = out;
+    if (out.kind != X86OperandKind::Register || rhs == out) {
+        target = createRegister(X86Register::Rax);
+    }
+    const char* mnemonic = "add";
+    if (inst->type == IrInstructionType::Sub) {
+        mnemonic = "sub";
+    } else if (inst->type == IrInstructionType::Mul) {
+        mnemonic = "imul";
+    } else if (inst->type == IrInstructionType::And) {
+        mnemonic = "and";
+    }
+    this->emitMove(target, lhs);
+    this->emit("    %s %s, %s\n", mnemonic, formatOperand(target, wide).c_str(),
+               formatOperand(rhs, wide).c_str());
+    this->emitMove(out, target);
+}
+// Division, remainder and the high half of a 64 bit product use the one operand forms on rdx:rax,
+// with the right operand in r11. rdx is allocatable, so it is saved around the instruction unless
+// it is the destination. The high half of a 32 bit product is the upper half of a 64 bit `imul`
+// on the extended operands.
+void X86Gen::emitDoubleWidth(IrInstruction* inst) {
+    X86Operand out = this->getOutput(inst);
+    if (out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    IrInstructionType type   = inst->type;
+    bool              wide   = is64Bit(inst->valueType);
+    bool              isHigh = type == IrInstructionType::Smulh || type == IrInstructionType::Umulh;
+    bool isSigned = type == IrInstructionType::Sdiv || type == IrInstructionType::Srem ||
+                    type == IrInstructionType::Smulh;
+    X86Operand lhs = this->getInput(inst->getOperand(0), inst);
+    X86Operand rhs = this->getInput(inst->getOperand(1), inst);
+    X86Operand rax = createRegister(X86Register::Rax);
+    X86Operand r11 = createRegister(X86Register::R11);
+    if (isHigh && !wide) {
+        X86Operand operands[] = {lhs, rhs};
+        X86Operand targets[]  = {rax, r11};
+        for (size_t i = 0; i < 2; ++i) {
+            if (operands[i].kind == X86OperandKind::Immediate) {
+                int64_t value = operands[i].immediate;
+                this->emitMove(targets[i], createImmediate(isSigned ? (int64_t)(int32_t)value
+                                                                    : (int64_t)(uint32_t)value));
+            } else {
+                this->emit("    %s %s, %s\n", isSigned ? "movsxd" : "mov",
+                           formatOperand(targets[i], isSigned).c_str(),
+                           formatOperand(operands[i], false).c_str());
+            }
+        }
+        this->emit("    imul rax, r11\n");
+        this->emit("    %s rax, 32\n", isSigned ? "sar" : "shr");
+        this->emitMove(out, rax);
+        return;
+    }
+    bool saveRdx = !(out == createRegister(X86Register::Rdx));
+    this->emitMove(r11, rhs);
+    this->emitMove(rax, lhs);
+    if (saveRdx) {
+        this->emit("    push rdx\n");
+    }
+    const char* mnemonic = isSigned ? "idiv" : "div";
+    if (isHigh) {
+        mnemonic = isSigned ? "imul" : "mul";
+    } else if (isSigned) {
+        this->emit("    %s\n", wide ? "cqo" : "cdq");
+    } else {
+        this->emit("    xor edx, edx\n");
+    }
+    this->emit("    %s %s\n", mnemonic, formatOperand(r11, wide).c_str());
+    if (type != IrInstructionType::Sdiv && type != IrInstructionType::Udiv) {
+        this->emit("    mov %s, %s\n", formatOperand(rax, wide).c_str(), wide ? "rdx" : "edx");
+    }
+    if (saveRdx) {
+        this->emit("    pop rdx\n");
+    }
+    this->emitMove(out, rax);
+}
+// A constant shift amount is masked to the width like the hardware does, a variable one has to
+// be in cl, so rcx is saved around the shift unless it is the destination.
+void X86Gen::emitShift(IrInstruction* inst) {
+    X86Operand out = this->getOutput(inst);
+    if (out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    bool        wide     = is64Bit(inst->valueType);
+    X86Operand  lhs      = this->getInput(inst->getOperand(0), inst);
+    X86Operand  amount   = this->getInput(inst->getOperand(1), inst);
+    const char* mnemonic = "shl";
+    if (inst->type == IrInstructionType::Lshr) {
+        mnemonic = "shr";
+    } else if (inst->type == IrInstructionType::Ashr) {
+        mnemonic = "sar";
+    }
+    if (amount.kind == X86OperandKind::Immediate) {
+        X86Operand target = getTarget(out);
+        this->emitMove(target, lhs);
+        this->emit("    %s %s, %lld\n", mnemonic, formatOperand(target, wide).c_str(),
+                   (long long)(amount.immediate & (wide ? 63 : 31)));
+        this->emitMove(out, target);
+        return;
+    }
+    X86Operand rax     = createRegister(X86Register::Rax);
+    bool       saveRcx = !(out == createRegister(X86Register::Rcx));
+    this->emitMove(rax, lhs);
+    if (saveRcx) {
+        this->emit("    push rcx\n");
+    }
+    this->emitMove(createRegister(X86Register::Rcx), amount);
+    this->emit("    %s %s, cl\n", mnemonic, formatOperand(rax, wide).c_str());
+    if (saveRcx) {
+        this->emit("    pop rcx\n");
+    }
+    this->emitMove(out, rax);
+}
+void X86Gen::emitCompare(IrInstruction* inst) {
+    bool fused = inst->next && inst->next->type == IrInstructionType::CondBr &&
+                 inst->next->getOperandValue(0) == inst && inst->getNumUses() == 1;
+    X86Operand out = this->getOutput(inst);
+    if (!fused && out.kind == X86OperandKind::Immediate) {
+        return;
+    }
+    IrInstructionType type = inst->type;
+    bool              wide = is64Bit(inst->getOperand(0).irType);
+    X86Operand        lhs  = this->getInput(inst->getOperand(0), inst);
+    X86Operand        rhs  = this->getInput(inst->getOperand(1), inst);
+    if (lhs.kind == X86OperandKind::Immediate) {
+        std::swap(lhs, rhs);
+        type = swapComparison(type);
+    }
+    if (lhs.kind == X86OperandKind::Immediate ||
+        (lhs.kind != X86OperandKind::Register && rhs.kind == X86OperandKind::Memory)) {
+        this->emitMove(createRegister(X86Register::Rax), lhs);
+        lhs = createRegister(X86Register::Rax);
+    }
+    if (rhs.kind == X86OperandKind::Immediate && wide && !fitsInImmediate(rhs.immediate)) {
+        this->emitMove(createRegister(X86Register::R11), rhs);
+        rhs = createRegister(X86Register::R11);
+    }
+    this->emit("    cmp %s, %s\n", formatOperand(lhs, wide).c_str(),
+               formatOperand(rhs, wide).c_str());
+    if (fused) {
+        this->fusedCompare   = inst;
+        this->fusedCondition = type;
+        return;
+    }
+    X86Operand target = getTarget(out);
+    this->emit("    set%s %s\n", getConditionCode(type), registerNames8[(size_t)target.reg]);
+    this->emit("    movzx %s, %s\n", registerNames32[(size_t)target.reg],
+               registerNames8[(size_t)target.reg]);
+    this->emitMove(out, target);
+}
+// Stack arguments are pushed before the argument registers are filled, the pushes may still read
+// registers the parallel move overwrites. Values live across the call are never in caller saved
+// registers, the allocator blocks those at every call.
+void X86Gen::emitCall(IrInstruction* inst) {
+    size_t count      = inst->numOperands - 1;
+    size_t stackCount = count > ARGUMENT_REGISTER_COUNT ? count - ARGUMENT_REGISTER_COUNT : 0;
+    size_t padding    = stackCount % 2;
+    if (padding) {
+        this->emit("    sub rsp, 8\n");
+    }
+    for (size_t i = count; i > ARGUMENT_REGISTER_COUNT; --i) {
+        X86Operand argument = this->getInput(inst->getOperand(i), inst);
+        if (argument.kind == X86OperandKind::Immediate && !fitsInImmediate(argument.immediate)) {
+            this->emitMove(createRegister(X86Register::Rax), argument);
+            argument = createRegister(X86Register::Rax);
+        }
+        this->emit("    push %s\n", formatOperand(argument, true).c_str());
+    }
+    std::vector<X86Move> moves;
+    for (size_t i = 0; i < count && i < ARGUMENT_REGISTER_COUNT; ++i) {
+        moves.push_back({this->getInput(inst->getOperand(i + 1), inst),
+                         createRegister(argumentRegisters[i])});
+    }
+    this->emitParallelMove(moves);
+    this->emit("    call %s\n", inst->getOperand(0).function->getSymbolName().c_str());
+    if (stackCount + padding > 0) {
+        this->emit("    add rsp, %zu\n", 8 * (stackCount + padding));
+    }
+    if (inst->hasResult) {
+        this->emitMove(this->getOutput(inst), createRegister(X86Register::Rax));
+    }
+}
+// A call the function returns from right away, with its value or without any, either in the same
+// block or in the block it jumps to. It can become a jump when its stack arguments fit where the
+// function's own stack arguments are, the callee then returns to our caller directly. A slot
+// passed to the callee would point into the frame the jump gives up, those calls stay calls.
+bool X86Gen::isSiblingCall(IrInstruction* inst) {
+    if (inst->type != IrInstructionType::Call || !inst->next) {
+        return false;
+    }
+    for (size_t i = 1; i < inst->numOperands; ++i) {
+        IrOperand& operand = inst->getOperand(i);
+        if (operand.type == IrOperandType::SSA && isReserve(operand.value)) {
+            return false;
+        }
+    }
+    IrInstruction* ret = inst->next;
+    if (ret->type == IrInstructionType::Br) {
+        ret = ret->getOperand(0).block->insts.front();
+    }
+    if (ret->type != IrInstructionType::Return) {
+        return false;
+    }
+    IrOperand& value       = ret->getOperand(0);
+    bool       returnsCall = value.type == IrOperandType::SSA && value.value == inst;
+    if (value.type != IrOperandType::Type && !returnsCall) {
+        return false;
+    }
+    size_t count = inst->numOperands - 1;
+    return count <= std::max(this->func->arguments.size(), ARGUMENT_REGISTER_COUNT);
+}
+// Stack arguments overwrite our own, which were moved to their locations in the prologue. The
+// frame is torn down after the arguments are in place, nothing it restores is an argument.
+void X86Gen::emitSiblingCall(IrInstruction* inst) {
+    std::vector<X86Move> moves;
+    for (size_t i = 0; i + 1 < inst->numOperands; ++i) {
+        X86Operand to = createMemory(X86Register::Rbp, 16 + 8 * (i - ARGUMENT_REGISTER_COUNT));
+        if (i < ARGUMENT_REGISTER_COUNT) {
+            to = createRegister(argumentRegisters[i]);
+        }
+        moves.push_back({this->getInput(inst->getOperand(i + 1), inst), to});
+    }
+    this->emitParallelMove(moves);
+    this->emitFrameRestore();
+    this->emit("    jmp %s\n", inst->getOperand(0).function->getSymbolName().c_str());
+}
+void X86Gen::emitReturn(IrInstruction* inst) {
+    if (inst->numOperands > 0 && inst->getOperand(0).type != IrOperandType::Type) {
+        this->emitMove(createRegister(X86Register::Rax), this->getInput(inst->getOperand(0), inst));
+    }
+    this->emitEpilogue();
+}
+// The edge without moves is taken by the conditional jump, when both edges have moves the true
+// edge gets a stub label behind the false edge.
+void X86Gen::emitCondBranch(IrInstruction* inst) {
+    IrBlock*          block     = inst->parent;
+    IrBlock*          ifTrue    = inst->getOperand(1).block;
+    IrBlock*          ifFalse   = inst->getOperand(2).block;
+    IrInstructionType condition = IrInstructionType::Ne;
+    if (this->fusedCompare && inst->getOperandValue(0) == this->fusedCompare) {
+        condition = this->fusedCondition;
+    } else {
+        X86Operand value = this->getInput(inst->getOperand(0), inst);
+        bool       wide  = is64Bit(inst->getOperand(0).irType);
+        if (value.kind == X86OperandKind::Immediate) {
+            this->emitEdge(block, value.immediate ? ifTrue : ifFalse, true);
+            return;
+        }
+        if (value.kind == X86OperandKind::Register) {
+            this->emit("    test %s, %s\n", formatOperand(value, wide).c_str(),
+                       formatOperand(value, wide).c_str());
+        } else {
+            this->emit("    cmp %s, 0\n", formatOperand(value, wide).c_str());
+        }
+    }
+    this->fusedCompare = nullptr;
+    bool trueMoves     = !this->allocation->getEdgeMoves(block, ifTrue).empty();
+    bool falseMoves    = !this->allocation->getEdgeMoves(block, ifFalse).empty();
+    if (!trueMoves && !falseMoves && ifTrue == this->nextBlock) {
+        this->emit("    j%s %s\n", getConditionCode(invertComparison(condition)),
+                   this->getBlockLabel(ifFalse).c_str());
+    } else if (!trueMoves) {
+        this->emit("    j%s %s\n", getConditionCode(condition),
+                   this->getBlockLabel(ifTrue).c_str());
+        this->emitEdge(block, ifFalse, true);
+    } else if (!falseMoves) {
+        this->emit("    j%s %s\n", getConditionCode(invertComparison(condition)),
+                   this->getBlockLabel(ifFalse).c_str());
+        this->emitEdge(block, ifTrue, true);
+    } else {
+        std::string stub =
+            ".LE" + std::to_string(this->functionIndex) + "_" + std::to_string(this->stubCount++);
+        this->emit("    j%s %s\n", getConditionCode(condition), stub.c_str());
+        this->emitEdge(block, ifFalse, false);
+        this->emit("%s:\n", stub.c_str());
+        this->emitEdge(block, ifTrue, true);
+    }
+}
+void X86Gen::emitEdge(IrBlock* pred, IrBlock* succ, bool canFallThrough) {
+    std::vector<X86Move> moves;
+    for (RegMove& move : this->allocation->getEdgeMoves(pred, succ)) {
+        moves.push_back({this->getLocation(move.from), this->getLocation(move.to)});
+    }
+    this->emitParallelMove(moves);
+    if (!canFallThrough || succ != this->nextBlock) {
+        this->emit("    jmp %s\n", this->getBlockLabel(succ).c_str());
+    }
+}
+}; // namespace language
@@ -0,0 +1,169 @@
+#!/bin/python3
+# Runs the tests against the binaries `build.py compile` writes, `build.py test` calls this.
+#
+# opt/<pass>/<name>.ir goes through `lng-opt -passes=<pass>`, the printed module has to match
+# <name>.out and has to be read back by lng-opt without an error. <name>.args, if there is one,
+# holds more arguments for that lng-opt run, such as an inline threshold. In opt/<analysis>/ for
+# one of ANALYSES the output of `lng-opt -print=<analysis>` has to match instead.
+# opt/invalid/<name>.ir has to be rejected with the message in <name>.out.
+#
+# programs/<name>.lng is run at every level with --interpret, with --run, as an executable built
+# with -emit=exe, as the -emit=ir file read back and interpreted, as the -emit=c source built with
+# `cc` and as the -emit=llvm module run by `lli` when those are installed. The module read back
+# from the -emit=ir file has to print like the one it was written from. Each run has to exit with
+# the code the first line names, `# exit: <code>`, and print what <name>.out holds, or nothing when
+# there is no such file. collatz.lng is sized so that the interpreter takes about a second at -O0.
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+LEVELS = ["0", "1", "2", "s"]
+ANALYSES = ["domtree", "postdomtree", "loops"]
+
+def runOpt(lngOpt: str, path: str, passes: list[str],
+           arguments: list[str] = []) -> subprocess.CompletedProcess:
+    command = [lngOpt, path] + arguments
+    if passes:
+        command.append("-passes=" + ",".join(passes))
+    return subprocess.run(command, capture_output=True, text=True, timeout=60)
+
+def checkOpt(lngOpt: str, path: str) -> str | None:
+    """Returns why the test at `path` failed, or None."""
+    passName = os.path.basename(os.path.dirname(path))
+    with open(path[:-len(".ir")] + ".out") as f:
+        expected = f.read()
+    if passName == "invalid":
+        result = runOpt(lngOpt, path, [])
+        if result.returncode == 0:
+            return "accepted"
+        if result.stderr != expected:
+            return f"expected `{expected.strip()}`, got `{result.stderr.strip()}`"
+        return None
+    if passName in ANALYSES:
+        result = subprocess.run([lngOpt, path, "-print=" + passName, "-q"], capture_output=True,
+                                text=True, timeout=60)
+        if result.returncode != 0:
+            return result.stderr.strip()
+        if result.stdout != expected:
+            return "output differs from " + os.path.basename(path)[:-len(".ir")] + ".out"
+        return None
+    arguments = []
+    if os.path.exists(path[:-len(".ir")] + ".args"):
+        with open(path[:-len(".ir")] + ".args") as f:
+            arguments = f.read().split()
+    result = runOpt(lngOpt, path, [passName], arguments)
+    if result.returncode != 0:
+        return result.stderr.strip()
+    if result.stdout != expected:
+        return "output differs from " + os.path.basename(path)[:-len(".ir")] + ".out"
+    with tempfile.NamedTemporaryFile("w", suffix=".ir") as output:
+        output.write(result.stdout)
+        output.flush()
+        reread = runOpt(lngOpt, output.name, [])
+        if reread.returncode != 0:
+            return "output does not read back: " + reread.stderr.strip()
+    return None
+
+# lng prints a stack trace to stdout when it exits, it is not part of the program's output.
+def stripTrace(output: str) -> str:
+    index = output.find("=== Stack trace ===")
+    return output if index < 0 else output[:index]
+
+def runProgram(lng: str, path: str, level: str, mode: str, directory: str) -> tuple[int, str]:
+    executable = os.path.join(directory, "a.out")
+    if mode == "exe":
+        result = subprocess.run([lng, path, "-O" + level, "-emit=exe", "-o", executable],
+                                capture_output=True, text=True, timeout=60)
+        if result.returncode != 0:
+            return (-1, stripTrace(result.stdout) + result.stderr)
+        result = subprocess.run([executable], capture_output=True, text=True, timeout=60)
+        return (result.returncode, result.stdout)
+    if mode == "ir":
+        module = os.path.join(directory, "out.lir")
+        result = subprocess.run([lng, path, "-O" + level, "-emit=ir", "-o", module],
+                                capture_output=True, text=True, timeout=60)
+        if result.returncode != 0:
+            return (-1, stripTrace(result.stdout) + result.stderr)
+        written = subprocess.run([lng, path, "-O" + level, "-dump-ir"], capture_output=True,
+                                 text=True, timeout=60)
+        read = subprocess.run([lng, module, "-O0", "-dump-ir"], capture_output=True, text=True,
+                              timeout=60)
+        if stripTrace(read.stdout) != stripTrace(written.stdout):
+            return (-1, "the module read back from -emit=ir differs")
+        result = subprocess.run([lng, module, "-O0", "--interpret"], capture_output=True,
+                                text=True, timeout=60)
+        return (result.returncode, stripTrace(result.stdout))
+    if mode == "c":
+        source = os.path.join(directory, "out.c")
+        result = subprocess.run([lng, path, "-O" + level, "-emit=c", "-o", source],
+                                capture_output=True, text=True, timeout=60)
+        if result.returncode != 0:
+            return (-1, stripTrace(result.stdout) + result.stderr)
+        result = subprocess.run(["cc", "-std=c11", source, "-o", executable], capture_output=True,
+                                text=True, timeout=60)
+        if result.returncode != 0:
+            return (-1, result.stderr)
+        result = subprocess.run([executable], capture_output=True, text=True, timeout=60)
+        return (result.returncode, result.stdout)
+    if mode == "llvm":
+        module = os.path.join(directory, "out.ll")
+        result = subprocess.run([lng, path, "-O" + level, "-emit=llvm", "-o", module],
+                                capture_output=True, text=True, timeout=60)
+        if result.returncode != 0:
+            return (-1, stripTrace(result.stdout) + result.stderr)
+        result = subprocess.run(["lli", module], capture_output=True, text=True, timeout=60)
+        return (result.returncode, result.stdout)
+    result = subprocess.run([lng, path, "-O" + level, "--" + mode], capture_output=True,
+                            text=True, timeout=60)
+    return (result.returncode, stripTrace(result.stdout))
+
+def checkProgram(lng: str, path: str, modes: list[str]) -> str | None:
+    """Returns why the program at `path` failed, or None."""
+    with open(path) as f:
+        header = f.readline()
+    if not header.startswith("# exit: "):
+        return "the first line does not name the exit code"
+    exitCode = int(header[len("# exit: "):])
+    expected = ""
+    if os.path.exists(path[:-len(".lng")] + ".out"):
+        with open(path[:-len(".lng")] + ".out") as f:
+            expected = f.read()
+    with tempfile.TemporaryDirectory() as directory:
+        for level in LEVELS:
+            for mode in modes:
+                returnCode, output = runProgram(lng, path, level, mode, directory)
+                if returnCode != exitCode:
+                    return f"-O{level} {mode} exited with {returnCode} instead of {exitCode}"
+                if output != expected:
+                    return f"-O{level} {mode} printed `{output.strip()}`"
+    return None
+
+def main():
+    directory = os.path.dirname(os.path.realpath(__file__))
+    binaries = sys.argv[1] if len(sys.argv) > 1 else os.path.join(directory, "..", "bin")
+    lng = os.path.join(binaries, "lng.elf")
+    lngOpt = os.path.join(binaries, "lng-opt.elf")
+    modes = ["interpret", "run", "exe", "ir"]
+    if shutil.which("cc"):
+        modes.append("c")
+    if shutil.which("lli"):
+        modes.append("llvm")
+    failed = 0
+    tests = sorted(glob.glob(os.path.join(directory, "opt", "*", "*.ir")))
+    tests += sorted(glob.glob(os.path.join(directory, "programs", "*.lng")))
+    for path in tests:
+        if path.endswith(".ir"):
+            error = checkOpt(lngOpt, path)
+        else:
+            error = checkProgram(lng, path, modes)
+        if error is not None:
+            print(f"FAIL {os.path.relpath(path, directory)}: {error}")
+            failed += 1
+    print(f"{len(tests) - failed} of {len(tests)} tests passed")
+    exit(1 if failed else 0)
+
+if __name__ == '__main__':
+    main()
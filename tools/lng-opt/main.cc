@@ -0,0 +1,152 @@
+#include <analysis.h>
+#include <clopts.h>
+#include <cstdio>
+#include <filesystem>
+#include <irfile.h>
+#include <irparser.h>
+#include <passmanager.h>
+#include <string>
+#include <threadpool.h>
+
+using namespace command_line_opts;
+
+// Runs passes on IR without the front end. The input is the text of `lng -dump-ir` or a file
+// written by `lng -emit=ir`. The passes given with -passes= run in order, -O adds the pipeline of
+// that level after them, -j sets the number of threads the function passes run on. The resulting
+// module is printed and the timing of every pass goes to stderr. -print= prints an analysis of
+// every function in front of the module, `domtree`, `postdomtree` or `loops`.
+std::string              inputFile;
+std::vector<std::string> passNames;
+std::string              analysisName;
+bool                     hasLevel;
+language::OptLevel       optLevel = language::OptLevel::O0;
+std::string              inlineThreshold;
+bool                     quiet;
+
+void addPasses(std::string names) {
+    size_t start = 0;
+    while (start <= names.size()) {
+        size_t end = names.find(',', start);
+        if (end == std::string::npos) {
+            end = names.size();
+        }
+        if (end != start) {
+            passNames.push_back(names.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+}
+void setOptLevel(std::string level) {
+    hasLevel = true;
+    if (level == "0") {
+        optLevel = language::OptLevel::O0;
+    } else if (level == "1") {
+        optLevel = language::OptLevel::O1;
+    } else if (level == "2") {
+        optLevel = language::OptLevel::O2;
+    } else if (level == "s") {
+        optLevel = language::OptLevel::Os;
+    } else {
+        std::fprintf(stderr, "Invalid optimization level `-O%s`\n", level.c_str());
+        std::exit(1);
+    }
+}
+void setThreadCount(std::string count) {
+    if (count.find_first_not_of("0123456789") != std::string::npos || std::stoull(count) == 0) {
+        std::fprintf(stderr, "Invalid thread count `-j%s`\n", count.c_str());
+        std::exit(1);
+    }
+    language::ThreadPool::setDefaultThreadCount(std::stoull(count));
+}
+void setInlineThreshold(std::string threshold) {
+    size_t digits = threshold.front() == '-' ? 1 : 0;
+    if (digits == threshold.size() ||
+        threshold.find_first_not_of("0123456789", digits) != std::string::npos) {
+        std::fprintf(stderr, "Invalid inline threshold `%s`\n", threshold.c_str());
+        std::exit(1);
+    }
+    inlineThreshold = threshold;
+}
+void setAnalysis(std::string name) {
+    if (name != "domtree" && name != "postdomtree" && name != "loops") {
+        std::fprintf(stderr, "Unknown analysis `%s`\n", name.c_str());
+        std::exit(1);
+    }
+    analysisName = name;
+}
+void printAnalysis(language::IrFunction* func) {
+    language::IrAnalysisCache analyses(func);
+    if (analysisName == "domtree") {
+        analyses.getDominatorTree()->print();
+    } else if (analysisName == "postdomtree") {
+        analyses.getPostDominatorTree()->print();
+    } else if (analysisName == "loops") {
+        analyses.getLoopInfo()->print();
+    }
+}
+int unknownArg(std::string path) {
+    if (path == "-q") {
+        quiet = true;
+        return 0;
+    }
+    if (std::filesystem::exists(path)) {
+        if (!inputFile.empty()) {
+            std::fprintf(stderr, "Cannot have multiple input files\n");
+            return 1;
+        }
+        inputFile = path;
+        return 0;
+    }
+    return 1;
+}
+clopts_opt_t clopts = {{{"-passes=", addPasses, false},
+                        {"-O", setOptLevel, false},
+                        {"-inline-threshold=", setInlineThreshold, false},
+                        {"-j", setThreadCount, false},
+                        {"-print=", setAnalysis, false}},
+                       unknownArg};
+
+int main(int argc, char** argv) {
+    clopts.parse(argc, argv);
+    if (inputFile.empty()) {
+        std::fprintf(stderr,
+                     "usage: lng-opt <file> [-passes=a,b,...] [-O<level>] [-j<threads>] "
+                     "[-print=<analysis>] [-q]\n");
+        return 1;
+    }
+    language::IrModule* module;
+    if (language::isIrFile(inputFile)) {
+        language::IrReader* reader = new language::IrReader(inputFile);
+        reader->materializeAll();
+        module = reader->getModule();
+    } else {
+        language::IrParser parser(clopts.handleFile(inputFile));
+        module = parser.getModule();
+    }
+    language::PassManager passManager(module);
+    for (std::string& name : passNames) {
+        if (!passManager.addPass(name)) {
+            std::fprintf(stderr, "Unknown pass `%s`\n", name.c_str());
+            return 1;
+        }
+    }
+    if (hasLevel) {
+        passManager.addPipeline(optLevel);
+    }
+    if (!inlineThreshold.empty()) {
+        passManager.setInlineThreshold(std::stoll(inlineThreshold));
+    }
+    passManager.run();
+    passManager.printTimings();
+    if (!analysisName.empty()) {
+        for (language::IrFunction* func : module->functions) {
+            if (!func->blocks.empty()) {
+                printAnalysis(func);
+            }
+        }
+    }
+    if (!quiet) {
+        module->print();
+    }
+    return 0;
+}